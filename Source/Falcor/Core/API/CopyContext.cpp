@@ -68,9 +68,9 @@ namespace Falcor
         }
     }
 
-    CopyContext::ReadTextureTask::SharedPtr CopyContext::asyncReadTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex)
+    CopyContext::ReadTextureTask::SharedPtr CopyContext::asyncReadTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex, const Buffer::SharedPtr& pStagingBuffer, bool flush)
     {
-        return CopyContext::ReadTextureTask::create(this, pTexture, subresourceIndex);
+        return CopyContext::ReadTextureTask::create(this, pTexture, subresourceIndex, pStagingBuffer, flush);
     }
 
     std::vector<uint8_t> CopyContext::readTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex)
@@ -43,11 +43,20 @@ namespace Falcor
         {
         public:
             using SharedPtr = std::shared_ptr<ReadTextureTask>;
-            static SharedPtr create(CopyContext* pCtx, const Texture* pTexture, uint32_t subresourceIndex);
+            static SharedPtr create(CopyContext* pCtx, const Texture* pTexture, uint32_t subresourceIndex, const Buffer::SharedPtr& pStagingBuffer = nullptr, bool flush = true);
             std::vector<uint8_t> getData();
+
+            /** Get the value of the context fence that is signaled once the copy has completed.
+            */
+            uint64_t getFenceValue() const { return mFenceValue; }
+
+            /** Get the staging buffer the texture is copied to. It can be passed to a later readback once this task has completed.
+            */
+            const Buffer::SharedPtr& getStagingBuffer() const { return mpBuffer; }
         private:
             ReadTextureTask() = default;
             GpuFence::SharedPtr mpFence;
+            uint64_t mFenceValue = 0;
             Buffer::SharedPtr mpBuffer;
             CopyContext* mpContext;
 #ifdef FALCOR_D3D12
@@ -126,8 +135,12 @@ namespace Falcor
         std::vector<uint8_t> readTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex);
 
         /** Read texture data Asynchronously
+            \param[in] pTexture The texture to read.
+            \param[in] subresourceIndex The subresource to read.
+            \param[in] pStagingBuffer Optional staging buffer to copy to. It is used if it is large enough, otherwise a new buffer is created.
+            \param[in] flush Flush the context to submit the copy. Otherwise the copy is submitted with the next flush of the context.
         */
-        ReadTextureTask::SharedPtr asyncReadTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex);
+        ReadTextureTask::SharedPtr asyncReadTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex, const Buffer::SharedPtr& pStagingBuffer = nullptr, bool flush = true);
 
         /** Get the low-level context data
         */
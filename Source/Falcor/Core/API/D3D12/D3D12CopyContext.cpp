@@ -142,7 +142,7 @@ namespace Falcor
         pBuffer->unmap();
     }
 
-    CopyContext::ReadTextureTask::SharedPtr CopyContext::ReadTextureTask::create(CopyContext* pCtx, const Texture* pTexture, uint32_t subresourceIndex)
+    CopyContext::ReadTextureTask::SharedPtr CopyContext::ReadTextureTask::create(CopyContext* pCtx, const Texture* pTexture, uint32_t subresourceIndex, const Buffer::SharedPtr& pStagingBuffer, bool flush)
     {
         SharedPtr pThis = SharedPtr(new ReadTextureTask);
         pThis->mpContext = pCtx;
@@ -154,19 +154,21 @@ namespace Falcor
         ID3D12Device* pDevice = gpDevice->getApiHandle();
         pDevice->GetCopyableFootprints(&texDesc, subresourceIndex, 1, 0, &footprint, &pThis->mRowCount, &rowSize, &size);
 
-        //Create buffer
-        pThis->mpBuffer = Buffer::create(size, Buffer::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+        //Create buffer, unless the staging buffer is large enough
+        if (pStagingBuffer && pStagingBuffer->getSize() >= size) pThis->mpBuffer = pStagingBuffer;
+        else pThis->mpBuffer = Buffer::create(size, Buffer::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
 
         //Copy from texture to buffer
         D3D12_TEXTURE_COPY_LOCATION srcLoc = { pTexture->getApiHandle(), D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX, subresourceIndex };
         D3D12_TEXTURE_COPY_LOCATION dstLoc = { pThis->mpBuffer->getApiHandle(), D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT, footprint };
         pCtx->resourceBarrier(pTexture, Resource::State::CopySource);
         pCtx->getLowLevelData()->getCommandList()->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
+        pCtx->setPendingCommands(true);
 
-        // Create a fence and signal
-        pThis->mpFence = GpuFence::create();
-        pCtx->flush(false);
-        pThis->mpFence->gpuSignal(pCtx->getLowLevelData()->getCommandQueue());
+        // Wait on the fence of the context, which the next flush signals with its current value. No fence is created per readback.
+        pThis->mpFence = pCtx->getLowLevelData()->getFence();
+        pThis->mFenceValue = pThis->mpFence->getCpuValue();
+        if (flush) pCtx->flush(false);
         pThis->mTextureFormat = pTexture->getFormat();
 
         return pThis;
@@ -174,7 +176,9 @@ namespace Falcor
 
     std::vector<uint8_t> CopyContext::ReadTextureTask::getData()
     {
-        mpFence->syncCpu();
+        // Submit the copy if the context hasn't been flushed since it was recorded.
+        if (mFenceValue >= mpFence->getCpuValue()) mpContext->flush(false);
+        mpFence->syncCpu(mFenceValue);
         D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint = mFootprint;
 
         //Get buffer data
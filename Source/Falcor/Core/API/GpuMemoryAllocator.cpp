@@ -0,0 +1,242 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "GpuMemoryAllocator.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        const size_t kMinBlockSize = 64 * 1024;     // Resource placement alignment in D3D12.
+        const size_t kDedicatedBlockFraction = 4;   // Allocations larger than a quarter of a page get a dedicated block.
+    }
+
+    GpuMemoryAllocator::GpuMemoryAllocator(size_t pageSize, const Callbacks& callbacks)
+        : mPageSize(pageSize)
+        , mCallbacks(callbacks)
+    {
+        assert(pageSize > 0);
+        assert(mCallbacks.createPage && mCallbacks.destroyPage);
+    }
+
+    size_t GpuMemoryAllocator::getBlockSize(size_t size)
+    {
+        // Round up to a quarter of the largest power of two below the size. Above 256KB, this wastes less than 25%.
+        size = std::max(size, kMinBlockSize);
+        size_t powerOfTwo = kMinBlockSize;
+        while (powerOfTwo <= size / 2) powerOfTwo <<= 1;
+        const size_t granularity = std::max(powerOfTwo / 4, kMinBlockSize);
+        return align_to(granularity, size);
+    }
+
+    GpuMemoryAllocator::Allocation GpuMemoryAllocator::allocate(size_t size, size_t alignment)
+    {
+        Allocation allocation;
+        allocation.size = size;
+
+        if (size > mPageSize / kDedicatedBlockFraction)
+        {
+            allocation.pageIndex = acquireBlock(getBlockSize(size));
+            allocation.offset = 0;
+        }
+        else
+        {
+            size_t offset = mActivePage != kInvalidPage ? align_to(alignment, mPages[mActivePage].currentOffset) : mPageSize;
+            if (offset + size > mPageSize)
+            {
+                activateNewPage();
+                offset = 0;
+            }
+            allocation.pageIndex = mActivePage;
+            allocation.offset = offset;
+            mPages[mActivePage].currentOffset = offset + size;
+        }
+
+        mPages[allocation.pageIndex].allocationCount++;
+        mStats.bytesInFlight += size;
+        mStats.peakBytesInFlight = std::max(mStats.peakBytesInFlight, mStats.bytesInFlight);
+        return allocation;
+    }
+
+    void GpuMemoryAllocator::release(const Allocation& allocation, uint64_t fenceValue)
+    {
+        assert(allocation.pageIndex < mPages.size() && mPages[allocation.pageIndex].allocationCount > 0);
+        mDeferredReleases.push({ fenceValue, allocation.pageIndex, allocation.size });
+    }
+
+    void GpuMemoryAllocator::executeDeferredReleases(uint64_t completedFenceValue)
+    {
+        while (mDeferredReleases.size() && mDeferredReleases.top().fenceValue <= completedFenceValue)
+        {
+            const DeferredRelease& release = mDeferredReleases.top();
+            const uint32_t pageIndex = release.pageIndex;
+            Page& page = mPages[pageIndex];
+            mStats.bytesInFlight -= release.size;
+            mDeferredReleases.pop();
+
+            assert(page.allocationCount > 0);
+            if (--page.allocationCount > 0) continue;
+
+            page.lastUsedFenceValue = completedFenceValue;
+            if (page.isBlock)
+            {
+                mAvailableBlocks[page.size].push_back(pageIndex);
+            }
+            else if (pageIndex == mActivePage)
+            {
+                page.currentOffset = 0;
+            }
+            else
+            {
+                mAvailablePages.push_back(pageIndex);
+            }
+        }
+
+        trimIdle(completedFenceValue);
+    }
+
+    void GpuMemoryAllocator::trim()
+    {
+        for (uint32_t pageIndex : mAvailablePages) destroyPage(pageIndex);
+        mStats.pagesTrimmed += mAvailablePages.size();
+        mAvailablePages.clear();
+
+        for (const auto& [blockSize, blocks] : mAvailableBlocks)
+        {
+            for (uint32_t pageIndex : blocks) destroyPage(pageIndex);
+            mStats.blocksTrimmed += blocks.size();
+        }
+        mAvailableBlocks.clear();
+    }
+
+    uint32_t GpuMemoryAllocator::createPage(size_t size, bool isBlock)
+    {
+        uint32_t pageIndex;
+        if (mFreePageIndices.size())
+        {
+            pageIndex = mFreePageIndices.back();
+            mFreePageIndices.pop_back();
+        }
+        else
+        {
+            pageIndex = (uint32_t)mPages.size();
+            mPages.push_back({});
+        }
+
+        mCallbacks.createPage(pageIndex, size);
+
+        Page& page = mPages[pageIndex];
+        page = {};
+        page.size = size;
+        page.isBlock = isBlock;
+
+        mStats.bytesReserved += size;
+        mStats.peakBytesReserved = std::max(mStats.peakBytesReserved, mStats.bytesReserved);
+        if (isBlock)
+        {
+            mStats.blockCount++;
+            mStats.blocksCreated++;
+        }
+        else
+        {
+            mStats.pageCount++;
+            mStats.pagesCreated++;
+        }
+        return pageIndex;
+    }
+
+    void GpuMemoryAllocator::destroyPage(uint32_t pageIndex)
+    {
+        Page& page = mPages[pageIndex];
+        assert(page.size > 0 && page.allocationCount == 0);
+        mCallbacks.destroyPage(pageIndex);
+
+        mStats.bytesReserved -= page.size;
+        if (page.isBlock) mStats.blockCount--;
+        else mStats.pageCount--;
+
+        page = {};
+        mFreePageIndices.push_back(pageIndex);
+    }
+
+    void GpuMemoryAllocator::activateNewPage()
+    {
+        // The previous active page stays in use until its allocations are retired.
+        if (mAvailablePages.size())
+        {
+            mActivePage = mAvailablePages.back();
+            mAvailablePages.pop_back();
+            mPages[mActivePage].currentOffset = 0;
+            mStats.pagesRecycled++;
+        }
+        else
+        {
+            mActivePage = createPage(mPageSize, false);
+        }
+    }
+
+    uint32_t GpuMemoryAllocator::acquireBlock(size_t blockSize)
+    {
+        if (auto it = mAvailableBlocks.find(blockSize); it != mAvailableBlocks.end())
+        {
+            auto& blocks = it->second;
+            assert(blocks.size());
+            uint32_t pageIndex = blocks.back();
+            blocks.pop_back();
+            if (blocks.empty()) mAvailableBlocks.erase(it);
+            mStats.blocksRecycled++;
+            return pageIndex;
+        }
+        return createPage(blockSize, true);
+    }
+
+    void GpuMemoryAllocator::trimIdle(uint64_t completedFenceValue)
+    {
+        // The available lists are ordered by the fence value at which they became unused, so only their fronts need to be checked.
+        auto isIdle = [&](uint32_t pageIndex) { return completedFenceValue - mPages[pageIndex].lastUsedFenceValue > mIdleTrimThreshold; };
+
+        while (mAvailablePages.size() && isIdle(mAvailablePages.front()))
+        {
+            destroyPage(mAvailablePages.front());
+            mAvailablePages.pop_front();
+            mStats.pagesTrimmed++;
+        }
+
+        for (auto it = mAvailableBlocks.begin(); it != mAvailableBlocks.end();)
+        {
+            auto& blocks = it->second;
+            while (blocks.size() && isIdle(blocks.front()))
+            {
+                destroyPage(blocks.front());
+                blocks.pop_front();
+                mStats.blocksTrimmed++;
+            }
+            it = blocks.empty() ? mAvailableBlocks.erase(it) : std::next(it);
+        }
+    }
+}
@@ -0,0 +1,163 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include <deque>
+#include <functional>
+#include <map>
+#include <queue>
+
+namespace Falcor
+{
+    /** API-independent sub-allocator used by GpuMemoryHeap.
+        It decides where allocations are placed and when backing memory is created, recycled and destroyed. The backing memory itself
+        is managed by the owner through callbacks, and GPU progress is passed in as fence values, so the allocator doesn't need a device.
+
+        Allocations of up to a quarter of the page size are placed linearly in the active page. A page is recycled once all its
+        allocations have been retired. Larger allocations get a dedicated block, with the size rounded up to one of four size classes
+        per power of two. Retired blocks are pooled by size class and reused for later allocations of the same class.
+        Pages and blocks that stay unused for more than a given number of fence values are destroyed.
+    */
+    class dlldecl GpuMemoryAllocator
+    {
+    public:
+        static const uint32_t kInvalidPage = uint32_t(-1);
+        static const uint64_t kDefaultIdleTrimThreshold = 300;
+
+        /** Callbacks for managing the backing memory.
+            Pages and blocks are identified by an index. Indices of destroyed pages are reused for new pages.
+        */
+        struct Callbacks
+        {
+            std::function<void(uint32_t pageIndex, size_t size)> createPage;    ///< Create backing memory of the given size.
+            std::function<void(uint32_t pageIndex)> destroyPage;                ///< Release the backing memory.
+        };
+
+        struct Allocation
+        {
+            uint32_t pageIndex = kInvalidPage;  ///< Page or block holding the allocation.
+            size_t offset = 0;                  ///< Offset in bytes within the page.
+            size_t size = 0;                    ///< Requested size in bytes.
+        };
+
+        struct Stats
+        {
+            uint64_t bytesInFlight = 0;         ///< Bytes allocated and not yet retired. This includes released allocations the GPU may still be using.
+            uint64_t peakBytesInFlight = 0;     ///< Maximum of bytesInFlight.
+            uint64_t bytesReserved = 0;         ///< Bytes of backing memory in pages and blocks.
+            uint64_t peakBytesReserved = 0;     ///< Maximum of bytesReserved.
+            uint32_t pageCount = 0;             ///< Current number of pages.
+            uint32_t blockCount = 0;            ///< Current number of dedicated blocks.
+            uint64_t pagesCreated = 0;
+            uint64_t pagesRecycled = 0;         ///< Number of times a page was reused instead of creating a new one.
+            uint64_t pagesTrimmed = 0;          ///< Number of pages destroyed after being unused.
+            uint64_t blocksCreated = 0;
+            uint64_t blocksRecycled = 0;        ///< Number of times a pooled block was reused instead of creating a new one.
+            uint64_t blocksTrimmed = 0;         ///< Number of blocks destroyed after being unused.
+        };
+
+        /** Constructor. No memory is created until the first allocation.
+            The owner is responsible for releasing the backing memory that remains when the allocator is destroyed.
+            \param[in] pageSize Page size in bytes.
+            \param[in] callbacks Callbacks for managing the backing memory.
+        */
+        GpuMemoryAllocator(size_t pageSize, const Callbacks& callbacks);
+
+        /** Allocate memory.
+            \param[in] size Size in bytes.
+            \param[in] alignment Alignment of the offset within the page. Dedicated blocks always start at offset 0.
+            \return The allocation.
+        */
+        Allocation allocate(size_t size, size_t alignment = 1);
+
+        /** Release an allocation. The memory is retired once the GPU has reached the fence value.
+            \param[in] allocation The allocation.
+            \param[in] fenceValue Fence value after which the GPU no longer uses the memory.
+        */
+        void release(const Allocation& allocation, uint64_t fenceValue);
+
+        /** Retire the released allocations the GPU is done with, and destroy pages and blocks that have been unused for too long.
+            \param[in] completedFenceValue The last fence value the GPU has reached.
+        */
+        void executeDeferredReleases(uint64_t completedFenceValue);
+
+        /** Destroy all unused pages and blocks.
+        */
+        void trim();
+
+        /** Set the number of fence values after which unused pages and blocks are destroyed.
+            Use std::numeric_limits<uint64_t>::max() to keep them indefinitely.
+        */
+        void setIdleTrimThreshold(uint64_t fenceValues) { mIdleTrimThreshold = fenceValues; }
+        uint64_t getIdleTrimThreshold() const { return mIdleTrimThreshold; }
+
+        size_t getPageSize() const { return mPageSize; }
+        const Stats& getStats() const { return mStats; }
+
+        /** Get the size of the dedicated block used for an allocation.
+            \param[in] size Size of the allocation in bytes.
+            \return The size rounded up to the next size class.
+        */
+        static size_t getBlockSize(size_t size);
+
+    private:
+        struct Page
+        {
+            size_t size = 0;                    ///< Size of the backing memory. Zero if the page index is unused.
+            size_t currentOffset = 0;           ///< Offset of the next allocation. Only used for regular pages.
+            uint32_t allocationCount = 0;       ///< Number of allocations that haven't been retired.
+            uint64_t lastUsedFenceValue = 0;    ///< Fence value at which the last allocation was retired.
+            bool isBlock = false;               ///< True for dedicated blocks.
+        };
+
+        struct DeferredRelease
+        {
+            uint64_t fenceValue;
+            uint32_t pageIndex;
+            size_t size;
+            bool operator<(const DeferredRelease& other) const { return fenceValue > other.fenceValue; }
+        };
+
+        uint32_t createPage(size_t size, bool isBlock);
+        void destroyPage(uint32_t pageIndex);
+        void activateNewPage();
+        uint32_t acquireBlock(size_t blockSize);
+        void trimIdle(uint64_t completedFenceValue);
+
+        size_t mPageSize;
+        Callbacks mCallbacks;
+        uint64_t mIdleTrimThreshold = kDefaultIdleTrimThreshold;
+
+        std::vector<Page> mPages;
+        std::vector<uint32_t> mFreePageIndices;
+        uint32_t mActivePage = kInvalidPage;
+        std::deque<uint32_t> mAvailablePages;                   ///< Unused pages, least recently used first.
+        std::map<size_t, std::deque<uint32_t>> mAvailableBlocks; ///< Unused blocks by size class, least recently used first.
+        std::priority_queue<DeferredRelease> mDeferredReleases;
+        Stats mStats;
+    };
+}
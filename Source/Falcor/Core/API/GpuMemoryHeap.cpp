@@ -31,17 +31,13 @@
 
 namespace Falcor
 {
-    GpuMemoryHeap::~GpuMemoryHeap()
-    {
-        mDeferredReleases = decltype(mDeferredReleases)();
-    }
+    GpuMemoryHeap::~GpuMemoryHeap() = default;
 
     GpuMemoryHeap::GpuMemoryHeap(Type type, size_t pageSize, const GpuFence::SharedPtr& pFence)
         : mType(type)
-        , mPageSize(pageSize)
         , mpFence(pFence)
+        , mAllocator(pageSize, { [this](uint32_t pageIndex, size_t size) { createPage(pageIndex, size); }, [this](uint32_t pageIndex) { mPages[pageIndex] = BaseData(); } })
     {
-        allocateNewPage();
     }
 
     GpuMemoryHeap::SharedPtr GpuMemoryHeap::create(Type type, size_t pageSize, const GpuFence::SharedPtr& pFence)
@@ -49,56 +45,23 @@ namespace Falcor
         return SharedPtr(new GpuMemoryHeap(type, pageSize, pFence));
     }
 
-    void GpuMemoryHeap::allocateNewPage()
+    void GpuMemoryHeap::createPage(uint32_t pageIndex, size_t size)
     {
-        if (mpActivePage)
-        {
-            mUsedPages[mCurrentPageId] = std::move(mpActivePage);
-        }
-
-        if (mAvailablePages.size())
-        {
-            mpActivePage = std::move(mAvailablePages.front());
-            mAvailablePages.pop();
-            mpActivePage->allocationsCount = 0;
-            mpActivePage->currentOffset = 0;
-        }
-        else
-        {
-            mpActivePage = std::make_unique<PageData>();
-            initBasePageData((*mpActivePage), mPageSize);
-        }
-
-        mpActivePage->currentOffset = 0;
-        mCurrentPageId++;
+        if (pageIndex >= mPages.size()) mPages.resize(pageIndex + 1);
+        initBasePageData(mPages[pageIndex], size);
     }
 
     GpuMemoryHeap::Allocation GpuMemoryHeap::allocate(size_t size, size_t alignment)
     {
-        Allocation data;
-        if (size > mPageSize)
-        {
-            data.pageID = GpuMemoryHeap::Allocation::kMegaPageId;
-            initBasePageData(data, size);
-        }
-        else
-        {
-            // Calculate the start
-            size_t currentOffset = align_to(alignment, mpActivePage->currentOffset);
-            if (currentOffset + size > mPageSize)
-            {
-                currentOffset = 0;
-                allocateNewPage();
-            }
-
-            data.pageID = mCurrentPageId;
-            data.offset = currentOffset;
-            data.pData = mpActivePage->pData + currentOffset;
-            data.pResourceHandle = mpActivePage->pResourceHandle;
-            mpActivePage->currentOffset = currentOffset + size;
-            mpActivePage->allocationsCount++;
-        }
+        GpuMemoryAllocator::Allocation allocation = mAllocator.allocate(size, alignment);
+        const BaseData& page = mPages[allocation.pageIndex];
 
+        Allocation data;
+        data.pResourceHandle = page.pResourceHandle;
+        data.offset = allocation.offset;
+        data.pData = page.pData + allocation.offset;
+        data.pageID = allocation.pageIndex;
+        data.size = size;
         data.fenceValue = mpFence->getCpuValue();
         return data;
     }
@@ -106,38 +69,17 @@ namespace Falcor
     void GpuMemoryHeap::release(Allocation& data)
     {
         assert(data.pResourceHandle);
-        mDeferredReleases.push(data);
+
+        // The allocation may have been used by all work recorded since it was allocated.
+        GpuMemoryAllocator::Allocation allocation;
+        allocation.pageIndex = (uint32_t)data.pageID;
+        allocation.offset = (size_t)data.offset;
+        allocation.size = data.size;
+        mAllocator.release(allocation, std::max(data.fenceValue, mpFence->getCpuValue()));
     }
 
     void GpuMemoryHeap::executeDeferredReleases()
     {
-        uint64_t gpuVal = mpFence->getGpuValue();
-        while (mDeferredReleases.size() && mDeferredReleases.top().fenceValue <= gpuVal)
-        {
-            const Allocation& data = mDeferredReleases.top();
-            if (data.pageID == mCurrentPageId)
-            {
-                mpActivePage->allocationsCount--;
-                if (mpActivePage->allocationsCount == 0)
-                {
-                    mpActivePage->currentOffset = 0;
-                }
-            }
-            else
-            {
-                if (data.pageID != Allocation::kMegaPageId)
-                {
-                    auto& pData = mUsedPages[data.pageID];
-                    pData->allocationsCount--;
-                    if (pData->allocationsCount == 0)
-                    {
-                        mAvailablePages.push(std::move(pData));
-                        mUsedPages.erase(data.pageID);
-                    }
-                }
-                // else it's a mega-page. Popping it will release the resource
-            }
-            mDeferredReleases.pop();
-        }
+        mAllocator.executeDeferredReleases(mpFence->getGpuValue());
     }
 }
@@ -26,8 +26,8 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #pragma once
-#include <queue>
 #include "Core/API/GpuFence.h"
+#include "Core/API/GpuMemoryAllocator.h"
 
 namespace Falcor
 {   
@@ -55,11 +55,11 @@ namespace Falcor
         {
             uint64_t pageID = 0;
             uint64_t fenceValue = 0;
-
-            static const uint64_t kMegaPageId = -1;
-            bool operator<(const Allocation& other)  const { return fenceValue > other.fenceValue; }
+            size_t size = 0;
         };
 
+        using Stats = GpuMemoryAllocator::Stats;
+
         ~GpuMemoryHeap();
 
         /** Create a new GPU memory heap.
@@ -70,33 +70,44 @@ namespace Falcor
         */
         static SharedPtr create(Type type, size_t pageSize, const GpuFence::SharedPtr& pFence);
 
+        /** Allocate memory. Allocations larger than a quarter of the page size get a dedicated block, which is pooled for reuse after release.
+            \param[in] size Size in bytes.
+            \param[in] alignment Alignment of the offset in bytes.
+            \return The allocation.
+        */
         Allocation allocate(size_t size, size_t alignment = 1);
+
+        /** Release an allocation. The memory is reused once the GPU has finished the work submitted so far.
+        */
         void release(Allocation& data);
-        size_t getPageSize() const { return mPageSize; }
+
+        size_t getPageSize() const { return mAllocator.getPageSize(); }
+
+        /** Retire released allocations the GPU is done with, and destroy pages and blocks that have been unused for longer than the idle trim threshold.
+        */
         void executeDeferredReleases();
 
-    private:
-        GpuMemoryHeap(Type type, size_t pageSize, const GpuFence::SharedPtr& pFence);
+        /** Destroy all unused pages and blocks.
+        */
+        void trim() { mAllocator.trim(); }
 
-        struct PageData : public BaseData
-        {
-            uint32_t allocationsCount = 0;
-            size_t currentOffset = 0;
+        /** Set the number of fence values after which unused pages and blocks are destroyed.
+        */
+        void setIdleTrimThreshold(uint64_t fenceValues) { mAllocator.setIdleTrimThreshold(fenceValues); }
 
-            using UniquePtr = std::unique_ptr<PageData>;
-        };
+        /** Get the memory usage counters.
+        */
+        const Stats& getStats() const { return mAllocator.getStats(); }
+
+    private:
+        GpuMemoryHeap(Type type, size_t pageSize, const GpuFence::SharedPtr& pFence);
 
         Type mType;
         GpuFence::SharedPtr mpFence;
-        size_t mPageSize = 0;
-        size_t mCurrentPageId = 0;
-        PageData::UniquePtr mpActivePage;
-
-        std::priority_queue<Allocation> mDeferredReleases;
-        std::unordered_map<size_t, PageData::UniquePtr> mUsedPages;
-        std::queue<PageData::UniquePtr> mAvailablePages;
+        std::vector<BaseData> mPages;       ///< Backing memory by page index. Declared before the allocator, which refers to it.
+        GpuMemoryAllocator mAllocator;
 
-        void allocateNewPage();
+        void createPage(uint32_t pageIndex, size_t size);
         void initBasePageData(BaseData& data, size_t size);
     };
 }
@@ -0,0 +1,149 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "ReadbackQueue.h"
+
+namespace Falcor
+{
+    ReadbackQueue::SharedPtr ReadbackQueue::create(const std::shared_ptr<Fence>& pFence, uint64_t maxBytesInFlight)
+    {
+        assert(pFence);
+        return SharedPtr(new ReadbackQueue(pFence, maxBytesInFlight));
+    }
+
+    ReadbackQueue::ReadbackQueue(const std::shared_ptr<Fence>& pFence, uint64_t maxBytesInFlight)
+        : mpFence(pFence)
+        , mMaxBytesInFlight(maxBytesInFlight)
+    {
+    }
+
+    ReadbackQueue::~ReadbackQueue()
+    {
+        try
+        {
+            flush();
+        }
+        catch (const std::exception& e)
+        {
+            logError("Readback failed: " + std::string(e.what()));
+        }
+    }
+
+    void ReadbackQueue::submit(uint64_t fenceValue, uint64_t size, std::function<void()> process, std::function<void()> retire)
+    {
+        assert(mJobs.empty() || fenceValue >= mJobs.back().fenceValue);
+
+        update();
+
+        // Wait for the oldest readbacks until the new one fits into the budget. A readback larger than the budget waits for all others.
+        if (!mJobs.empty() && mStats.bytesInFlight + size > mMaxBytesInFlight)
+        {
+            mStats.stallCount++;
+            while (!mJobs.empty() && mStats.bytesInFlight + size > mMaxBytesInFlight) retireOldest();
+        }
+
+        Job job;
+        job.fenceValue = fenceValue;
+        job.size = size;
+        job.process = std::move(process);
+        job.retire = std::move(retire);
+        mJobs.push_back(std::move(job));
+
+        mStats.submitCount++;
+        mStats.bytesInFlight += size;
+        mStats.peakBytesInFlight = std::max(mStats.peakBytesInFlight, mStats.bytesInFlight);
+
+        dispatchCompleted();
+    }
+
+    uint32_t ReadbackQueue::update()
+    {
+        dispatchCompleted();
+        return retireFinished();
+    }
+
+    void ReadbackQueue::flush()
+    {
+        while (!mJobs.empty()) retireOldest();
+    }
+
+    void ReadbackQueue::dispatchCompleted()
+    {
+        uint64_t completedValue = mpFence->getCompletedValue();
+        for (auto& job : mJobs)
+        {
+            if (job.fenceValue > completedValue) break;
+            if (job.started) continue;
+
+            // The worker only references the process function, so it is destroyed on this thread when the job is retired.
+            const std::function<void()>* pProcess = &job.process;
+            job.started = true;
+            job.task = Threading::dispatchTask([pProcess]() { (*pProcess)(); });
+        }
+    }
+
+    uint32_t ReadbackQueue::retireFinished()
+    {
+        uint32_t retiredCount = 0;
+        while (!mJobs.empty() && mJobs.front().started && !mJobs.front().task.isRunning())
+        {
+            Job job = std::move(mJobs.front());
+            mJobs.pop_front();
+
+            mStats.bytesInFlight -= job.size;
+            mStats.retireCount++;
+            retiredCount++;
+
+            if (job.retire) job.retire();
+
+            // Rethrows exceptions from the process function.
+            job.task.finish();
+        }
+        return retiredCount;
+    }
+
+    void ReadbackQueue::retireOldest()
+    {
+        assert(!mJobs.empty());
+        if (!mJobs.front().started)
+        {
+            mpFence->wait(mJobs.front().fenceValue);
+            dispatchCompleted();
+        }
+
+        // Exceptions are rethrown when the job is retired.
+        try
+        {
+            mJobs.front().task.finish();
+        }
+        catch (...)
+        {
+        }
+        retireFinished();
+    }
+}
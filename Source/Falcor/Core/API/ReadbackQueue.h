@@ -0,0 +1,137 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Utils/Threading.h"
+#include <deque>
+
+namespace Falcor
+{
+    /** Queue of asynchronous GPU-to-CPU readbacks.
+
+        The caller records a copy into staging memory, submits the command list and then submits the readback with
+        the fence value signaled after the copy. Readbacks are retired in submission order: once the fence has reached
+        the value of a readback, its process function is dispatched to the thread pool, where it reads the staging
+        memory and consumes the data (e.g. encodes an image). The caller never waits for the GPU, except when the
+        memory budget is exceeded.
+
+        The memory held by a readback (its staging memory and any data produced while processing) is accounted from
+        submission until processing has finished. Submitting a readback that would exceed the budget first waits for
+        the oldest readbacks to retire.
+
+        The fence is abstracted, so the queue can be driven by a CPU-only fake in tests. The queue itself is not thread
+        safe and must be used from a single thread, typically the render thread. Process functions run on worker
+        threads, but they are destroyed on the thread that calls update() or flush(), so they may hold references to
+        GPU resources.
+    */
+    class dlldecl ReadbackQueue
+    {
+    public:
+        using SharedPtr = std::shared_ptr<ReadbackQueue>;
+
+        static const uint64_t kDefaultMaxBytesInFlight = 1024ull * 1024 * 1024;
+
+        /** Fence signaled by the GPU when copies complete.
+        */
+        class Fence
+        {
+        public:
+            virtual ~Fence() = default;
+
+            /** Get the last value the fence has reached.
+            */
+            virtual uint64_t getCompletedValue() const = 0;
+
+            /** Block until the fence reaches a value.
+            */
+            virtual void wait(uint64_t value) = 0;
+        };
+
+        struct Stats
+        {
+            uint64_t submitCount = 0;           ///< Number of submitted readbacks.
+            uint64_t retireCount = 0;           ///< Number of readbacks that finished processing.
+            uint64_t stallCount = 0;            ///< Number of submissions that had to wait for older readbacks because of the memory budget.
+            uint64_t bytesInFlight = 0;         ///< Memory held by readbacks that haven't finished processing.
+            uint64_t peakBytesInFlight = 0;     ///< Maximum of bytesInFlight.
+        };
+
+        /** Create a queue.
+            \param[in] pFence The fence signaled after the copies.
+            \param[in] maxBytesInFlight Memory budget for readbacks in flight.
+        */
+        static SharedPtr create(const std::shared_ptr<Fence>& pFence, uint64_t maxBytesInFlight = kDefaultMaxBytesInFlight);
+
+        ~ReadbackQueue();
+
+        /** Submit a readback. Fence values must be submitted in non-decreasing order.
+            \param[in] fenceValue The fence value signaled once the copy to staging memory has completed.
+            \param[in] size Memory held by the readback in bytes.
+            \param[in] process Function called on a worker thread once the fence has reached fenceValue.
+            \param[in] retire Optional function called on the queue's thread after processing has finished, e.g. to recycle the staging memory.
+        */
+        void submit(uint64_t fenceValue, uint64_t size, std::function<void()> process, std::function<void()> retire = {});
+
+        /** Dispatch the readbacks whose copy has completed and retire those that finished processing. Doesn't block.
+            \return The number of readbacks retired.
+        */
+        uint32_t update();
+
+        /** Wait until all submitted readbacks have been processed and retired.
+        */
+        void flush();
+
+        /** Get the number of readbacks that haven't been retired yet.
+        */
+        uint32_t getPendingCount() const { return (uint32_t)mJobs.size(); }
+
+        uint64_t getMaxBytesInFlight() const { return mMaxBytesInFlight; }
+        const Stats& getStats() const { return mStats; }
+
+    private:
+        ReadbackQueue(const std::shared_ptr<Fence>& pFence, uint64_t maxBytesInFlight);
+
+        struct Job
+        {
+            uint64_t fenceValue;
+            uint64_t size;
+            std::function<void()> process;
+            std::function<void()> retire;
+            Threading::Task task;
+            bool started = false;
+        };
+
+        void dispatchCompleted();
+        uint32_t retireFinished();
+        void retireOldest();
+
+        std::shared_ptr<Fence> mpFence;
+        uint64_t mMaxBytesInFlight;
+        std::deque<Job> mJobs;  ///< Readbacks in submission order. Elements are only added at the back and removed at the front, so references to them stay valid.
+        Stats mStats;
+    };
+}
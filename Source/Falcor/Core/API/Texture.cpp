@@ -29,6 +29,7 @@
 #include "Texture.h"
 #include "Device.h"
 #include "RenderContext.h"
+#include "ReadbackQueue.h"
 #include "Utils/Threading.h"
 
 namespace Falcor
@@ -54,6 +55,69 @@ namespace Falcor
 
             return flags;
         }
+
+        /** Fence of the render context. Every flush signals it, so it is reached once all previously submitted copies have completed.
+            Captures don't flush the context, their copies are submitted with the next flush. Waiting for a value that hasn't been submitted yet flushes the context first.
+        */
+        class ContextFence : public ReadbackQueue::Fence
+        {
+        public:
+            ContextFence(CopyContext* pContext) : mpContext(pContext), mpFence(pContext->getLowLevelData()->getFence()) {}
+            uint64_t getCompletedValue() const override { return mpFence->getGpuValue(); }
+            void wait(uint64_t value) override
+            {
+                if (value >= mpFence->getCpuValue()) mpContext->flush(false);
+                mpFence->syncCpu(value);
+            }
+
+        private:
+            CopyContext* mpContext;
+            GpuFence::SharedPtr mpFence;
+        };
+
+        const size_t kMaxFreeStagingBuffers = 8;
+        const uint64_t kMaxFreeStagingBytes = 256ull << 20;    ///< Limit for the total size of the free staging buffers, about two 4K RGBA32F images.
+
+        ReadbackQueue::SharedPtr spCaptureQueue;
+        std::vector<Buffer::SharedPtr> sFreeStagingBuffers;     ///< Staging buffers of retired captures, reused by later captures.
+        uint64_t sFreeStagingBytes = 0;                         ///< Total size of the free staging buffers.
+
+        ReadbackQueue& getCaptureQueue(RenderContext* pContext)
+        {
+            if (!spCaptureQueue) spCaptureQueue = ReadbackQueue::create(std::make_shared<ContextFence>(pContext));
+            return *spCaptureQueue;
+        }
+
+        Buffer::SharedPtr takeStagingBuffer()
+        {
+            if (sFreeStagingBuffers.empty()) return nullptr;
+            auto it = std::max_element(sFreeStagingBuffers.begin(), sFreeStagingBuffers.end(), [](const Buffer::SharedPtr& a, const Buffer::SharedPtr& b) { return a->getSize() < b->getSize(); });
+            Buffer::SharedPtr pBuffer = *it;
+            sFreeStagingBuffers.erase(it);
+            sFreeStagingBytes -= pBuffer->getSize();
+            return pBuffer;
+        }
+
+        void recycleStagingBuffer(const Buffer::SharedPtr& pBuffer)
+        {
+            sFreeStagingBuffers.push_back(pBuffer);
+            sFreeStagingBytes += pBuffer->getSize();
+
+            // Over the count limit, drop the smallest buffer. Over the size limit, drop the largest ones.
+            auto bySize = [](const Buffer::SharedPtr& a, const Buffer::SharedPtr& b) { return a->getSize() < b->getSize(); };
+            if (sFreeStagingBuffers.size() > kMaxFreeStagingBuffers)
+            {
+                auto it = std::min_element(sFreeStagingBuffers.begin(), sFreeStagingBuffers.end(), bySize);
+                sFreeStagingBytes -= (*it)->getSize();
+                sFreeStagingBuffers.erase(it);
+            }
+            while (sFreeStagingBytes > kMaxFreeStagingBytes)
+            {
+                auto it = std::max_element(sFreeStagingBuffers.begin(), sFreeStagingBuffers.end(), bySize);
+                sFreeStagingBytes -= (*it)->getSize();
+                sFreeStagingBuffers.erase(it);
+            }
+        }
     }
 
     Texture::SharedPtr Texture::createFromApiHandle(ApiHandle handle, Type type, uint32_t width, uint32_t height, uint32_t depth, ResourceFormat format, uint32_t sampleCount, uint32_t arraySize, uint32_t mipLevels, State initState, BindFlags bindFlags)
@@ -253,30 +317,54 @@ namespace Falcor
         // Handle the special case where we have an HDR texture with less then 3 channels
         FormatType type = getFormatType(mFormat);
         uint32_t channels = getFormatChannelCount(mFormat);
-        std::vector<uint8_t> textureData;
         ResourceFormat resourceFormat = mFormat;
+        const Texture* pSource = this;
+        uint32_t subresource = getSubresourceIndex(arraySlice, mipLevel);
+        Texture::SharedPtr pOther;
 
         if (type == FormatType::Float && channels < 3)
         {
-            Texture::SharedPtr pOther = Texture::create2D(getWidth(mipLevel), getHeight(mipLevel), ResourceFormat::RGBA32Float, 1, 1, nullptr, ResourceBindFlags::RenderTarget | ResourceBindFlags::ShaderResource);
+            pOther = Texture::create2D(getWidth(mipLevel), getHeight(mipLevel), ResourceFormat::RGBA32Float, 1, 1, nullptr, ResourceBindFlags::RenderTarget | ResourceBindFlags::ShaderResource);
             pContext->blit(getSRV(mipLevel, 1, arraySlice, 1), pOther->getRTV(0, 0, 1));
-            textureData = pContext->readTextureSubresource(pOther.get(), 0);
             resourceFormat = ResourceFormat::RGBA32Float;
+            pSource = pOther.get();
+            subresource = 0;
         }
-        else
-        {
-            uint32_t subresource = getSubresourceIndex(arraySlice, mipLevel);
-            textureData = pContext->readTextureSubresource(this, subresource);
-        }
+
+        // Record the copy to a staging buffer. It is submitted with the next flush of the context, which signals the context fence.
+        ReadbackQueue& queue = getCaptureQueue(pContext);
+        auto pTask = pContext->asyncReadTextureSubresource(pSource, subresource, takeStagingBuffer(), false);
+        uint64_t fenceValue = pTask->getFenceValue();
+
+        // The staging buffer and the CPU copy of the data are alive until the image is written.
+        uint64_t size = 2 * pTask->getStagingBuffer()->getSize();
 
         uint32_t width = getWidth(mipLevel);
         uint32_t height = getHeight(mipLevel);
-        auto func = [=]()
+        auto process = [=]()
         {
+            std::vector<uint8_t> textureData = pTask->getData();
             Bitmap::saveImage(filename, width, height, format, exportFlags, resourceFormat, true, (void*)textureData.data());
         };
+        auto retire = [pTask]()
+        {
+            recycleStagingBuffer(pTask->getStagingBuffer());
+        };
+
+        queue.submit(fenceValue, size, process, retire);
+    }
 
-        Threading::dispatchTask(func);
+    void Texture::retireCaptures()
+    {
+        if (spCaptureQueue) spCaptureQueue->update();
+    }
+
+    void Texture::flushCaptures()
+    {
+        if (spCaptureQueue) spCaptureQueue->flush();
+        spCaptureQueue = nullptr;
+        sFreeStagingBuffers.clear();
+        sFreeStagingBytes = 0;
     }
 
     void Texture::uploadInitData(const void* pData, bool autoGenMips)
@@ -172,6 +172,37 @@ namespace Falcor
         */
         static SharedPtr createFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, BindFlags bindFlags = BindFlags::ShaderResource);
 
+        /** Image data decoded from a file, ready to be uploaded with createFromImageData().
+        */
+        struct ImageData
+        {
+            Type type = Type::Texture2D;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t depth = 1;
+            uint32_t arraySize = 1;
+            uint32_t mipLevels = 1;             ///< Number of mip levels to create. Can be kMaxPossible, in which case the data only contains the top level.
+            ResourceFormat format = ResourceFormat::Unknown;
+            std::vector<uint8_t> data;          ///< Texel data in the layout expected by the texture create functions.
+            std::string sourceFilename;         ///< Full path of the file the data was loaded from.
+        };
+
+        /** Decode an image file without creating a texture.
+            This function doesn't access the device and is safe to call from worker threads.
+            \param[in] filename Filename of the image. Can also include a full path or relative path from a data directory.
+            \param[in] generateMipLevels Whether the mip-chain should be generated when the texture is created.
+            \param[in] loadAsSrgb Load the texture using sRGB format. Only valid for 3 or 4 component textures.
+            \return The decoded image, or nullptr if the file failed to load.
+        */
+        static std::shared_ptr<ImageData> loadImageDataFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb);
+
+        /** Create a new texture object from decoded image data.
+            \param[in] image Image data returned by loadImageDataFromFile().
+            \param[in] bindFlags The bind flags to create the texture with.
+            \return A new texture, or nullptr if the texture failed to be created.
+        */
+        static SharedPtr createFromImageData(const ImageData& image, BindFlags bindFlags = BindFlags::ShaderResource);
+
         /** Get a shader-resource view for the entire resource
         */
         virtual ShaderResourceView::SharedPtr getSRV() override;
@@ -210,6 +241,9 @@ namespace Falcor
         UnorderedAccessView::SharedPtr getUAV(uint32_t mipLevel, uint32_t firstArraySlice = 0, uint32_t arraySize = kMaxPossible);
 
         /** Capture the texture to an image file.
+            The capture is asynchronous. The texture is copied to a staging buffer, which is read back and encoded on a worker
+            thread once the GPU has completed the copy. The copy is submitted with the next flush of the render context.
+            Call flushCaptures() to wait for the file to be written.
             \param[in] mipLevel Requested mip-level
             \param[in] arraySlice Requested array-slice
             \param[in] filename Name of the file to save.
@@ -218,6 +252,14 @@ namespace Falcor
         */
         void captureToFile(uint32_t mipLevel, uint32_t arraySlice, const std::string& filename, Bitmap::FileFormat format = Bitmap::FileFormat::PngFile, Bitmap::ExportFlags exportFlags = Bitmap::ExportFlags::None);
 
+        /** Start encoding pending captures whose copy has completed and release the finished ones. Doesn't block. Called once per frame by the framework.
+        */
+        static void retireCaptures();
+
+        /** Wait until all pending captures have been written and release the staging buffers.
+        */
+        static void flushCaptures();
+
         /** Generates mipmaps for a specified texture object.
         */
         void generateMips(RenderContext* pContext);
@@ -592,77 +592,93 @@ namespace Falcor
         return format;
     }
 
-    Texture::SharedPtr createTextureFromDx10Dds(DdsData& ddsData, const std::string& filename, ResourceFormat format, uint32_t mipLevels, Texture::BindFlags bindFlags)
+    bool fillImageFromDx10Dds(DdsData& ddsData, ResourceFormat format, uint32_t mipLevels, Texture::ImageData& image)
     {
         format = convertBgrxFormatToBgra(ddsData, format);
 
         uint32_t arraySize = ddsData.dx10Header.arraySize;
         assert(arraySize > 0);
 
+        image.width = ddsData.header.width;
+        image.height = ddsData.header.height;
+        image.format = format;
+        image.mipLevels = mipLevels;
+        image.arraySize = arraySize;
+
         switch(ddsData.dx10Header.resourceDimension)
         {
         case DXResourceDimension::RESOURCE_DIMENSION_TEXTURE1D:
-            return Texture::create1D(ddsData.header.width, format, arraySize, mipLevels, ddsData.data.data(), bindFlags);
+            image.type = Resource::Type::Texture1D;
+            image.height = 1;
+            return true;
         case DXResourceDimension::RESOURCE_DIMENSION_TEXTURE2D:
             if(ddsData.dx10Header.miscFlag & DdsHeaderDX10::kCubeMapMask)
             {
                 flipData(ddsData, format, ddsData.header.width, ddsData.header.height, 6 * arraySize, mipLevels == Texture::kMaxPossible ? 1 : mipLevels, true);
-                return Texture::createCube(ddsData.header.width, ddsData.header.height, format, arraySize, mipLevels, ddsData.data.data(), bindFlags);
+                image.type = Resource::Type::TextureCube;
             }
             else
             {
                 flipData(ddsData, format, ddsData.header.width, ddsData.header.height, arraySize, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-                return Texture::create2D(ddsData.header.width, ddsData.header.height, format, arraySize, mipLevels, ddsData.data.data(), bindFlags);
+                image.type = Resource::Type::Texture2D;
             }
+            return true;
         case DXResourceDimension::RESOURCE_DIMENSION_TEXTURE3D:
             flipData(ddsData, format, ddsData.header.width, ddsData.header.height, ddsData.header.depth, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-            return Texture::create3D(ddsData.header.width, ddsData.header.height, ddsData.header.depth, format, mipLevels, ddsData.data.data(), bindFlags);
+            image.type = Resource::Type::Texture3D;
+            image.depth = ddsData.header.depth;
+            image.arraySize = 1;
+            return true;
         case DXResourceDimension::RESOURCE_DIMENSION_BUFFER:
         case DXResourceDimension::RESOURCE_DIMENSION_UNKNOWN:
-            logError("The resource dimension specified in " + filename + " is not supported by Falcor");
-            return nullptr;
+            logError("The resource dimension specified in " + image.sourceFilename + " is not supported by Falcor");
+            return false;
         default:
-            logError("Unknown resource dimension specified in " + filename);
-            return nullptr;
+            logError("Unknown resource dimension specified in " + image.sourceFilename);
+            return false;
         }
     }
 
-    Texture::SharedPtr createTextureFromLegacyDds(DdsData& ddsData, const std::string& filename, ResourceFormat format, uint32_t mipLevels, Texture::BindFlags bindFlags)
+    bool fillImageFromLegacyDds(DdsData& ddsData, ResourceFormat format, uint32_t mipLevels, Texture::ImageData& image)
     {
         format = convertBgrxFormatToBgra(ddsData, format);
 
+        image.width = ddsData.header.width;
+        image.height = ddsData.header.height;
+        image.format = format;
+        image.mipLevels = mipLevels;
+
         // Load the volume or 3D texture
         if(ddsData.header.flags & DdsHeader::kDepthMask)
         {
             flipData(ddsData, format, ddsData.header.width, ddsData.header.height, ddsData.header.depth, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-            return Texture::create3D(ddsData.header.width, ddsData.header.height, ddsData.header.depth, format, mipLevels, ddsData.data.data(), bindFlags);
+            image.type = Resource::Type::Texture3D;
+            image.depth = ddsData.header.depth;
         }
         // Load the cubemap texture
         else if(ddsData.header.caps[1] & DdsHeader::kCaps2CubeMapMask)
         {
-            return Texture::createCube(ddsData.header.width, ddsData.header.height, format, 1, mipLevels, ddsData.data.data(), bindFlags);
+            image.type = Resource::Type::TextureCube;
         }
         // This is a 2D Texture
         else
         {
             flipData(ddsData, format, ddsData.header.width, ddsData.header.height, 1, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-            return Texture::create2D(ddsData.header.width, ddsData.header.height, format, 1, mipLevels, ddsData.data.data(), bindFlags);
+            image.type = Resource::Type::Texture2D;
         }
-
-        should_not_get_here();
-        return nullptr;
+        return true;
     }
 
-    Texture::SharedPtr createTextureFromDDSFile(const std::string filename, bool generateMips, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    bool loadImageFromDDSFile(bool generateMips, bool loadAsSrgb, Texture::ImageData& image)
     {
         DdsData ddsData;
-        if (!loadDDSDataFromFile(filename, ddsData)) return nullptr;
+        if (!loadDDSDataFromFile(image.sourceFilename, ddsData)) return false;
 
         ResourceFormat format = getDdsResourceFormat(ddsData);
         if (format == ResourceFormat::Unknown)
         {
-            logError("Unknown resource format in DDS file " + filename);
-            return nullptr;
+            logError("Unknown resource format in DDS file " + image.sourceFilename);
+            return false;
         }
 
         if (loadAsSrgb)
@@ -680,50 +696,76 @@ namespace Falcor
             mipLevels = Texture::kMaxPossible;
         }
 
-        if (ddsData.hasDX10Header)
-        {
-            return createTextureFromDx10Dds(ddsData, filename, format, mipLevels, bindFlags);
-        }
-        else
-        {
-            return createTextureFromLegacyDds(ddsData, filename, format, mipLevels, bindFlags);
-        }
+        bool result = ddsData.hasDX10Header ? fillImageFromDx10Dds(ddsData, format, mipLevels, image) : fillImageFromLegacyDds(ddsData, format, mipLevels, image);
+        image.data = std::move(ddsData.data);
+        return result;
     }
 
-    Texture::SharedPtr Texture::createFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    bool loadImageFromBitmapFile(bool generateMips, bool loadAsSrgb, Texture::ImageData& image)
     {
-        std::string fullpath;
-        if (findFileInDataDirectories(filename, fullpath) == false)
+        Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(image.sourceFilename, kTopDown);
+        if (!pBitmap) return false;
+
+        image.type = Resource::Type::Texture2D;
+        image.width = pBitmap->getWidth();
+        image.height = pBitmap->getHeight();
+        image.format = loadAsSrgb ? linearToSrgbFormat(pBitmap->getFormat()) : pBitmap->getFormat();
+        image.mipLevels = generateMips ? Texture::kMaxPossible : 1;
+
+        const uint8_t* pData = pBitmap->getData();
+        size_t size = (size_t)image.width * image.height * getFormatBytesPerBlock(pBitmap->getFormat());
+        image.data.assign(pData, pData + size);
+        return true;
+    }
+
+    std::shared_ptr<Texture::ImageData> Texture::loadImageDataFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb)
+    {
+        auto pImage = std::make_shared<ImageData>();
+        if (findFileInDataDirectories(filename, pImage->sourceFilename) == false)
         {
             logError("Error when loading image file. Can't find image file " + filename);
             return nullptr;
         }
 
+        bool result = hasSuffix(filename, ".dds") ? loadImageFromDDSFile(generateMipLevels, loadAsSrgb, *pImage) : loadImageFromBitmapFile(generateMipLevels, loadAsSrgb, *pImage);
+        return result ? pImage : nullptr;
+    }
+
+    Texture::SharedPtr Texture::createFromImageData(const ImageData& image, Texture::BindFlags bindFlags)
+    {
         Texture::SharedPtr pTex;
-        if (hasSuffix(filename, ".dds"))
-        {
-            pTex = createTextureFromDDSFile(fullpath, generateMipLevels, loadAsSrgb, bindFlags);
-        }
-        else
-        {
-            Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(fullpath, kTopDown);
-            if (pBitmap)
-            {
-                ResourceFormat texFormat = pBitmap->getFormat();
-                if (loadAsSrgb)
-                {
-                    texFormat = linearToSrgbFormat(texFormat);
-                }
+        const void* pData = image.data.data();
 
-                pTex = Texture::create2D(pBitmap->getWidth(), pBitmap->getHeight(), texFormat, 1, generateMipLevels ? Texture::kMaxPossible : 1, pBitmap->getData(), bindFlags);
-            }
+        switch (image.type)
+        {
+        case Type::Texture1D:
+            pTex = Texture::create1D(image.width, image.format, image.arraySize, image.mipLevels, pData, bindFlags);
+            break;
+        case Type::Texture2D:
+            pTex = Texture::create2D(image.width, image.height, image.format, image.arraySize, image.mipLevels, pData, bindFlags);
+            break;
+        case Type::Texture3D:
+            pTex = Texture::create3D(image.width, image.height, image.depth, image.format, image.mipLevels, pData, bindFlags);
+            break;
+        case Type::TextureCube:
+            pTex = Texture::createCube(image.width, image.height, image.format, image.arraySize, image.mipLevels, pData, bindFlags);
+            break;
+        default:
+            should_not_get_here();
+            return nullptr;
         }
 
-        if (pTex != nullptr)
+        if (pTex != nullptr && !image.sourceFilename.empty())
         {
-            pTex->setSourceFilename(fullpath);
+            pTex->setSourceFilename(image.sourceFilename);
         }
 
         return pTex;
     }
+
+    Texture::SharedPtr Texture::createFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    {
+        auto pImage = loadImageDataFromFile(filename, generateMipLevels, loadAsSrgb);
+        return pImage ? createFromImageData(*pImage, bindFlags) : nullptr;
+    }
 }
@@ -219,7 +219,7 @@ namespace Falcor
         }
     }
 
-    CopyContext::ReadTextureTask::SharedPtr CopyContext::ReadTextureTask::create(CopyContext* pCtx, const Texture* pTexture, uint32_t subresourceIndex)
+    CopyContext::ReadTextureTask::SharedPtr CopyContext::ReadTextureTask::create(CopyContext* pCtx, const Texture* pTexture, uint32_t subresourceIndex, const Buffer::SharedPtr& pStagingBuffer, bool flush)
     {
         SharedPtr pThis = SharedPtr(new ReadTextureTask);
         pThis->mpContext = pCtx;
@@ -235,7 +235,7 @@ namespace Falcor
         // Create a fence and signal
         pThis->mpFence = GpuFence::create();
         pCtx->flush(false);
-        pThis->mpFence->gpuSignal(pCtx->getLowLevelData()->getCommandQueue());
+        pThis->mFenceValue = pThis->mpFence->gpuSignal(pCtx->getLowLevelData()->getCommandQueue());
 
         return pThis;
     }
@@ -247,7 +247,13 @@ namespace Falcor
         }
     }
 
-    ParameterBlock::~ParameterBlock() = default;
+    ParameterBlock::~ParameterBlock()
+    {
+        for (const auto& assigned : mParameterBlocks)
+        {
+            if (assigned.pBlock) assigned.pBlock->removeParent(this);
+        }
+    }
 
     ParameterBlock::SharedPtr ParameterBlock::create(const std::shared_ptr<const ProgramVersion>& pProgramVersion, const ReflectionType::SharedConstPtr& pElementType)
     {
@@ -552,6 +558,7 @@ namespace Falcor
         auto epoch = mEpochOfLastChange++;
         mSets[index].pSet = nullptr;
         mSets[index].epochOfLastChange = epoch;
+        notifyParentsOfChange();
     }
 
     void ParameterBlock::markUniformDataDirty() const
@@ -560,6 +567,7 @@ namespace Falcor
         mEpochOfLastUniformDataChange = epoch;
         mUnderlyingConstantBuffer.epochOfLastObservedChange = epoch-1;
         mUnderlyingConstantBuffer.pCBV = nullptr;
+        notifyParentsOfChange();
 
         // When the underlying constant buffer is invalidated, that
         // also means that whatever descriptor set the constant buffer
@@ -568,6 +576,29 @@ namespace Falcor
         markDescriptorSetDirty(mpReflector->getDefaultConstantBufferBindingInfo().descriptorSetIndex);
     }
 
+    void ParameterBlock::markIndirectChangePending() const
+    {
+        // Stop at blocks that are already pending. Their ancestors have
+        // either been notified already or don't depend on them.
+        if (mIndirectChangePending) return;
+        mIndirectChangePending = true;
+        notifyParentsOfChange();
+    }
+
+    void ParameterBlock::notifyParentsOfChange() const
+    {
+        for (auto pParent : mParents) pParent->markIndirectChangePending();
+    }
+
+    void ParameterBlock::removeParent(const ParameterBlock* pParent)
+    {
+        // A block attached to several slots of the same parent is listed once per slot.
+        auto it = std::find(mParents.begin(), mParents.end(), pParent);
+        assert(it != mParents.end());
+        *it = mParents.back();
+        mParents.pop_back();
+    }
+
     bool ParameterBlock::setParameterBlock(const BindLocation& bindLocation, const ParameterBlock::SharedPtr& pBlock)
     {
         if (!checkResourceIndices(bindLocation, "setParameterBlock")) return false;
@@ -584,8 +615,13 @@ namespace Falcor
 #endif
 #endif
         if (assigned.pBlock == pBlock) return true;
+        if (assigned.pBlock) assigned.pBlock->removeParent(this);
         assigned.pBlock = pBlock;
         assigned.epochOfLastObservedChange = pBlock ? pBlock->mEpochOfLastChange : 0;
+        if (pBlock) pBlock->mParents.push_back(this);
+
+        // The new block may itself have pending changes that we haven't observed yet.
+        markIndirectChangePending();
         return true;
     }
 
@@ -840,8 +876,9 @@ namespace Falcor
 
         auto pSlangTypeLayout = mpSpecializedReflector->getElementType()->getSlangTypeLayout();
 
-        auto requiredSize = pSlangTypeLayout->getSize();
-        if(auto pSlangPendingTypeLayout = pSlangTypeLayout->getPendingDataTypeLayout() )
+        // Reflection loaded from the shader cache has no Slang layouts, but then there is no pending data either.
+        auto requiredSize = pSlangTypeLayout ? pSlangTypeLayout->getSize() : mpSpecializedReflector->getElementType()->getByteSize();
+        if(auto pSlangPendingTypeLayout = pSlangTypeLayout ? pSlangTypeLayout->getPendingDataTypeLayout() : nullptr)
         {
             // Note: In this case, the type being stored in this block has been specialized
             // (because concrete types have been plugged in for its interface-type fields),
@@ -936,125 +973,58 @@ namespace Falcor
 
     void ParameterBlock::checkForIndirectChanges(ParameterBlockReflection const* pReflector) const
     {
+        // Changes to sub-objects are pushed up to their parents as they happen
+        // (see `markIndirectChangePending()`), so if nothing below us has changed
+        // since the last check there is nothing to do.
+        //
+        if (!mIndirectChangePending) return;
+
+        const auto& plan = pReflector->getBindingPlan();
+
         // First off, we will recursively check any parameter blocks attached to use
         // for `ConstantBuffer<T>`/`cbuffer` or interface-type parameters, since
         // changes to their state will indirectly affect validity of the descriptor
         // sets attached to `this`.
         //
-        auto resourceRangeCount = pReflector->getResourceRangeCount();
-        for(uint32_t r = 0; r < resourceRangeCount; ++r)
+        for (const auto& subObject : plan.subObjects)
         {
-            auto rangeBindingInfo = pReflector->getResourceRangeBindingInfo(r);
-            switch(rangeBindingInfo.flavor)
-            {
-            default:
-                continue;
-
-            case ParameterBlockReflection::ResourceRangeBindingInfo::Flavor::Interface:
-            case ParameterBlockReflection::ResourceRangeBindingInfo::Flavor::ConstantBuffer:
-                break;
-            }
-
-            auto pSubObjectReflector = rangeBindingInfo.pSubObjectReflector.get();
-            assert(pSubObjectReflector);
-
-            auto rangeInfo = pReflector->getResourceRange(r);
-            for(uint32_t i = 0; i < rangeInfo.count; ++i)
-            {
-                auto& assigned = getAssignedParameterBlock(r, i);
-                auto& pSubObject = assigned.pBlock;
-
-                pSubObject->checkForIndirectChanges(pSubObjectReflector);
-            }
+            auto pSubObject = mParameterBlocks[subObject.flatIndex].pBlock.get();
+            assert(subObject.pReflector);
+            pSubObject->checkForIndirectChanges(subObject.pReflector);
         }
 
         // Next, we will check for any cases where one of our descriptor sets
         // would be invalidated due to a change in a sub-block.
         //
-        auto setCount = pReflector->getDescriptorSetCount();
-        for(uint32_t s = 0; s < setCount; ++s)
+        for (const auto& dependency : plan.setDependencies)
         {
-            auto& setInfo = pReflector->getDescriptorSetInfo(s);
-            for( auto subObjectRange : setInfo.subObjects )
-            {
-                auto resourceRangeIndex = subObjectRange.resourceRangeIndexOfSubObject;
-                auto setIndexInSubObject = subObjectRange.setIndexInSubObject;
+            const auto& assigned = mParameterBlocks[plan.subObjects[dependency.subObjectIndex].flatIndex];
+            auto currentChangeEpoch = assigned.pBlock->mSets[dependency.setIndexInSubObject].epochOfLastChange;
 
-                auto subObjectCount = pReflector->getResourceRange(resourceRangeIndex).count;
-                auto pSubObjectReflector = pReflector->getResourceRangeBindingInfo(resourceRangeIndex).pSubObjectReflector.get();
-                for(uint32_t i = 0; i < subObjectCount; ++i)
-                {
-                    auto& assigned = getAssignedParameterBlock(resourceRangeIndex, i);
-                    auto& pSubObject = assigned.pBlock;
-
-                    auto lastObservedChangeEpoch = assigned.epochOfLastObservedChange;
-                    auto currentChangeEpoch = pSubObject->mSets[setIndexInSubObject].epochOfLastChange;
-
-                    if(currentChangeEpoch > lastObservedChangeEpoch)
-                    {
-                        markDescriptorSetDirty(s);
-                    }
-                }
-            }
-        }
-
-        // Next, we will check for any cases where our default constant
-        // buffer would be invalidated due to changes in a sub-block.
-        // This can only occur for sub-blocks of interface type.
-        //
-        for(uint32_t r = 0; r < resourceRangeCount; ++r)
-        {
-            auto rangeBindingInfo = pReflector->getResourceRangeBindingInfo(r);
-            if(rangeBindingInfo.flavor != ParameterBlockReflection::ResourceRangeBindingInfo::Flavor::Interface)
-                continue;
-
-            auto pSubObjectReflector = rangeBindingInfo.pSubObjectReflector.get();
-            assert(pSubObjectReflector);
-
-            auto rangeInfo = pReflector->getResourceRange(r);
-            for(uint32_t i = 0; i < rangeInfo.count; ++i)
+            if (hasChangedSince(currentChangeEpoch, assigned.epochOfLastObservedChange))
             {
-                auto& assigned = getAssignedParameterBlock(r, i);
-                auto& pSubObject = assigned.pBlock;
-
-                auto lastObservedChangeEpoch = assigned.epochOfLastObservedChange;
-                auto currentChangeEpoch = pSubObject->mEpochOfLastUniformDataChange;
-
-                if(currentChangeEpoch > lastObservedChangeEpoch)
-                {
-                    markUniformDataDirty();
-                }
+                markDescriptorSetDirty(dependency.setIndex);
             }
         }
 
-        // Finally, we will update our tracking information to show that we have
-        // updated to the latest changed in each sub-block.
+        // Finally, we will check for any cases where our default constant
+        // buffer would be invalidated due to changes in a sub-block (this can
+        // only occur for sub-blocks of interface type), and update our tracking
+        // information to show that we have updated to the latest change in each sub-block.
         //
-        for(uint32_t r = 0; r < resourceRangeCount; ++r)
+        for (const auto& subObject : plan.subObjects)
         {
-            auto rangeBindingInfo = pReflector->getResourceRangeBindingInfo(r);
-            switch(rangeBindingInfo.flavor)
-            {
-            default:
-                continue;
-
-            case ParameterBlockReflection::ResourceRangeBindingInfo::Flavor::Interface:
-            case ParameterBlockReflection::ResourceRangeBindingInfo::Flavor::ConstantBuffer:
-                break;
-            }
-
-            auto pSubObjectReflector = rangeBindingInfo.pSubObjectReflector.get();
-            assert(pSubObjectReflector);
+            auto& assigned = mParameterBlocks[subObject.flatIndex];
+            auto pSubObject = assigned.pBlock.get();
 
-            auto rangeInfo = pReflector->getResourceRange(r);
-            for(uint32_t i = 0; i < rangeInfo.count; ++i)
+            if (subObject.isInterface && hasChangedSince(pSubObject->mEpochOfLastUniformDataChange, assigned.epochOfLastObservedChange))
             {
-                auto& assigned = getAssignedParameterBlock(r, i);
-                auto& pSubObject = assigned.pBlock;
-
-                assigned.epochOfLastObservedChange = pSubObject->mEpochOfLastChange;
+                markUniformDataDirty();
             }
+            assigned.epochOfLastObservedChange = pSubObject->mEpochOfLastChange;
         }
+
+        mIndirectChangePending = false;
     }
 
     ParameterBlock::ChangeEpoch ParameterBlock::computeEpochOfLastChange(ParameterBlock* pBlock)
@@ -1513,6 +1483,16 @@ namespace Falcor
         // should use...
 
         auto pSlangTypeLayout = getElementType()->getSlangTypeLayout();
+
+        // Reflection loaded from the shader cache has no Slang layouts. It is only stored
+        // for programs without interface-type parameters, so there is nothing to specialize.
+        //
+        if( !pSlangTypeLayout )
+        {
+            mpSpecializedReflector = mpReflector;
+            return false;
+        }
+
         auto pSlangType = pSlangTypeLayout->getType();
 
         SpecializationArgs specializationArgs;
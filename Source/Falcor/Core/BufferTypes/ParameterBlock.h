@@ -436,6 +436,15 @@ namespace Falcor
 
         void checkForIndirectChanges(ParameterBlockReflection const* pReflector) const;
 
+        /** Flag this block as having a sub-object that changed since the last `checkForIndirectChanges()` call, and propagate the flag to all parents.
+        */
+        void markIndirectChangePending() const;
+        void notifyParentsOfChange() const;
+        void removeParent(const ParameterBlock* pParent);
+
+        mutable bool mIndirectChangePending = true;
+        std::vector<ParameterBlock*> mParents;  ///< Blocks that this block is assigned to as a sub-object, once per slot. Not owning.
+
         mutable uint32_t mDescriptorSetResourceDataVersion = 0;
 
         uint32_t getDescriptorSetIndex(const BindLocation& bindLocation);
@@ -26,6 +26,9 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #include "stdafx.h"
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 // #include "Utils/StringUtils.h"
 // #include "Utils/Platform/OS.h"
 // #include "Utils/Logger.h"
@@ -494,6 +497,33 @@ namespace Falcor
         return s.st_mtime;
     }
 
+    const void* mapFileForReading(const std::string& filename, size_t& size)
+    {
+        size = 0;
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return nullptr;
+
+        struct stat s;
+        if (fstat(fd, &s) != 0 || s.st_size == 0)
+        {
+            close(fd);
+            return nullptr;
+        }
+
+        // The mapping stays valid after the file descriptor is closed.
+        void* pData = mmap(nullptr, (size_t)s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (pData == MAP_FAILED) return nullptr;
+
+        size = (size_t)s.st_size;
+        return pData;
+    }
+
+    void unmapFile(const void* pData, size_t size)
+    {
+        if (pData) munmap(const_cast<void*>(pData), size);
+    }
+
     uint32_t bitScanReverse(uint32_t a)
     {
         // __builtin_clz counts 0's from the MSB, convert to index from the LSB
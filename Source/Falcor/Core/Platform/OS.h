@@ -401,6 +401,20 @@ namespace Falcor
     */
     dlldecl std::string readFile(const std::string& filename);
 
+    /** Map the content of a file into memory for reading.
+        The mapping stays valid until it is released with unmapFile().
+        \param[in] filename The file to map.
+        \param[out] size The size of the file in bytes.
+        \return Pointer to the mapped data, or nullptr if the file doesn't exist, is empty or can't be mapped.
+    */
+    dlldecl const void* mapFileForReading(const std::string& filename, size_t& size);
+
+    /** Release a mapping created with mapFileForReading().
+        \param[in] pData Pointer returned by mapFileForReading().
+        \param[in] size The size of the mapping in bytes.
+    */
+    dlldecl void unmapFile(const void* pData, size_t size);
+
     /** Load a shared-library
     */
     dlldecl DllHandle loadDll(const std::string& libPath);
@@ -29,6 +29,7 @@
 #include "Program.h"
 #include "Slang/slang.h"
 #include "Utils/StringUtils.h"
+#include "Utils/Threading.h"
 
 namespace Falcor
 {
@@ -38,8 +39,82 @@ namespace Falcor
     const std::string kSupportedShaderModels[] = { "4_0", "4_1", "5_0", "5_1", "6_0", "6_1", "6_2", "6_3" };
 #endif
 
+    static std::mutex sGlobalDefineListMutex;
     static Program::DefineList sGlobalDefineList;
 
+    static std::mutex sProgramsMutex;
+    static thread_local Program::LinkRecorder* spLinkRecorder = nullptr;
+
+    static std::mutex sShaderCacheMutex;
+    static ShaderCache::SharedPtr spShaderCache;
+    static bool sShaderCacheInitialized = false;
+
+    namespace
+    {
+        Program::DefineList getGlobalDefineList()
+        {
+            std::lock_guard<std::mutex> lock(sGlobalDefineListMutex);
+            return sGlobalDefineList;
+        }
+
+        /** Get a key identifying the shader compilers. It is computed once per process.
+            Slang reports its version through the build tag. Slang doesn't expose the version of dxcompiler, so the
+            deployed compiler binaries are hashed instead.
+        */
+        const ShaderCache::Key& getCompilerKey()
+        {
+            static const ShaderCache::Key key = []()
+            {
+                ShaderCache::KeyBuilder builder;
+                builder.addString(spGetBuildTagString());
+#ifdef FALCOR_D3D12
+                builder.addFile(getExecutableDirectory() + "/dxcompiler.dll");
+                builder.addFile(getExecutableDirectory() + "/dxil.dll");
+#endif
+                return builder.getKey();
+            }();
+            return key;
+        }
+
+        /** Blob holding kernel code loaded from the shader cache.
+        */
+        class CachedBlob : public ISlangBlob
+        {
+        public:
+            CachedBlob(std::vector<uint8_t>&& data) : mData(std::move(data)) {}
+
+            SLANG_NO_THROW SlangResult SLANG_MCALL queryInterface(SlangUUID const& uuid, void** outObject) override
+            {
+                static const SlangUUID kUnknownGuid = SLANG_UUID_ISlangUnknown;
+                static const SlangUUID kBlobGuid = SLANG_UUID_ISlangBlob;
+                if (std::memcmp(&uuid, &kUnknownGuid, sizeof(SlangUUID)) == 0 || std::memcmp(&uuid, &kBlobGuid, sizeof(SlangUUID)) == 0)
+                {
+                    addRef();
+                    *outObject = static_cast<ISlangBlob*>(this);
+                    return SLANG_OK;
+                }
+                *outObject = nullptr;
+                return SLANG_E_NO_INTERFACE;
+            }
+
+            SLANG_NO_THROW uint32_t SLANG_MCALL addRef() override { return ++mRefCount; }
+
+            SLANG_NO_THROW uint32_t SLANG_MCALL release() override
+            {
+                uint32_t count = --mRefCount;
+                if (count == 0) delete this;
+                return count;
+            }
+
+            SLANG_NO_THROW void const* SLANG_MCALL getBufferPointer() override { return mData.data(); }
+            SLANG_NO_THROW size_t SLANG_MCALL getBufferSize() override { return mData.size(); }
+
+        private:
+            std::atomic<uint32_t> mRefCount{ 0 };
+            std::vector<uint8_t> mData;
+        };
+    }
+
     static Shader::SharedPtr createShaderFromBlob(const Shader::Blob& shaderBlob, ShaderType shaderType, const std::string& entryPointName, Shader::CompilerFlags flags, std::string& log)
     {
         std::string errorMsg;
@@ -173,7 +248,30 @@ namespace Falcor
         mDesc = desc;
         mDefineList = defineList;
 
-        sPrograms.push_back(shared_from_this());
+        {
+            std::lock_guard<std::mutex> lock(sProgramsMutex);
+            sPrograms.push_back(shared_from_this());
+        }
+        if (spLinkRecorder) spLinkRecorder->mPrograms.push_back(weak_from_this());
+    }
+
+    void Program::markDirty()
+    {
+        mLinkRequired = true;
+        if (spLinkRecorder) spLinkRecorder->mPrograms.push_back(weak_from_this());
+    }
+
+    Program::LinkRecorder::LinkRecorder(std::vector<std::weak_ptr<Program>>& programs)
+        : mPrograms(programs)
+        , mpParent(spLinkRecorder)
+    {
+        spLinkRecorder = this;
+    }
+
+    Program::LinkRecorder::~LinkRecorder()
+    {
+        assert(spLinkRecorder == this);
+        spLinkRecorder = mpParent;
     }
 
     Program::~Program()
@@ -348,16 +446,19 @@ namespace Falcor
         return mpActiveVersion;
     }
 
-    slang::IGlobalSession* createSlangGlobalSession()
+    ComPtr<slang::IGlobalSession> createSlangGlobalSession()
     {
-        slang::IGlobalSession* result = nullptr;
-        slang::createGlobalSession(&result);
+        ComPtr<slang::IGlobalSession> result;
+        slang::createGlobalSession(result.writeRef());
         return result;
     }
 
     slang::IGlobalSession* getSlangGlobalSession()
     {
-        static slang::IGlobalSession* pSlangGlobalSession = createSlangGlobalSession();
+        // A Slang global session and the sessions created from it must not be used by several threads at once.
+        // Each thread compiling programs (the main thread and the thread pool workers) therefore creates its own global session once.
+        // It is released when the thread exits.
+        static thread_local ComPtr<slang::IGlobalSession> pSlangGlobalSession = createSlangGlobalSession();
         return pSlangGlobalSession;
     }
 
@@ -471,7 +572,8 @@ namespace Falcor
         };
 
         // Add global defines.
-        for (const auto& shaderDefine : sGlobalDefineList)
+        DefineList globalDefineList = getGlobalDefineList();
+        for (const auto& shaderDefine : globalDefineList)
         {
             addSlangDefine(shaderDefine.first.c_str(), shaderDefine.second.c_str());
         }
@@ -618,6 +720,60 @@ namespace Falcor
         return true;
     }
 
+    ProgramReflection::SharedPtr Program::createReflection(
+        ProgramVersion const*                       pVersion,
+        slang::IComponentType*                      pSlangGlobalScope,
+        std::vector<ComPtr<slang::IComponentType>>  pSlangLinkedEntryPoints,
+        ShaderCache*                                pShaderCache,
+        const ShaderCache::Key&                     reflectionKey,
+        std::string&                                log) const
+    {
+        // Loading the reflection skips building it from the Slang layouts of the parameters and entry points.
+        // The layout of the global scope is still passed on, as `ProgramReflection::findType()` looks up types through it.
+        //
+        std::vector<uint8_t> data;
+        if (pShaderCache && pShaderCache->load(reflectionKey, data))
+        {
+            auto pReflector = ProgramReflection::deserialize(pVersion, pSlangGlobalScope->getLayout(), data.data(), data.size());
+            if (pReflector && pReflector->getEntryPointGroups().size() == getEntryPointGroupCount()) return pReflector;
+        }
+
+        ProgramReflection::SharedPtr pReflector;
+        if (!doSlangReflection(pVersion, pSlangGlobalScope, pSlangLinkedEntryPoints, pReflector, log)) return nullptr;
+
+        if (pShaderCache && pReflector->serialize(data))
+        {
+#ifdef _DEBUG
+            // Check that the reflection loads back unchanged before storing it. This validates the format against every program compiled in debug builds.
+            std::vector<uint8_t> roundTripData;
+            auto pRoundTrip = ProgramReflection::deserialize(pVersion, pSlangGlobalScope->getLayout(), data.data(), data.size());
+            if (!pRoundTrip || !pRoundTrip->serialize(roundTripData) || roundTripData != data)
+            {
+                logError("Reflection of program '" + getProgramDescString() + "' doesn't round-trip through the shader cache.");
+                return pReflector;
+            }
+#endif
+            pShaderCache->store(reflectionKey, data.data(), data.size());
+        }
+
+        return pReflector;
+    }
+
+    /** Check if a program has interface-type parameters, including interface-type fields of its parameters.
+        Slang turns each of these into a specialization parameter. Their reflection can't be serialized, see ProgramReflection::serialize().
+    */
+    static bool hasInterfaceParameters(
+        slang::IComponentType*                              pSlangGlobalScope,
+        const std::vector<ComPtr<slang::IComponentType>>&   pSlangEntryPoints)
+    {
+        if (pSlangGlobalScope->getSpecializationParamCount() > 0) return true;
+        for (const auto& pSlangEntryPoint : pSlangEntryPoints)
+        {
+            if (pSlangEntryPoint->getSpecializationParamCount() > 0) return true;
+        }
+        return false;
+    }
+
     static ComPtr<slang::IComponentType> doSlangSpecialization(
         slang::IComponentType*                      pSlangProgram,
         ParameterBlock::SpecializationArgs const&   specializationArgs,
@@ -745,8 +901,32 @@ namespace Falcor
                 pSpecializedSlangProgram.writeRef());
         }
 
-        ProgramReflection::SharedPtr pReflector;
-        doSlangReflection(pVersion, pSpecializedSlangProgram, pLinkedEntryPoints, pReflector, log);
+        // Reflection and kernel code are looked up in the persistent shader cache before invoking Slang.
+        // Intermediates are only dumped when Slang generates the code, so the cache is bypassed in that case.
+        //
+        ShaderCache::SharedPtr pShaderCache = getShaderCache();
+        if (pVersion->mSourceKey == ShaderCache::Key() || is_set(mDesc.getCompilerFlags(), Shader::CompilerFlags::DumpIntermediates))
+        {
+            pShaderCache = nullptr;
+        }
+
+        std::string specializationKey;
+        for (const auto& specializationArg : specializationArgs)
+        {
+            specializationKey += std::string(specializationArg.type->getName()) + ",";
+        }
+
+        ShaderCache::Key reflectionKey = ShaderCache::KeyBuilder(pVersion->mSourceKey)
+            .addString(specializationKey)
+            .addString("reflection")
+            .addValue(ProgramReflection::kSerializationVersion)
+            .addString(spGetBuildTagString())
+            .getKey();
+
+        // The reflection of programs with interface-type parameters isn't cached, so it is built without looking it up.
+        ShaderCache* pReflectionCache = hasInterfaceParameters(pSlangGlobalScope, pVersion->mpSlangEntryPoints) ? nullptr : pShaderCache.get();
+        ProgramReflection::SharedPtr pReflector = createReflection(pVersion, pSpecializedSlangProgram, pLinkedEntryPoints, pReflectionCache, reflectionKey, log);
+        if (!pReflector) return nullptr;
 
         // In order to construct the `ProgramKernels` we need to extract
         // the kernels for each entry-point group.
@@ -776,20 +956,38 @@ namespace Falcor
                 auto pLinkedEntryPoint = pLinkedEntryPoints[entryPointIndex];
                 auto entryPointDesc = mDesc.mEntryPoints[entryPointIndex];
 
+                // The kernel key extends the key of the program version with the specialization arguments and the entry point.
+                ShaderCache::Key kernelKey = ShaderCache::KeyBuilder(pVersion->mSourceKey)
+                    .addString(specializationKey)
+                    .addValue(entryPointIndex)
+                    .addString(entryPointDesc.name)
+                    .addValue(entryPointDesc.stage)
+                    .getKey();
+
                 Shader::Blob blob;
-                ComPtr<slang::IBlob> pSlangDiagnostics;
-                bool failed = SLANG_FAILED(pLinkedEntryPoint->getEntryPointCode(
-                    /* entryPointIndex: */ 0,
-                    /* targetIndex: */ 0,
-                    blob.writeRef(),
-                    pSlangDiagnostics.writeRef()));
-
-                if (pSlangDiagnostics && pSlangDiagnostics->getBufferSize() > 0)
+                std::vector<uint8_t> cachedCode;
+                if (pShaderCache && pShaderCache->load(kernelKey, cachedCode))
                 {
-                    log += (char const*) pSlangDiagnostics->getBufferPointer();
+                    blob = Shader::Blob(new CachedBlob(std::move(cachedCode)));
                 }
+                else
+                {
+                    ComPtr<slang::IBlob> pSlangDiagnostics;
+                    bool failed = SLANG_FAILED(pLinkedEntryPoint->getEntryPointCode(
+                        /* entryPointIndex: */ 0,
+                        /* targetIndex: */ 0,
+                        blob.writeRef(),
+                        pSlangDiagnostics.writeRef()));
+
+                    if (pSlangDiagnostics && pSlangDiagnostics->getBufferSize() > 0)
+                    {
+                        log += (char const*) pSlangDiagnostics->getBufferPointer();
+                    }
+
+                    if (failed) return nullptr;
 
-                if (failed) return nullptr;
+                    if (pShaderCache) pShaderCache->store(kernelKey, blob->getBufferPointer(), blob->getBufferSize());
+                }
 
                 Shader::SharedPtr shader = createShaderFromBlob(blob, entryPointDesc.stage, entryPointDesc.name, mDesc.getCompilerFlags(), log);
                 if (!shader) return nullptr;
@@ -848,13 +1046,18 @@ namespace Falcor
         }
 
         // Extract list of files referenced, for dependency-tracking purposes
+        std::vector<std::string> depFiles;
         int depFileCount = spGetDependencyFileCount(pSlangRequest);
         for(int ii = 0; ii < depFileCount; ++ii)
         {
             std::string depFilePath = spGetDependencyFilePath(pSlangRequest, ii);
             mFileTimeMap[depFilePath] = getFileModifiedTime(depFilePath);
+            depFiles.push_back(depFilePath);
         }
 
+        // The source key identifies the compiled kernels of this version in the shader cache.
+        ShaderCache::Key sourceKey = getShaderCache() ? computeSourceKey(depFiles) : ShaderCache::Key();
+
         // Note: the `ProgramReflection` needs to be able to refer back to the
         // `ProgramVersion`, but the `ProgramVersion` can't be initialized
         // until we have its reflection. We cut that dependency knot by
@@ -882,8 +1085,17 @@ namespace Falcor
             pSlangRequest,
             pSlangProgram.writeRef());
 
-        ProgramReflection::SharedPtr pReflector;
-        if( !doSlangReflection(pVersion.get(), pSlangGlobalScope, pSlangEntryPoints, pReflector, log) )
+        // The reflection of programs with interface-type parameters isn't cached, so it is built without looking it up.
+        bool cacheReflection = sourceKey != ShaderCache::Key() && !hasInterfaceParameters(pSlangGlobalScope, pSlangEntryPoints);
+        ShaderCache::SharedPtr pShaderCache = cacheReflection ? getShaderCache() : nullptr;
+        ShaderCache::Key reflectionKey = ShaderCache::KeyBuilder(sourceKey)
+            .addString("reflection")
+            .addValue(ProgramReflection::kSerializationVersion)
+            .addString(spGetBuildTagString())
+            .getKey();
+
+        ProgramReflection::SharedPtr pReflector = createReflection(pVersion.get(), pSlangGlobalScope, pSlangEntryPoints, pShaderCache.get(), reflectionKey, log);
+        if( !pReflector )
         {
             return nullptr;
         }
@@ -892,11 +1104,43 @@ namespace Falcor
             mDefineList,
             pReflector,
             getProgramDescString(),
-            pSlangEntryPoints);
+            pSlangEntryPoints,
+            sourceKey);
 
         return pVersion;
     }
 
+    ShaderCache::Key Program::computeSourceKey(const std::vector<std::string>& dependencyFiles) const
+    {
+        ShaderCache::KeyBuilder builder;
+        builder.addValue(ShaderCache::kVersion);
+        builder.addKey(getCompilerKey());
+#ifdef FALCOR_VK
+        builder.addString("FALCOR_VK");
+#elif defined FALCOR_D3D12
+        builder.addString("FALCOR_D3D12");
+#endif
+        builder.addString(mDesc.mShaderModel);
+        builder.addValue(mDesc.getCompilerFlags());
+        builder.addMap(getGlobalDefineList());
+        builder.addMap(mDefineList);
+        builder.addString(getProgramDescString());
+
+        for (const auto& src : mDesc.mSources)
+        {
+            if (src.type == Desc::Source::Type::String) builder.addString(src.str);
+        }
+
+        // Hash the transitive include set in a fixed order, independent of the order Slang reports the files in.
+        std::vector<std::string> files = dependencyFiles;
+        std::sort(files.begin(), files.end());
+        files.erase(std::unique(files.begin(), files.end()), files.end());
+        for (const auto& file : files) builder.addFile(file);
+
+        ShaderCache::Key key = builder.getKey();
+        return key != ShaderCache::Key() ? key : ShaderCache::Key{ 0, 1 };
+    }
+
     EntryPointGroupKernels::SharedPtr Program::createEntryPointGroupKernels(
         const std::vector<Shader::SharedPtr>& shaders,
         EntryPointBaseReflection::SharedPtr const& pReflector) const
@@ -906,31 +1150,32 @@ namespace Falcor
 
     bool Program::link() const
     {
-        while(1)
-        {
-            // Create the program
-            std::string log;
-            auto pVersion = preprocessAndCreateProgramVersion(log);
+        // Create the program
+        std::string log;
+        auto pVersion = preprocessAndCreateProgramVersion(log);
+        return link(pVersion, log);
+    }
 
-            if (pVersion == nullptr)
-            {
-                std::string error = "Failed to link program:\n" + getProgramDescString() + "\n\n" + log;
-                logError(error, Logger::MsgBox::RetryAbort);
+    bool Program::link(ProgramVersion::SharedPtr pVersion, std::string log) const
+    {
+        while (pVersion == nullptr)
+        {
+            std::string error = "Failed to link program:\n" + getProgramDescString() + "\n\n" + log;
+            logError(error, Logger::MsgBox::RetryAbort);
 
-                // Continue loop to keep trying...
-            }
-            else
-            {
-                if (!log.empty())
-                {
-                    std::string warn = "Warnings in program:\n" + getProgramDescString() + "\n" + log;
-                    logWarning(warn);
-                }
+            // Continue loop to keep trying...
+            log.clear();
+            pVersion = preprocessAndCreateProgramVersion(log);
+        }
 
-                mpActiveVersion = pVersion;
-                return true;
-            }
+        if (!log.empty())
+        {
+            std::string warn = "Warnings in program:\n" + getProgramDescString() + "\n" + log;
+            logWarning(warn);
         }
+
+        mpActiveVersion = pVersion;
+        return true;
     }
 
     void Program::reset()
@@ -943,6 +1188,7 @@ namespace Falcor
 
     bool Program::reloadAllPrograms(bool forceReload)
     {
+        std::lock_guard<std::mutex> lock(sProgramsMutex);
         bool hasReloaded = false;
 
         // The `sPrograms` array stores weak pointers, and we will
@@ -1005,16 +1251,83 @@ namespace Falcor
 
     void Program::addGlobalDefines(const DefineList& defineList)
     {
-        sGlobalDefineList.add(defineList);
+        {
+            std::lock_guard<std::mutex> lock(sGlobalDefineListMutex);
+            sGlobalDefineList.add(defineList);
+        }
         reloadAllPrograms(true);
     }
 
     void Program::removeGlobalDefines(const DefineList& defineList)
     {
-        sGlobalDefineList.remove(defineList);
+        {
+            std::lock_guard<std::mutex> lock(sGlobalDefineListMutex);
+            sGlobalDefineList.remove(defineList);
+        }
         reloadAllPrograms(true);
     }
 
+    uint32_t Program::linkPrograms(const std::vector<SharedPtr>& programs)
+    {
+        std::vector<Program*> pending;
+        for (const auto& pProgram : programs)
+        {
+            if (!pProgram || !pProgram->isLinkRequired()) continue;
+            if (std::find(pending.begin(), pending.end(), pProgram.get()) == pending.end()) pending.push_back(pProgram.get());
+        }
+        if (pending.empty()) return 0;
+
+        std::vector<ProgramVersion::SharedPtr> versions(pending.size());
+        std::vector<std::string> logs(pending.size());
+        Threading::parallelFor(0, pending.size(), [&](size_t i)
+        {
+            versions[i] = pending[i]->preprocessAndCreateProgramVersion(logs[i]);
+        }, 1);
+
+        // Failed programs report the error of the batch compile and are only compiled again if the user retries.
+        uint32_t linkedCount = 0;
+        for (size_t i = 0; i < pending.size(); i++)
+        {
+            Program* pProgram = pending[i];
+            if (!pProgram->link(versions[i], logs[i])) continue;
+
+            pProgram->mProgramVersions[pProgram->mDefineList] = pProgram->mpActiveVersion;
+            pProgram->mLinkRequired = false;
+            linkedCount++;
+        }
+        return linkedCount;
+    }
+
+    std::vector<Program::SharedPtr> Program::getProgramsRequiringLink()
+    {
+        std::lock_guard<std::mutex> lock(sProgramsMutex);
+        std::vector<SharedPtr> programs;
+        for (const auto& pWeakProgram : sPrograms)
+        {
+            auto pProgram = pWeakProgram.lock();
+            if (pProgram && pProgram->isLinkRequired()) programs.push_back(pProgram);
+        }
+        return programs;
+    }
+
+    void Program::setShaderCache(const ShaderCache::SharedPtr& pCache)
+    {
+        std::lock_guard<std::mutex> lock(sShaderCacheMutex);
+        spShaderCache = pCache;
+        sShaderCacheInitialized = true;
+    }
+
+    ShaderCache::SharedPtr Program::getShaderCache()
+    {
+        std::lock_guard<std::mutex> lock(sShaderCacheMutex);
+        if (!sShaderCacheInitialized)
+        {
+            spShaderCache = ShaderCache::create(ShaderCache::getDefaultDirectory());
+            sShaderCacheInitialized = true;
+        }
+        return spShaderCache;
+    }
+
     SCRIPT_BINDING(Program)
     {
         pybind11::class_<Program, Program::SharedPtr>(m, "Program");
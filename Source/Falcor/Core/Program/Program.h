@@ -227,6 +227,50 @@ namespace Falcor
         */
         static void removeGlobalDefines(const DefineList& defineList);
 
+        /** Compile the active versions of multiple programs concurrently.
+            The programs are compiled on the thread pool. Every worker thread uses its own Slang global session, so the compiles don't share any Slang state.
+            The results are published on the calling thread in the order of the input list, so the outcome doesn't depend on thread scheduling.
+            Errors are reported on the calling thread in the same way as when a program is linked on first use, including the option to retry.
+            \param[in] programs Programs to compile. Programs that are already linked and duplicates are skipped.
+            \return The number of programs that were linked.
+        */
+        static uint32_t linkPrograms(const std::vector<SharedPtr>& programs);
+
+        /** Records the programs that require linking because they are created, or their defines change, on the calling thread while the recorder is alive.
+            This is used to find the programs owned by an object, for example the passes of a render graph, so they can be compiled with linkPrograms().
+            Recorders nest. A program is only recorded by the innermost recorder of the thread.
+        */
+        class dlldecl LinkRecorder
+        {
+        public:
+            /** Start recording.
+                \param[in] programs List the programs are appended to. It must outlive the recorder.
+            */
+            LinkRecorder(std::vector<std::weak_ptr<Program>>& programs);
+            ~LinkRecorder();
+
+            LinkRecorder(const LinkRecorder&) = delete;
+            LinkRecorder& operator=(const LinkRecorder&) = delete;
+
+        private:
+            friend class Program;
+            std::vector<std::weak_ptr<Program>>& mPrograms;
+            LinkRecorder* mpParent;
+        };
+
+        /** Get all live programs whose active version has not been compiled yet, in creation order.
+        */
+        static std::vector<SharedPtr> getProgramsRequiringLink();
+
+        /** Set the persistent cache for compiled kernels, shared by all programs.
+            \param[in] pCache The cache, or nullptr to disable caching.
+        */
+        static void setShaderCache(const ShaderCache::SharedPtr& pCache);
+
+        /** Get the persistent cache for compiled kernels. Unless set with setShaderCache(), a cache in ShaderCache::getDefaultDirectory() is created on first use.
+        */
+        static ShaderCache::SharedPtr getShaderCache();
+
         /** Get the program reflection for the active program.
             \return Program reflection object, or an exception is thrown on failure.
         */
@@ -248,6 +292,12 @@ namespace Falcor
 
         bool link() const;
 
+        /** Finish linking from the result of a compile. If the compile failed, the error is reported and the program is compiled again until it succeeds.
+            \param[in] pVersion The compiled version, or nullptr if the compile failed.
+            \param[in] log The log of the compile.
+        */
+        bool link(ProgramVersion::SharedPtr pVersion, std::string log) const;
+
         SlangCompileRequest* createSlangCompileRequest(
             DefineList  const& defineList) const;
 
@@ -258,8 +308,23 @@ namespace Falcor
             ProgramReflection::SharedPtr&               pReflector,
             std::string&                                log) const;
 
+        /** Create the reflection for a program version. The reflection is loaded from the shader cache if possible,
+            otherwise it is created through Slang reflection and stored in the cache.
+            \param[in] pShaderCache The shader cache, or nullptr to bypass the cache.
+            \param[in] reflectionKey Key of the reflection in the shader cache.
+        */
+        ProgramReflection::SharedPtr createReflection(
+            ProgramVersion const*                       pVersion,
+            slang::IComponentType*                      pSlangGlobalScope,
+            std::vector<ComPtr<slang::IComponentType>>  pSlangEntryPointGroups,
+            ShaderCache*                                pShaderCache,
+            const ShaderCache::Key&                     reflectionKey,
+            std::string&                                log) const;
+
         ProgramVersion::SharedPtr preprocessAndCreateProgramVersion(std::string& log) const;
 
+        ShaderCache::Key computeSourceKey(const std::vector<std::string>& dependencyFiles) const;
+
         ProgramKernels::SharedPtr preprocessAndCreateProgramKernels(
             ProgramVersion const* pVersion,
             ProgramVars    const* pVars,
@@ -278,7 +343,8 @@ namespace Falcor
         mutable bool mLinkRequired = true;
         mutable std::map<DefineList, ProgramVersion::SharedConstPtr> mProgramVersions;
         mutable ProgramVersion::SharedConstPtr mpActiveVersion;
-        void markDirty() { mLinkRequired = true; }
+        void markDirty();
+        bool isLinkRequired() const { return mLinkRequired && mProgramVersions.find(mDefineList) == mProgramVersions.end(); }
 
         std::string getProgramDescString() const;
         static std::vector<std::weak_ptr<Program>> sPrograms;
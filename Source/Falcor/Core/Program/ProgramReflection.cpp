@@ -1081,7 +1081,7 @@ namespace Falcor
 
     std::shared_ptr<const ProgramVersion> ParameterBlockReflection::getProgramVersion() const
     {
-        return mpProgramVersion->shared_from_this();
+        return mpProgramVersion ? mpProgramVersion->shared_from_this() : ProgramVersion::SharedConstPtr();
     }
 
     void ProgramReflection::finalize()
@@ -1801,6 +1801,55 @@ namespace Falcor
             }
 
             // TODO: Do we need to handle interface sub-object slots here?
+
+            buildBindingPlan(pReflector);
+        }
+
+        void buildBindingPlan(ParameterBlockReflection* pReflector)
+        {
+            auto& plan = pReflector->mBindingPlan;
+            plan = {};
+
+            // Flatten every array element of the `ConstantBuffer` and `Interface` ranges
+            // into a single list, remembering where each range starts in it.
+            auto resourceRangeCount = (uint32_t)pReflector->mResourceRanges.size();
+            std::vector<uint32_t> firstSubObjectOfRange(resourceRangeCount, ParameterBlockReflection::kInvalidIndex);
+            for (uint32_t rangeIndex = 0; rangeIndex < resourceRangeCount; ++rangeIndex)
+            {
+                const auto& rangeBindingInfo = pReflector->mResourceRanges[rangeIndex];
+                bool isInterface = rangeBindingInfo.flavor == ParameterBlockReflection::ResourceRangeBindingInfo::Flavor::Interface;
+                if (!isInterface && rangeBindingInfo.flavor != ParameterBlockReflection::ResourceRangeBindingInfo::Flavor::ConstantBuffer) continue;
+
+                const auto& range = pReflector->getResourceRange(rangeIndex);
+                firstSubObjectOfRange[rangeIndex] = (uint32_t)plan.subObjects.size();
+                for (uint32_t i = 0; i < range.count; ++i)
+                {
+                    ParameterBlockReflection::BindingPlan::SubObject subObject;
+                    subObject.flatIndex = range.baseIndex + i;
+                    subObject.isInterface = isInterface;
+                    subObject.pReflector = rangeBindingInfo.pSubObjectReflector.get();
+                    plan.subObjects.push_back(subObject);
+                }
+            }
+
+            for (uint32_t setIndex = 0; setIndex < (uint32_t)pReflector->mDescriptorSets.size(); ++setIndex)
+            {
+                for (const auto& subObjectInfo : pReflector->mDescriptorSets[setIndex].subObjects)
+                {
+                    auto rangeIndex = subObjectInfo.resourceRangeIndexOfSubObject;
+                    assert(firstSubObjectOfRange[rangeIndex] != ParameterBlockReflection::kInvalidIndex);
+
+                    auto count = pReflector->getResourceRange(rangeIndex).count;
+                    for (uint32_t i = 0; i < count; ++i)
+                    {
+                        ParameterBlockReflection::BindingPlan::SetDependency dependency;
+                        dependency.subObjectIndex = firstSubObjectOfRange[rangeIndex] + i;
+                        dependency.setIndexInSubObject = subObjectInfo.setIndexInSubObject;
+                        dependency.setIndex = setIndex;
+                        plan.setDependencies.push_back(dependency);
+                    }
+                }
+            }
         }
     };
 
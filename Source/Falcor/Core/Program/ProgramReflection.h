@@ -1358,6 +1358,39 @@ namespace Falcor
         uint32_t getParameterBlockSubObjectRangeCount() const { return (uint32_t) mParameterBlockSubObjectRangeIndices.size(); }
         uint32_t getParameterBlockSubObjectRangeIndex(uint32_t index) const { return mParameterBlockSubObjectRangeIndices[index]; }
 
+        /// A flattened view of the sub-object dependencies of a parameter block.
+        ///
+        /// The plan is computed once in `finalize()` and shared by every
+        /// `ParameterBlock` created from this reflector, so that checking a
+        /// block for indirect changes is a linear walk over plain arrays
+        /// instead of a nested walk over resource ranges and array elements.
+        ///
+        struct BindingPlan
+        {
+            /// A single `ConstantBuffer` or `Interface` sub-object slot.
+            struct SubObject
+            {
+                uint32_t flatIndex = 0;     ///< Index into the parameter block's array of assigned sub-objects.
+                bool isInterface = false;   ///< True if the sub-object's uniform data is stored in the parent's default constant buffer.
+                const ParameterBlockReflection* pReflector = nullptr;  ///< Reflector to validate the sub-object with.
+            };
+
+            /// A descriptor set of the parameter block that sub-object data is written into.
+            struct SetDependency
+            {
+                uint32_t subObjectIndex = 0;        ///< Index into `subObjects`.
+                uint32_t setIndexInSubObject = 0;   ///< Descriptor set of the sub-object that is written into the set.
+                uint32_t setIndex = 0;              ///< Descriptor set of the parameter block.
+            };
+
+            std::vector<SubObject> subObjects;
+            std::vector<SetDependency> setDependencies;
+        };
+
+        /** Get the precomputed binding plan. Only valid after `finalize()` has been called.
+        */
+        const BindingPlan& getBindingPlan() const { return mBindingPlan; }
+
         std::shared_ptr<const ProgramVersion> getProgramVersion() const;
 
         std::shared_ptr<const ReflectionVar> findMember(const std::string& name) const
@@ -1414,6 +1447,10 @@ namespace Falcor
         ///
         std::vector<uint32_t> mParameterBlockSubObjectRangeIndices;
 
+        /// Flattened sub-object dependencies, built from the information above in `finalize()`.
+        ///
+        BindingPlan mBindingPlan;
+
         ProgramVersion const* mpProgramVersion = nullptr;
     };
 
@@ -1431,6 +1468,8 @@ namespace Falcor
             std::vector<slang::EntryPointLayout*> const& pSlangEntryPointReflectors);
 
     private:
+        friend class ProgramReflectionReader;
+
         EntryPointGroupReflection(
             ProgramVersion const* pProgramVersion);
     };
@@ -1468,6 +1507,27 @@ namespace Falcor
         static SharedPtr createEmpty();
         void finalize();
 
+        /** Version of the format written by serialize(). Increment when the format or the reflection of programs changes.
+        */
+        static const uint32_t kSerializationVersion = 1;
+
+        /** Serialize the reflection into a compact binary format, used to store it in the shader cache.
+            Strings are interned, and types, variables and parameter blocks are stored in flat arrays of records.
+            \param[out] data The serialized reflection.
+            \return False if the reflection can't be serialized. This is the case for programs with interface-type parameters, which are specialized through the Slang type layouts.
+        */
+        bool serialize(std::vector<uint8_t>& data) const;
+
+        /** Create a reflection object from data written by serialize(), without building it from Slang reflection.
+            The Slang type layouts of the loaded types are null.
+            \param[in] pProgramVersion The program version the reflection belongs to.
+            \param[in] pSlangReflector Slang reflection of the program, only used by findType().
+            \param[in] pData The serialized reflection.
+            \param[in] size Size of the serialized reflection in bytes.
+            \return A new object, or nullptr if the data is invalid.
+        */
+        static SharedPtr deserialize(ProgramVersion const* pProgramVersion, slang::ShaderReflection* pSlangReflector, const void* pData, size_t size);
+
         std::shared_ptr<const ProgramVersion> getProgramVersion() const;
 
         /** Get parameter block by name
@@ -1514,6 +1574,9 @@ namespace Falcor
         EntryPointGroupReflection::SharedPtr const& getEntryPointGroup(uint32_t index) const { return mEntryPointGroups[index]; }
 
     private:
+        friend class ProgramReflectionWriter;
+        friend class ProgramReflectionReader;
+
         ProgramReflection(
             ProgramVersion const* pProgramVersion,
             slang::ShaderReflection* pSlangReflector,
@@ -1534,7 +1597,7 @@ namespace Falcor
         VariableMap mVertAttrBySemantic;
 
         slang::ShaderReflection* mpSlangReflector = nullptr;
-        mutable std::map<std::string, ReflectionType::SharedPtr> mMapNameToType;
+        mutable std::unordered_map<std::string, ReflectionType::SharedPtr> mMapNameToType;
 
         std::vector<EntryPointGroupReflection::SharedPtr> mEntryPointGroups;
     };
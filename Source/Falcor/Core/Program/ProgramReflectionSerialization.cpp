@@ -0,0 +1,620 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "ProgramReflection.h"
+#include <algorithm>
+
+namespace Falcor
+{
+    namespace
+    {
+        const char kMagic[4] = { 'F', 'R', 'F', 'L' };
+        const uint32_t kInvalidIndex = uint32_t(-1);
+
+        enum class VariableMapId : uint32_t
+        {
+            PsOut,
+            VertAttr,
+            VertAttrBySemantic,
+        };
+
+        /** Serialized type. The meaning of the arguments depends on the kind:
+            - Array: element count, element byte stride, element type.
+            - Struct: name, index of the first member in the member list, member count.
+            - Basic: basic type, row-major flag.
+            - Resource: resource type, dimensions, structured type, return type, shader access, struct type, parameter block.
+            All records only contain 32-bit fields after the byte size, so there are no padding bytes in the output.
+        */
+        struct TypeRecord
+        {
+            uint64_t byteSize;
+            uint32_t kind;
+            uint32_t args[7];
+        };
+
+        struct VarRecord
+        {
+            uint32_t name;
+            uint32_t type;
+            uint32_t byteOffset;
+            uint32_t rangeIndex;
+            uint32_t arrayIndex;
+        };
+
+        struct BlockRecord
+        {
+            uint32_t isEntryPointGroup;
+            uint32_t elementType;
+            uint32_t cbRegIndex;
+            uint32_t cbRegSpace;
+            uint32_t cbUseRootConstants;
+            uint32_t firstRange;
+            uint32_t rangeCount;
+        };
+
+        struct RangeRecord
+        {
+            uint32_t flavor;
+            uint32_t regIndex;
+            uint32_t regSpace;
+            uint32_t subObject;
+        };
+
+        struct ShaderVariableRecord
+        {
+            uint32_t map;
+            uint32_t name;
+            uint32_t bindLocation;
+            uint32_t semanticName;
+            uint32_t type;
+        };
+
+        struct ProgramRecord
+        {
+            uint32_t defaultBlock;
+            uint32_t threadGroupSize[3];
+            uint32_t isSampleFrequency;
+        };
+
+        /** Appends plain-old-data values to a byte stream.
+        */
+        class DataWriter
+        {
+        public:
+            void writeBytes(const void* pData, size_t size)
+            {
+                const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pData);
+                mData.insert(mData.end(), pBytes, pBytes + size);
+            }
+
+            template<typename T>
+            void write(const T& value) { writeBytes(&value, sizeof(T)); }
+
+            template<typename T>
+            void writeVector(const std::vector<T>& vec)
+            {
+                write((uint64_t)vec.size());
+                writeBytes(vec.data(), vec.size() * sizeof(T));
+            }
+
+            std::vector<uint8_t>& getData() { return mData; }
+
+        private:
+            std::vector<uint8_t> mData;
+        };
+
+        /** Reads plain-old-data values from a byte stream. Throws if reading past the end of the stream.
+        */
+        class DataReader
+        {
+        public:
+            DataReader(const uint8_t* pData, size_t size) : mpData(pData), mSize(size) {}
+
+            void readBytes(void* pDst, size_t size)
+            {
+                if (size > mSize - mOffset) throw std::runtime_error("Unexpected end of reflection data");
+                std::memcpy(pDst, mpData + mOffset, size);
+                mOffset += size;
+            }
+
+            template<typename T>
+            T read()
+            {
+                T value;
+                readBytes(&value, sizeof(T));
+                return value;
+            }
+
+            template<typename T>
+            std::vector<T> readVector()
+            {
+                uint64_t count = read<uint64_t>();
+                if (count > (mSize - mOffset) / sizeof(T)) throw std::runtime_error("Unexpected end of reflection data");
+                std::vector<T> vec((size_t)count);
+                readBytes(vec.data(), vec.size() * sizeof(T));
+                return vec;
+            }
+
+            bool isEnd() const { return mOffset == mSize; }
+
+        private:
+            const uint8_t* mpData;
+            size_t mSize;
+            size_t mOffset = 0;
+        };
+    }
+
+    /** Flattens a program reflection into arrays of records.
+        Objects are identified by pointer, so types and blocks that are shared in the reflection are written once and stay shared when loaded.
+    */
+    class ProgramReflectionWriter
+    {
+    public:
+        bool write(const ProgramReflection& reflection, std::vector<uint8_t>& data)
+        {
+            ProgramRecord program;
+            program.defaultBlock = addBlock(reflection.mpDefaultBlock.get());
+            program.threadGroupSize[0] = reflection.mThreadGroupSize.x;
+            program.threadGroupSize[1] = reflection.mThreadGroupSize.y;
+            program.threadGroupSize[2] = reflection.mThreadGroupSize.z;
+            program.isSampleFrequency = reflection.mIsSampleFrequency ? 1 : 0;
+
+            std::vector<uint32_t> groups;
+            for (const auto& pGroup : reflection.mEntryPointGroups) groups.push_back(addBlock(pGroup.get()));
+
+            addShaderVariables(VariableMapId::PsOut, reflection.mPsOut);
+            addShaderVariables(VariableMapId::VertAttr, reflection.mVertAttr);
+            addShaderVariables(VariableMapId::VertAttrBySemantic, reflection.mVertAttrBySemantic);
+
+            if (mUnsupported) return false;
+
+            DataWriter writer;
+            writer.writeBytes(kMagic, sizeof(kMagic));
+            writer.write(ProgramReflection::kSerializationVersion);
+            writer.writeVector(mStringData);
+            writer.writeVector(mStringOffsets);
+            writer.writeVector(mTypes);
+            writer.writeVector(mVars);
+            writer.writeVector(mMembers);
+            writer.writeVector(mBlocks);
+            writer.writeVector(mRanges);
+            writer.writeVector(mShaderVariables);
+            writer.write(program);
+            writer.writeVector(groups);
+
+            data = std::move(writer.getData());
+            return true;
+        }
+
+    private:
+        uint32_t addString(const std::string& str)
+        {
+            auto it = mStringIndices.find(str);
+            if (it != mStringIndices.end()) return it->second;
+
+            uint32_t index = (uint32_t)mStringOffsets.size() - 1;
+            mStringData.insert(mStringData.end(), str.begin(), str.end());
+            mStringOffsets.push_back((uint32_t)mStringData.size());
+            mStringIndices.emplace(str, index);
+            return index;
+        }
+
+        uint32_t addType(const ReflectionType* pType)
+        {
+            if (!pType) return kInvalidIndex;
+            auto it = mTypeIndices.find(pType);
+            if (it != mTypeIndices.end()) return it->second;
+
+            TypeRecord record = {};
+            record.byteSize = pType->getByteSize();
+            record.kind = (uint32_t)pType->getKind();
+
+            switch (pType->getKind())
+            {
+            case ReflectionType::Kind::Array:
+            {
+                auto pArrayType = pType->asArrayType();
+                record.args[0] = pArrayType->getElementCount();
+                record.args[1] = pArrayType->getElementByteStride();
+                record.args[2] = addType(pArrayType->getElementType().get());
+                break;
+            }
+            case ReflectionType::Kind::Struct:
+            {
+                // Members are added first, as they may append the members of nested structs.
+                auto pStructType = pType->asStructType();
+                std::vector<uint32_t> members;
+                for (uint32_t i = 0; i < pStructType->getMemberCount(); i++) members.push_back(addVar(pStructType->getMember(i).get()));
+
+                record.args[0] = addString(pStructType->getName());
+                record.args[1] = (uint32_t)mMembers.size();
+                record.args[2] = (uint32_t)members.size();
+                mMembers.insert(mMembers.end(), members.begin(), members.end());
+                break;
+            }
+            case ReflectionType::Kind::Basic:
+            {
+                auto pBasicType = pType->asBasicType();
+                record.args[0] = (uint32_t)pBasicType->getType();
+                record.args[1] = pBasicType->isRowMajor() ? 1 : 0;
+                break;
+            }
+            case ReflectionType::Kind::Resource:
+            {
+                auto pResourceType = pType->asResourceType();
+                record.args[0] = (uint32_t)pResourceType->getType();
+                record.args[1] = (uint32_t)pResourceType->getDimensions();
+                record.args[2] = (uint32_t)pResourceType->getStructuredBufferType();
+                record.args[3] = (uint32_t)pResourceType->getReturnType();
+                record.args[4] = (uint32_t)pResourceType->getShaderAccess();
+                record.args[5] = addType(pResourceType->getStructType().get());
+                record.args[6] = addBlock(pResourceType->getParameterBlockReflector().get());
+                break;
+            }
+            default:
+                // Interface types are specialized through their Slang type layouts, which can't be serialized.
+                mUnsupported = true;
+                break;
+            }
+
+            uint32_t index = (uint32_t)mTypes.size();
+            mTypes.push_back(record);
+            mTypeIndices[pType] = index;
+            return index;
+        }
+
+        uint32_t addVar(const ReflectionVar* pVar)
+        {
+            auto it = mVarIndices.find(pVar);
+            if (it != mVarIndices.end()) return it->second;
+
+            ShaderVarOffset offset = pVar->getBindLocation();
+            VarRecord record;
+            record.name = addString(pVar->getName());
+            record.type = addType(pVar->getType().get());
+            record.byteOffset = offset.getUniform().getByteOffset();
+            record.rangeIndex = offset.getResource().getRangeIndex();
+            record.arrayIndex = offset.getResource().getArrayIndex();
+
+            uint32_t index = (uint32_t)mVars.size();
+            mVars.push_back(record);
+            mVarIndices[pVar] = index;
+            return index;
+        }
+
+        uint32_t addBlock(const ParameterBlockReflection* pBlock)
+        {
+            if (!pBlock) return kInvalidIndex;
+            auto it = mBlockIndices.find(pBlock);
+            if (it != mBlockIndices.end()) return it->second;
+
+            const auto& cbInfo = pBlock->getDefaultConstantBufferBindingInfo();
+            BlockRecord record;
+            record.isEntryPointGroup = dynamic_cast<const EntryPointGroupReflection*>(pBlock) ? 1 : 0;
+            record.elementType = addType(pBlock->getElementType().get());
+            record.cbRegIndex = cbInfo.regIndex;
+            record.cbRegSpace = cbInfo.regSpace;
+            record.cbUseRootConstants = cbInfo.useRootConstants ? 1 : 0;
+
+            std::vector<RangeRecord> ranges;
+            for (uint32_t i = 0; i < pBlock->getResourceRangeCount(); i++)
+            {
+                const auto& bindingInfo = pBlock->getResourceRangeBindingInfo(i);
+                if (bindingInfo.flavor == ParameterBlockReflection::ResourceRangeBindingInfo::Flavor::Interface) mUnsupported = true;
+
+                RangeRecord range;
+                range.flavor = (uint32_t)bindingInfo.flavor;
+                range.regIndex = bindingInfo.regIndex;
+                range.regSpace = bindingInfo.regSpace;
+                range.subObject = addBlock(bindingInfo.pSubObjectReflector.get());
+                ranges.push_back(range);
+            }
+
+            // The descriptor sets and sub-object indices of the block are derived data and get rebuilt by finalize() when loading.
+            record.firstRange = (uint32_t)mRanges.size();
+            record.rangeCount = (uint32_t)ranges.size();
+            mRanges.insert(mRanges.end(), ranges.begin(), ranges.end());
+
+            uint32_t index = (uint32_t)mBlocks.size();
+            mBlocks.push_back(record);
+            mBlockIndices[pBlock] = index;
+            return index;
+        }
+
+        void addShaderVariables(VariableMapId map, const ProgramReflection::VariableMap& variables)
+        {
+            // Variables are written sorted by name, so that the output doesn't depend on the iteration order of the map.
+            std::vector<const ProgramReflection::VariableMap::value_type*> sorted;
+            for (const auto& it : variables) sorted.push_back(&it);
+            std::sort(sorted.begin(), sorted.end(), [](const auto* pA, const auto* pB) { return pA->first < pB->first; });
+
+            for (const auto* pEntry : sorted)
+            {
+                ShaderVariableRecord record;
+                record.map = (uint32_t)map;
+                record.name = addString(pEntry->first);
+                record.bindLocation = pEntry->second.bindLocation;
+                record.semanticName = addString(pEntry->second.semanticName);
+                record.type = (uint32_t)pEntry->second.type;
+                mShaderVariables.push_back(record);
+            }
+        }
+
+        std::unordered_map<std::string, uint32_t> mStringIndices;
+        std::unordered_map<const ReflectionType*, uint32_t> mTypeIndices;
+        std::unordered_map<const ReflectionVar*, uint32_t> mVarIndices;
+        std::unordered_map<const ParameterBlockReflection*, uint32_t> mBlockIndices;
+
+        std::vector<char> mStringData;
+        std::vector<uint32_t> mStringOffsets = { 0 };
+        std::vector<TypeRecord> mTypes;
+        std::vector<VarRecord> mVars;
+        std::vector<uint32_t> mMembers;
+        std::vector<BlockRecord> mBlocks;
+        std::vector<RangeRecord> mRanges;
+        std::vector<ShaderVariableRecord> mShaderVariables;
+        bool mUnsupported = false;
+    };
+
+    /** Recreates a program reflection from the record arrays written by ProgramReflectionWriter.
+        Objects are created on first reference. Throws if the data is malformed.
+    */
+    class ProgramReflectionReader
+    {
+    public:
+        ProgramReflectionReader(ProgramVersion const* pProgramVersion) : mpProgramVersion(pProgramVersion) {}
+
+        ProgramReflection::SharedPtr read(slang::ShaderReflection* pSlangReflector, const void* pData, size_t size)
+        {
+            DataReader reader(reinterpret_cast<const uint8_t*>(pData), size);
+
+            char magic[sizeof(kMagic)];
+            reader.readBytes(magic, sizeof(magic));
+            if (std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || reader.read<uint32_t>() != ProgramReflection::kSerializationVersion)
+            {
+                throw std::runtime_error("Invalid header or version");
+            }
+
+            mStringData = reader.readVector<char>();
+            mStringOffsets = reader.readVector<uint32_t>();
+            mTypes = reader.readVector<TypeRecord>();
+            mVars = reader.readVector<VarRecord>();
+            mMembers = reader.readVector<uint32_t>();
+            mBlocks = reader.readVector<BlockRecord>();
+            mRanges = reader.readVector<RangeRecord>();
+            auto shaderVariables = reader.readVector<ShaderVariableRecord>();
+            auto program = reader.read<ProgramRecord>();
+            auto groups = reader.readVector<uint32_t>();
+            if (!reader.isEnd()) throw std::runtime_error("Unexpected data after the end of the reflection");
+
+            mTypeObjects.resize(mTypes.size());
+            mVarObjects.resize(mVars.size());
+            mBlockObjects.resize(mBlocks.size());
+            mPending.assign(mTypes.size() + mVars.size() + mBlocks.size(), false);
+
+            auto pReflection = ProgramReflection::SharedPtr(new ProgramReflection(mpProgramVersion));
+            pReflection->mpSlangReflector = pSlangReflector;
+            pReflection->setDefaultParameterBlock(getBlock(program.defaultBlock));
+            pReflection->mThreadGroupSize = uint3(program.threadGroupSize[0], program.threadGroupSize[1], program.threadGroupSize[2]);
+            pReflection->mIsSampleFrequency = program.isSampleFrequency != 0;
+
+            for (uint32_t groupIndex : groups)
+            {
+                auto pGroup = std::dynamic_pointer_cast<EntryPointGroupReflection>(getBlock(groupIndex));
+                if (!pGroup) throw std::runtime_error("Entry point group is not an entry point group block");
+                pReflection->mEntryPointGroups.push_back(pGroup);
+            }
+
+            for (const auto& record : shaderVariables)
+            {
+                ProgramReflection::VariableMap* pMap = nullptr;
+                switch ((VariableMapId)record.map)
+                {
+                case VariableMapId::PsOut: pMap = &pReflection->mPsOut; break;
+                case VariableMapId::VertAttr: pMap = &pReflection->mVertAttr; break;
+                case VariableMapId::VertAttrBySemantic: pMap = &pReflection->mVertAttrBySemantic; break;
+                default: throw std::runtime_error("Invalid shader variable map");
+                }
+
+                ProgramReflection::ShaderVariable var;
+                var.bindLocation = record.bindLocation;
+                var.semanticName = getString(record.semanticName);
+                var.type = (ReflectionBasicType::Type)(int32_t)record.type;
+                (*pMap)[getString(record.name)] = var;
+            }
+
+            return pReflection;
+        }
+
+    private:
+        std::string getString(uint32_t index) const
+        {
+            if ((size_t)index + 1 >= mStringOffsets.size()) throw std::runtime_error("Invalid string index");
+            uint32_t begin = mStringOffsets[index];
+            uint32_t end = mStringOffsets[index + 1];
+            if (begin > end || end > mStringData.size()) throw std::runtime_error("Invalid string offsets");
+            return std::string(mStringData.data() + begin, end - begin);
+        }
+
+        /** Get an object, creating it on first reference. Cyclic references can only come from corrupt data and are rejected.
+        */
+        template<typename T, typename CreateFunc>
+        T resolve(std::vector<T>& objects, size_t pendingOffset, uint32_t index, CreateFunc create)
+        {
+            if (index >= objects.size()) throw std::runtime_error("Invalid object index");
+            if (!objects[index])
+            {
+                if (mPending[pendingOffset + index]) throw std::runtime_error("Cyclic object reference");
+                mPending[pendingOffset + index] = true;
+                objects[index] = create(index);
+                mPending[pendingOffset + index] = false;
+            }
+            return objects[index];
+        }
+
+        ReflectionType::SharedConstPtr getType(uint32_t index)
+        {
+            if (index == kInvalidIndex) return nullptr;
+            return resolve(mTypeObjects, 0, index, [this](uint32_t i) { return createType(mTypes[i]); });
+        }
+
+        ReflectionVar::SharedConstPtr getVar(uint32_t index)
+        {
+            return resolve(mVarObjects, mTypes.size(), index, [this](uint32_t i) { return createVar(mVars[i]); });
+        }
+
+        ParameterBlockReflection::SharedPtr getBlock(uint32_t index)
+        {
+            return resolve(mBlockObjects, mTypes.size() + mVars.size(), index, [this](uint32_t i) { return createBlock(mBlocks[i]); });
+        }
+
+        ReflectionType::SharedConstPtr getRequiredType(uint32_t index)
+        {
+            auto pType = getType(index);
+            if (!pType) throw std::runtime_error("Missing type reference");
+            return pType;
+        }
+
+        ReflectionType::SharedConstPtr createType(const TypeRecord& record)
+        {
+            // Loaded types have no Slang type layouts. This is fine as types that need them for specialization are never serialized.
+            size_t byteSize = (size_t)record.byteSize;
+            switch ((ReflectionType::Kind)record.kind)
+            {
+            case ReflectionType::Kind::Array:
+                return ReflectionArrayType::create(record.args[0], record.args[1], getRequiredType(record.args[2]), byteSize, nullptr);
+            case ReflectionType::Kind::Struct:
+            {
+                // Adding the members in their original order recreates the name lookup and the resource ranges of the struct.
+                uint32_t firstMember = record.args[1];
+                uint32_t memberCount = record.args[2];
+                if (firstMember > mMembers.size() || memberCount > mMembers.size() - firstMember) throw std::runtime_error("Invalid struct member range");
+
+                auto pStructType = ReflectionStructType::create(byteSize, getString(record.args[0]), nullptr);
+                ReflectionStructType::BuildState buildState;
+                for (uint32_t i = 0; i < memberCount; i++) pStructType->addMember(getVar(mMembers[firstMember + i]), buildState);
+                return pStructType;
+            }
+            case ReflectionType::Kind::Basic:
+                return ReflectionBasicType::create((ReflectionBasicType::Type)(int32_t)record.args[0], record.args[1] != 0, byteSize, nullptr);
+            case ReflectionType::Kind::Resource:
+            {
+                auto pResourceType = ReflectionResourceType::create(
+                    (ReflectionResourceType::Type)record.args[0],
+                    (ReflectionResourceType::Dimensions)record.args[1],
+                    (ReflectionResourceType::StructuredType)record.args[2],
+                    (ReflectionResourceType::ReturnType)record.args[3],
+                    (ReflectionResourceType::ShaderAccess)record.args[4],
+                    nullptr);
+                pResourceType->setStructType(getType(record.args[5]));
+                if (record.args[6] != kInvalidIndex) pResourceType->setParameterBlockReflector(getBlock(record.args[6]));
+                return pResourceType;
+            }
+            default:
+                throw std::runtime_error("Invalid type kind");
+            }
+        }
+
+        ReflectionVar::SharedConstPtr createVar(const VarRecord& record)
+        {
+            ShaderVarOffset offset(UniformShaderVarOffset(record.byteOffset), ResourceShaderVarOffset(record.rangeIndex, record.arrayIndex));
+            return ReflectionVar::create(getString(record.name), getRequiredType(record.type), offset);
+        }
+
+        ParameterBlockReflection::SharedPtr createBlock(const BlockRecord& record)
+        {
+            ParameterBlockReflection::SharedPtr pBlock = record.isEntryPointGroup
+                ? ParameterBlockReflection::SharedPtr(new EntryPointGroupReflection(mpProgramVersion))
+                : ParameterBlockReflection::createEmpty(mpProgramVersion);
+
+            auto pElementType = getRequiredType(record.elementType);
+            pBlock->setElementType(pElementType);
+
+            ParameterBlockReflection::DefaultConstantBufferBindingInfo cbInfo;
+            cbInfo.regIndex = record.cbRegIndex;
+            cbInfo.regSpace = record.cbRegSpace;
+            cbInfo.useRootConstants = record.cbUseRootConstants != 0;
+            pBlock->setDefaultConstantBufferBindingInfo(cbInfo);
+
+            if (record.firstRange > mRanges.size() || record.rangeCount > mRanges.size() - record.firstRange) throw std::runtime_error("Invalid resource range list");
+            if (record.rangeCount != pElementType->getResourceRangeCount()) throw std::runtime_error("Resource ranges don't match the element type");
+
+            for (uint32_t i = 0; i < record.rangeCount; i++)
+            {
+                const RangeRecord& range = mRanges[record.firstRange + i];
+                if (range.flavor >= (uint32_t)ParameterBlockReflection::ResourceRangeBindingInfo::Flavor::Interface) throw std::runtime_error("Invalid resource range flavor");
+
+                ParameterBlockReflection::ResourceRangeBindingInfo bindingInfo;
+                bindingInfo.flavor = (ParameterBlockReflection::ResourceRangeBindingInfo::Flavor)range.flavor;
+                bindingInfo.regIndex = range.regIndex;
+                bindingInfo.regSpace = range.regSpace;
+                if (range.subObject != kInvalidIndex) bindingInfo.pSubObjectReflector = getBlock(range.subObject);
+                pBlock->addResourceRange(bindingInfo);
+            }
+
+            // Sub-objects are created before their parent, so finalize() sees finished sub-object reflectors, like when reflecting through Slang.
+            pBlock->finalize();
+            return pBlock;
+        }
+
+        ProgramVersion const* mpProgramVersion;
+
+        std::vector<char> mStringData;
+        std::vector<uint32_t> mStringOffsets;
+        std::vector<TypeRecord> mTypes;
+        std::vector<VarRecord> mVars;
+        std::vector<uint32_t> mMembers;
+        std::vector<BlockRecord> mBlocks;
+        std::vector<RangeRecord> mRanges;
+
+        std::vector<ReflectionType::SharedConstPtr> mTypeObjects;
+        std::vector<ReflectionVar::SharedConstPtr> mVarObjects;
+        std::vector<ParameterBlockReflection::SharedPtr> mBlockObjects;
+        std::vector<bool> mPending;
+    };
+
+    bool ProgramReflection::serialize(std::vector<uint8_t>& data) const
+    {
+        ProgramReflectionWriter writer;
+        return writer.write(*this, data);
+    }
+
+    ProgramReflection::SharedPtr ProgramReflection::deserialize(ProgramVersion const* pProgramVersion, slang::ShaderReflection* pSlangReflector, const void* pData, size_t size)
+    {
+        try
+        {
+            ProgramReflectionReader reader(pProgramVersion);
+            return reader.read(pSlangReflector, pData, size);
+        }
+        catch (const std::exception& e)
+        {
+            logWarning(std::string("Cached program reflection is invalid. ") + e.what());
+            return nullptr;
+        }
+    }
+}
@@ -138,13 +138,15 @@ namespace Falcor
         const DefineList&                                   defineList,
         const ProgramReflection::SharedPtr&                 pReflector,
         const std::string&                                  name,
-        std::vector<ComPtr<slang::IComponentType>> const&   pSlangEntryPoints)
+        std::vector<ComPtr<slang::IComponentType>> const&   pSlangEntryPoints,
+        const ShaderCache::Key&                             sourceKey)
     {
         assert(pReflector);
         mDefines = defineList,
         mpReflector = pReflector;
         mName = name;
         mpSlangEntryPoints = pSlangEntryPoints;
+        mSourceKey = sourceKey;
     }
 
     ProgramVersion::SharedPtr ProgramVersion::createEmpty(Program* pProgram, slang::IComponentType* pSlangGlobalScope)
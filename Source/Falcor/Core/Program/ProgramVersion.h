@@ -29,6 +29,7 @@
 #include "Core/Program/ProgramReflection.h"
 #include "Core/API/Shader.h"
 #include "Core/API/RootSignature.h"
+#include "Core/Program/ShaderCache.h"
 
 #include <slang/slang.h>
 
@@ -247,7 +248,8 @@ namespace Falcor
             const DefineList&                                   defineList,
             const ProgramReflection::SharedPtr&                 pReflector,
             const std::string&                                  name,
-            std::vector<ComPtr<slang::IComponentType>> const&   pSlangEntryPoints);
+            std::vector<ComPtr<slang::IComponentType>> const&   pSlangEntryPoints,
+            const ShaderCache::Key&                             sourceKey);
 
         std::shared_ptr<Program>        mpProgram;
         DefineList                      mDefines;
@@ -255,6 +257,7 @@ namespace Falcor
         std::string                     mName;
         ComPtr<slang::IComponentType>   mpSlangGlobalScope;
         std::vector<ComPtr<slang::IComponentType>> mpSlangEntryPoints;
+        ShaderCache::Key                mSourceKey;     ///< Hash of the sources, defines and compiler options this version was compiled with.
 
         // Cached version of compiled kernels for this program version
         mutable std::unordered_map<std::string, ProgramKernels::SharedPtr> mpKernels;
@@ -0,0 +1,364 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "ShaderCache.h"
+#include <filesystem>
+#include <fstream>
+
+namespace Falcor
+{
+    const uint64_t ShaderCache::kDefaultMaxSize = 512ull * 1024 * 1024;
+    const char* ShaderCache::kFileExtension = "fshader";
+
+    namespace
+    {
+        const char kMagic[8] = { 'F', 'S', 'H', 'A', 'D', 'E', 'R', '\0' };
+
+        struct FileHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t reserved;
+            uint64_t keyHi;
+            uint64_t keyLo;
+            uint64_t dataSize;
+            uint64_t checksum;
+        };
+
+        // The two halves of the key use independent hash functions: 64-bit FNV-1a and a rotate-multiply hash.
+        const uint64_t kSeedLo = 14695981039346656037ull;
+        const uint64_t kSeedHi = 0x6a09e667f3bcc908ull;
+
+        void hashBytes(const void* pData, size_t size, uint64_t& hi, uint64_t& lo)
+        {
+            const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pData);
+            for (size_t i = 0; i < size; i++)
+            {
+                lo = (lo ^ pBytes[i]) * 1099511628211ull;
+                hi = (((hi << 5) | (hi >> 59)) ^ pBytes[i]) * 0x9e3779b97f4a7c15ull;
+            }
+        }
+
+        uint64_t computeChecksum(const void* pData, size_t size)
+        {
+            return ShaderCache::KeyBuilder().addBytes(pData, size).getKey().lo;
+        }
+    }
+
+    std::string ShaderCache::Key::toString() const
+    {
+        char str[33];
+        snprintf(str, sizeof(str), "%016llx%016llx", (unsigned long long)hi, (unsigned long long)lo);
+        return str;
+    }
+
+    bool ShaderCache::Key::fromString(const std::string& str, Key& key)
+    {
+        if (str.size() != 32) return false;
+        for (char c : str)
+        {
+            if (!isxdigit((unsigned char)c)) return false;
+        }
+        key.hi = std::strtoull(str.substr(0, 16).c_str(), nullptr, 16);
+        key.lo = std::strtoull(str.substr(16).c_str(), nullptr, 16);
+        return true;
+    }
+
+    ShaderCache::KeyBuilder::KeyBuilder()
+    {
+        mKey.hi = kSeedHi;
+        mKey.lo = kSeedLo;
+    }
+
+    ShaderCache::KeyBuilder::KeyBuilder(const Key& key)
+        : KeyBuilder()
+    {
+        addKey(key);
+    }
+
+    ShaderCache::KeyBuilder& ShaderCache::KeyBuilder::addBytes(const void* pData, size_t size)
+    {
+        hashBytes(pData, size, mKey.hi, mKey.lo);
+        return *this;
+    }
+
+    ShaderCache::KeyBuilder& ShaderCache::KeyBuilder::addString(const std::string& str)
+    {
+        addValue((uint64_t)str.size());
+        return addBytes(str.data(), str.size());
+    }
+
+    bool ShaderCache::KeyBuilder::addFile(const std::string& path)
+    {
+        addString(path);
+
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+        {
+            addValue(uint64_t(-1));
+            return false;
+        }
+
+        std::vector<char> data((size_t)file.tellg());
+        file.seekg(0);
+        file.read(data.data(), data.size());
+        if (!file)
+        {
+            addValue(uint64_t(-1));
+            return false;
+        }
+
+        addValue((uint64_t)data.size());
+        addBytes(data.data(), data.size());
+        return true;
+    }
+
+    ShaderCache::SharedPtr ShaderCache::create(const std::string& directory, uint64_t maxSize)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (!std::filesystem::is_directory(directory, ec))
+        {
+            logWarning("Can't create shader cache directory '" + directory + "'.");
+            return nullptr;
+        }
+
+        SharedPtr pCache = SharedPtr(new ShaderCache(directory, maxSize));
+        pCache->scanDirectory();
+        std::lock_guard<std::mutex> lock(pCache->mMutex);
+        pCache->evict();
+        return pCache;
+    }
+
+    std::string ShaderCache::getDefaultDirectory()
+    {
+        return getAppDataDirectory() + "/NVIDIA/Falcor/ShaderCache";
+    }
+
+    ShaderCache::ShaderCache(const std::string& directory, uint64_t maxSize)
+        : mDirectory(directory)
+        , mMaxSize(maxSize)
+    {
+    }
+
+    std::string ShaderCache::getEntryPath(const Key& key) const
+    {
+        return mDirectory + "/" + key.toString() + "." + kFileExtension;
+    }
+
+    void ShaderCache::scanDirectory()
+    {
+        struct FoundEntry
+        {
+            Key key;
+            uint64_t size;
+            std::filesystem::file_time_type time;
+        };
+        std::vector<FoundEntry> found;
+
+        std::error_code ec;
+        for (const auto& it : std::filesystem::directory_iterator(mDirectory, ec))
+        {
+            if (!it.is_regular_file(ec) || it.path().extension() != std::string(".") + kFileExtension) continue;
+
+            FoundEntry entry;
+            if (!Key::fromString(it.path().stem().string(), entry.key)) continue;
+            entry.size = it.file_size(ec);
+            if (ec) continue;
+            entry.time = it.last_write_time(ec);
+            if (ec) continue;
+            found.push_back(entry);
+        }
+
+        // Most recently written files go to the front of the LRU list.
+        std::sort(found.begin(), found.end(), [](const FoundEntry& a, const FoundEntry& b) { return a.time > b.time; });
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const auto& entry : found)
+        {
+            mLru.push_back(entry.key);
+            mEntries[entry.key] = { entry.size, std::prev(mLru.end()) };
+            mStats.sizeInBytes += entry.size;
+        }
+    }
+
+    void ShaderCache::removeEntry(const Key& key)
+    {
+        auto it = mEntries.find(key);
+        if (it == mEntries.end()) return;
+
+        mStats.sizeInBytes -= it->second.size;
+        mLru.erase(it->second.lruIt);
+        mEntries.erase(it);
+
+        std::error_code ec;
+        std::filesystem::remove(getEntryPath(key), ec);
+    }
+
+    void ShaderCache::evict()
+    {
+        while (mStats.sizeInBytes > mMaxSize && !mLru.empty())
+        {
+            removeEntry(mLru.back());
+            mStats.evictionCount++;
+        }
+    }
+
+    bool ShaderCache::load(const Key& key, std::vector<uint8_t>& data)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mEntries.find(key);
+            if (it == mEntries.end())
+            {
+                mStats.missCount++;
+                return false;
+            }
+            mLru.splice(mLru.begin(), mLru, it->second.lruIt);
+        }
+
+        // Read the file outside of the lock. The entry may be evicted concurrently, in which case the read fails and is reported as a miss.
+        const std::string path = getEntryPath(key);
+        bool valid = false;
+        {
+            std::ifstream file(path, std::ios::binary);
+            FileHeader header = {};
+            if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+                std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+                header.version == kVersion &&
+                header.keyHi == key.hi && header.keyLo == key.lo)
+            {
+                data.resize((size_t)header.dataSize);
+                valid = file.read(reinterpret_cast<char*>(data.data()), data.size()) && computeChecksum(data.data(), data.size()) == header.checksum;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!valid)
+        {
+            logWarning("Removing invalid shader cache entry '" + path + "'.");
+            removeEntry(key);
+            data.clear();
+            mStats.missCount++;
+            return false;
+        }
+
+        // Persist the access order for other processes.
+        std::error_code ec;
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+        mStats.hitCount++;
+        return true;
+    }
+
+    bool ShaderCache::store(const Key& key, const void* pData, size_t size)
+    {
+        FileHeader header = {};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.keyHi = key.hi;
+        header.keyLo = key.lo;
+        header.dataSize = size;
+        header.checksum = computeChecksum(pData, size);
+
+        // Write to a temporary file first, so that a crash or a concurrent reader never sees a partial entry.
+        const std::string path = getEntryPath(key);
+        const std::string tempPath = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        std::error_code ec;
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(pData), size);
+            if (!file)
+            {
+                file.close();
+                std::filesystem::remove(tempPath, ec);
+                logWarning("Can't write shader cache entry '" + path + "'.");
+                return false;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // Drop the index entry of a previous version without deleting the file, which is replaced below.
+        auto it = mEntries.find(key);
+        if (it != mEntries.end())
+        {
+            mStats.sizeInBytes -= it->second.size;
+            mLru.erase(it->second.lruIt);
+            mEntries.erase(it);
+        }
+
+        std::filesystem::rename(tempPath, path, ec);
+        if (ec)
+        {
+            std::filesystem::remove(tempPath, ec);
+            logWarning("Can't write shader cache entry '" + path + "'.");
+            return false;
+        }
+
+        const uint64_t entrySize = sizeof(header) + size;
+        mLru.push_front(key);
+        mEntries[key] = { entrySize, mLru.begin() };
+        mStats.sizeInBytes += entrySize;
+        mStats.storeCount++;
+        evict();
+        return true;
+    }
+
+    bool ShaderCache::contains(const Key& key) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mEntries.find(key) != mEntries.end();
+    }
+
+    void ShaderCache::clear()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::error_code ec;
+        for (const auto& key : mLru) std::filesystem::remove(getEntryPath(key), ec);
+        mLru.clear();
+        mEntries.clear();
+        mStats = Stats();
+    }
+
+    void ShaderCache::setMaxSize(uint64_t maxSize)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mMaxSize = maxSize;
+        evict();
+    }
+
+    ShaderCache::Stats ShaderCache::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Stats stats = mStats;
+        stats.entryCount = mEntries.size();
+        return stats;
+    }
+}
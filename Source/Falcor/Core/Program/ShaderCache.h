@@ -0,0 +1,195 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include <list>
+#include <mutex>
+
+namespace Falcor
+{
+    /** Persistent, content-addressed cache of compiled shader kernels.
+
+        Each entry maps a 128-bit key to the code blob generated for one entry point. The key is a hash of everything that
+        affects code generation: the content of the transitive set of included files, the define lists, the shader model,
+        the compiler flags, the compiler versions, the entry point and the specialization arguments. Keys are built with ShaderCache::KeyBuilder.
+
+        Entries are stored as one file per key in the cache directory, so the cache is shared between processes. The total
+        size of the stored entries is bounded; when it is exceeded, the least recently used entries are evicted. The access
+        order is persisted through the file modification times. All operations are thread safe.
+    */
+    class dlldecl ShaderCache
+    {
+    public:
+        using SharedPtr = std::shared_ptr<ShaderCache>;
+
+        static const uint32_t kVersion = 2;             ///< Cache format version. Increment when the file format or the key derivation changes. Compiler versions are part of the key.
+        static const uint64_t kDefaultMaxSize;          ///< Default size limit of the cache in bytes.
+        static const char* kFileExtension;              ///< File extension of cache entries.
+
+        /** Cache key.
+        */
+        struct Key
+        {
+            uint64_t hi = 0;
+            uint64_t lo = 0;
+
+            bool operator==(const Key& other) const { return hi == other.hi && lo == other.lo; }
+            bool operator!=(const Key& other) const { return !(*this == other); }
+
+            /** Get the key as a 32 character hex string.
+            */
+            std::string toString() const;
+
+            /** Parse a key from a 32 character hex string.
+                \return True if the string is a valid key.
+            */
+            static bool fromString(const std::string& str, Key& key);
+        };
+
+        /** Builds a cache key by hashing a sequence of values.
+            Strings are hashed together with their length, so the sequences ("ab", "c") and ("a", "bc") give different keys.
+        */
+        class dlldecl KeyBuilder
+        {
+        public:
+            KeyBuilder();
+
+            /** Start from an existing key.
+            */
+            explicit KeyBuilder(const Key& key);
+
+            KeyBuilder& addBytes(const void* pData, size_t size);
+            KeyBuilder& addString(const std::string& str);
+            KeyBuilder& addKey(const Key& key) { return addBytes(&key.hi, sizeof(key.hi)).addBytes(&key.lo, sizeof(key.lo)); }
+
+            template<typename T>
+            KeyBuilder& addValue(const T& value)
+            {
+                static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "KeyBuilder::addValue() expects a scalar type");
+                return addBytes(&value, sizeof(T));
+            }
+
+            /** Add a string-to-string map. The entries are hashed in the iteration order of the map.
+            */
+            template<typename MapType>
+            KeyBuilder& addMap(const MapType& map)
+            {
+                addValue((uint64_t)map.size());
+                for (const auto& it : map) addString(it.first).addString(it.second);
+                return *this;
+            }
+
+            /** Add the path and the content of a file.
+                \return False if the file can't be read. The path is hashed in any case.
+            */
+            bool addFile(const std::string& path);
+
+            Key getKey() const { return mKey; }
+
+        private:
+            Key mKey;
+        };
+
+        struct Stats
+        {
+            uint64_t hitCount = 0;          ///< Number of successful lookups.
+            uint64_t missCount = 0;         ///< Number of failed lookups.
+            uint64_t storeCount = 0;        ///< Number of stored entries.
+            uint64_t evictionCount = 0;     ///< Number of entries evicted to stay within the size limit.
+            uint64_t entryCount = 0;        ///< Number of entries currently in the cache.
+            uint64_t sizeInBytes = 0;       ///< Total size of the entries currently in the cache.
+        };
+
+        /** Create a cache. Existing entries in the directory are indexed, and evicted if they exceed the size limit.
+            \param[in] directory Directory holding the cache entries. Created if it doesn't exist.
+            \param[in] maxSize Maximum total size of the entries in bytes.
+            \return A new object, or nullptr if the directory can't be created.
+        */
+        static SharedPtr create(const std::string& directory, uint64_t maxSize = kDefaultMaxSize);
+
+        /** Get the directory used for the default cache shared by all programs.
+        */
+        static std::string getDefaultDirectory();
+
+        /** Look up an entry and mark it as most recently used.
+            \param[in] key The cache key.
+            \param[out] data The stored blob.
+            \return True if the entry was found and is valid. Corrupt entries are removed and reported as misses.
+        */
+        bool load(const Key& key, std::vector<uint8_t>& data);
+
+        /** Store an entry, replacing any existing entry with the same key. Evicts least recently used entries if the size limit is exceeded.
+            \return True if the entry was written.
+        */
+        bool store(const Key& key, const void* pData, size_t size);
+
+        /** Check if an entry is in the cache, without updating its access order or the statistics.
+        */
+        bool contains(const Key& key) const;
+
+        /** Remove all entries from the cache directory and reset the statistics.
+        */
+        void clear();
+
+        /** Set the size limit. Evicts entries if the new limit is exceeded.
+        */
+        void setMaxSize(uint64_t maxSize);
+
+        uint64_t getMaxSize() const { return mMaxSize; }
+        const std::string& getDirectory() const { return mDirectory; }
+        Stats getStats() const;
+
+    private:
+        ShaderCache(const std::string& directory, uint64_t maxSize);
+        ShaderCache(const ShaderCache&) = delete;
+        void operator=(const ShaderCache&) = delete;
+
+        struct KeyHash
+        {
+            size_t operator()(const Key& key) const { return size_t(key.lo ^ (key.hi * 0x9e3779b97f4a7c15ull)); }
+        };
+
+        struct Entry
+        {
+            uint64_t size;
+            std::list<Key>::iterator lruIt;
+        };
+
+        std::string getEntryPath(const Key& key) const;
+        void scanDirectory();
+        void removeEntry(const Key& key);
+        void evict();
+
+        std::string mDirectory;
+        uint64_t mMaxSize;
+
+        mutable std::mutex mMutex;
+        std::list<Key> mLru;    ///< Keys ordered from most to least recently used.
+        std::unordered_map<Key, Entry, KeyHash> mEntries;
+        Stats mStats;
+    };
+}
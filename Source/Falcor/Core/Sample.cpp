@@ -171,6 +171,7 @@ namespace Falcor
         mpRenderer.reset();
         if (mVideoCapture.pVideoCapture) endVideoCapture();
 
+        Texture::flushCaptures();
         Clock::shutdown();
         Threading::shutdown();
         Scripting::shutdown();
@@ -430,9 +431,9 @@ namespace Falcor
                 if(gProfileEnabled)
                 {
                     profilerWindow.text(Profiler::getEventsString().c_str());
-                    Profiler::startEvent("renderUI");
                     profilerWindow.release();
                 }
+                Profiler::startEvent("renderUI"); // Restart the timer, the event is ended by the PROFILE scope
                 mpGui->setActiveFont("");
             }
 
@@ -488,6 +489,8 @@ namespace Falcor
                 PROFILE("present", Profiler::Flags::Internal);
                 gpDevice->present();
             }
+
+            Texture::retireCaptures();
         }
 
         Console::instance().flush();
@@ -28,6 +28,7 @@
 #include "stdafx.h"
 #include "LightBVHBuilder.h"
 #include <algorithm>
+#include <emmintrin.h>
 
 namespace
 {
@@ -41,6 +42,11 @@ namespace
     const uint32_t kMaxLeafTriangleCount = 1 << PackedNode::kTriangleCountBits;
     const uint32_t kMaxLeafTriangleOffset = 1 << PackedNode::kTriangleOffsetBits;
 
+    // Thresholds for the parallel build. Subtrees with fewer triangles are built serially by a single task,
+    // and binning is only distributed over multiple threads for nodes with at least as many triangles.
+    const uint32_t kParallelSubtreeMinTriangleCount = 16384;
+    const uint32_t kParallelBinningMinTriangleCount = 65536;
+
     inline float safeACos(float v)
     {
         return std::acos(glm::clamp(v, -1.0f, 1.0f));
@@ -201,6 +207,113 @@ namespace
         return dir;
     }
 
+    /** Combines the cosine of an accumulated cone angle with a candidate computed by computeCosConeAngleCandidates().
+        Folding the candidates in order gives the same result as accumulating the cones with computeCosConeAngle().
+    */
+    inline float foldCosConeAngle(float cosTheta, float cosCandidate)
+    {
+        return (cosTheta == kInvalidCosConeAngle || cosCandidate == kInvalidCosConeAngle) ? kInvalidCosConeAngle : std::min(cosTheta, cosCandidate);
+    }
+
+    /** SIMD version of computeCosConeAngle() for four cones at a time, without the accumulated cone angle.
+        The operations are performed in the same order as in the scalar version, so the results are bit-identical.
+        \return The cosines of the spread angles, or kInvalidCosConeAngle in lanes where the resulting cone is invalid.
+    */
+    inline __m128 computeCosConeAngleCandidates(__m128 dirX, __m128 dirY, __m128 dirZ, __m128 otherDirX, __m128 otherDirY, __m128 otherDirZ, __m128 cosOtherTheta)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 invalid = _mm_set1_ps(kInvalidCosConeAngle);
+
+        const __m128 cosDiffTheta = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dirX, otherDirX), _mm_mul_ps(dirY, otherDirY)), _mm_mul_ps(dirZ, otherDirZ));
+        const __m128 sinDiffTheta = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(cosDiffTheta, cosDiffTheta)), zero));
+        const __m128 sinOtherTheta = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(cosOtherTheta, cosOtherTheta)), zero));
+
+        const __m128 cosTotalTheta = _mm_sub_ps(_mm_mul_ps(cosOtherTheta, cosDiffTheta), _mm_mul_ps(sinOtherTheta, sinDiffTheta));
+        const __m128 sinTotalTheta = _mm_add_ps(_mm_mul_ps(sinOtherTheta, cosDiffTheta), _mm_mul_ps(cosOtherTheta, sinDiffTheta));
+
+        const __m128 valid = _mm_and_ps(_mm_cmpgt_ps(sinTotalTheta, zero), _mm_cmpneq_ps(cosOtherTheta, invalid));
+        return _mm_or_ps(_mm_and_ps(valid, cosTotalTheta), _mm_andnot_ps(valid, invalid));
+    }
+
+    /** Computes the cosine of the spread angle of a cone around coneDir that encloses the cones [first, last), given in SoA layout.
+        This is equivalent to accumulating the cones in order with computeCosConeAngle() starting from a cosine of one:
+        the result is invalid if any candidate is invalid, and the minimum over the candidates otherwise.
+        The arrays are read in groups of four and must be padded by three elements past the last cone.
+    */
+    float computeCosConeAngleSIMD(const float3& coneDir, const float* dirX, const float* dirY, const float* dirZ, const float* cosTheta, uint32_t first, uint32_t last)
+    {
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 invalid = _mm_set1_ps(kInvalidCosConeAngle);
+        const __m128 x = _mm_set1_ps(coneDir.x), y = _mm_set1_ps(coneDir.y), z = _mm_set1_ps(coneDir.z);
+        const __m128i end = _mm_set1_epi32((int)last);
+
+        __m128 minCosTheta = one;
+        __m128 anyInvalid = _mm_setzero_ps();
+        for (uint32_t i = first; i < last; i += 4)
+        {
+            __m128 c = computeCosConeAngleCandidates(x, y, z, _mm_loadu_ps(dirX + i), _mm_loadu_ps(dirY + i), _mm_loadu_ps(dirZ + i), _mm_loadu_ps(cosTheta + i));
+
+            // Lanes past the last cone don't contribute.
+            const __m128 active = _mm_castsi128_ps(_mm_cmplt_epi32(_mm_setr_epi32((int)i, (int)i + 1, (int)i + 2, (int)i + 3), end));
+            c = _mm_or_ps(_mm_and_ps(active, c), _mm_andnot_ps(active, one));
+
+            minCosTheta = _mm_min_ps(minCosTheta, c);
+            anyInvalid = _mm_or_ps(anyInvalid, _mm_cmpeq_ps(c, invalid));
+        }
+        if (_mm_movemask_ps(anyInvalid) != 0) return kInvalidCosConeAngle;
+
+        float m[4];
+        _mm_storeu_ps(m, minCosTheta);
+        return std::min(std::min(m[0], m[1]), std::min(m[2], m[3]));
+    }
+
+    /** Computes the bin id min((uint32_t)((p - bmin) * scale), binCount - 1) for an array of positions, four at a time.
+        The positions are all inside the node bounds. For non-negative values, clamping before the conversion to integer gives the same result.
+    */
+    void computeBinIdsSIMD(const float* positions, uint32_t count, float bmin, float scale, uint32_t binCount, uint32_t* binIds)
+    {
+        const __m128 offset = _mm_set1_ps(bmin);
+        const __m128 factor = _mm_set1_ps(scale);
+        const __m128 maxBinId = _mm_set1_ps((float)(binCount - 1));
+
+        uint32_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128 p = _mm_loadu_ps(positions + i);
+            const __m128 binId = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(p, offset), factor), maxBinId);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(binIds + i), _mm_cvttps_epi32(binId));
+        }
+        for (; i < count; ++i)
+        {
+            binIds[i] = std::min((uint32_t)((positions[i] - bmin) * scale), binCount - 1);
+        }
+    }
+
+    inline __m128 load(const float4& v) { return _mm_loadu_ps(&v.x); }
+
+    /** Component-wise min/max with the same semantics as glm::min(a, b) and glm::max(a, b), including the handling of signed zeros.
+    */
+    inline __m128 simdMin(__m128 a, __m128 b) { return _mm_min_ps(b, a); }
+    inline __m128 simdMax(__m128 a, __m128 b) { return _mm_max_ps(b, a); }
+
+    inline float3 toFloat3(__m128 v)
+    {
+        float4 result;
+        _mm_storeu_ps(&result.x, v);
+        return float3(result);
+    }
+
+    /** Reorders the elements values[offset + i] to values[offset + order[offset + i].second] for i in [0, count).
+        Only the same range of the scratch buffer is used, so disjoint ranges can be permuted concurrently.
+    */
+    template<typename T>
+    void permuteRange(std::vector<T>& values, std::vector<T>& scratch, uint32_t offset, uint32_t count, const std::vector<std::pair<float, uint32_t>>& order)
+    {
+        for (uint32_t i = offset; i < offset + count; ++i) scratch[i] = values[offset + order[i].second];
+        std::copy(scratch.begin() + offset, scratch.begin() + offset + count, values.begin() + offset);
+    }
+
     const Gui::DropdownList kSplitHeuristicList =
     {
         { (uint32_t)LightBVHBuilder::SplitHeuristic::Equal, "Equal" },
@@ -228,34 +341,48 @@ namespace Falcor
         // Get global list of emissive triangles.
         assert(bvh.mpLightCollection);
         const auto& triangles = bvh.mpLightCollection->getMeshLightTriangles();
-        if (triangles.empty()) return;
+
+        std::vector<uint32_t> triangleIndices;
+        std::vector<uint64_t> triangleBitmasks;
+        if (!buildNodes(triangles, bvh.mNodes, triangleIndices, triangleBitmasks)) return;
+
+        // The BVH is ready, mark it as valid and upload the data.
+        bvh.mIsValid = true;
+        bvh.mMaxTriangleCountPerLeaf = mOptions.maxTriangleCountPerLeaf;
+        bvh.uploadCPUBuffers(triangleIndices, triangleBitmasks);
+
+        // Computate metadata.
+        bvh.finalize();
+    }
+
+    bool LightBVHBuilder::buildNodes(const std::vector<LightCollection::MeshLightTriangle>& triangles, std::vector<PackedNode>& nodes, std::vector<uint32_t>& triangleIndices, std::vector<uint64_t>& triangleBitmasks) const
+    {
+        nodes.clear();
+        triangleIndices.clear();
+        triangleBitmasks.clear();
+        if (triangles.empty()) return false;
 
         // Create list of triangles that should be included in BVH.
         // For each triangle, precompute data we need for the build.
-        BuildingData data(bvh.mNodes);
+        BuildingData data(nodes);
         data.trianglesData.reserve(triangles.size());
 
         for (size_t i = 0; i < triangles.size(); i++)
         {
             if (!mOptions.usePreintegration || triangles[i].flux > 0.f)
             {
-                LightBVHBuilder::TriangleSortData tri;
+                BBox bounds;
                 for (uint32_t j = 0; j < 3; j++)
                 {
-                    tri.bounds |= triangles[i].vtx[j].pos;
+                    bounds |= triangles[i].vtx[j].pos;
                 }
-                tri.center = triangles[i].getCenter();
-                tri.coneDirection = triangles[i].normal;
-                tri.cosConeAngle = 1.f; // Single flat emitter => normal bounding cone angle is zero.
-                tri.flux = triangles[i].flux;
-                tri.triangleIndex = static_cast<uint32_t>(i);
-
-                data.trianglesData.push_back(tri);
+                const float cosConeAngle = 1.f; // Single flat emitter => normal bounding cone angle is zero.
+                data.trianglesData.push_back(bounds, triangles[i].normal, cosConeAngle, triangles[i].flux, static_cast<uint32_t>(i));
             }
         }
 
         // If there are no non-culled triangles, we're done.
-        if (data.trianglesData.empty()) return;
+        if (data.trianglesData.empty()) return false;
 
         // Validate options.
         if (mOptions.maxTriangleCountPerLeaf > kMaxLeafTriangleCount)
@@ -271,16 +398,29 @@ namespace Falcor
         // To be grossly conservative, assume each triangle requires two nodes.
         // This is only system RAM and shouldn't be that much, so it's not worth being more careful about it.
         // TODO: Better estimate of how many nodes we will need.
-        data.nodes.clear();
         data.nodes.reserve(2 * data.trianglesData.size());
         data.triangleIndices.reserve(data.trianglesData.size());
+        data.partitionOrder.resize(data.trianglesData.size());
+        data.partitionScratch4.resize(data.trianglesData.size());
+        data.partitionScratchFloat.resize(data.trianglesData.size());
+        data.partitionScratchUint.resize(data.trianglesData.size());
 
         const uint64_t invalidBitmask = std::numeric_limits<uint64_t>::max();
         data.triangleBitmasks.resize(triangles.size(), invalidBitmask); // This is sized based on input triangle count, as it's indexed by global triangle index.
 
         // Build the tree.
         SplitHeuristicFunction splitFunc = getSplitFunction(mOptions.splitHeuristicSelection);
-        buildInternal(mOptions, splitFunc, 0ull, 0, Range(0, static_cast<uint32_t>(data.trianglesData.size())), data);
+        const Range rootRange(0, static_cast<uint32_t>(data.trianglesData.size()));
+        if (mOptions.useParallelBuild && rootRange.length() >= kParallelSubtreeMinTriangleCount)
+        {
+            Subtree root;
+            buildParallel(mOptions, splitFunc, 0ull, 0, rootRange, data, root);
+            flattenSubtree(root, data);
+        }
+        else
+        {
+            buildInternal(mOptions, splitFunc, 0ull, 0, rootRange, data, data.nodes, data.triangleIndices);
+        }
         assert(!data.nodes.empty());
 
         size_t numValid = 0;
@@ -292,13 +432,9 @@ namespace Falcor
         float cosConeAngle;
         computeLightingConesInternal(0, data, cosConeAngle);
 
-        // The BVH is ready, mark it as valid and upload the data.
-        bvh.mIsValid = true;
-        bvh.mMaxTriangleCountPerLeaf = mOptions.maxTriangleCountPerLeaf;
-        bvh.uploadCPUBuffers(data.triangleIndices, data.triangleBitmasks);
-
-        // Computate metadata.
-        bvh.finalize();
+        triangleIndices = std::move(data.triangleIndices);
+        triangleBitmasks = std::move(data.triangleBitmasks);
+        return true;
     }
 
     bool LightBVHBuilder::renderUI(Gui::Widgets& widget)
@@ -325,6 +461,8 @@ namespace Falcor
                 optionsChanged |= splitGroup.var("Bin count", options.binCount);
             }
             optionsChanged |= splitGroup.checkbox("Split along largest dimension", options.splitAlongLargest);
+            optionsChanged |= splitGroup.checkbox("Parallel build", options.useParallelBuild);
+            optionsChanged |= splitGroup.checkbox("Use SIMD", options.useSIMD);
             optionsChanged |= splitGroup.checkbox("Use volume instead of surface area", options.useVolumeOverSA);
             if (options.useVolumeOverSA)
             {
@@ -349,24 +487,102 @@ namespace Falcor
     {
     }
 
-    uint32_t LightBVHBuilder::buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data)
+    void LightBVHBuilder::TriangleSortData::reserve(size_t count)
     {
-        assert(triangleRange.begin < triangleRange.end);
+        boundsMin.reserve(count);
+        boundsMax.reserve(count);
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            centroid[axis].reserve(count);
+            coneDirection[axis].reserve(count);
+        }
+        cosConeAngle.reserve(count);
+        flux.reserve(count);
+        triangleIndex.reserve(count);
+    }
 
-        // Compute the AABB and total flux of the node.
-        float nodeFlux = 0.f;
-        BBox nodeBounds;
-        for (uint32_t dataIndex = triangleRange.begin; dataIndex < triangleRange.end; ++dataIndex)
+    void LightBVHBuilder::TriangleSortData::push_back(const BBox& bounds, const float3& coneDir, float cosAngle, float triangleFlux, uint32_t globalIndex)
+    {
+        boundsMin.push_back(float4(bounds.minPoint, 0.f));
+        boundsMax.push_back(float4(bounds.maxPoint, 0.f));
+        const float3 c = bounds.centroid();
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            centroid[axis].push_back(c[axis]);
+            coneDirection[axis].push_back(coneDir[axis]);
+        }
+        cosConeAngle.push_back(cosAngle);
+        flux.push_back(triangleFlux);
+        triangleIndex.push_back(globalIndex);
+    }
+
+    void LightBVHBuilder::computeNodeBoundsAndFlux(const Range& triangleRange, const BuildingData& data, bool useSIMD, BBox& nodeBounds, float& nodeFlux)
+    {
+        nodeFlux = 0.f;
+        nodeBounds = BBox();
+        if (useSIMD)
         {
-            nodeBounds |= data.trianglesData[dataIndex].bounds;
-            nodeFlux += data.trianglesData[dataIndex].flux;
+            __m128 boundsMin = _mm_set1_ps(std::numeric_limits<float>::infinity());
+            __m128 boundsMax = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+            for (uint32_t dataIndex = triangleRange.begin; dataIndex < triangleRange.end; ++dataIndex)
+            {
+                boundsMin = simdMin(boundsMin, load(data.trianglesData.boundsMin[dataIndex]));
+                boundsMax = simdMax(boundsMax, load(data.trianglesData.boundsMax[dataIndex]));
+                nodeFlux += data.trianglesData.flux[dataIndex];
+            }
+            nodeBounds.minPoint = toFloat3(boundsMin);
+            nodeBounds.maxPoint = toFloat3(boundsMax);
+        }
+        else
+        {
+            for (uint32_t dataIndex = triangleRange.begin; dataIndex < triangleRange.end; ++dataIndex)
+            {
+                nodeBounds |= data.trianglesData.getBounds(dataIndex);
+                nodeFlux += data.trianglesData.flux[dataIndex];
+            }
         }
         assert(nodeBounds.valid());
+    }
+
+    void LightBVHBuilder::partitionTriangles(const Range& triangleRange, const SplitResult& splitResult, BuildingData& data)
+    {
+        // Partition (centroid, index) pairs and then reorder all the attribute arrays accordingly.
+        // The permutation only depends on the outcome of the comparisons, so it's the same as if the triangles were partitioned directly.
+        auto& trianglesData = data.trianglesData;
+        auto& order = data.partitionOrder;
+        const uint32_t offset = triangleRange.begin;
+        const uint32_t count = triangleRange.length();
+        assert(order.size() == trianglesData.size());
+
+        const auto& centroids = trianglesData.centroid[splitResult.axis];
+        for (uint32_t i = 0; i < count; ++i) order[offset + i] = std::make_pair(centroids[offset + i], i);
+
+        auto comp = [](const std::pair<float, uint32_t>& d1, const std::pair<float, uint32_t>& d2) { return d1.first < d2.first; };
+        std::nth_element(order.begin() + offset, order.begin() + splitResult.triangleIndex, order.begin() + offset + count, comp);
+
+        permuteRange(trianglesData.boundsMin, data.partitionScratch4, offset, count, order);
+        permuteRange(trianglesData.boundsMax, data.partitionScratch4, offset, count, order);
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            permuteRange(trianglesData.centroid[axis], data.partitionScratchFloat, offset, count, order);
+            permuteRange(trianglesData.coneDirection[axis], data.partitionScratchFloat, offset, count, order);
+        }
+        permuteRange(trianglesData.cosConeAngle, data.partitionScratchFloat, offset, count, order);
+        permuteRange(trianglesData.flux, data.partitionScratchFloat, offset, count, order);
+        permuteRange(trianglesData.triangleIndex, data.partitionScratchUint, offset, count, order);
+    }
+
+    uint32_t LightBVHBuilder::buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data, std::vector<PackedNode>& nodes, std::vector<uint32_t>& triangleIndices)
+    {
+        assert(triangleRange.begin < triangleRange.end);
 
-        data.currentNodeFlux = nodeFlux;
+        // Compute the AABB and total flux of the node.
+        float nodeFlux;
+        BBox nodeBounds;
+        computeNodeBoundsAndFlux(triangleRange, data, options.useSIMD, nodeBounds, nodeFlux);
 
         bool trySplitting = triangleRange.length() > (options.createLeavesASAP ? options.maxTriangleCountPerLeaf : 1);
-        const SplitResult splitResult = trySplitting ? splitHeuristic(data, triangleRange, nodeBounds, options) : SplitResult();
+        const SplitResult splitResult = trySplitting ? splitHeuristic(data, triangleRange, nodeBounds, nodeFlux, options) : SplitResult();
 
         // If we should split, then create an internal node and split.
         if (splitResult.isValid())
@@ -374,13 +590,12 @@ namespace Falcor
             assert(triangleRange.begin < splitResult.triangleIndex && splitResult.triangleIndex < triangleRange.end);
 
             // Sort the centroids and update the lists accordingly.
-            auto comp = [dim = splitResult.axis](const TriangleSortData& d1, const TriangleSortData& d2) { return d1.bounds.centroid()[dim] < d2.bounds.centroid()[dim]; };
-            std::nth_element(std::begin(data.trianglesData) + triangleRange.begin, std::begin(data.trianglesData) + splitResult.triangleIndex, std::begin(data.trianglesData) + triangleRange.end, comp);
+            partitionTriangles(triangleRange, splitResult, data);
 
             // Allocate internal node.
-            assert(data.nodes.size() < std::numeric_limits<uint32_t>::max());
-            const uint32_t nodeIndex = (uint32_t)data.nodes.size();
-            data.nodes.push_back({});
+            assert(nodes.size() < std::numeric_limits<uint32_t>::max());
+            const uint32_t nodeIndex = (uint32_t)nodes.size();
+            nodes.push_back({});
 
             InternalNode node = {};
             node.attribs.setAABB(nodeBounds.minPoint, nodeBounds.maxPoint);
@@ -394,13 +609,13 @@ namespace Falcor
                 throw std::exception(("BVH depth of " + std::to_string(depth + 1) + " reached; maximum of " + std::to_string(kMaxBVHDepth) + " allowed.").c_str());
             }
 
-            uint32_t leftIndex = buildInternal(options, splitHeuristic, bitmask | (0ull << depth), depth + 1, Range(triangleRange.begin, splitResult.triangleIndex), data);
-            uint32_t rightIndex = buildInternal(options, splitHeuristic, bitmask | (1ull << depth), depth + 1, Range(splitResult.triangleIndex, triangleRange.end), data);
+            uint32_t leftIndex = buildInternal(options, splitHeuristic, bitmask | (0ull << depth), depth + 1, Range(triangleRange.begin, splitResult.triangleIndex), data, nodes, triangleIndices);
+            uint32_t rightIndex = buildInternal(options, splitHeuristic, bitmask | (1ull << depth), depth + 1, Range(splitResult.triangleIndex, triangleRange.end), data, nodes, triangleIndices);
 
             assert(leftIndex == nodeIndex + 1); // The left node should always be placed immediately after the current node.
             node.rightChildIdx = rightIndex;
 
-            data.nodes[nodeIndex].setInternalNode(node);
+            nodes[nodeIndex].setInternalNode(node);
             return nodeIndex;
         }
         else // No split => create leaf node
@@ -408,9 +623,9 @@ namespace Falcor
             assert(triangleRange.length() <= options.maxTriangleCountPerLeaf);
 
             // Allocate leaf node.
-            assert(data.nodes.size() < std::numeric_limits<uint32_t>::max());
-            const uint32_t nodeIndex = (uint32_t)data.nodes.size();
-            data.nodes.push_back({});
+            assert(nodes.size() < std::numeric_limits<uint32_t>::max());
+            const uint32_t nodeIndex = (uint32_t)nodes.size();
+            nodes.push_back({});
 
             LeafNode node = {};
             node.attribs.setAABB(nodeBounds.minPoint, nodeBounds.maxPoint);
@@ -420,23 +635,115 @@ namespace Falcor
             node.attribs.cosConeAngle = cosTheta;
 
             node.triangleCount = triangleRange.length();
-            node.triangleOffset = (uint32_t)data.triangleIndices.size();
+            node.triangleOffset = (uint32_t)triangleIndices.size();
             assert(node.triangleCount < kMaxLeafTriangleCount);
             assert(node.triangleOffset < kMaxLeafTriangleOffset);
 
             for (uint32_t triangleIdx = triangleRange.begin, index = 0; triangleIdx < triangleRange.end; ++triangleIdx, ++index)
             {
-                uint32_t globalTriangleIndex = data.trianglesData[triangleIdx].triangleIndex;
-                data.triangleIndices.push_back(globalTriangleIndex);
+                uint32_t globalTriangleIndex = data.trianglesData.triangleIndex[triangleIdx];
+                triangleIndices.push_back(globalTriangleIndex);
                 data.triangleBitmasks[globalTriangleIndex] = bitmask;
             }
-            assert(data.triangleIndices.size() == node.triangleOffset + node.triangleCount);
+            assert(triangleIndices.size() == node.triangleOffset + node.triangleCount);
 
-            data.nodes[nodeIndex].setLeafNode(node);
+            nodes[nodeIndex].setLeafNode(node);
             return nodeIndex;
         }
     }
 
+    void LightBVHBuilder::buildParallel(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data, Subtree& subtree)
+    {
+        assert(triangleRange.begin < triangleRange.end);
+
+        // Small subtrees are built serially by the current task.
+        if (triangleRange.length() < kParallelSubtreeMinTriangleCount)
+        {
+            buildInternal(options, splitHeuristic, bitmask, depth, triangleRange, data, subtree.nodes, subtree.triangleIndices);
+            return;
+        }
+
+        // Compute the AABB and total flux of the node.
+        float nodeFlux;
+        BBox nodeBounds;
+        computeNodeBoundsAndFlux(triangleRange, data, options.useSIMD, nodeBounds, nodeFlux);
+
+        // Large nodes are always split, unless the heuristic fails. In that case let the serial builder create the node.
+        bool trySplitting = triangleRange.length() > (options.createLeavesASAP ? options.maxTriangleCountPerLeaf : 1);
+        const SplitResult splitResult = trySplitting ? splitHeuristic(data, triangleRange, nodeBounds, nodeFlux, options) : SplitResult();
+        if (!splitResult.isValid())
+        {
+            buildInternal(options, splitHeuristic, bitmask, depth, triangleRange, data, subtree.nodes, subtree.triangleIndices);
+            return;
+        }
+
+        assert(triangleRange.begin < splitResult.triangleIndex && splitResult.triangleIndex < triangleRange.end);
+
+        // Sort the centroids and update the lists accordingly.
+        // The two children only touch their own triangle range from here on, so they can be built concurrently.
+        partitionTriangles(triangleRange, splitResult, data);
+
+        subtree.node.attribs.setAABB(nodeBounds.minPoint, nodeBounds.maxPoint);
+        subtree.node.attribs.flux = nodeFlux;
+        // The lighting normal bounding cone will be computed later when all leaf nodes have been created.
+
+        if (depth >= kMaxBVHDepth)
+        {
+            throw std::exception(("BVH depth of " + std::to_string(depth + 1) + " reached; maximum of " + std::to_string(kMaxBVHDepth) + " allowed.").c_str());
+        }
+
+        subtree.pLeft = std::make_unique<Subtree>();
+        subtree.pRight = std::make_unique<Subtree>();
+
+        auto leftTask = Threading::dispatchTask([&]()
+        {
+            buildParallel(options, splitHeuristic, bitmask | (0ull << depth), depth + 1, Range(triangleRange.begin, splitResult.triangleIndex), data, *subtree.pLeft);
+        });
+        try
+        {
+            buildParallel(options, splitHeuristic, bitmask | (1ull << depth), depth + 1, Range(splitResult.triangleIndex, triangleRange.end), data, *subtree.pRight);
+        }
+        catch (...)
+        {
+            // The left task references this stack frame, so it has to finish before the exception unwinds it.
+            // Its own exception (if any) is dropped in favor of the one already in flight.
+            try { leftTask.finish(); } catch (...) {}
+            throw;
+        }
+        leftTask.finish();
+    }
+
+    void LightBVHBuilder::flattenSubtree(const Subtree& subtree, BuildingData& data)
+    {
+        if (subtree.pLeft)
+        {
+            assert(subtree.pRight);
+            assert(data.nodes.size() < std::numeric_limits<uint32_t>::max());
+            const uint32_t nodeIndex = (uint32_t)data.nodes.size();
+            data.nodes.push_back({});
+
+            flattenSubtree(*subtree.pLeft, data);
+            InternalNode node = subtree.node;
+            node.rightChildIdx = (uint32_t)data.nodes.size();
+            flattenSubtree(*subtree.pRight, data);
+
+            data.nodes[nodeIndex].setInternalNode(node);
+            return;
+        }
+
+        // Relocate the serially built nodes. Only the first dword is patched, as unpacking and repacking the node attributes is lossy.
+        // For internal nodes it holds the right child index, for leaf nodes the triangle offset is stored in the low bits.
+        const uint32_t nodeOffset = (uint32_t)data.nodes.size();
+        const uint32_t triangleOffset = (uint32_t)data.triangleIndices.size();
+        assert(triangleOffset + subtree.triangleIndices.size() <= kMaxLeafTriangleOffset);
+        for (PackedNode node : subtree.nodes)
+        {
+            node.data[0].x += node.isLeaf() ? triangleOffset : nodeOffset;
+            data.nodes.push_back(node);
+        }
+        data.triangleIndices.insert(data.triangleIndices.end(), subtree.triangleIndices.begin(), subtree.triangleIndices.end());
+    }
+
     float3 LightBVHBuilder::computeLightingConesInternal(const uint32_t nodeIndex, BuildingData& data, float& cosConeAngle)
     {
         if (!data.nodes[nodeIndex].isLeaf())
@@ -482,7 +789,7 @@ namespace Falcor
         float3 coneDirectionSum = float3(0.0f);
         for (uint32_t triangleIdx = triangleRange.begin; triangleIdx < triangleRange.end; ++triangleIdx)
         {
-            coneDirectionSum += data.trianglesData[triangleIdx].coneDirection;
+            coneDirectionSum += data.trianglesData.getConeDirection(triangleIdx);
         }
         if (glm::length(coneDirectionSum) >= FLT_MIN)
         {
@@ -490,14 +797,13 @@ namespace Falcor
             cosTheta = 1.f;
             for (uint32_t triangleIdx = triangleRange.begin; triangleIdx < triangleRange.end; ++triangleIdx)
             {
-                const TriangleSortData& td = data.trianglesData[triangleIdx];
-                cosTheta = computeCosConeAngle(coneDirection, cosTheta, td.coneDirection, td.cosConeAngle);
+                cosTheta = computeCosConeAngle(coneDirection, cosTheta, data.trianglesData.getConeDirection(triangleIdx), data.trianglesData.cosConeAngle[triangleIdx]);
             }
         }
         return coneDirection;
     }
 
-    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithEqual(const BuildingData& /*data*/, const Range& triangleRange, const BBox& nodeBounds, const Options& /*parameters*/)
+    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithEqual(const BuildingData& /*data*/, const Range& triangleRange, const BBox& nodeBounds, float /*nodeFlux*/, const Options& /*parameters*/)
     {
         // Find the largest dimension.
         float3 dimensions = nodeBounds.dimensions();
@@ -524,7 +830,7 @@ namespace Falcor
         return cost;
     }
 
-    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithBinnedSAH(const BuildingData& data, const Range& triangleRange, const BBox& nodeBounds, const Options& parameters)
+    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithBinnedSAH(const BuildingData& data, const Range& triangleRange, const BBox& nodeBounds, float /*nodeFlux*/, const Options& parameters)
     {
         std::pair<float, SplitResult> overallBestSplit = std::make_pair(std::numeric_limits<float>::infinity(), SplitResult());
         assert(!overallBestSplit.second.isValid());
@@ -535,7 +841,7 @@ namespace Falcor
             uint32_t triangleCount = 0;
 
             Bin() = default;
-            Bin(const TriangleSortData& tri) : bounds(tri.bounds), triangleCount(1) {}
+            Bin(const TriangleSortData& sortData, uint32_t i) : bounds(sortData.getBounds(i)), triangleCount(1) {}
             Bin& operator|= (const Bin& rhs)
             {
                 bounds |= rhs.bounds;
@@ -545,34 +851,80 @@ namespace Falcor
         };
 
         assert(parameters.binCount > 1);
-        std::vector<Bin> bins(parameters.binCount);
-        std::vector<float> costs(parameters.binCount - 1);
+
+        // Large nodes are binned on multiple threads. The bins only hold bounds and counts, so the result is independent of the order.
+        const bool parallelBinning = parameters.useParallelBuild && triangleRange.length() >= kParallelBinningMinTriangleCount;
 
         /** Helper function that computes the best split along the given dimension using the SAH metric.
             The triangles are binned to n bins, storing only the aggregate parameters (triangle count and bounds).
             Then the cost metric is evaluated for each of the n-1 potential splits.
+            Returns an invalid split if all lights fall on either side of the best split.
         */
-        const auto binAlongDimension = [&bins, &costs, &triangleRange, &data, &parameters, &overallBestSplit, &nodeBounds](uint32_t dimension)
+        const auto binAlongDimension = [&triangleRange, &data, &parameters, &nodeBounds, parallelBinning](uint32_t dimension, std::vector<Bin>& bins, std::vector<float>& costs)
         {
+            const auto& centroids = data.trianglesData.centroid[dimension];
+            const float bmin = nodeBounds.minPoint[dimension], bmax = nodeBounds.maxPoint[dimension];
+            const float w = bmax - bmin;
+            assert(w >= 0.f); // The node bounds can be zero if all primitives are axis-aligned and coplanar
+            const float scale = w > FLT_MIN ? (float)parameters.binCount / w : 0.f;
+
             // Helper to compute the bin id for a given triangle.
-            auto getBinId = [&](const TriangleSortData& td)
+            auto getBinId = [&](uint32_t i)
             {
-                float bmin = nodeBounds.minPoint[dimension], bmax = nodeBounds.maxPoint[dimension];
-                assert(bmin < bmax);
-                float scale = (float)parameters.binCount / (bmax - bmin);
-                float p = td.bounds.centroid()[dimension];
+                float p = centroids[i];
                 assert(bmin <= p && p <= bmax);
                 return std::min((uint32_t)((p - bmin) * scale), parameters.binCount - 1);
             };
 
-            // Reset the bins.
-            for (Bin& bin : bins) bin = Bin();
-
             // Fill the bins with all triangles.
-            for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+            auto fillBins = [&](uint32_t first, uint32_t last, std::vector<Bin> chunkBins)
+            {
+                if (parameters.useSIMD)
+                {
+                    // Compute the bin ids four triangles at a time and accumulate the bounds with SIMD min/max.
+                    std::vector<uint32_t> binIds(last - first);
+                    computeBinIdsSIMD(centroids.data() + first, last - first, bmin, scale, parameters.binCount, binIds.data());
+
+                    std::vector<__m128> binMin(chunkBins.size(), _mm_set1_ps(std::numeric_limits<float>::infinity()));
+                    std::vector<__m128> binMax(chunkBins.size(), _mm_set1_ps(-std::numeric_limits<float>::infinity()));
+                    for (uint32_t i = first; i < last; ++i)
+                    {
+                        const uint32_t binId = binIds[i - first];
+                        binMin[binId] = simdMin(binMin[binId], load(data.trianglesData.boundsMin[i]));
+                        binMax[binId] = simdMax(binMax[binId], load(data.trianglesData.boundsMax[i]));
+                        chunkBins[binId].triangleCount++;
+                    }
+                    for (size_t j = 0; j < chunkBins.size(); ++j)
+                    {
+                        BBox bounds;
+                        bounds.minPoint = toFloat3(binMin[j]);
+                        bounds.maxPoint = toFloat3(binMax[j]);
+                        chunkBins[j].bounds |= bounds;
+                    }
+                }
+                else
+                {
+                    for (uint32_t i = first; i < last; ++i)
+                    {
+                        chunkBins[getBinId(i)] |= Bin(data.trianglesData, i);
+                    }
+                }
+                return chunkBins;
+            };
+
+            if (parallelBinning)
             {
-                const auto& td = data.trianglesData[i];
-                bins[getBinId(td)] |= td;
+                bins = Threading::parallelReduce(triangleRange.begin, triangleRange.end, std::vector<Bin>(parameters.binCount),
+                    [&](size_t first, size_t last, std::vector<Bin> chunkBins) { return fillBins((uint32_t)first, (uint32_t)last, std::move(chunkBins)); },
+                    [](std::vector<Bin> a, const std::vector<Bin>& b)
+                    {
+                        for (size_t i = 0; i < a.size(); i++) a[i] |= b[i];
+                        return a;
+                    });
+            }
+            else
+            {
+                bins = fillBins(triangleRange.begin, triangleRange.end, std::vector<Bin>(parameters.binCount));
             }
 
             // First, compute A_j(L) * N_j(L) by sweeping over the bins from left to right.
@@ -606,29 +958,50 @@ namespace Falcor
 
             // Early out if all lights fall on either side of the split.
             if (axisBestSplit.second.triangleIndex == triangleRange.begin ||
-                axisBestSplit.second.triangleIndex == triangleRange.end) return;
+                axisBestSplit.second.triangleIndex == triangleRange.end) axisBestSplit.second = SplitResult();
 
-            if (axisBestSplit.first < overallBestSplit.first)
-            {
-                overallBestSplit = axisBestSplit;
-                assert(triangleRange.begin < overallBestSplit.second.triangleIndex && overallBestSplit.second.triangleIndex < triangleRange.end);
-            }
+            return axisBestSplit;
         };
 
+        std::vector<uint32_t> dimensionsToBin;
         if (parameters.splitAlongLargest)
         {
             // Find the largest dimension.
             float3 dimensions = nodeBounds.dimensions();
             uint32_t largestDimension = dimensions[2] >= dimensions[0] && dimensions[2] >= dimensions[1] ?
                 2 : (dimensions[1] >= dimensions[0] && dimensions[1] >= dimensions[2] ? 1 : 0);
+            dimensionsToBin = { largestDimension };
+        }
+        else
+        {
+            dimensionsToBin = { 0, 1, 2 };
+        }
 
-            binAlongDimension(largestDimension);
+        // Bin along each dimension. For large nodes the dimensions are processed concurrently.
+        std::vector<std::pair<float, SplitResult>> axisBestSplits(dimensionsToBin.size());
+        if (parallelBinning)
+        {
+            Threading::parallelFor(0, dimensionsToBin.size(), [&](size_t i)
+            {
+                std::vector<Bin> bins(parameters.binCount);
+                std::vector<float> costs(parameters.binCount - 1);
+                axisBestSplits[i] = binAlongDimension(dimensionsToBin[i], bins, costs);
+            }, 1);
         }
         else
         {
-            for (uint32_t dimension = 0; dimension < 3; ++dimension)
+            std::vector<Bin> bins(parameters.binCount);
+            std::vector<float> costs(parameters.binCount - 1);
+            for (size_t i = 0; i < dimensionsToBin.size(); i++) axisBestSplits[i] = binAlongDimension(dimensionsToBin[i], bins, costs);
+        }
+
+        // Pick the cheapest split. The dimensions are compared in order, so ties are resolved the same way in both paths.
+        for (const auto& axisBestSplit : axisBestSplits)
+        {
+            if (axisBestSplit.second.isValid() && axisBestSplit.first < overallBestSplit.first)
             {
-                binAlongDimension(dimension);
+                overallBestSplit = axisBestSplit;
+                assert(triangleRange.begin < overallBestSplit.second.triangleIndex && overallBestSplit.second.triangleIndex < triangleRange.end);
             }
         }
 
@@ -637,7 +1010,7 @@ namespace Falcor
         {
             if (triangleRange.length() <= parameters.maxTriangleCountPerLeaf) return SplitResult();
             logWarning("LightBVHBuilder::computeSplitWithBinnedSAH() was not able to compute a proper split: reverting to LightBVHBuilder::computeSplitWithEqual()");
-            return computeSplitWithEqual(data, triangleRange, nodeBounds, parameters);
+            return computeSplitWithEqual(data, triangleRange, nodeBounds, 0.f, parameters);
         }
 
         // If the best split we found is more expensive than the cost of a leaf node (and we can create one), then create a leaf node.
@@ -672,14 +1045,19 @@ namespace Falcor
     {
         float fluxCost = parameters.usePreintegration ? flux : 1.0f;
         float aabbCost = bounds.valid() ? (parameters.useVolumeOverSA ? bounds.volume(parameters.volumeEpsilon) : bounds.surfaceArea()) : 0.f;
-        float theta = cosTheta != kInvalidCosConeAngle ? safeACos(cosTheta) : glm::pi<float>();
-        float orientationCost = parameters.useLightingCones ? computeOrientationCost(theta) : 1.0f;
+        float orientationCost = 1.0f;
+        if (parameters.useLightingCones)
+        {
+            // Invalid cones cover the whole sphere. Their orientation cost is constant, so it's only evaluated once.
+            static const float kInvalidConeOrientationCost = computeOrientationCost(glm::pi<float>());
+            orientationCost = cosTheta != kInvalidCosConeAngle ? computeOrientationCost(safeACos(cosTheta)) : kInvalidConeOrientationCost;
+        }
         float cost = fluxCost * aabbCost * orientationCost;
         assert(cost >= 0.f && !std::isnan(cost) && !std::isinf(cost));
         return cost;
     }
 
-    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithBinnedSAOH(const BuildingData& data, const Range& triangleRange, const BBox& nodeBounds, const Options& parameters)
+    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithBinnedSAOH(const BuildingData& data, const Range& triangleRange, const BBox& nodeBounds, float nodeFlux, const Options& parameters)
     {
         std::pair<float, SplitResult> overallBestSplit = std::make_pair(std::numeric_limits<float>::infinity(), SplitResult());
         assert(!overallBestSplit.second.isValid());
@@ -698,7 +1076,7 @@ namespace Falcor
             float cosConeAngle = 1.0f;
 
             Bin() = default;
-            Bin(const TriangleSortData& tri) : bounds(tri.bounds), triangleCount(1), flux(tri.flux), coneDirection(tri.coneDirection), cosConeAngle(tri.cosConeAngle) {}
+            Bin(const TriangleSortData& sortData, uint32_t i) : bounds(sortData.getBounds(i)), triangleCount(1), flux(sortData.flux[i]), coneDirection(sortData.getConeDirection(i)), cosConeAngle(sortData.cosConeAngle[i]) {}
             Bin& operator|= (const Bin& rhs)
             {
                 bounds |= rhs.bounds;
@@ -711,8 +1089,11 @@ namespace Falcor
         };
 
         assert(parameters.binCount > 1);
-        std::vector<Bin> bins(parameters.binCount);
-        std::vector<float> costs(parameters.binCount - 1);
+
+        // Large nodes are binned on multiple threads. The flux and cone direction sums depend on the summation order,
+        // so only the bin ids and the cone angles (which are a min-reduction) are computed in parallel.
+        // This keeps the result identical to the serial path.
+        const bool parallelBinning = parameters.useParallelBuild && triangleRange.length() >= kParallelBinningMinTriangleCount;
 
         /** Helper function that computes the best split along the given dimension using the SAOH metric.
             The triangles are binned to n bins, storing only the aggregate parameters (triangle count, bounds, flux, and cone direction).
@@ -720,29 +1101,67 @@ namespace Falcor
             Note that while the bounds and flux are accurately represented by the aggregated parameters,
             the bounding cones are approximates based on the bins' bounding cones. This is less expensive,
             but also less precise than computing them directly from the triangles.
+            Returns an invalid split if all lights fall on either side of the best split.
         */
-        const auto binAlongDimension = [&bins, &costs, &triangleRange, &data, &parameters, &overallBestSplit, &nodeBounds, largestDimension, dimensions](uint32_t dimension)
+        const auto binAlongDimension = [&triangleRange, &data, &parameters, &nodeBounds, largestDimension, dimensions, parallelBinning](uint32_t dimension, std::vector<Bin>& bins, std::vector<float>& costs)
         {
-            // Helper to compute the bin id for a given triangle.
-            auto getBinId = [&](const TriangleSortData& td)
+            const auto& trianglesData = data.trianglesData;
+            const auto& centroids = trianglesData.centroid[dimension];
+            const float bmin = nodeBounds.minPoint[dimension], bmax = nodeBounds.maxPoint[dimension];
+            const float w = bmax - bmin;
+            assert(w >= 0.f); // The node bounds can be zero if all primitives are axis-aligned and coplanar
+            const float scale = w > FLT_MIN ? (float)parameters.binCount / w : 0.f;
+
+            // Compute the bin id for each triangle. The ids are kept as they are needed again for the cone angles.
+            std::vector<uint32_t> binIds(triangleRange.length());
+            auto computeBinIds = [&](size_t first, size_t last)
             {
-                float bmin = nodeBounds.minPoint[dimension], bmax = nodeBounds.maxPoint[dimension];
-                float w = bmax - bmin;
-                assert(w >= 0.f); // The node bounds can be zero if all primitives are axis-aligned and coplanar
-                float scale = w > FLT_MIN ? (float)parameters.binCount / w : 0.f;
-                float p = td.bounds.centroid()[dimension];
-                assert(bmin <= p && p <= bmax);
-                return std::min((uint32_t)((p - bmin) * scale), parameters.binCount - 1);
+                if (parameters.useSIMD)
+                {
+                    computeBinIdsSIMD(centroids.data() + first, (uint32_t)(last - first), bmin, scale, parameters.binCount, binIds.data() + (first - triangleRange.begin));
+                    return;
+                }
+                for (size_t i = first; i < last; ++i)
+                {
+                    float p = centroids[i];
+                    assert(bmin <= p && p <= bmax);
+                    binIds[i - triangleRange.begin] = std::min((uint32_t)((p - bmin) * scale), parameters.binCount - 1);
+                }
             };
+            if (parallelBinning) Threading::parallelForRange(triangleRange.begin, triangleRange.end, computeBinIds);
+            else computeBinIds(triangleRange.begin, triangleRange.end);
 
             // Reset the bins.
             for (Bin& bin : bins) bin = Bin();
 
             // Fill the bins with all triangles.
-            for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+            if (parameters.useSIMD)
             {
-                const auto& td = data.trianglesData[i];
-                bins[getBinId(td)] |= td;
+                std::vector<__m128> binMin(bins.size(), _mm_set1_ps(std::numeric_limits<float>::infinity()));
+                std::vector<__m128> binMax(bins.size(), _mm_set1_ps(-std::numeric_limits<float>::infinity()));
+                for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+                {
+                    const uint32_t binId = binIds[i - triangleRange.begin];
+                    binMin[binId] = simdMin(binMin[binId], load(trianglesData.boundsMin[i]));
+                    binMax[binId] = simdMax(binMax[binId], load(trianglesData.boundsMax[i]));
+
+                    Bin& bin = bins[binId];
+                    bin.triangleCount++;
+                    bin.flux += trianglesData.flux[i];
+                    bin.coneDirection += trianglesData.getConeDirection(i);
+                }
+                for (size_t j = 0; j < bins.size(); ++j)
+                {
+                    bins[j].bounds.minPoint = toFloat3(binMin[j]);
+                    bins[j].bounds.maxPoint = toFloat3(binMax[j]);
+                }
+            }
+            else
+            {
+                for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+                {
+                    bins[binIds[i - triangleRange.begin]] |= Bin(trianglesData, i);
+                }
             }
 
             // Compute the lighting cones for each bin.
@@ -754,13 +1173,86 @@ namespace Falcor
                 bin.cosConeAngle = glm::length(bin.coneDirection) < FLT_MIN ? kInvalidCosConeAngle : 1.0f;
                 bin.coneDirection = glm::normalize(bin.coneDirection);
             }
-            for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+
+            // The SIMD code path keeps a copy of the bin cones in SoA layout, padded as required by computeCosConeAngleSIMD().
+            std::vector<float> binConeDirection[3];
+            std::vector<float> binCosConeAngle;
+            if (parameters.useSIMD)
             {
-                const auto& td = data.trianglesData[i];
-                Bin& bin = bins[getBinId(td)];
-                bin.cosConeAngle = computeCosConeAngle(bin.coneDirection, bin.cosConeAngle, td.coneDirection, td.cosConeAngle);
+                for (uint32_t axis = 0; axis < 3; ++axis)
+                {
+                    binConeDirection[axis].assign(bins.size() + 3, 0.f);
+                    for (size_t j = 0; j < bins.size(); ++j) binConeDirection[axis][j] = bins[j].coneDirection[axis];
+                }
+                binCosConeAngle.assign(bins.size() + 3, 1.f);
             }
 
+            // Grow the bin cone angles to include all triangles. The SIMD code path evaluates four triangles at a time and then
+            // folds the results into the bins in order. For large nodes the triangles are processed in parallel; the cone angle of
+            // a bin is the minimum over its triangles, or invalid if any of them is, so the result is independent of the order.
+            auto growBinCones = [&](size_t first, size_t last, std::vector<float> cosConeAngles)
+            {
+                size_t i = first;
+                if (parameters.useSIMD)
+                {
+                    for (; i + 4 <= last; i += 4)
+                    {
+                        const uint32_t* ids = binIds.data() + (i - triangleRange.begin);
+                        const __m128 dirX = _mm_setr_ps(binConeDirection[0][ids[0]], binConeDirection[0][ids[1]], binConeDirection[0][ids[2]], binConeDirection[0][ids[3]]);
+                        const __m128 dirY = _mm_setr_ps(binConeDirection[1][ids[0]], binConeDirection[1][ids[1]], binConeDirection[1][ids[2]], binConeDirection[1][ids[3]]);
+                        const __m128 dirZ = _mm_setr_ps(binConeDirection[2][ids[0]], binConeDirection[2][ids[1]], binConeDirection[2][ids[2]], binConeDirection[2][ids[3]]);
+
+                        float c[4];
+                        _mm_storeu_ps(c, computeCosConeAngleCandidates(dirX, dirY, dirZ,
+                            _mm_loadu_ps(&trianglesData.coneDirection[0][i]), _mm_loadu_ps(&trianglesData.coneDirection[1][i]), _mm_loadu_ps(&trianglesData.coneDirection[2][i]),
+                            _mm_loadu_ps(&trianglesData.cosConeAngle[i])));
+                        for (uint32_t j = 0; j < 4; ++j) cosConeAngles[ids[j]] = foldCosConeAngle(cosConeAngles[ids[j]], c[j]);
+                    }
+                }
+                for (; i < last; ++i)
+                {
+                    const uint32_t binId = binIds[i - triangleRange.begin];
+                    cosConeAngles[binId] = computeCosConeAngle(bins[binId].coneDirection, cosConeAngles[binId], trianglesData.getConeDirection(i), trianglesData.cosConeAngle[i]);
+                }
+                return cosConeAngles;
+            };
+
+            std::vector<float> binCosConeAngles(bins.size());
+            for (size_t j = 0; j < bins.size(); ++j) binCosConeAngles[j] = bins[j].cosConeAngle;
+            if (parallelBinning)
+            {
+                binCosConeAngles = Threading::parallelReduce(triangleRange.begin, triangleRange.end, binCosConeAngles, growBinCones,
+                    [](std::vector<float> a, const std::vector<float>& b)
+                    {
+                        for (size_t j = 0; j < a.size(); ++j) a[j] = foldCosConeAngle(a[j], b[j]);
+                        return a;
+                    });
+            }
+            else
+            {
+                binCosConeAngles = growBinCones(triangleRange.begin, triangleRange.end, std::move(binCosConeAngles));
+            }
+            for (size_t j = 0; j < bins.size(); ++j)
+            {
+                bins[j].cosConeAngle = binCosConeAngles[j];
+                if (parameters.useSIMD) binCosConeAngle[j] = binCosConeAngles[j];
+            }
+
+            // Helper to compute the bounding cone angle around a given direction for the union of bins [first, last).
+            auto computeBinsCosConeAngle = [&](const float3& coneDir, size_t first, size_t last)
+            {
+                if (parameters.useSIMD)
+                {
+                    return computeCosConeAngleSIMD(coneDir, binConeDirection[0].data(), binConeDirection[1].data(), binConeDirection[2].data(), binCosConeAngle.data(), (uint32_t)first, (uint32_t)last);
+                }
+                float cosTheta = 1.f;
+                for (size_t j = first; j < last; ++j)
+                {
+                    cosTheta = computeCosConeAngle(coneDir, cosTheta, bins[j].coneDirection, bins[j].cosConeAngle);
+                }
+                return cosTheta;
+            };
+
             // First, compute A_j(L) * N_j(L) by sweeping over the bins from left to right.
             // Note that the costs vector has n-1 elements when there are n bins; the i:th elements represents the split between bin i and i+1.
             Bin total = Bin();
@@ -772,12 +1264,7 @@ namespace Falcor
                 float cosTheta = kInvalidCosConeAngle;
                 if (glm::length(total.coneDirection) >= FLT_MIN)
                 {
-                    cosTheta = 1.f;
-                    float3 coneDir = glm::normalize(total.coneDirection);
-                    for (std::size_t j = 0; j <= i; ++j)
-                    {
-                        cosTheta = computeCosConeAngle(coneDir, cosTheta, bins[j].coneDirection, bins[j].cosConeAngle);
-                    }
+                    cosTheta = computeBinsCosConeAngle(glm::normalize(total.coneDirection), 0, i + 1);
                 }
 
                 costs[i] = evalSAOH(total.bounds, total.flux, cosTheta, parameters);
@@ -793,12 +1280,7 @@ namespace Falcor
                 float cosTheta = kInvalidCosConeAngle;
                 if (glm::length(total.coneDirection) >= FLT_MIN)
                 {
-                    cosTheta = 1.f;
-                    float3 coneDir = glm::normalize(total.coneDirection);
-                    for (std::size_t j = i; j <= costs.size(); ++j)
-                    {
-                        cosTheta = computeCosConeAngle(coneDir, cosTheta, bins[j].coneDirection, bins[j].cosConeAngle);
-                    }
+                    cosTheta = computeBinsCosConeAngle(glm::normalize(total.coneDirection), i, bins.size());
                 }
 
                 costs[i - 1] += evalSAOH(total.bounds, total.flux, cosTheta, parameters);
@@ -821,25 +1303,40 @@ namespace Falcor
 
             // Early out if all lights fall on either side of the split.
             if (axisBestSplit.second.triangleIndex == triangleRange.begin ||
-                axisBestSplit.second.triangleIndex == triangleRange.end) return;
+                axisBestSplit.second.triangleIndex == triangleRange.end) axisBestSplit.second = SplitResult();
 
-            if (axisBestSplit.first < overallBestSplit.first)
-            {
-                overallBestSplit = axisBestSplit;
-                assert(triangleRange.begin < overallBestSplit.second.triangleIndex && overallBestSplit.second.triangleIndex < triangleRange.end);
-            }
+            return axisBestSplit;
         };
 
-        // Compute the best split.
-        if (parameters.splitAlongLargest)
+        // Compute the best split along each dimension. For large nodes the dimensions are processed concurrently.
+        std::vector<uint32_t> dimensionsToBin;
+        if (parameters.splitAlongLargest) dimensionsToBin = { largestDimension };
+        else dimensionsToBin = { 0, 1, 2 };
+
+        std::vector<std::pair<float, SplitResult>> axisBestSplits(dimensionsToBin.size());
+        if (parallelBinning)
         {
-            binAlongDimension(largestDimension);
+            Threading::parallelFor(0, dimensionsToBin.size(), [&](size_t i)
+            {
+                std::vector<Bin> bins(parameters.binCount);
+                std::vector<float> costs(parameters.binCount - 1);
+                axisBestSplits[i] = binAlongDimension(dimensionsToBin[i], bins, costs);
+            }, 1);
         }
         else
         {
-            for (uint32_t dimension = 0; dimension < 3; ++dimension)
+            std::vector<Bin> bins(parameters.binCount);
+            std::vector<float> costs(parameters.binCount - 1);
+            for (size_t i = 0; i < dimensionsToBin.size(); i++) axisBestSplits[i] = binAlongDimension(dimensionsToBin[i], bins, costs);
+        }
+
+        // Pick the cheapest split. The dimensions are compared in order, so ties are resolved the same way in both paths.
+        for (const auto& axisBestSplit : axisBestSplits)
+        {
+            if (axisBestSplit.second.isValid() && axisBestSplit.first < overallBestSplit.first)
             {
-                binAlongDimension(dimension);
+                overallBestSplit = axisBestSplit;
+                assert(triangleRange.begin < overallBestSplit.second.triangleIndex && overallBestSplit.second.triangleIndex < triangleRange.end);
             }
         }
 
@@ -848,7 +1345,7 @@ namespace Falcor
         {
             if (triangleRange.length() <= parameters.maxTriangleCountPerLeaf) return SplitResult();
             logWarning("LightBVHBuilder::computeSplitWithBinnedSAOH() was not able to compute a proper split: reverting to LightBVHBuilder::computeSplitWithEqual()");
-            return computeSplitWithEqual(data, triangleRange, nodeBounds, parameters);
+            return computeSplitWithEqual(data, triangleRange, nodeBounds, nodeFlux, parameters);
         }
 
         // If the best split we found is more expensive than the cost of a leaf node (and we can create one), then create a leaf node.
@@ -858,7 +1355,7 @@ namespace Falcor
             // Evaluate the cost metric for the node. This requires us to first compute the cone angle.
             float cosTheta = kInvalidCosConeAngle;
             computeLightingCone(triangleRange, data, cosTheta);
-            float leafCost = evalSAOH(nodeBounds, data.currentNodeFlux, cosTheta, parameters);
+            float leafCost = evalSAOH(nodeBounds, nodeFlux, cosTheta, parameters);
             if (leafCost <= overallBestSplit.first) return SplitResult();
         }
 
@@ -902,6 +1399,8 @@ namespace Falcor
         options.field(allowRefitting);
         options.field(usePreintegration);
         options.field(useLightingCones);
+        options.field(useParallelBuild);
+        options.field(useSIMD);
 #undef field
     }
 }
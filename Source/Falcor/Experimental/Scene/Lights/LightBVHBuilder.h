@@ -71,6 +71,8 @@ namespace Falcor
             bool           allowRefitting = true;                                ///< Rather than always rebuilding the BVH from scratch, keep the hierarchy but update the bounds and lighting cones.
             bool           usePreintegration = true;                             ///< Use pre-integration for culling out emissive triangles and use their flux when computing the splits. Only valid when using the BinnedSAOH split heuristic.
             bool           useLightingCones = true;                              ///< Use lighting cones when computing the splits. Only valid when using the BinnedSAOH split heuristic.
+            bool           useParallelBuild = true;                              ///< Build the BVH on multiple threads. The result is identical to the single-threaded build.
+            bool           useSIMD = true;                                       ///< Use SIMD instructions for binning and cost evaluation. The resulting splits are identical to the scalar code path.
         };
 
         /** Creates a new object.
@@ -83,6 +85,16 @@ namespace Falcor
         */
         void build(LightBVH& bvh);
 
+        /** Build the BVH nodes for a list of emissive triangles on the CPU.
+            This is the part of build() that doesn't touch the GPU, it is exposed for testing and benchmarking.
+            \param[in] triangles List of emissive triangles.
+            \param[out] nodes BVH nodes in depth-first order.
+            \param[out] triangleIndices Triangle indices sorted by leaf node.
+            \param[out] triangleBitmasks Per triangle bit pattern retracing the tree traversal to reach the triangle. Indexed by global triangle index.
+            \return True if a BVH was built, false if there were no (non-culled) triangles.
+        */
+        bool buildNodes(const std::vector<LightCollection::MeshLightTriangle>& triangles, std::vector<PackedNode>& nodes, std::vector<uint32_t>& triangleIndices, std::vector<uint64_t>& triangleBitmasks) const;
+
         virtual bool renderUI(Gui::Widgets& widget);
 
         const Options& getOptions() const { return mOptions; }
@@ -110,34 +122,66 @@ namespace Falcor
             }
         };
 
+        /** Per-triangle data used for the build, stored as a structure of arrays.
+            Each attribute is kept in its own array so that the binning can process several triangles at a time with SIMD instructions.
+            All arrays are permuted together when the triangles of a node are partitioned.
+        */
         struct TriangleSortData
         {
-            BBox bounds;                                    ///< World-space bounding box for the light source(s).
-            float3 center = {};                             ///< Center point.
-            float3 coneDirection = {};                      ///< Light emission normal direction.
-            float cosConeAngle = 1.f;                       ///< Cosine normal bounding cone (half) angle.
-            float flux = 0.f;                               ///< Precomputed triangle flux (note, this takes doublesidedness into account).
-            uint32_t triangleIndex = MeshLightData::kInvalidIndex; ///< Index into global triangle list.
+            std::vector<float4> boundsMin;                  ///< World-space bounding box min point for the light source(s). The w component is unused.
+            std::vector<float4> boundsMax;                  ///< World-space bounding box max point for the light source(s). The w component is unused.
+            std::vector<float> centroid[3];                 ///< Bounding box centroid along each axis.
+            std::vector<float> coneDirection[3];            ///< Light emission normal direction along each axis.
+            std::vector<float> cosConeAngle;                ///< Cosine normal bounding cone (half) angle.
+            std::vector<float> flux;                        ///< Precomputed triangle flux (note, this takes doublesidedness into account).
+            std::vector<uint32_t> triangleIndex;            ///< Index into global triangle list.
+
+            size_t size() const { return triangleIndex.size(); }
+            bool empty() const { return triangleIndex.empty(); }
+            void reserve(size_t count);
+            void push_back(const BBox& bounds, const float3& coneDir, float cosAngle, float triangleFlux, uint32_t globalIndex);
+
+            BBox getBounds(size_t i) const { BBox bounds; bounds.minPoint = float3(boundsMin[i]); bounds.maxPoint = float3(boundsMax[i]); return bounds; }
+            float3 getConeDirection(size_t i) const { return float3(coneDirection[0][i], coneDirection[1][i], coneDirection[2][i]); }
         };
 
         struct BuildingData
         {
             std::vector<PackedNode>& nodes;                 ///< BVH nodes generated by the builder.
-            std::vector<TriangleSortData> trianglesData;    ///< Compact list of triangles to include in build.
+            TriangleSortData trianglesData;                 ///< Compact list of triangles to include in build.
             std::vector<uint32_t> triangleIndices;          ///< Triangle indices sorted by leaf node. Each leaf node refers to a contiguous array of triangle indices.
             std::vector<uint64_t> triangleBitmasks;         ///< Array containing the per triangle bit pattern retracing the tree traversal to reach the triangle: 0=left child, 1=right child; this array gets filled in during the build process. Indexed by global triangle index.
-            float currentNodeFlux = 0.f;                    ///< Used by computeSAOHSplit() as the leaf creation cost.
+
+            // Scratch buffers for partitioning, indexed like trianglesData. Concurrently built subtrees only touch their own triangle range.
+            std::vector<std::pair<float, uint32_t>> partitionOrder; ///< Sorted (centroid, relative index) pairs of the node being partitioned.
+            std::vector<float4> partitionScratch4;          ///< Permutation scratch for float4 attributes.
+            std::vector<float> partitionScratchFloat;       ///< Permutation scratch for float attributes.
+            std::vector<uint32_t> partitionScratchUint;     ///< Permutation scratch for uint32_t attributes.
 
             BuildingData(std::vector<PackedNode>& bvhNodes) : nodes(bvhNodes) {}
         };
 
+        /** Subtree produced by the parallel build.
+            Nodes created in the parallel phase store their two children as separate subtrees. All other subtrees are built
+            serially into a compact node list, where node indices and triangle offsets are relative to the subtree.
+        */
+        struct Subtree
+        {
+            InternalNode node = {};                         ///< Root node if the subtree was split in the parallel phase. The right child index is set when flattening.
+            std::unique_ptr<Subtree> pLeft;                 ///< Left child subtree, or nullptr if the subtree was built serially.
+            std::unique_ptr<Subtree> pRight;                ///< Right child subtree, or nullptr if the subtree was built serially.
+            std::vector<PackedNode> nodes;                  ///< Serially built nodes.
+            std::vector<uint32_t> triangleIndices;          ///< Triangle indices of the serially built leaf nodes.
+        };
+
         /** Compute the split according to a specified heuristic.
             \param[in] data Prepared light data.
             \param[in] triangleRange Range of triangles to process.
             \param[in] nodeBounds Bounds for the node to be splitted.
+            \param[in] nodeFlux Total flux of the node to be splitted. Used as the leaf creation cost.
             \param[in] parameters Various parameters defining how the building should occur.
         */
-        using SplitHeuristicFunction = std::function<SplitResult(const BuildingData& data, const Range& triangleRange, const BBox& nodeBounds, const Options& parameters)>;
+        using SplitHeuristicFunction = std::function<SplitResult(const BuildingData& data, const Range& triangleRange, const BBox& nodeBounds, float nodeFlux, const Options& parameters)>;
 
         LightBVHBuilder(const Options& options);
 
@@ -151,9 +195,42 @@ namespace Falcor
             \param[in] depth Depth of the node to be built
             \param[in] triangleRange Range of triangles to process.
             \param[in,out] data Prepared light data.
+            \param[in,out] nodes List of nodes to append the new nodes to.
+            \param[in,out] triangleIndices List of triangle indices to append the leaf triangles to.
             \return Index of the allocated node.
         */
-        uint32_t buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data);
+        static uint32_t buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data, std::vector<PackedNode>& nodes, std::vector<uint32_t>& triangleIndices);
+
+        /** Parallel BVH build.
+            Large nodes are split using parallel binning and their children are built as independent tasks.
+            Subtrees below a size threshold are built with buildInternal().
+            \param[in] splitHeuristic The splitting heuristic to be used.
+            \param[in] bitmask Bit pattern retracing the tree traversal to reach the node to be built: 0=left child, 1=right child.
+            \param[in] depth Depth of the node to be built
+            \param[in] triangleRange Range of triangles to process.
+            \param[in,out] data Prepared light data. Only the given triangle range is modified.
+            \param[out] subtree The built subtree.
+        */
+        static void buildParallel(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data, Subtree& subtree);
+
+        /** Append the nodes and triangle indices of a subtree to the final node list in depth-first order.
+            The resulting layout is identical to the one produced by buildInternal() over the whole tree.
+            \param[in] subtree The subtree to append.
+            \param[in,out] data Building data receiving the nodes and triangle indices.
+        */
+        static void flattenSubtree(const Subtree& subtree, BuildingData& data);
+
+        /** Compute the bounds and total flux of a range of triangles.
+        */
+        static void computeNodeBoundsAndFlux(const Range& triangleRange, const BuildingData& data, bool useSIMD, BBox& nodeBounds, float& nodeFlux);
+
+        /** Partition a range of triangles so that the triangle at the split index is the one that would be there if the range
+            was sorted by centroid along the split axis. Triangles before it are not greater, triangles after it are not smaller.
+            \param[in] triangleRange Range of triangles to process.
+            \param[in] splitResult The split axis and index.
+            \param[in,out] data Prepared light data. Only the given triangle range is modified.
+        */
+        static void partitionTriangles(const Range& triangleRange, const SplitResult& splitResult, BuildingData& data);
 
         /** Recursive computation of lighting cones for all internal nodes.
             \param[in] nodeIndex Index of the current node.
@@ -161,7 +238,7 @@ namespace Falcor
             \param[out] cosConeAngle Cosine of the cone angle of the lighting cone for the current node, or kInvalidCosConeAngle if the cone is invalid.
             \return direction of the lighting cone for the current node.
         */
-        float3 computeLightingConesInternal(const uint32_t nodeIndex, BuildingData& data, float& cosConeAngle);
+        static float3 computeLightingConesInternal(const uint32_t nodeIndex, BuildingData& data, float& cosConeAngle);
 
         /** Compute lighting cone for a range of triangles.
             \param[in] triangleRange Range of triangles to process.
@@ -172,9 +249,9 @@ namespace Falcor
         static float3 computeLightingCone(const Range& triangleRange, const BuildingData& data, float& cosTheta);
 
         // See the documentation of SplitHeuristicFunction.
-        static SplitResult computeSplitWithEqual(const BuildingData& /*data*/, const Range& triangleRange, const BBox& nodeBounds, const Options& /*parameters*/);
-        static SplitResult computeSplitWithBinnedSAH(const BuildingData& data, const Range& triangleRange, const BBox& nodeBounds, const Options& parameters);
-        static SplitResult computeSplitWithBinnedSAOH(const BuildingData& data, const Range& triangleRange, const BBox& nodeBounds, const Options& parameters);
+        static SplitResult computeSplitWithEqual(const BuildingData& /*data*/, const Range& triangleRange, const BBox& nodeBounds, float /*nodeFlux*/, const Options& /*parameters*/);
+        static SplitResult computeSplitWithBinnedSAH(const BuildingData& data, const Range& triangleRange, const BBox& nodeBounds, float nodeFlux, const Options& parameters);
+        static SplitResult computeSplitWithBinnedSAOH(const BuildingData& data, const Range& triangleRange, const BBox& nodeBounds, float nodeFlux, const Options& parameters);
 
         static SplitHeuristicFunction getSplitFunction(SplitHeuristic heuristic);
 
@@ -29,6 +29,9 @@
 #include "LightCollection.h"
 #include "LightCollectionShared.slang"
 #include "Scene/Scene.h"
+#include "Utils/Threading.h"
+#include "Utils/Color/ColorHelpers.slang"
+#include "Utils/Math/MathConstants.slangh"
 #include <sstream>
 
 namespace Falcor
@@ -43,12 +46,209 @@ namespace Falcor
         const char kBuildTriangleListFile[] = "Experimental/Scene/Lights/BuildTriangleList.cs.slang";
         const char kUpdateTriangleVerticesFile[] = "Experimental/Scene/Lights/UpdateTriangleVertices.cs.slang";
         const char kFinalizeIntegrationFile[] = "Experimental/Scene/Lights/FinalizeIntegration.cs.slang";
+
+        const uint32_t kIntegratorViewportDim = 16384;      // 16K x 16K
+        const uint32_t kInvalidIndex = 0xffffffff;
+
+        /** Emissive texture decoded to linear RGB on the CPU.
+        */
+        struct EmissiveTexels
+        {
+            int width = 0;
+            int height = 0;
+            std::vector<float3> texels;
+        };
+
+        /** Decodes the top mip level of an emissive texture from its source file.
+            Only the uncompressed formats produced by the image loader are supported.
+            \param[in] texture The texture to decode.
+            \param[out] result The decoded texels.
+            \return True if successful, false if the texture can't be decoded on the CPU.
+        */
+        bool decodeEmissiveTexture(const Texture& texture, EmissiveTexels& result)
+        {
+            if (texture.getSourceFilename().empty()) return false;
+
+            const auto pImage = Texture::loadImageDataFromFile(texture.getSourceFilename(), false, isSrgbFormat(texture.getFormat()));
+            if (!pImage || pImage->type != Resource::Type::Texture2D || pImage->format != texture.getFormat()) return false;
+            if (pImage->width != texture.getWidth() || pImage->height != texture.getHeight()) return false;
+
+            const ResourceFormat format = srgbToLinearFormat(pImage->format);
+            switch (format)
+            {
+            case ResourceFormat::RGBA32Float:
+            case ResourceFormat::RGB32Float:
+            case ResourceFormat::RGBA16Float:
+            case ResourceFormat::RGB16Float:
+            case ResourceFormat::RGBA8Unorm:
+            case ResourceFormat::BGRA8Unorm:
+            case ResourceFormat::BGRX8Unorm:
+            case ResourceFormat::RG8Unorm:
+            case ResourceFormat::R8Unorm:
+                break;
+            default:
+                return false;
+            }
+
+            const size_t texelCount = (size_t)pImage->width * pImage->height;
+            const size_t bytesPerTexel = getFormatBytesPerBlock(pImage->format);
+            if (pImage->data.size() < texelCount * bytesPerTexel) return false;
+
+            // Lookup table for 8-bit channels, with the sRGB curve applied if needed.
+            const bool srgb = isSrgbFormat(pImage->format);
+            float unorm[256];
+            for (uint32_t i = 0; i < 256; i++) unorm[i] = srgb ? sRGBToLinear(i / 255.f) : i / 255.f;
+
+            result.width = (int)pImage->width;
+            result.height = (int)pImage->height;
+            result.texels.resize(texelCount);
+
+            const uint8_t* pData = pImage->data.data();
+            for (size_t i = 0; i < texelCount; i++)
+            {
+                const uint8_t* p = pData + i * bytesPerTexel;
+                float3& texel = result.texels[i];
+                switch (format)
+                {
+                case ResourceFormat::RGBA32Float:
+                case ResourceFormat::RGB32Float:
+                    std::memcpy(&texel, p, sizeof(float3));
+                    break;
+                case ResourceFormat::RGBA16Float:
+                case ResourceFormat::RGB16Float:
+                {
+                    uint16_t h[3];
+                    std::memcpy(h, p, sizeof(h));
+                    texel = float3(f16tof32(h[0]), f16tof32(h[1]), f16tof32(h[2]));
+                    break;
+                }
+                case ResourceFormat::RGBA8Unorm:
+                    texel = float3(unorm[p[0]], unorm[p[1]], unorm[p[2]]);
+                    break;
+                case ResourceFormat::BGRA8Unorm:
+                case ResourceFormat::BGRX8Unorm:
+                    texel = float3(unorm[p[2]], unorm[p[1]], unorm[p[0]]);
+                    break;
+                case ResourceFormat::RG8Unorm:
+                    texel = float3(unorm[p[0]], unorm[p[1]], 0.f);
+                    break;
+                case ResourceFormat::R8Unorm:
+                    texel = float3(unorm[p[0]], 0.f, 0.f);
+                    break;
+                default:
+                    should_not_get_here();
+                }
+            }
+
+            return true;
+        }
+
+        /** Applies a sampler address mode to a texel coordinate.
+            \return Texel coordinate in [0, size), or -1 if the texel is outside the texture and border addressing is used.
+        */
+        int applyAddressMode(int64_t i, int size, Sampler::AddressMode mode)
+        {
+            switch (mode)
+            {
+            case Sampler::AddressMode::Wrap:
+                i %= size;
+                return (int)(i < 0 ? i + size : i);
+            case Sampler::AddressMode::Mirror:
+            {
+                int64_t j = i % (2 * (int64_t)size);
+                if (j < 0) j += 2 * (int64_t)size;
+                return (int)(j < size ? j : 2 * (int64_t)size - 1 - j);
+            }
+            case Sampler::AddressMode::MirrorOnce:
+                if (i < 0) i = -i - 1;
+                return (int)std::min(i, (int64_t)size - 1);
+            case Sampler::AddressMode::Border:
+                return i >= 0 && i < size ? (int)i : -1;
+            case Sampler::AddressMode::Clamp:
+            default:
+                return (int)glm::clamp(i, (int64_t)0, (int64_t)size - 1);
+            }
+        }
+
+        /** Sums up the texels covered by an emissive triangle.
+            This mirrors EmissiveIntegrator.ps.slang: The triangle is placed in texel space relative to the integer part of its
+            smallest texture coordinate, clipped to the integrator viewport, and each texel whose center is covered according to
+            the D3D rasterization rules contributes one point-sampled texel.
+            \return Sum over texels (RGB) and number of texels (A).
+        */
+        float4 integrateTexels(const EmissiveTexels& texture, const float2 texCoords[3], Sampler::AddressMode addressU, Sampler::AddressMode addressV, const float3& borderColor)
+        {
+            const float2 size = float2((float)texture.width, (float)texture.height);
+            const float2 offset = glm::floor(glm::min(glm::min(texCoords[0], texCoords[1]), texCoords[2]));
+
+            // Vertex positions in texels. The y-axis is flipped to match the viewport transform, which the top-left rule refers to.
+            float2 p[3];
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                const float2 texelPos = (texCoords[i] - offset) * size;
+                p[i] = float2(texelPos.x, -texelPos.y);
+            }
+
+            // Orient the triangle so that the edge functions are positive on the inside. Culling is disabled on the GPU.
+            auto edgeFunction = [](const float2& a, const float2& b, const float2& q) { return (b.x - a.x) * (q.y - a.y) - (b.y - a.y) * (q.x - a.x); };
+            const float area = edgeFunction(p[0], p[1], p[2]);
+            if (area == 0.f) return float4(0.f);
+            if (area < 0.f) std::swap(p[1], p[2]);
+
+            // Texel centers exactly on an edge are covered only if it's a top or left edge.
+            bool topLeft[3];
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                const float2& a = p[i];
+                const float2& b = p[(i + 1) % 3];
+                topLeft[i] = (a.y == b.y && b.x > a.x) || b.y < a.y;
+            }
+
+            // Bounding box of the covered texel centers, clipped to the viewport.
+            const float2 pMin = glm::min(glm::min(p[0], p[1]), p[2]);
+            const float2 pMax = glm::max(glm::max(p[0], p[1]), p[2]);
+            const int vpMax = (int)kIntegratorViewportDim - 1;
+            const int x0 = std::max(0, (int)std::ceil(pMin.x - 0.5f));
+            const int x1 = std::min(vpMax, (int)std::floor(pMax.x - 0.5f));
+            const int y0 = std::max(0, (int)std::ceil(-pMax.y - 0.5f));
+            const int y1 = std::min(vpMax, (int)std::floor(-pMin.y - 0.5f));
+
+            const int64_t offsetX = (int64_t)offset.x * texture.width;
+            const int64_t offsetY = (int64_t)offset.y * texture.height;
+
+            double sum[3] = {};
+            uint32_t count = 0;
+            for (int y = y0; y <= y1; y++)
+            {
+                const int ty = applyAddressMode(offsetY + y, texture.height, addressV);
+                for (int x = x0; x <= x1; x++)
+                {
+                    const float2 q = float2(x + 0.5f, -(y + 0.5f));
+                    bool covered = true;
+                    for (uint32_t i = 0; i < 3 && covered; i++)
+                    {
+                        const float e = edgeFunction(p[i], p[(i + 1) % 3], q);
+                        covered = e > 0.f || (e == 0.f && topLeft[i]);
+                    }
+                    if (!covered) continue;
+
+                    const int tx = applyAddressMode(offsetX + x, texture.width, addressU);
+                    const float3 color = (tx < 0 || ty < 0) ? borderColor : texture.texels[(size_t)ty * texture.width + tx];
+                    sum[0] += color.r;
+                    sum[1] += color.g;
+                    sum[2] += color.b;
+                    count++;
+                }
+            }
+
+            return float4((float)sum[0], (float)sum[1], (float)sum[2], (float)count);
+        }
     }
 
-    LightCollection::SharedPtr LightCollection::create(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene)
+    LightCollection::SharedPtr LightCollection::create(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene, bool allowCPUBuild)
     {
         SharedPtr ptr = SharedPtr(new LightCollection());
-        return ptr->init(pRenderContext, pScene) ? ptr : nullptr;
+        return ptr->init(pRenderContext, pScene, allowCPUBuild) ? ptr : nullptr;
     }
 
     bool LightCollection::update(RenderContext* pRenderContext, UpdateStatus* pUpdateStatus)
@@ -89,10 +289,11 @@ namespace Falcor
         return false;
     }
 
-    bool LightCollection::init(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene)
+    bool LightCollection::init(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene, bool allowCPUBuild)
     {
         assert(pScene);
         mpScene = pScene;
+        mAllowCPUBuild = allowCPUBuild;
 
         // Setup the lights.
         if (!setupMeshLights()) return false;
@@ -142,7 +343,7 @@ namespace Falcor
         mIntegrator.pState->setVao(Vao::create(Vao::Topology::TriangleList));
 
         // Set viewport. Note we don't bind any render targets so the size just determines the dispatch limits.
-        const uint32_t vpDim = 16384;       // 16K x 16K
+        const uint32_t vpDim = kIntegratorViewportDim;
         mIntegrator.pState->setViewport(0, GraphicsState::Viewport(0.f, 0.f, (float)vpDim, (float)vpDim, 0.f, 1.f));
         mIntegrator.pProgram->addDefine("_VIEWPORT_DIM", std::to_string(vpDim));    // Pass size to shader
 
@@ -228,18 +429,25 @@ namespace Falcor
         }
         else
         {
-            // Prepare GPU buffers.
-            prepareTriangleData(pRenderContext);
+            // Build the triangle data and pre-integrate the emissive triangles on the CPU if possible.
+            // This avoids the GPU passes and the readback, as the CPU needs the data for the active triangle list anyway.
+            mBuiltOnCPU = mAllowCPUBuild && buildOnCPU();
 
-            // Pre-integrate emissive triangles.
-            // TODO: We might want to redo this in update() for animated meshes or after scale changes as that affects the flux.
-            integrateEmissive(pRenderContext);
+            if (!mBuiltOnCPU)
+            {
+                // Prepare GPU buffers.
+                prepareTriangleData(pRenderContext);
 
-            mCPUInvalidData = CPUOutOfDateFlags::All;
-            mStagingBufferValid = false;
-            mStatsValid = false;
+                // Pre-integrate emissive triangles.
+                // TODO: We might want to redo this in update() for animated meshes or after scale changes as that affects the flux.
+                integrateEmissive(pRenderContext);
 
-            prepareSyncCPUData(pRenderContext);
+                mCPUInvalidData = CPUOutOfDateFlags::All;
+                mStagingBufferValid = false;
+                mStatsValid = false;
+
+                prepareSyncCPUData(pRenderContext);
+            }
 
             // Build list of active triangles.
             updateActiveTriangleList();
@@ -251,6 +459,14 @@ namespace Falcor
         assert(mTriangleCount > 0);
 
         // Create GPU buffers.
+        createTriangleBuffers();
+
+        // Compute triangle data (vertices, uv-coordinates, materialID) for all mesh lights.
+        buildTriangleList(pRenderContext);
+    }
+
+    void LightCollection::createTriangleBuffers()
+    {
         mpTriangleData = Buffer::createStructured(mpTriangleListBuilder["gTriangleData"], mTriangleCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess, Buffer::CpuAccess::None, nullptr, false);
         mpTriangleData->setName("LightCollection::mpTriangleData");
         if (mpTriangleData->getStructSize() != sizeof(PackedEmissiveTriangle)) throw std::exception("Struct PackedEmissiveTriangle size mismatch between CPU/GPU");
@@ -258,9 +474,127 @@ namespace Falcor
         mpFluxData = Buffer::createStructured(mpFinalizeIntegration["gFluxData"], mTriangleCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess, Buffer::CpuAccess::None, nullptr, false);
         mpFluxData->setName("LightCollection::mpFluxData");
         if (mpFluxData->getStructSize() != sizeof(EmissiveFlux)) throw std::exception("Struct EmissiveFlux size mismatch between CPU/GPU");
+    }
 
-        // Compute triangle data (vertices, uv-coordinates, materialID) for all mesh lights.
-        buildTriangleList(pRenderContext);
+    bool LightCollection::buildOnCPU()
+    {
+        PROFILE("LightCollection::buildOnCPU()");
+        assert(mTriangleCount > 0);
+
+        // The scene keeps the geometry of static emissive meshes on the CPU. Skinned meshes etc. take the GPU path.
+        std::vector<const Scene::EmissiveMeshGeometry*> geometry(mMeshLights.size());
+        for (size_t lightIdx = 0; lightIdx < mMeshLights.size(); lightIdx++)
+        {
+            const MeshLightData& meshLight = mMeshLights[lightIdx];
+            const Scene::EmissiveMeshGeometry* pGeometry = mpScene->getEmissiveMeshGeometry(mpScene->getMeshInstance(meshLight.meshInstanceID).meshID);
+            if (!pGeometry || pGeometry->positions.size() != (size_t)meshLight.triangleCount * 3) return false;
+            geometry[lightIdx] = pGeometry;
+        }
+
+        // Decode the emissive textures. The texture cache doesn't keep the image data around, so we load it again from the source files.
+        std::vector<Texture::SharedPtr> textures;
+        std::vector<uint32_t> textureIndices(mMeshLights.size(), kInvalidIndex);
+        for (size_t lightIdx = 0; lightIdx < mMeshLights.size(); lightIdx++)
+        {
+            const Texture::SharedPtr& pTexture = mpScene->getMaterial(mMeshLights[lightIdx].materialID)->getEmissiveTexture();
+            if (!pTexture) continue;
+            auto it = std::find(textures.begin(), textures.end(), pTexture);
+            textureIndices[lightIdx] = (uint32_t)(it - textures.begin());
+            if (it == textures.end()) textures.push_back(pTexture);
+        }
+
+        std::vector<EmissiveTexels> texels(textures.size());
+        std::atomic<bool> decoded(true);
+        Threading::parallelFor(0, textures.size(), [&](size_t i)
+        {
+            if (!decodeEmissiveTexture(*textures[i], texels[i])) decoded = false;
+        }, 1);
+        if (!decoded) return false;
+
+        // Texels are fetched with the material sampler's address modes, as done by the integrator's point sampler.
+        const Sampler::AddressMode addressU = mpSamplerState ? mpSamplerState->getAddressModeU() : Sampler::AddressMode::Wrap;
+        const Sampler::AddressMode addressV = mpSamplerState ? mpSamplerState->getAddressModeV() : Sampler::AddressMode::Wrap;
+        const float3 borderColor = mpSamplerState ? float3(mpSamplerState->getBorderColor()) : float3(0.f);
+
+        const auto& globalMatrices = mpScene->getAnimationController()->getGlobalMatrices();
+        std::vector<PackedEmissiveTriangle> triangleData(mTriangleCount);
+        std::vector<EmissiveFlux> fluxData(mTriangleCount);
+        mMeshLightTriangles.resize(mTriangleCount);
+
+        Threading::parallelForRange(0, mTriangleCount, [&](size_t first, size_t last)
+        {
+            // Find the mesh light of the first triangle. The mesh lights are sorted by triangle offset.
+            auto it = std::upper_bound(mMeshLights.begin(), mMeshLights.end(), (uint32_t)first, [](uint32_t triIdx, const MeshLightData& meshLight) { return triIdx < meshLight.triangleOffset; });
+            assert(it != mMeshLights.begin());
+            uint32_t lightIdx = (uint32_t)(it - mMeshLights.begin()) - 1;
+
+            for (uint32_t triIdx = (uint32_t)first; triIdx < (uint32_t)last; triIdx++)
+            {
+                while (triIdx >= mMeshLights[lightIdx].triangleOffset + mMeshLights[lightIdx].triangleCount) lightIdx++;
+                const MeshLightData& meshLight = mMeshLights[lightIdx];
+                const MeshInstanceData& instanceData = mpScene->getMeshInstance(meshLight.meshInstanceID);
+                const glm::mat4& worldMat = globalMatrices[instanceData.globalMatrixID];
+                const Scene::EmissiveMeshGeometry& meshGeometry = *geometry[lightIdx];
+                const size_t vtxOffset = (size_t)(triIdx - meshLight.triangleOffset) * 3;
+
+                // Transform the triangle to world space, as done by BuildTriangleList.cs.slang.
+                EmissiveTriangle tri;
+                for (uint32_t j = 0; j < 3; j++)
+                {
+                    tri.posW[j] = float3(worldMat * float4(meshGeometry.positions[vtxOffset + j], 1.f));
+                    tri.texCoords[j] = meshGeometry.texCrds[vtxOffset + j];
+                }
+                float3 N = glm::cross(tri.posW[1] - tri.posW[0], tri.posW[2] - tri.posW[0]);
+                tri.area = 0.5f * glm::length(N);
+                if (instanceData.flags & (uint32_t)MeshInstanceFlags::Flipped) N = -N;
+                tri.normal = glm::normalize(N);
+                tri.materialID = meshLight.materialID;
+                tri.lightIdx = lightIdx;
+
+                // Continue from the packed data so that the results match the GPU path.
+                triangleData[triIdx].pack(tri);
+                tri = triangleData[triIdx].unpack();
+
+                // Compute average radiance and flux, as done by FinalizeIntegration.cs.slang.
+                const Material::SharedPtr& pMaterial = mpScene->getMaterial(tri.materialID);
+                float3 averageEmissiveColor = pMaterial->getEmissiveColor();
+                const uint32_t textureIdx = textureIndices[lightIdx];
+                if (textureIdx != kInvalidIndex)
+                {
+                    const float4 texelSum = integrateTexels(texels[textureIdx], tri.texCoords, addressU, addressV, borderColor);
+                    averageEmissiveColor = texelSum.a > 0.f ? float3(texelSum) / texelSum.a : float3(1.f);
+                }
+                const float3 averageRadiance = averageEmissiveColor * pMaterial->getEmissiveFactor();
+                const float flux = luminance(averageRadiance) * tri.area * (float)M_PI;
+                fluxData[triIdx].flux = flux;
+                fluxData[triIdx].averageRadiance = averageRadiance;
+
+                // Store the CPU-side triangle, identical to what syncCPUData() reads back.
+                auto& meshLightTri = mMeshLightTriangles[triIdx];
+                meshLightTri.lightIdx = tri.lightIdx;
+                meshLightTri.normal = tri.normal;
+                meshLightTri.area = tri.area;
+                for (uint32_t j = 0; j < 3; j++)
+                {
+                    meshLightTri.vtx[j].pos = tri.posW[j];
+                    meshLightTri.vtx[j].uv = tri.texCoords[j];
+                }
+                meshLightTri.flux = flux;
+                meshLightTri.averageRadiance = averageRadiance;
+            }
+        }, 256);
+
+        // Upload the results.
+        createTriangleBuffers();
+        mpTriangleData->setBlob(triangleData.data(), 0, triangleData.size() * sizeof(PackedEmissiveTriangle));
+        mpFluxData->setBlob(fluxData.data(), 0, fluxData.size() * sizeof(EmissiveFlux));
+
+        // The CPU data is up-to-date, nothing needs to be read back.
+        mCPUInvalidData = CPUOutOfDateFlags::None;
+        mStagingBufferValid = true;
+        mStatsValid = false;
+
+        return true;
     }
 
     void LightCollection::prepareMeshData()
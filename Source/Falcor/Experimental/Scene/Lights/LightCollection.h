@@ -109,9 +109,11 @@ namespace Falcor
             Note that update() must be called before the collection is ready to use.
             \param[in] pRenderContext The render context.
             \param[in] pScene The scene.
+            \param[in] allowCPUBuild Build the emissive triangles and pre-integrate their flux on the CPU if the scene provides the geometry and emissive textures on the CPU.
+                        Otherwise, or if this is false, this is done in GPU passes and the results are read back when needed.
             \return Ptr to the created object, or nullptr if an error occured.
         */
-        static SharedPtr create(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene);
+        static SharedPtr create(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene, bool allowCPUBuild = true);
 
         /** Updates the light collection to the current state of the scene.
             \param[in] pRenderContext The render context.
@@ -135,6 +137,10 @@ namespace Falcor
         */
         uint32_t getTotalLightCount() const { return mTriangleCount; }
 
+        /** Returns true if the emissive triangles were built and pre-integrated on the CPU.
+        */
+        bool isBuiltOnCPU() const { return mBuiltOnCPU; }
+
         /** Returns stats.
         */
         const MeshLightStats& getStats() const { computeStats(); return mMeshLightStats; }
@@ -170,11 +176,13 @@ namespace Falcor
     protected:
         LightCollection() = default;
 
-        bool init(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene);
+        bool init(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene, bool allowCPUBuild);
         bool initIntegrator();
         bool setupMeshLights();
         void build(RenderContext* pRenderContext);
+        void createTriangleBuffers();
         void prepareTriangleData(RenderContext* pRenderContext);
+        bool buildOnCPU();
         void prepareMeshData();
         void integrateEmissive(RenderContext* pRenderContext);
         void computeStats() const;
@@ -224,6 +232,8 @@ namespace Falcor
 
         mutable CPUOutOfDateFlags               mCPUInvalidData = CPUOutOfDateFlags::None;  ///< Flags indicating which CPU data is valid.
         mutable bool                            mStagingBufferValid = true;                 ///< Flag to indicate if the contents of the staging buffer is up-to-date.
+        bool                                    mAllowCPUBuild = true;                      ///< Build on the CPU if the scene provides the required data.
+        bool                                    mBuiltOnCPU = false;                        ///< True if the emissive triangles were built on the CPU.
     };
 
     enum_class_operators(LightCollection::CPUOutOfDateFlags);
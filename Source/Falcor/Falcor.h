@@ -59,6 +59,7 @@
 #include "Core/API/LowLevelContextData.h"
 #include "Core/API/QueryHeap.h"
 #include "Core/API/RasterizerState.h"
+#include "Core/API/ReadbackQueue.h"
 #include "Core/API/RenderContext.h"
 #include "Core/API/Resource.h"
 #include "Core/API/GpuMemoryHeap.h"
@@ -84,6 +85,7 @@
 #include "Core/Program/ProgramReflection.h"
 #include "Core/Program/ProgramVars.h"
 #include "Core/Program/ProgramVersion.h"
+#include "Core/Program/ShaderCache.h"
 #include "Core/Program/ShaderLibrary.h"
 
 // Core/State
@@ -109,13 +111,17 @@
 #include "Scene/Scene.h"
 #include "Scene/ProceduralScene.h"
 #include "Scene/Importer.h"
+#include "Scene/SceneCache.h"
 #include "Scene/Camera/Camera.h"
+#include "Scene/Culling/Frustum.h"
+#include "Scene/Culling/InstanceBVH.h"
 #include "Scene/Camera/CameraController.h"
 #include "Scene/Lights/Light.h"
 #include "Scene/Lights/LightProbe.h"
 #include "Scene/Material/Material.h"
 #include "Scene/Animation/Animation.h"
 #include "Scene/Animation/AnimationController.h"
+#include "Scene/Animation/TransformHierarchy.h"
 #include "Scene/ParticleSystem/ParticleSystem.h"
 
 // Utils
@@ -129,6 +135,7 @@
 #include "Utils/Algorithm/DirectedGraphTraversal.h"
 #include "Utils/Algorithm/ParallelReduction.h"
 #include "Utils/Image/Bitmap.h"
+#include "Utils/Image/TextureCache.h"
 #include "Utils/Math/CubicSpline.h"
 #include "Utils/Math/FalcorMath.h"
 #include "Utils/Scripting/Dictionary.h"
@@ -71,7 +71,9 @@ namespace Falcor
         mpScene = pScene;
         for (auto& it : mNodeData)
         {
+            Program::LinkRecorder recorder(it.second.pPass->mProgramsToLink);
             it.second.pPass->setScene(gpDevice->getRenderContext(), pScene);
+            mpGraph->markNodeDirty(it.first);
         }
         mRecompile = true;
     }
@@ -91,10 +93,14 @@ namespace Falcor
             mNameToIndex[passName] = passIndex;
         }
 
-        pPass->mPassChangedCB = [this]() { mRecompile = true; };
+        pPass->mPassChangedCB = [this, passIndex]() { mpGraph->markNodeDirty(passIndex); mRecompile = true; };
         pPass->mName = passName;
 
-        if (mpScene) pPass->setScene(gpDevice->getRenderContext(), mpScene);
+        if (mpScene)
+        {
+            Program::LinkRecorder recorder(pPass->mProgramsToLink);
+            pPass->setScene(gpDevice->getRenderContext(), mpScene);
+        }
         mNodeData[passIndex] = { passName, pPass };
         mRecompile = true;
         return passIndex;
@@ -143,10 +149,15 @@ namespace Falcor
         std::string passTypeName = getClassTypeName(pOldPass.get());
         auto pPass = RenderPassLibrary::instance().createPass(pRenderContext, passTypeName.c_str(), dict);
         pPassIt->second.pPass = pPass;
-        pPass->mPassChangedCB = [this]() { mRecompile = true; };
+        pPass->mPassChangedCB = [this, index]() { mpGraph->markNodeDirty(index); mRecompile = true; };
         pPass->mName = pOldPass->getName();
 
-        if (mpScene) pPass->setScene(gpDevice->getRenderContext(), mpScene);
+        if (mpScene)
+        {
+            Program::LinkRecorder recorder(pPass->mProgramsToLink);
+            pPass->setScene(gpDevice->getRenderContext(), mpScene);
+        }
+        mpGraph->markNodeDirty(index);
         mRecompile = true;
     }
 
@@ -385,11 +396,14 @@ namespace Falcor
     bool RenderGraph::compile(RenderContext* pContext, std::string& log)
     {
         if (!mRecompile) return true;
-        mpExe = nullptr;
+
+        // Recompile incrementally, the compiler keeps the passes and resources that are unaffected by the changes
+        auto pPrevious = std::move(mpExe);
 
         try
         {
-            mpExe = RenderGraphCompiler::compile(*this, pContext, mCompilerDeps);
+            mpExe = RenderGraphCompiler::compile(*this, pContext, mCompilerDeps, pPrevious.get());
+            mpGraph->clearDirtyNodes();
             mRecompile = false;
             return true;
         }
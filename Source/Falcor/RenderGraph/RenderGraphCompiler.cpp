@@ -38,13 +38,25 @@ namespace Falcor
         {
             return src.getSampleCount() > 1 && dst.getSampleCount() == 1;
         }
+
+        bool isSameCompileData(const RenderPass::CompileData& a, const RenderPass::CompileData& b)
+        {
+            return a.defaultTexDims == b.defaultTexDims && a.defaultTexFormat == b.defaultTexFormat && a.connectedResources == b.connectedResources;
+        }
     }
 
-    RenderGraphCompiler::RenderGraphCompiler(RenderGraph& graph, const Dependencies& dependencies) : mGraph(graph), mDependencies(dependencies) {}
+    RenderGraphCompiler::RenderGraphCompiler(RenderGraph& graph, const Dependencies& dependencies, const RenderGraphExe* pPrevious) : mGraph(graph), mDependencies(dependencies), mpPrevious(pPrevious)
+    {
+        if (mpPrevious)
+        {
+            auto changed = mGraph.mpGraph->getDownstreamNodes(mGraph.mpGraph->getDirtyNodes());
+            mChangedPasses.insert(changed.begin(), changed.end());
+        }
+    }
 
-    RenderGraphExe::SharedPtr RenderGraphCompiler::compile(RenderGraph& graph, RenderContext* pContext, const Dependencies& dependencies)
+    RenderGraphExe::SharedPtr RenderGraphCompiler::compile(RenderGraph& graph, RenderContext* pContext, const Dependencies& dependencies, const RenderGraphExe* pPrevious)
     {
-        RenderGraphCompiler c = RenderGraphCompiler(graph, dependencies);
+        RenderGraphCompiler c = RenderGraphCompiler(graph, dependencies, pPrevious);
 
         // Register the external resources
         auto pResourcesCache = ResourceCache::create();
@@ -57,14 +69,30 @@ namespace Falcor
         c.allocateResources(pResourcesCache.get());
 
         auto pExe = RenderGraphExe::create();
+        pExe->mpResourceCache = pResourcesCache;
         pExe->mExecutionList.reserve(c.mExecutionList.size());
 
-        for (auto e : c.mExecutionList)
+        for (const auto& e : c.mExecutionList)
         {
-            pExe->insertPass(e.name, e.pPass);
+            pExe->insertPass(e.name, e.pPass, e.reflector);
+            pExe->mExecutionList.back().compileData = e.compileData;
+            pExe->mExecutionList.back().compiled = e.compiled;
         }
         c.restoreCompilationChanges();
-        pExe->mpResourceCache = pResourcesCache;
+
+        // Passes compile their programs lazily, one at a time, when they first execute.
+        // Compile the programs created or changed by the passes of the graph concurrently instead.
+        std::vector<Program::SharedPtr> programs;
+        for (const auto& e : pExe->mExecutionList)
+        {
+            for (const auto& pWeakProgram : e.pPass->mProgramsToLink)
+            {
+                if (auto pProgram = pWeakProgram.lock()) programs.push_back(pProgram);
+            }
+            e.pPass->mProgramsToLink.clear();
+        }
+        Program::linkPrograms(programs);
+
         return pExe;
     }
 
@@ -134,8 +162,8 @@ namespace Falcor
             }
         }
 
-        // Run topological sort
-        auto topologicalSort = DirectedGraphTopologicalSort::sort(mGraph.mpGraph.get());
+        // The graph keeps its topological order up to date as it is edited
+        auto topologicalSort = mGraph.mpGraph->getTopologicalOrder();
 
         // For each object in the vector, if it's being used in the execution, put it in the list
         for (auto& node : topologicalSort)
@@ -235,13 +263,6 @@ namespace Falcor
 
     void RenderGraphCompiler::allocateResources(ResourceCache* pResourceCache)
     {
-        // Build list to look up execution order index from the pass
-        std::unordered_map<RenderPass*, uint32_t> passToIndex;
-        for (size_t i = 0; i < mExecutionList.size(); i++)
-        {
-            passToIndex.emplace(mExecutionList[i].pPass.get(), uint32_t(i));
-        }
-
         for (size_t i = 0; i < mExecutionList.size(); i++)
         {
             uint32_t nodeIndex = mExecutionList[i].index;
@@ -303,13 +324,12 @@ namespace Falcor
                 std::string srcFieldName = mGraph.mNodeData[pEdge->getSourceNode()].name + '.' + edgeData.srcField;
                 std::string dstFieldName = mGraph.mNodeData[nodeIndex].name + '.' + dstField.getName();
 
-                const auto& pSrcPass = mGraph.mNodeData[pEdge->getSourceNode()].pPass.get();
-                const auto& srcReflection = mExecutionList[passToIndex.at(pSrcPass)].reflector;
-                pResourceCache->registerField(dstFieldName, dstField, passToIndex[pSrcPass], srcFieldName);
+                // The resource is used until the last pass reading it, which is needed for aliasing transient resources
+                pResourceCache->registerField(dstFieldName, dstField, uint32_t(i), srcFieldName);
             }
         }
 
-        pResourceCache->allocateResources(mDependencies.defaultResourceProps);
+        pResourceCache->allocateResources(mDependencies.defaultResourceProps, mpPrevious ? mpPrevious->mpResourceCache.get() : nullptr);
     }
 
 
@@ -396,21 +416,44 @@ namespace Falcor
         return compileData;
     }
 
+    bool RenderGraphCompiler::isCompiled(const PassData& passData, const RenderPass::CompileData& compileData) const
+    {
+        if (!mpPrevious || mChangedPasses.count(passData.index)) return false;
+
+        for (const auto& p : mpPrevious->mExecutionList)
+        {
+            if (p.name == passData.name) return p.compiled && p.pPass == passData.pPass && isSameCompileData(p.compileData, compileData);
+        }
+        return false;
+    }
+
     void RenderGraphCompiler::compilePasses(RenderContext* pContext)
     {
+        bool retry = false;
         while(1)
         {
             std::string log;
             bool success = true;
             for (auto& p : mExecutionList)
             {
+                // Skip the passes that are unchanged since the previous compilation, unless a pass failed and the reflection changed
+                p.compileData = prepPassCompilationData(p);
+                if (!retry && isCompiled(p, p.compileData))
+                {
+                    p.compiled = true;
+                    continue;
+                }
+
                 try
                 {
-                    p.pPass->compile(pContext, prepPassCompilationData(p));
+                    Program::LinkRecorder recorder(p.pPass->mProgramsToLink);
+                    p.pPass->compile(pContext, p.compileData);
+                    p.compiled = true;
                 }
                 catch (const std::exception& e)
                 {
                     log += std::string(e.what()) + "\n";
+                    p.compiled = false;
                     success = false;
                 }
             }
@@ -418,6 +461,7 @@ namespace Falcor
             if (success) return;
 
             // Retry
+            retry = true;
             bool changed = false;
             for (auto& p : mExecutionList)
             {
@@ -41,12 +41,22 @@ namespace Falcor
             ResourceCache::DefaultProperties defaultResourceProps;
             ResourceCache::ResourcesMap externalResources;
         };
-        static RenderGraphExe::SharedPtr compile(RenderGraph& graph, RenderContext* pContext, const Dependencies& dependencies);
+
+        /** Compile a graph.
+            \param[in] graph The graph to compile.
+            \param[in] pContext The render context.
+            \param[in] dependencies External resources and default resource properties.
+            \param[in] pPrevious Optional. The previous compilation of the graph. Passes are only recompiled if they changed, are downstream of a change or their compile data changed,
+                and resources are reused where possible. The changes are tracked by the graph's dirty nodes.
+            \return The executable graph. Throws an exception if compilation failed.
+        */
+        static RenderGraphExe::SharedPtr compile(RenderGraph& graph, RenderContext* pContext, const Dependencies& dependencies, const RenderGraphExe* pPrevious = nullptr);
 
     private:
-        RenderGraphCompiler(RenderGraph& graph, const Dependencies& dependencies);
+        RenderGraphCompiler(RenderGraph& graph, const Dependencies& dependencies, const RenderGraphExe* pPrevious);
         RenderGraph& mGraph;
         const Dependencies& mDependencies;
+        const RenderGraphExe* mpPrevious;
 
         struct PassData
         {
@@ -54,8 +64,11 @@ namespace Falcor
             RenderPass::SharedPtr pPass;
             std::string name;
             RenderPassReflection reflector;
+            RenderPass::CompileData compileData;
+            bool compiled = false;
         };
         std::vector<PassData> mExecutionList;
+        std::unordered_set<uint32_t> mChangedPasses;    // Passes that changed since the previous compilation and the passes downstream of them
 
         // TODO Better way to track history, or avoid changing the original graph altogether?
         struct
@@ -71,5 +84,6 @@ namespace Falcor
         void validateGraph() const;
         void restoreCompilationChanges();
         RenderPass::CompileData prepPassCompilationData(const PassData& passData);
+        bool isCompiled(const PassData& passData, const RenderPass::CompileData& compileData) const;
     };
 }
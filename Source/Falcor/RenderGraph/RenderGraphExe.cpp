@@ -38,7 +38,7 @@ namespace Falcor
         {
             PROFILE(pass.name);
 
-            RenderData renderData(pass.name, mpResourceCache, ctx.pGraphDictionary, ctx.defaultTexDims, ctx.defaultTexFormat);
+            RenderData renderData(pass.name, pass.resources, mpResourceCache.get(), ctx.pGraphDictionary, ctx.defaultTexDims, ctx.defaultTexFormat);
             pass.pPass->execute(ctx.pRenderContext, renderData);
         }
     }
@@ -90,9 +90,22 @@ namespace Falcor
         }
     }
 
-    void RenderGraphExe::insertPass(const std::string& name, const RenderPass::SharedPtr& pPass)
+    void RenderGraphExe::insertPass(const std::string& name, const RenderPass::SharedPtr& pPass, const RenderPassReflection& reflection)
     {
-        mExecutionList.push_back(Pass(name, pPass));
+        assert(mpResourceCache);
+        Pass pass(name, pPass);
+
+        // Resolve the fields once here instead of building their full names every frame. The handle of a field is its index in the reflection.
+        size_t fieldCount = reflection.getFieldCount();
+        pass.resources.slots.reserve(fieldCount);
+        for (size_t i = 0; i < fieldCount; i++)
+        {
+            const std::string& fieldName = reflection.getField(i)->getName();
+            pass.resources.handles[fieldName] = (uint32_t)i;
+            pass.resources.slots.push_back(mpResourceCache->getResourceSlot(name + '.' + fieldName));
+        }
+
+        mExecutionList.push_back(std::move(pass));
     }
 
     Resource::SharedPtr RenderGraphExe::getResource(const std::string& name) const
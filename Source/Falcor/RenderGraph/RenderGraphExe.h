@@ -84,12 +84,17 @@ namespace Falcor
         static SharedPtr create() { return SharedPtr(new RenderGraphExe); }
         RenderGraphExe() = default;
 
-        void insertPass(const std::string& name, const RenderPass::SharedPtr& pPass);
+        /** Add a pass to the end of the execution list. The pass' fields are resolved to resource cache slots, so the resource cache must be set before calling this.
+        */
+        void insertPass(const std::string& name, const RenderPass::SharedPtr& pPass, const RenderPassReflection& reflection);
 
         struct Pass
         {
             std::string name;
             RenderPass::SharedPtr pPass;
+            RenderData::PassResources resources;
+            RenderPass::CompileData compileData;    ///< Data the pass was compiled with.
+            bool compiled = false;                  ///< Whether the pass compiled successfully.
         private:
             friend class RenderGraphExe; // Force RenderGraphCompiler to use insertPass() by hiding this Ctor from it
             Pass(const std::string& name_, const RenderPass::SharedPtr& pPass_) : name(name_), pPass(pPass_) {}
@@ -30,8 +30,9 @@
 
 namespace Falcor
 {
-    RenderData::RenderData(const std::string& passName, const ResourceCache::SharedPtr& pResourceCache, const InternalDictionary::SharedPtr& pDict, const uint2& defaultTexDims, ResourceFormat defaultTexFormat)
+    RenderData::RenderData(const std::string& passName, const PassResources& passResources, const ResourceCache* pResourceCache, const InternalDictionary::SharedPtr& pDict, const uint2& defaultTexDims, ResourceFormat defaultTexFormat)
         : mName(passName)
+        , mPassResources(passResources)
         , mpResources(pResourceCache)
         , mpDictionary(pDict)
         , mDefaultTexDims(defaultTexDims)
@@ -42,6 +43,23 @@ namespace Falcor
 
     const Resource::SharedPtr& RenderData::getResource(const std::string& name) const
     {
+        uint32_t handle = getHandle(name);
+        if (handle != kInvalidHandle) return getResource(handle);
+
+        // Not one of the pass' fields, fall back to looking up the full name
         return mpResources->getResource(mName + '.' + name);
     }
+
+    const Resource::SharedPtr& RenderData::getResource(uint32_t handle) const
+    {
+        static const Resource::SharedPtr pNull;
+        if (handle >= mPassResources.slots.size()) return pNull;
+        return mpResources->getResource(mPassResources.slots[handle]);
+    }
+
+    uint32_t RenderData::getHandle(const std::string& name) const
+    {
+        auto it = mPassResources.handles.find(name);
+        return it != mPassResources.handles.end() ? it->second : kInvalidHandle;
+    }
 }
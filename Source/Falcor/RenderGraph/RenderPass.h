@@ -35,6 +35,7 @@
 #include "Utils/UI/Gui.h"
 #include "Utils/UI/UserInput.h"
 #include "Core/API/RenderContext.h"
+#include "Core/Program/Program.h"
 
 namespace Falcor
 {
@@ -43,6 +44,8 @@ namespace Falcor
     class dlldecl RenderData
     {
     public:
+        static const uint32_t kInvalidHandle = uint32_t(-1);
+
         /** Get a resource
             \param[in] name The name of the pass' resource (i.e. "outputColor"). No need to specify the pass' name
             \return If the name exists, a pointer to the resource. Otherwise, nullptr
@@ -55,6 +58,19 @@ namespace Falcor
         */
         const Resource::SharedPtr& getResource(const std::string& name) const;
 
+        /** Get a resource by handle. This avoids the name lookup, which matters for passes fetching many resources every frame.
+            The handle of a field is its index in the reflection returned by the pass' `reflect()`, i.e. the order in which the fields were added.
+            \param[in] handle The field's handle
+            \return If the handle is valid, a pointer to the resource. Otherwise, nullptr
+        */
+        const Resource::SharedPtr& getResource(uint32_t handle) const;
+
+        /** Get the handle of a field
+            \param[in] name The name of the pass' resource (i.e. "outputColor")
+            \return The field's handle, or kInvalidHandle if the pass doesn't have a field with that name
+        */
+        uint32_t getHandle(const std::string& name) const;
+
         /** Get the global dictionary. You can use it to pass data between different passes
         */
         InternalDictionary& getDictionary() const { return (*mpDictionary); }
@@ -68,9 +84,19 @@ namespace Falcor
         ResourceFormat getDefaultTextureFormat() const { return mDefaultTexFormat; }
     protected:
         friend class RenderGraphExe;
-        RenderData(const std::string& passName, const ResourceCache::SharedPtr& pResourceCache, const InternalDictionary::SharedPtr& pDict, const uint2& defaultTexDims, ResourceFormat defaultTexFormat);
+
+        /** The pass' fields, resolved to resource cache slots when the graph is compiled
+        */
+        struct PassResources
+        {
+            std::unordered_map<std::string, uint32_t> handles;  ///< Field name to handle.
+            std::vector<uint32_t> slots;                        ///< Resource cache slot of each handle.
+        };
+
+        RenderData(const std::string& passName, const PassResources& passResources, const ResourceCache* pResourceCache, const InternalDictionary::SharedPtr& pDict, const uint2& defaultTexDims, ResourceFormat defaultTexFormat);
         const std::string& mName;
-        ResourceCache::SharedPtr mpResources;
+        const PassResources& mPassResources;
+        const ResourceCache* mpResources;
         InternalDictionary::SharedPtr mpDictionary;
         uint2 mDefaultTexDims;
         ResourceFormat mDefaultTexFormat;
@@ -150,8 +176,11 @@ namespace Falcor
 
     protected:
         friend class RenderGraph;
+        friend class RenderGraphCompiler;
+        friend class RenderPassLibrary;
         RenderPass() = default;
         std::string mName;
         std::function<void(void)> mPassChangedCB = [] {};
+        std::vector<std::weak_ptr<Program>> mProgramsToLink;   ///< Programs created or changed by the pass that are compiled at the end of the next graph compilation.
     };
 }
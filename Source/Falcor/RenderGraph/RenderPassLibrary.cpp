@@ -113,8 +113,16 @@ namespace Falcor
             }
         }
 
+        // Record the programs the pass creates, so they are compiled with the other programs of the graph.
         auto& renderPass = mPasses[className];
-        return renderPass.func(pRenderContext, dict);
+        std::vector<std::weak_ptr<Program>> programs;
+        RenderPass::SharedPtr pPass;
+        {
+            Program::LinkRecorder recorder(programs);
+            pPass = renderPass.func(pRenderContext, dict);
+        }
+        if (pPass) pPass->mProgramsToLink = std::move(programs);
+        return pPass;
     }
 
     RenderPassLibrary::DescVec RenderPassLibrary::enumerateClasses() const
@@ -28,6 +28,8 @@
 #include "stdafx.h"
 #include "ResourceCache.h"
 #include "Core/API/Texture.h"
+#include <numeric>
+#include <queue>
 
 namespace Falcor
 {
@@ -40,6 +42,9 @@ namespace Falcor
     {
         mNameToIndex.clear();
         mResourceData.clear();
+        mNameToSlot.clear();
+        mSlots.clear();
+        mMemoryStats = {};
     }
 
     const Resource::SharedPtr& ResourceCache::getResource(const std::string& name) const
@@ -58,6 +63,13 @@ namespace Falcor
         return extIt->second;
     }
 
+    uint32_t ResourceCache::getResourceSlot(const std::string& name)
+    {
+        auto it = mNameToSlot.emplace(name, (uint32_t)mSlots.size()).first;
+        if (it->second == mSlots.size()) mSlots.push_back({ name, getResource(name) });
+        return it->second;
+    }
+
     const RenderPassReflection::Field& ResourceCache::getResourceReflection(const std::string& name) const
     {
         uint32_t i = mNameToIndex.at(name);
@@ -78,6 +90,10 @@ namespace Falcor
 
             mExternalResources.erase(it);
         }
+
+        // Update the slot, the name now resolves to the new external resource or back to the graph's own resource
+        auto slotIt = mNameToSlot.find(name);
+        if (slotIt != mNameToSlot.end()) mSlots[slotIt->second].pResource = getResource(name);
     }
 
     void mergeTimePoint(std::pair<uint32_t, uint32_t>& range, uint32_t newTime)
@@ -86,6 +102,14 @@ namespace Falcor
         range.second = std::max(range.second, newTime);
     }
 
+    bool isTransient(const RenderPassReflection::Field& field)
+    {
+        // Internal resources may carry data between frames, persistent resources must not change between executions.
+        if (is_set(field.getVisibility(), RenderPassReflection::Field::Visibility::Internal)) return false;
+        if (is_set(field.getFlags(), RenderPassReflection::Field::Flags::Persistent)) return false;
+        return true;
+    }
+
     void ResourceCache::registerField(const std::string& name, const RenderPassReflection::Field& field, uint32_t timePoint, const std::string& alias)
     {
         assert(mNameToIndex.find(name) == mNameToIndex.end());
@@ -102,7 +126,8 @@ namespace Falcor
             assert(mNameToIndex.count(name) == 0);
             mNameToIndex[name] = (uint32_t)mResourceData.size();
             bool resolveBindFlags = (field.getBindFlags() == ResourceBindFlags::None);
-            mResourceData.push_back({ field, {timePoint, timePoint}, nullptr, resolveBindFlags, name });
+            bool transient = isTransient(field) && timePoint != uint32_t(-1);
+            mResourceData.push_back({ field, {timePoint, timePoint}, nullptr, resolveBindFlags, name, transient });
         }
         else // Add alias
         {
@@ -112,81 +137,285 @@ namespace Falcor
             mergeTimePoint(mResourceData[index].lifetime, timePoint);
             mResourceData[index].pResource = nullptr;
             mResourceData[index].resolveBindFlags = mResourceData[index].resolveBindFlags || (field.getBindFlags() == ResourceBindFlags::None);
+            mResourceData[index].transient = mResourceData[index].transient && isTransient(field);
         }
     }
 
-    Resource::SharedPtr createResourceForPass(const ResourceCache::DefaultProperties& params, const RenderPassReflection::Field& field, bool resolveBindFlags, const std::string& resourceName)
+    namespace
     {
-        uint32_t width = field.getWidth() ? field.getWidth() : params.dims.x;
-        uint32_t height = field.getHeight() ? field.getHeight() : params.dims.y;
-        uint32_t depth = field.getDepth() ? field.getDepth() : 1;
-        uint32_t sampleCount = field.getSampleCount() ? field.getSampleCount() : 1;
-        auto bindFlags = field.getBindFlags();
-        auto arraySize = field.getArraySize();
-        auto mipLevels = field.getMipCount();
+        /** Fully resolved resource properties. Resources with equal descriptions are interchangeable.
+        */
+        struct ResourceDesc
+        {
+            RenderPassReflection::Field::Type type;
+            uint32_t width;
+            uint32_t height;
+            uint32_t depth;
+            uint32_t sampleCount;
+            uint32_t arraySize;
+            uint32_t mipLevels;
+            ResourceFormat format;
+            ResourceBindFlags bindFlags;
 
-        ResourceFormat format = ResourceFormat::Unknown;
+            bool operator<(const ResourceDesc& other) const
+            {
+                return std::tie(type, width, height, depth, sampleCount, arraySize, mipLevels, format, bindFlags) <
+                    std::tie(other.type, other.width, other.height, other.depth, other.sampleCount, other.arraySize, other.mipLevels, other.format, other.bindFlags);
+            }
+
+            bool operator==(const ResourceDesc& other) const { return !(*this < other) && !(other < *this); }
+        };
 
-        if (field.getType() != RenderPassReflection::Field::Type::RawBuffer)
+        ResourceDesc resolveResourceDesc(const ResourceCache::DefaultProperties& params, const RenderPassReflection::Field& field, bool resolveBindFlags)
         {
-            format = field.getFormat() == ResourceFormat::Unknown ? params.format : field.getFormat();
-            if (resolveBindFlags)
+            ResourceDesc desc;
+            desc.type = field.getType();
+            desc.width = field.getWidth() ? field.getWidth() : params.dims.x;
+            desc.height = field.getHeight() ? field.getHeight() : params.dims.y;
+            desc.depth = field.getDepth() ? field.getDepth() : 1;
+            desc.sampleCount = field.getSampleCount() ? field.getSampleCount() : 1;
+            desc.arraySize = field.getArraySize();
+            desc.mipLevels = field.getMipCount();
+            desc.format = ResourceFormat::Unknown;
+            desc.bindFlags = field.getBindFlags();
+
+            if (field.getType() != RenderPassReflection::Field::Type::RawBuffer)
+            {
+                desc.format = field.getFormat() == ResourceFormat::Unknown ? params.format : field.getFormat();
+                if (resolveBindFlags)
+                {
+                    ResourceBindFlags mask = Resource::BindFlags::UnorderedAccess | Resource::BindFlags::ShaderResource;
+                    bool isOutput = is_set(field.getVisibility(), RenderPassReflection::Field::Visibility::Output);
+                    bool isInternal = is_set(field.getVisibility(), RenderPassReflection::Field::Visibility::Internal);
+                    if (isOutput || isInternal) mask |= Resource::BindFlags::DepthStencil | Resource::BindFlags::RenderTarget;
+                    auto supported = getFormatBindFlags(desc.format);
+                    mask &= supported;
+                    desc.bindFlags |= mask;
+                }
+            }
+            else // RawBuffer
             {
-                ResourceBindFlags mask = Resource::BindFlags::UnorderedAccess | Resource::BindFlags::ShaderResource;
-                bool isOutput = is_set(field.getVisibility(), RenderPassReflection::Field::Visibility::Output);
-                bool isInternal = is_set(field.getVisibility(), RenderPassReflection::Field::Visibility::Internal);
-                if (isOutput || isInternal) mask |= Resource::BindFlags::DepthStencil | Resource::BindFlags::RenderTarget;
-                auto supported = getFormatBindFlags(format);
-                mask &= supported;
-                bindFlags |= mask;
+                if (resolveBindFlags) desc.bindFlags = Resource::BindFlags::UnorderedAccess | Resource::BindFlags::ShaderResource;
             }
+            return desc;
         }
-        else // RawBuffer
+
+        /** Estimate the memory size of a resource. Ignores alignment and compression.
+        */
+        uint64_t getResourceSize(const ResourceDesc& desc)
         {
-            if (resolveBindFlags) bindFlags = Resource::BindFlags::UnorderedAccess | Resource::BindFlags::ShaderResource;
+            if (desc.type == RenderPassReflection::Field::Type::RawBuffer) return desc.width;
+
+            uint32_t width = desc.width;
+            uint32_t height = desc.type == RenderPassReflection::Field::Type::Texture1D ? 1 : desc.height;
+            uint32_t depth = desc.type == RenderPassReflection::Field::Type::Texture3D ? desc.depth : 1;
+            uint32_t layers = desc.arraySize * (desc.type == RenderPassReflection::Field::Type::TextureCube ? 6 : 1);
+            uint32_t mipLevels = desc.sampleCount > 1 ? 1 : desc.mipLevels;
+
+            uint64_t texels = 0;
+            for (uint32_t mip = 0; mip < mipLevels; mip++)
+            {
+                texels += uint64_t(width) * height * depth;
+                if (width == 1 && height == 1 && depth == 1) break; // Reached the end of a full mip chain
+                width = std::max(width / 2, 1u);
+                height = std::max(height / 2, 1u);
+                depth = std::max(depth / 2, 1u);
+            }
+            return texels * layers * desc.sampleCount * getFormatBytesPerBlock(desc.format);
+        }
+
+        Resource::SharedPtr createResource(const ResourceDesc& desc, const std::string& resourceName)
+        {
+            Resource::SharedPtr pResource;
+
+            switch (desc.type)
+            {
+            case RenderPassReflection::Field::Type::RawBuffer:
+                pResource = Buffer::create(desc.width, desc.bindFlags, Buffer::CpuAccess::None);
+                break;
+            case RenderPassReflection::Field::Type::Texture1D:
+                pResource = Texture::create1D(desc.width, desc.format, desc.arraySize, desc.mipLevels, nullptr, desc.bindFlags);
+                break;
+            case RenderPassReflection::Field::Type::Texture2D:
+                if (desc.sampleCount > 1)
+                {
+                    pResource = Texture::create2DMS(desc.width, desc.height, desc.format, desc.sampleCount, desc.arraySize, desc.bindFlags);
+                }
+                else
+                {
+                    pResource = Texture::create2D(desc.width, desc.height, desc.format, desc.arraySize, desc.mipLevels, nullptr, desc.bindFlags);
+                }
+                break;
+            case RenderPassReflection::Field::Type::Texture3D:
+                pResource = Texture::create3D(desc.width, desc.height, desc.depth, desc.format, desc.mipLevels, nullptr, desc.bindFlags);
+                break;
+            case RenderPassReflection::Field::Type::TextureCube:
+                pResource = Texture::createCube(desc.width, desc.height, desc.format, desc.arraySize, desc.mipLevels, nullptr, desc.bindFlags);
+                break;
+            default:
+                should_not_get_here();
+                return nullptr;
+            }
+            pResource->setName(resourceName);
+            return pResource;
         }
-        Resource::SharedPtr pResource;
-
-        switch (field.getType())
-        {
-        case RenderPassReflection::Field::Type::RawBuffer:
-            pResource = Buffer::create(width, bindFlags, Buffer::CpuAccess::None);
-            break;
-        case RenderPassReflection::Field::Type::Texture1D:
-            pResource = Texture::create1D(width, format, arraySize, mipLevels, nullptr, bindFlags);
-            break;
-        case RenderPassReflection::Field::Type::Texture2D:
-            if (sampleCount > 1)
+
+        /** Resources of a previous compilation of the graph, available for reuse. Each resource can only be taken once.
+        */
+        class ResourcePool
+        {
+        public:
+            void add(const std::string& name, const ResourceDesc& desc, const Resource::SharedPtr& pResource)
+            {
+                mByName[name] = { desc, pResource };
+                if (mAvailable.insert(pResource.get()).second) mByDesc[desc].push_back(pResource);
+            }
+
+            Resource::SharedPtr takeByName(const std::string& name, const ResourceDesc& desc)
+            {
+                auto it = mByName.find(name);
+                if (it == mByName.end() || !(it->second.first == desc)) return nullptr;
+                return take(it->second.second);
+            }
+
+            Resource::SharedPtr takeByDesc(const ResourceDesc& desc)
             {
-                pResource = Texture::create2DMS(width, height, format, sampleCount, arraySize, bindFlags);
+                auto it = mByDesc.find(desc);
+                if (it == mByDesc.end()) return nullptr;
+
+                auto& candidates = it->second;
+                while (!candidates.empty())
+                {
+                    Resource::SharedPtr pResource = take(candidates.back());
+                    candidates.pop_back();
+                    if (pResource) return pResource;
+                }
+                return nullptr;
+            }
+
+        private:
+            Resource::SharedPtr take(const Resource::SharedPtr& pResource)
+            {
+                return mAvailable.erase(pResource.get()) ? pResource : nullptr;
+            }
+
+            std::unordered_map<std::string, std::pair<ResourceDesc, Resource::SharedPtr>> mByName;
+            std::map<ResourceDesc, std::vector<Resource::SharedPtr>> mByDesc;
+            std::unordered_set<const Resource*> mAvailable;
+        };
+    }
+
+    std::vector<uint32_t> ResourceCache::packLifetimes(const std::vector<Lifetime>& lifetimes, uint32_t& allocationCount)
+    {
+        // Process the resources in order of their first use.
+        std::vector<uint32_t> order(lifetimes.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&lifetimes](uint32_t a, uint32_t b) { return lifetimes[a].first < lifetimes[b].first; });
+
+        // For each description, keep the allocations ordered by the last use of the resource currently assigned to them.
+        // Reusing the allocation that became free the earliest is optimal for interval partitioning.
+        using Slot = std::pair<uint32_t, uint32_t>; // Last use, allocation index
+        std::unordered_map<uint32_t, std::priority_queue<Slot, std::vector<Slot>, std::greater<Slot>>> slots;
+
+        std::vector<uint32_t> allocation(lifetimes.size());
+        allocationCount = 0;
+        for (uint32_t i : order)
+        {
+            const Lifetime& lifetime = lifetimes[i];
+            assert(lifetime.first <= lifetime.last);
+
+            auto& descSlots = slots[lifetime.descIndex];
+            if (!descSlots.empty() && descSlots.top().first < lifetime.first)
+            {
+                allocation[i] = descSlots.top().second;
+                descSlots.pop();
             }
             else
             {
-                pResource = Texture::create2D(width, height, format, arraySize, mipLevels, nullptr, bindFlags);
+                allocation[i] = allocationCount++;
             }
-            break;
-        case RenderPassReflection::Field::Type::Texture3D:
-            pResource = Texture::create3D(width, height, depth, format, mipLevels, nullptr, bindFlags);
-            break;
-        case RenderPassReflection::Field::Type::TextureCube:
-            pResource = Texture::createCube(width, height, format, arraySize, mipLevels, nullptr, bindFlags);
-            break;
-        default:
-            should_not_get_here();
-            return nullptr;
+            descSlots.push({ lifetime.last, allocation[i] });
         }
-        pResource->setName(resourceName);
-        return pResource;
+        return allocation;
     }
 
-    void ResourceCache::allocateResources(const DefaultProperties& params)
+    void ResourceCache::allocateResources(const DefaultProperties& params, const ResourceCache* pPrevious)
     {
+        mMemoryStats = {};
+        mDefaultProps = params;
+
+        ResourcePool pool;
+        if (pPrevious)
+        {
+            for (const auto& [name, index] : pPrevious->mNameToIndex)
+            {
+                const auto& data = pPrevious->mResourceData[index];
+                if (data.pResource) pool.add(name, resolveResourceDesc(pPrevious->mDefaultProps, data.field, data.resolveBindFlags), data.pResource);
+            }
+        }
+
+        auto createOrReuse = [&](Resource::SharedPtr pResource, const ResourceDesc& desc, const std::string& name)
+        {
+            if (pResource) mMemoryStats.reusedCount++;
+            else pResource = createResource(desc, name);
+            mMemoryStats.allocationCount++;
+            mMemoryStats.allocatedBytes += getResourceSize(desc);
+            return pResource;
+        };
+
+        // Resolve the properties of the resources to create. Resources with equal properties get the same description index.
+        std::vector<ResourceDesc> descs;
+        std::map<ResourceDesc, uint32_t> descToIndex;
+        std::vector<uint32_t> transientResources;
+        std::vector<Lifetime> lifetimes;
+
         for (auto& data : mResourceData)
         {
             if ((data.pResource == nullptr) && (data.field.isValid()))
             {
-                data.pResource = createResourceForPass(params, data.field, data.resolveBindFlags, data.name);
+                ResourceDesc desc = resolveResourceDesc(params, data.field, data.resolveBindFlags);
+                mMemoryStats.resourceCount++;
+                mMemoryStats.requestedBytes += getResourceSize(desc);
+
+                if (data.transient)
+                {
+                    auto it = descToIndex.emplace(desc, (uint32_t)descs.size()).first;
+                    if (it->second == descs.size()) descs.push_back(desc);
+                    transientResources.push_back(uint32_t(&data - mResourceData.data()));
+                    lifetimes.push_back({ data.lifetime.first, data.lifetime.second, it->second });
+                }
+                else
+                {
+                    // The content must be kept, so only take over the resource previously used by the same field
+                    data.pResource = createOrReuse(pool.takeByName(data.name, desc), desc, data.name);
+                }
             }
         }
+
+        // Share allocations between transient resources that are never used at the same time.
+        uint32_t allocationCount = 0;
+        std::vector<uint32_t> allocation = packLifetimes(lifetimes, allocationCount);
+        std::vector<std::vector<uint32_t>> allocationUsers(allocationCount);
+        for (uint32_t i = 0; i < (uint32_t)allocation.size(); i++) allocationUsers[allocation[i]].push_back(i);
+
+        for (const auto& users : allocationUsers)
+        {
+            // Prefer a resource previously used by one of the users, then any unused resource with the same properties
+            const ResourceDesc& desc = descs[lifetimes[users[0]].descIndex];
+            Resource::SharedPtr pResource;
+            for (uint32_t i = 0; i < users.size() && !pResource; i++) pResource = pool.takeByName(mResourceData[transientResources[users[i]]].name, desc);
+            if (!pResource) pResource = pool.takeByDesc(desc);
+
+            pResource = createOrReuse(pResource, desc, mResourceData[transientResources[users[0]]].name);
+            for (uint32_t i : users) mResourceData[transientResources[i]].pResource = pResource;
+        }
+
+        for (auto& slot : mSlots) slot.pResource = getResource(slot.name);
+
+        if (mMemoryStats.allocationCount < mMemoryStats.resourceCount)
+        {
+            logInfo("Render graph resource aliasing: " + std::to_string(mMemoryStats.resourceCount) + " resources in " + std::to_string(mMemoryStats.allocationCount) + " allocations, " +
+                formatByteSize(mMemoryStats.allocatedBytes) + " instead of " + formatByteSize(mMemoryStats.requestedBytes) + ".");
+        }
     }
 }
@@ -68,19 +68,68 @@ namespace Falcor
         */
         const Resource::SharedPtr& getResource(const std::string& name) const;
 
+        /** Get the slot of a resource, creating it if needed. A slot caches the resource a name resolves to, including external resources.
+            Slots are updated when resources are allocated or external resources change, so fetching a resource by slot doesn't need any string operations.
+            Slots stay valid until reset() is called.
+            \param[in] name String in the format of PassName.FieldName
+            \return The slot index
+        */
+        uint32_t getResourceSlot(const std::string& name);
+
+        /** Get a resource by slot. Returns nullptr if the slot's name doesn't resolve to a resource.
+        */
+        const Resource::SharedPtr& getResource(uint32_t slot) const { assert(slot < mSlots.size()); return mSlots[slot].pResource; }
+
         /** Get the field-reflection of a resource
         */
         const RenderPassReflection::Field& getResourceReflection(const std::string& name) const;
 
         /** Allocate all resources that need to be created/updated.
             This includes new resources, resources whose properties have been updated since last allocation call.
+            Transient resources with the same properties and non-overlapping lifetimes share the same allocation.
+            Graph outputs, internal resources and persistent resources are never shared, since their content must outlive the execution of their passes.
+            \param[in] params Properties to use for the unspecified resource properties.
+            \param[in] pPrevious Optional. The cache of the previous compilation of the graph. Its resources are reused where the properties match, instead of creating new ones.
+                Graph outputs, internal and persistent resources are only reused by the field with the same name, so their content is kept.
         */
-        void allocateResources(const DefaultProperties& params);
+        void allocateResources(const DefaultProperties& params, const ResourceCache* pPrevious = nullptr);
 
         /** Clears all registered field/resource properties and allocated resources.
         */
         void reset();
 
+        /** Memory statistics of the last allocateResources() call.
+        */
+        struct MemoryStats
+        {
+            uint32_t resourceCount = 0;     ///< Number of resources requested by the graph.
+            uint32_t allocationCount = 0;   ///< Number of allocations used by the resources.
+            uint32_t reusedCount = 0;       ///< Number of allocations reused from the previous cache.
+            uint64_t requestedBytes = 0;    ///< Memory needed without aliasing.
+            uint64_t allocatedBytes = 0;    ///< Memory needed with aliasing.
+        };
+
+        /** Get the memory statistics of the last allocateResources() call.
+        */
+        const MemoryStats& getMemoryStats() const { return mMemoryStats; }
+
+        /** Lifetime of a transient resource, used for computing the aliasing.
+        */
+        struct Lifetime
+        {
+            uint32_t first;     ///< First execution index the resource is used at.
+            uint32_t last;      ///< Last execution index the resource is used at (inclusive).
+            uint32_t descIndex; ///< Resources can only share an allocation if they have the same description index.
+        };
+
+        /** Assign resources to shared allocations so that resources sharing an allocation have the same description and non-overlapping lifetimes.
+            Uses greedy interval partitioning, which results in the minimum number of allocations for each description. The result is deterministic.
+            \param[in] lifetimes Lifetimes of the resources.
+            \param[out] allocationCount Number of allocations needed.
+            \return The allocation index of each resource.
+        */
+        static std::vector<uint32_t> packLifetimes(const std::vector<Lifetime>& lifetimes, uint32_t& allocationCount);
+
     private:
         ResourceCache() = default;
 
@@ -91,14 +140,27 @@ namespace Falcor
             Resource::SharedPtr pResource;          // The resource
             bool resolveBindFlags;                  // Whether or not we should resolve the field's bind-flags before creating the resource
             std::string name;                       // Full name of the resource, including the pass name
+            bool transient;                         // Whether the content is only needed during the lifetime, in which case the allocation can be shared
         };
 
+        MemoryStats mMemoryStats;
+        DefaultProperties mDefaultProps;
+
         // Resources and properties for fields within (and therefore owned by) a render graph
         std::unordered_map<std::string, uint32_t> mNameToIndex;
         std::vector<ResourceData> mResourceData;
 
         // References to output resources not to be allocated by the render graph
         ResourcesMap mExternalResources;
+
+        // Names resolved ahead of time, see getResourceSlot()
+        struct Slot
+        {
+            std::string name;
+            Resource::SharedPtr pResource;
+        };
+        std::unordered_map<std::string, uint32_t> mNameToSlot;
+        std::vector<Slot> mSlots;
     };
 
 }
@@ -33,6 +33,153 @@
 
 namespace Falcor
 {
+    namespace
+    {
+        // Number of channels evaluated together by the batched path.
+        const size_t kBatchSize = 16;
+
+        // Per-lane storage for a batch of channels. The lane loops below operate on whole batches so the compiler can vectorize them.
+        struct Float3Lanes
+        {
+            float x[kBatchSize] = {};
+            float y[kBatchSize] = {};
+            float z[kBatchSize] = {};
+
+            void set(size_t lane, const float3& v) { x[lane] = v.x; y[lane] = v.y; z[lane] = v.z; }
+        };
+
+        struct QuatLanes
+        {
+            float x[kBatchSize] = {};
+            float y[kBatchSize] = {};
+            float z[kBatchSize] = {};
+            float w[kBatchSize] = {};
+
+            void set(size_t lane, const glm::quat& q) { x[lane] = q.x; y[lane] = q.y; z[lane] = q.z; w[lane] = q.w; }
+        };
+
+        // Compute index of adjacent frame including optional warping.
+        size_t adjacentFrame(size_t count, bool enableWarping, size_t frame, int32_t offset = 1)
+        {
+            if ((int64_t)frame + offset < 0) frame += count;
+            return enableWarping ? (frame + offset) % count : std::min(frame + offset, count - 1);
+        }
+
+        // Interpolation factor within a segment.
+        float segmentFactor(double time, double startTime, double endTime, bool enableWarping, double duration)
+        {
+            double segmentDuration = endTime - startTime;
+            if (enableWarping && segmentDuration < 0.0) segmentDuration += duration;
+            return (float)clamp(segmentDuration > 0.0 ? (time - startTime) / segmentDuration : 1.0, 0.0, 1.0);
+        }
+
+        void lerpBatch(const Float3Lanes& a, const Float3Lanes& b, const float* t, Float3Lanes& result)
+        {
+            for (size_t i = 0; i < kBatchSize; i++)
+            {
+                result.x[i] = a.x[i] * (1.f - t[i]) + b.x[i] * t[i];
+                result.y[i] = a.y[i] * (1.f - t[i]) + b.y[i] * t[i];
+                result.z[i] = a.z[i] * (1.f - t[i]) + b.z[i] * t[i];
+            }
+        }
+
+        // Same as glm::slerp(), including the fallback to linear interpolation for nearly parallel quaternions, but without branches.
+        void slerpBatch(const QuatLanes& a, const QuatLanes& b, const float* t, QuatLanes& result)
+        {
+            for (size_t i = 0; i < kBatchSize; i++)
+            {
+                float cosTheta = (a.w[i] * b.w[i] + a.x[i] * b.x[i]) + (a.y[i] * b.y[i] + a.z[i] * b.z[i]);
+                float sign = cosTheta < 0.f ? -1.f : 1.f;
+                cosTheta *= sign;
+
+                bool nearlyParallel = cosTheta > 1.f - std::numeric_limits<float>::epsilon();
+                float angle = std::acos(std::min(cosTheta, 1.f));
+                float s0 = nearlyParallel ? 1.f - t[i] : std::sin((1.f - t[i]) * angle);
+                float s1 = nearlyParallel ? t[i] : std::sin(t[i] * angle);
+                float d = nearlyParallel ? 1.f : std::sin(angle);
+
+                result.x[i] = (s0 * a.x[i] + s1 * sign * b.x[i]) / d;
+                result.y[i] = (s0 * a.y[i] + s1 * sign * b.y[i]) / d;
+                result.z[i] = (s0 * a.z[i] + s1 * sign * b.z[i]) / d;
+                result.w[i] = (s0 * a.w[i] + s1 * sign * b.w[i]) / d;
+            }
+        }
+
+        float hermiteScalar(float p0, float p1, float p2, float p3, float t)
+        {
+            float b0 = p1;
+            float b1 = p1 + (p2 - p0) * 0.5f / 3.f;
+            float b2 = p2 - (p3 - p1) * 0.5f / 3.f;
+            float b3 = p2;
+
+            float q0 = b0 * (1.f - t) + b1 * t;
+            float q1 = b1 * (1.f - t) + b2 * t;
+            float q2 = b2 * (1.f - t) + b3 * t;
+
+            float qq0 = q0 * (1.f - t) + q1 * t;
+            float qq1 = q1 * (1.f - t) + q2 * t;
+
+            return qq0 * (1.f - t) + qq1 * t;
+        }
+
+        void hermiteBatch(const Float3Lanes& p0, const Float3Lanes& p1, const Float3Lanes& p2, const Float3Lanes& p3, const float* t, Float3Lanes& result)
+        {
+            for (size_t i = 0; i < kBatchSize; i++)
+            {
+                result.x[i] = hermiteScalar(p0.x[i], p1.x[i], p2.x[i], p3.x[i], t[i]);
+                result.y[i] = hermiteScalar(p0.y[i], p1.y[i], p2.y[i], p3.y[i], t[i]);
+                result.z[i] = hermiteScalar(p0.z[i], p1.z[i], p2.z[i], p3.z[i], t[i]);
+            }
+        }
+
+        // Bezier control point of the Hermite slerp: r + (a - b) / 6.
+        void controlPoint(const QuatLanes& r, const QuatLanes& a, const QuatLanes& b, QuatLanes& result)
+        {
+            for (size_t i = 0; i < kBatchSize; i++)
+            {
+                result.x[i] = r.x[i] + (a.x[i] - b.x[i]) * 0.5f / 3.f;
+                result.y[i] = r.y[i] + (a.y[i] - b.y[i]) * 0.5f / 3.f;
+                result.z[i] = r.z[i] + (a.z[i] - b.z[i]) * 0.5f / 3.f;
+                result.w[i] = r.w[i] + (a.w[i] - b.w[i]) * 0.5f / 3.f;
+            }
+        }
+
+        /** Write the matrices T * R * S of a batch. The rotation is expanded as in glm::mat4_cast() and scaled per column,
+            which gives the same result as multiplying the three matrices.
+        */
+        void composeMatrices(const Float3Lanes& translation, const QuatLanes& rotation, const Float3Lanes& scaling, const uint32_t* matrixIDs, size_t count,
+            std::vector<glm::mat4>& matrices)
+        {
+            float m[9][kBatchSize];
+            for (size_t i = 0; i < kBatchSize; i++)
+            {
+                float qx = rotation.x[i], qy = rotation.y[i], qz = rotation.z[i], qw = rotation.w[i];
+                float qxx = qx * qx, qyy = qy * qy, qzz = qz * qz;
+                float qxz = qx * qz, qxy = qx * qy, qyz = qy * qz;
+                float qwx = qw * qx, qwy = qw * qy, qwz = qw * qz;
+
+                m[0][i] = (1.f - 2.f * (qyy + qzz)) * scaling.x[i];
+                m[1][i] = (2.f * (qxy + qwz)) * scaling.x[i];
+                m[2][i] = (2.f * (qxz - qwy)) * scaling.x[i];
+                m[3][i] = (2.f * (qxy - qwz)) * scaling.y[i];
+                m[4][i] = (1.f - 2.f * (qxx + qzz)) * scaling.y[i];
+                m[5][i] = (2.f * (qyz + qwx)) * scaling.y[i];
+                m[6][i] = (2.f * (qxz + qwy)) * scaling.z[i];
+                m[7][i] = (2.f * (qyz - qwx)) * scaling.z[i];
+                m[8][i] = (1.f - 2.f * (qxx + qyy)) * scaling.z[i];
+            }
+
+            for (size_t i = 0; i < count; i++)
+            {
+                glm::mat4& matrix = matrices[matrixIDs[i]];
+                matrix[0] = float4(m[0][i], m[1][i], m[2][i], 0.f);
+                matrix[1] = float4(m[3][i], m[4][i], m[5][i], 0.f);
+                matrix[2] = float4(m[6][i], m[7][i], m[8][i], 0.f);
+                matrix[3] = float4(translation.x[i], translation.y[i], translation.z[i], 1.f);
+            }
+        }
+    }
+
     // Bezier form hermite spline
     static float3 interpolateHermite(const float3& p0, const float3& p1, const float3& p2, const float3& p3, float t)
     {
@@ -123,45 +270,32 @@ namespace Falcor
         if (c.keyframes.size() < 4) mode = InterpolationMode::Linear;
 
         Keyframe interpolated;
-
-        // Compute index of adjacent frame including optional warping.
-        auto adjacentFrame = [] (const Channel& c, size_t frame, int32_t offset = 1)
-        {
-            size_t count = c.keyframes.size();
-            if ((int64_t)frame + offset < 0) frame += count;
-            return c.enableWarping ? (frame + offset) % count : std::min(frame + offset, count - 1);
-        };
+        size_t count = c.keyframes.size();
 
         if (mode == InterpolationMode::Linear)
         {
             size_t i0 = findChannelFrame(c, time);
-            size_t i1 = adjacentFrame(c, i0);
+            size_t i1 = adjacentFrame(count, c.enableWarping, i0);
 
             const Keyframe& k0 = c.keyframes[i0];
             const Keyframe& k1 = c.keyframes[i1];
 
-            double segmentDuration = k1.time - k0.time;
-            if (c.enableWarping && segmentDuration < 0.0) segmentDuration += mDurationInSeconds;
-            float t = (float)clamp(segmentDuration > 0.0 ? (time - k0.time) / segmentDuration : 1.0, 0.0, 1.0);
-
+            float t = segmentFactor(time, k0.time, k1.time, c.enableWarping, mDurationInSeconds);
             interpolated = interpolateLinear(k0, k1, t);
         }
         else if (mode == InterpolationMode::Hermite)
         {
             size_t i1 = findChannelFrame(c, time);
-            size_t i0 = adjacentFrame(c, i1, -1);
-            size_t i2 = adjacentFrame(c, i1, 1);
-            size_t i3 = adjacentFrame(c, i1, 2);
+            size_t i0 = adjacentFrame(count, c.enableWarping, i1, -1);
+            size_t i2 = adjacentFrame(count, c.enableWarping, i1, 1);
+            size_t i3 = adjacentFrame(count, c.enableWarping, i1, 2);
 
             const Keyframe& k0 = c.keyframes[i0];
             const Keyframe& k1 = c.keyframes[i1];
             const Keyframe& k2 = c.keyframes[i2];
             const Keyframe& k3 = c.keyframes[i3];
 
-            double segmentDuration = k2.time - k1.time;
-            if (c.enableWarping && segmentDuration < 0.0) segmentDuration += mDurationInSeconds;
-            float t = (float)clamp(segmentDuration > 0.0 ? (time - k1.time) / segmentDuration : 1.0, 0.0, 1.0);
-
+            float t = segmentFactor(time, k1.time, k2.time, c.enableWarping, mDurationInSeconds);
             interpolated = interpolateHermite(k0, k1, k2, k3, t);
         }
 
@@ -173,7 +307,7 @@ namespace Falcor
         return transform;
     }
 
-    void Animation::animate(double totalTime, std::vector<glm::mat4>& matrices)
+    void Animation::animateReference(double totalTime, std::vector<glm::mat4>& matrices)
     {
         // Calculate the relative time
         double modTime = std::fmod(totalTime, mDurationInSeconds);
@@ -183,9 +317,177 @@ namespace Falcor
         }
     }
 
+    void Animation::animate(double totalTime, std::vector<glm::mat4>& matrices)
+    {
+        if (mKeyframeBufferDirty) buildKeyframeBuffer();
+
+        // Calculate the relative time
+        double modTime = std::fmod(totalTime, mDurationInSeconds);
+
+        const auto& linear = mKeyframeBuffer.linearChannels;
+        for (size_t i = 0; i < linear.size(); i += kBatchSize)
+        {
+            animateLinear(linear.data() + i, std::min(kBatchSize, linear.size() - i), modTime, matrices);
+        }
+
+        const auto& hermite = mKeyframeBuffer.hermiteChannels;
+        for (size_t i = 0; i < hermite.size(); i += kBatchSize)
+        {
+            animateHermite(hermite.data() + i, std::min(kBatchSize, hermite.size() - i), modTime, matrices);
+        }
+    }
+
+    void Animation::buildKeyframeBuffer()
+    {
+        KeyframeBuffer& kb = mKeyframeBuffer;
+        kb = {};
+
+        size_t keyframeCount = 0;
+        for (const auto& c : mChannels) keyframeCount += c.keyframes.size();
+        assert(keyframeCount <= std::numeric_limits<uint32_t>::max());
+
+        kb.offsets.reserve(mChannels.size() + 1);
+        kb.times.reserve(keyframeCount);
+        kb.translations.reserve(keyframeCount);
+        kb.scalings.reserve(keyframeCount);
+        kb.rotations.reserve(keyframeCount);
+        kb.cursors.assign(mChannels.size(), 0);
+
+        for (uint32_t i = 0; i < (uint32_t)mChannels.size(); i++)
+        {
+            const Channel& c = mChannels[i];
+            assert(!c.keyframes.empty());
+
+            kb.offsets.push_back((uint32_t)kb.times.size());
+            for (const auto& k : c.keyframes)
+            {
+                kb.times.push_back(k.time);
+                kb.translations.push_back(k.translation);
+                kb.scalings.push_back(k.scaling);
+                kb.rotations.push_back(k.rotation);
+            }
+
+            // Use linear interpolation if there are less than 4 keyframes.
+            bool hermite = c.interpolationMode == InterpolationMode::Hermite && c.keyframes.size() >= 4;
+            (hermite ? kb.hermiteChannels : kb.linearChannels).push_back(i);
+        }
+        kb.offsets.push_back((uint32_t)kb.times.size());
+
+        mKeyframeBufferDirty = false;
+    }
+
+    uint32_t Animation::findKeyframe(uint32_t channelID, double time)
+    {
+        const double* times = mKeyframeBuffer.times.data() + mKeyframeBuffer.offsets[channelID];
+        uint32_t count = mKeyframeBuffer.offsets[channelID + 1] - mKeyframeBuffer.offsets[channelID];
+        uint32_t& cursor = mKeyframeBuffer.cursors[channelID];
+
+        // Time usually advances by less than a keyframe per frame, so check the cached keyframe and the next one first.
+        if (times[cursor] <= time)
+        {
+            if (cursor + 1 == count || times[cursor + 1] > time) return cursor;
+            if (cursor + 2 == count || times[cursor + 2] > time) return ++cursor;
+        }
+
+        // Find the last keyframe not after the time, or the first keyframe if there is none.
+        auto it = std::upper_bound(times, times + count, time);
+        cursor = it == times ? 0 : (uint32_t)(it - times) - 1;
+        return cursor;
+    }
+
+    void Animation::animateLinear(const uint32_t* channels, size_t count, double time, std::vector<glm::mat4>& matrices)
+    {
+        const KeyframeBuffer& kb = mKeyframeBuffer;
+
+        uint32_t matrixIDs[kBatchSize];
+        float t[kBatchSize] = {};
+        Float3Lanes t0, t1, s0, s1, translation, scaling;
+        QuatLanes r0, r1, rotation;
+
+        for (size_t lane = 0; lane < count; lane++)
+        {
+            uint32_t channelID = channels[lane];
+            const Channel& c = mChannels[channelID];
+            uint32_t offset = kb.offsets[channelID];
+            size_t keyframeCount = kb.offsets[channelID + 1] - offset;
+
+            size_t i0 = offset + findKeyframe(channelID, time);
+            size_t i1 = offset + adjacentFrame(keyframeCount, c.enableWarping, i0 - offset);
+
+            matrixIDs[lane] = c.matrixID;
+            t[lane] = segmentFactor(time, kb.times[i0], kb.times[i1], c.enableWarping, mDurationInSeconds);
+            t0.set(lane, kb.translations[i0]);
+            t1.set(lane, kb.translations[i1]);
+            s0.set(lane, kb.scalings[i0]);
+            s1.set(lane, kb.scalings[i1]);
+            r0.set(lane, kb.rotations[i0]);
+            r1.set(lane, kb.rotations[i1]);
+        }
+
+        lerpBatch(t0, t1, t, translation);
+        lerpBatch(s0, s1, t, scaling);
+        slerpBatch(r0, r1, t, rotation);
+
+        composeMatrices(translation, rotation, scaling, matrixIDs, count, matrices);
+    }
+
+    void Animation::animateHermite(const uint32_t* channels, size_t count, double time, std::vector<glm::mat4>& matrices)
+    {
+        const KeyframeBuffer& kb = mKeyframeBuffer;
+
+        uint32_t matrixIDs[kBatchSize];
+        float t[kBatchSize] = {};
+        Float3Lanes t0, t1, t2, t3, s1, s2, translation, scaling;
+        QuatLanes r0, r1, r2, r3;
+
+        for (size_t lane = 0; lane < count; lane++)
+        {
+            uint32_t channelID = channels[lane];
+            const Channel& c = mChannels[channelID];
+            uint32_t offset = kb.offsets[channelID];
+            size_t keyframeCount = kb.offsets[channelID + 1] - offset;
+
+            size_t frame = findKeyframe(channelID, time);
+            size_t i0 = offset + adjacentFrame(keyframeCount, c.enableWarping, frame, -1);
+            size_t i1 = offset + frame;
+            size_t i2 = offset + adjacentFrame(keyframeCount, c.enableWarping, frame, 1);
+            size_t i3 = offset + adjacentFrame(keyframeCount, c.enableWarping, frame, 2);
+
+            matrixIDs[lane] = c.matrixID;
+            t[lane] = segmentFactor(time, kb.times[i1], kb.times[i2], c.enableWarping, mDurationInSeconds);
+            t0.set(lane, kb.translations[i0]);
+            t1.set(lane, kb.translations[i1]);
+            t2.set(lane, kb.translations[i2]);
+            t3.set(lane, kb.translations[i3]);
+            s1.set(lane, kb.scalings[i1]);
+            s2.set(lane, kb.scalings[i2]);
+            r0.set(lane, kb.rotations[i0]);
+            r1.set(lane, kb.rotations[i1]);
+            r2.set(lane, kb.rotations[i2]);
+            r3.set(lane, kb.rotations[i3]);
+        }
+
+        hermiteBatch(t0, t1, t2, t3, t, translation);
+        lerpBatch(s1, s2, t, scaling);
+
+        // Bezier hermite slerp, see interpolateHermite().
+        QuatLanes b1, b2, q0, q1, q2, qq0, qq1, rotation;
+        controlPoint(r1, r2, r0, b1);
+        controlPoint(r2, r1, r3, b2);
+        slerpBatch(r1, b1, t, q0);
+        slerpBatch(b1, b2, t, q1);
+        slerpBatch(b2, r2, t, q2);
+        slerpBatch(q0, q1, t, qq0);
+        slerpBatch(q1, q2, t, qq1);
+        slerpBatch(qq0, qq1, t, rotation);
+
+        composeMatrices(translation, rotation, scaling, matrixIDs, count, matrices);
+    }
+
     uint32_t Animation::addChannel(uint32_t matrixID)
     {
         mChannels.push_back(Channel(matrixID));
+        mKeyframeBufferDirty = true;
         return (uint32_t)(mChannels.size() - 1);
     }
 
@@ -204,6 +506,7 @@ namespace Falcor
         assert(keyframe.time <= mDurationInSeconds);
 
         mChannels[channelID].lastKeyframeUsed = 0;
+        mKeyframeBufferDirty = true;
         auto& channelFrames = mChannels[channelID].keyframes;
 
         if (channelFrames.size() == 0 || channelFrames[0].time > keyframe.time)
@@ -265,6 +568,7 @@ namespace Falcor
         assert(channelID < mChannels.size());
         mChannels[channelID].interpolationMode = mode;
         mChannels[channelID].enableWarping = enableWarping;
+        mKeyframeBufferDirty = true;
     }
 
 }
@@ -65,6 +65,10 @@ namespace Falcor
         */
         uint32_t addChannel(uint32_t matrixID);
 
+        /** Get the animation's duration in seconds
+        */
+        double getDuration() const { return mDurationInSeconds; }
+
         /** Get the channel for a given matrix ID or kInvalidChannel if not available
         */
         uint32_t getChannel(uint32_t matrixID) const;
@@ -91,12 +95,32 @@ namespace Falcor
         */
         void setInterpolationMode(uint32_t channelID, InterpolationMode mode, bool enableWarping);
 
+        /** Get the interpolation mode of a channel
+        */
+        InterpolationMode getInterpolationMode(uint32_t channelID) const { return mChannels[channelID].interpolationMode; }
+
+        /** Check if warping is enabled for a channel
+        */
+        bool isWarpingEnabled(uint32_t channelID) const { return mChannels[channelID].enableWarping; }
+
+        /** Get the keyframes of a channel, sorted by time
+        */
+        const std::vector<Keyframe>& getKeyframes(uint32_t channelID) const { return mChannels[channelID].keyframes; }
+
         /** Run the animation
+            Channels are evaluated in batches from a structure-of-arrays copy of the keyframes.
             \param currentTime The current time in seconds. This can be larger then the animation time, in which case the animation will loop
             \param matrices The array of global matrices to update
         */
         void animate(double currentTime, std::vector<glm::mat4>& matrices);
 
+        /** Run the animation one channel at a time.
+            This is the unbatched path, kept as a reference to validate animate() against.
+            \param currentTime The current time in seconds. This can be larger then the animation time, in which case the animation will loop
+            \param matrices The array of global matrices to update
+        */
+        void animateReference(double currentTime, std::vector<glm::mat4>& matrices);
+
         /** Get the matrixID affected by a channel
         */
         uint32_t getChannelMatrixID(uint32_t channel) const { return mChannels[channel].matrixID; }
@@ -120,12 +144,33 @@ namespace Falcor
             mutable double lastUpdateTime = 0;
         };
 
+        /** Keyframes of all channels in structure-of-arrays layout, used by animate(). Rebuilt when the channels change.
+        */
+        struct KeyframeBuffer
+        {
+            std::vector<uint32_t> offsets;          // Keyframes of channel i are at offsets[i] to offsets[i + 1] - 1
+            std::vector<double> times;
+            std::vector<float3> translations;
+            std::vector<float3> scalings;
+            std::vector<glm::quat> rotations;
+            std::vector<uint32_t> cursors;          // Keyframe found by the last lookup of each channel, relative to its offset
+            std::vector<uint32_t> linearChannels;   // Channels evaluated with linear interpolation
+            std::vector<uint32_t> hermiteChannels;  // Channels evaluated with Hermite interpolation
+        };
+
         std::vector<Channel> mChannels;
         const std::string mName;
         double mDurationInSeconds = 0;
 
+        KeyframeBuffer mKeyframeBuffer;
+        bool mKeyframeBufferDirty = true;
+
         glm::mat4 animateChannel(const Channel& c, double time) const;
         size_t findChannelFrame(const Channel& c, double time) const;
-        glm::mat4 interpolate(const Keyframe& start, const Keyframe& end, double curTime) const;
+
+        void buildKeyframeBuffer();
+        uint32_t findKeyframe(uint32_t channelID, double time);
+        void animateLinear(const uint32_t* channels, size_t count, double time, std::vector<glm::mat4>& matrices);
+        void animateHermite(const uint32_t* channels, size_t count, double time, std::vector<glm::mat4>& matrices);
     };
 }
@@ -36,15 +36,27 @@ namespace Falcor
         const static std::string kWorldMatrices = "worldMatrices";
         const static std::string kInverseTransposeWorldMatrices = "inverseTransposeWorldMatrices";
         const static std::string kPreviousFrameWorldMatrices = "previousFrameWorldMatrices";
+
+        // Matrices separated by at most this many unchanged matrices are uploaded in a single copy.
+        const uint32_t kMaxUploadGap = 16;
+        // Upload the whole buffer if the changes are scattered over more ranges than this.
+        const size_t kMaxUploadRanges = 256;
     }
 
     AnimationController::AnimationController(Scene* pScene, const StaticVertexVector& staticVertexData, const DynamicVertexVector& dynamicVertexData)
         : mpScene(pScene)
         , mLocalMatrices(pScene->mSceneGraph.size())
-        , mInvTransposeGlobalMatrices(pScene->mSceneGraph.size())
-        , mMatricesChanged(pScene->mSceneGraph.size())
     {
         assert(mLocalMatrices.size() * 4 <= std::numeric_limits<uint32_t>::max());
+
+        // Skinning matrices are only needed if there are skinned vertices.
+        std::vector<uint32_t> parents(pScene->mSceneGraph.size());
+        std::vector<glm::mat4> localToBindSpace(dynamicVertexData.size() ? pScene->mSceneGraph.size() : 0);
+        for (size_t i = 0; i < parents.size(); i++) parents[i] = pScene->mSceneGraph[i].parent;
+        for (size_t i = 0; i < localToBindSpace.size(); i++) localToBindSpace[i] = pScene->mSceneGraph[i].localToBindSpace;
+        static_assert(TransformHierarchy::kInvalidNode == Scene::kInvalidNode, "Invalid node IDs must match");
+        mpHierarchy = std::make_unique<TransformHierarchy>(parents, localToBindSpace);
+
         uint32_t float4Count = (uint32_t)mLocalMatrices.size() * 4;
 
         mpWorldMatricesBuffer = Buffer::createStructured(sizeof(float4), float4Count, Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, nullptr, false);
@@ -86,8 +98,9 @@ namespace Falcor
     {
         PROFILE("animate");
 
-        mMatricesChanged.assign(mMatricesChanged.size(), false);
+        mMatricesChanged = false;
 
+        bool fullUpdate = false;
         if (mAnimationChanged == false)
         {
             if (!mEnabled || !hasAnimations()) return false;
@@ -95,14 +108,23 @@ namespace Falcor
             {
                 // Copy the current matrices to the previous matrices. We can do that only once, but not sure if it we'll help perf (it only occures when the animation is paused)
                 pContext->copyResource(mpPrevWorldMatricesBuffer.get(), mpWorldMatricesBuffer.get());
+
+                // Both buffers hold the current matrices now.
+                mPrevUpdatedNodes.clear();
+                mPrevFullUpdate = false;
                 return false;
             }
         }
-        else initLocalMatrices();
+        else
+        {
+            initLocalMatrices();
+            fullUpdate = true;
+        }
 
         mAnimationChanged = false;
         mLastAnimationTime = currentTime;
 
+        mChangedNodes.clear();
         if (mEnabled)
         {
             for (auto& pAnimation : mAnimations)
@@ -110,42 +132,61 @@ namespace Falcor
                 pAnimation->animate(currentTime, mLocalMatrices);
                 for (uint32_t i = 0; i < pAnimation->getChannelCount(); i++)
                 {
-                    mMatricesChanged[pAnimation->getChannelMatrixID(i)] = true;
+                    mChangedNodes.push_back((uint32_t)pAnimation->getChannelMatrixID(i));
                 }
             }
         }
 
         swap(mpPrevWorldMatricesBuffer, mpWorldMatricesBuffer);
-        updateMatrices();
+        updateMatrices(fullUpdate);
         bindBuffers();
         executeSkinningPass(pContext);
 
         return true;
     }
 
-    void AnimationController::updateMatrices()
+    void AnimationController::updateMatrices(bool fullUpdate)
     {
-        // We can optimize this
-        mGlobalMatrices = mLocalMatrices;
+        // Only recompute the animated nodes and their descendants, unless the local matrices were reset.
+        if (fullUpdate) mpHierarchy->updateAll(mLocalMatrices);
+        else mpHierarchy->update(mLocalMatrices, mChangedNodes);
+        mMatricesChanged = true;
 
-        for (size_t i = 0; i < mGlobalMatrices.size(); i++)
+        const auto& updatedNodes = mpHierarchy->getUpdatedNodes();
+        uint32_t nodeCount = mpHierarchy->getNodeCount();
+
+        // The world matrices buffer written this frame was last written two frames ago, so it also needs the nodes updated in the previous frame.
+        bool fullWorldUpdate = fullUpdate || mPrevFullUpdate;
+        if (fullWorldUpdate) mWorldUpdateNodes.clear();
+        else
         {
-            if (mpScene->mSceneGraph[i].parent != SceneBuilder::kInvalidNode)
-            {
-                mGlobalMatrices[i] = mGlobalMatrices[mpScene->mSceneGraph[i].parent] * mGlobalMatrices[i];
-                mMatricesChanged[i] = mMatricesChanged[i] || mMatricesChanged[mpScene->mSceneGraph[i].parent];
-            }
+            mWorldUpdateNodes.clear();
+            std::set_union(updatedNodes.begin(), updatedNodes.end(), mPrevUpdatedNodes.begin(), mPrevUpdatedNodes.end(), std::back_inserter(mWorldUpdateNodes));
+        }
 
-            mInvTransposeGlobalMatrices[i] = transpose(inverse(mGlobalMatrices[i]));
+        mUpdatedRanges = fullUpdate ? std::vector<TransformHierarchy::Range>{ { 0, nodeCount } } : TransformHierarchy::getRanges(updatedNodes, kMaxUploadGap);
+        mWorldUpdateRanges = fullWorldUpdate ? std::vector<TransformHierarchy::Range>{ { 0, nodeCount } } : TransformHierarchy::getRanges(mWorldUpdateNodes, kMaxUploadGap);
 
-            if(mpSkinningPass)
-            {
-                mSkinningMatrices[i] = mGlobalMatrices[i] * mpScene->mSceneGraph[i].localToBindSpace;
-                mInvTransposeSkinningMatrices[i] = transpose(inverse(mSkinningMatrices[i]));
-            }
+        uploadMatrices(mpWorldMatricesBuffer.get(), mpHierarchy->getGlobalMatrices(), mWorldUpdateRanges);
+        uploadMatrices(mpInvTransposeWorldMatricesBuffer.get(), mpHierarchy->getInvTransposeGlobalMatrices(), mUpdatedRanges);
+
+        mPrevUpdatedNodes = updatedNodes;
+        mPrevFullUpdate = fullUpdate;
+    }
+
+    void AnimationController::uploadMatrices(Buffer* pBuffer, const std::vector<glm::mat4>& matrices, const std::vector<TransformHierarchy::Range>& ranges)
+    {
+        assert(pBuffer->getSize() == matrices.size() * sizeof(glm::mat4));
+        if (ranges.size() > kMaxUploadRanges)
+        {
+            pBuffer->setBlob(matrices.data(), 0, pBuffer->getSize());
+            return;
+        }
+
+        for (const auto& range : ranges)
+        {
+            pBuffer->setBlob(&matrices[range.first], range.first * sizeof(glm::mat4), range.count * sizeof(glm::mat4));
         }
-        mpWorldMatricesBuffer->setBlob(mGlobalMatrices.data(), 0, mpWorldMatricesBuffer->getSize());
-        mpInvTransposeWorldMatricesBuffer->setBlob(mInvTransposeGlobalMatrices.data(), 0, mpInvTransposeWorldMatricesBuffer->getSize());
     }
 
     void AnimationController::bindBuffers()
@@ -176,9 +217,6 @@ namespace Falcor
 
         if (dynamicVertexData.size())
         {
-            mSkinningMatrices.resize(mpScene->mSceneGraph.size());
-            mInvTransposeSkinningMatrices.resize(mSkinningMatrices.size());
-
             mpSkinningPass = ComputePass::create("Scene/Animation/Skinning.slang");
             auto block = mpSkinningPass->getVars()["gData"];
             block["skinnedVertices"] = pVB;
@@ -195,8 +233,8 @@ namespace Falcor
             createBuffer("staticData", staticVertexData);
             createBuffer("dynamicData", dynamicVertexData);
 
-            assert(mSkinningMatrices.size() * 4 < std::numeric_limits<uint32_t>::max());
-            uint32_t float4Count = (uint32_t)mSkinningMatrices.size() * 4;
+            assert(mpHierarchy->getNodeCount() * 4ull < std::numeric_limits<uint32_t>::max());
+            uint32_t float4Count = mpHierarchy->getNodeCount() * 4;
             mpSkinningMatricesBuffer = Buffer::createStructured(sizeof(float4), float4Count, ResourceBindFlags::ShaderResource, Buffer::CpuAccess::None, nullptr, false);
             mpSkinningMatricesBuffer->setName("AnimationController::mpSkinningMatricesBuffer");
             mpInvTransposeSkinningMatricesBuffer = Buffer::createStructured(sizeof(float4), float4Count, ResourceBindFlags::ShaderResource, Buffer::CpuAccess::None, nullptr, false);
@@ -213,8 +251,8 @@ namespace Falcor
     void AnimationController::executeSkinningPass(RenderContext* pContext)
     {
         if (!mpSkinningPass) return;
-        mpSkinningMatricesBuffer->setBlob(mSkinningMatrices.data(), 0, mpSkinningMatricesBuffer->getSize());
-        mpInvTransposeSkinningMatricesBuffer->setBlob(mInvTransposeSkinningMatrices.data(), 0, mpInvTransposeSkinningMatricesBuffer->getSize());
+        uploadMatrices(mpSkinningMatricesBuffer.get(), mpHierarchy->getSkinningMatrices(), mUpdatedRanges);
+        uploadMatrices(mpInvTransposeSkinningMatricesBuffer.get(), mpHierarchy->getInvTransposeSkinningMatrices(), mUpdatedRanges);
         mpSkinningPass->execute(pContext, mSkinningDispatchSize, 1, 1);
     }
 }
@@ -27,6 +27,7 @@
  **************************************************************************/
 #pragma once
 #include "Animation.h"
+#include "TransformHierarchy.h"
 #include "RenderGraph/BasePasses/ComputePass.h"
 #include "Scene/SceneTypes.slang"
 
@@ -86,24 +87,32 @@ namespace Falcor
 
         /** Check if a matrix changed
         */
-        bool didMatrixChanged(size_t matrixID) const { return mMatricesChanged[matrixID]; }
+        bool didMatrixChanged(size_t matrixID) const { return mMatricesChanged && mpHierarchy->isUpdated((uint32_t)matrixID); }
 
         /** Get the global matrices
         */
-        const std::vector<glm::mat4>& getGlobalMatrices() const { return mGlobalMatrices; }
+        const std::vector<glm::mat4>& getGlobalMatrices() const { return mpHierarchy->getGlobalMatrices(); }
 
     private:
         friend class SceneBuilder;
         AnimationController(Scene* pScene, const StaticVertexVector& staticVertexData, const DynamicVertexVector& dynamicVertexData);
 
         void bindBuffers();
-        void updateMatrices();
+        void updateMatrices(bool fullUpdate);
+        void uploadMatrices(Buffer* pBuffer, const std::vector<glm::mat4>& matrices, const std::vector<TransformHierarchy::Range>& ranges);
 
         std::vector<Animation::SharedPtr> mAnimations;
         std::vector<glm::mat4> mLocalMatrices;
-        std::vector<glm::mat4> mGlobalMatrices;
-        std::vector<glm::mat4> mInvTransposeGlobalMatrices;
-        std::vector<bool> mMatricesChanged;
+        std::unique_ptr<TransformHierarchy> mpHierarchy;
+        std::vector<uint32_t> mChangedNodes;                        // Nodes animated in the current frame
+        bool mMatricesChanged = false;                              // True if the matrices were updated in the last call to animate()
+
+        // Ranges of matrices to upload. The world matrices are double buffered, so they also include the nodes updated in the previous frame.
+        std::vector<TransformHierarchy::Range> mUpdatedRanges;
+        std::vector<TransformHierarchy::Range> mWorldUpdateRanges;
+        std::vector<uint32_t> mPrevUpdatedNodes;
+        std::vector<uint32_t> mWorldUpdateNodes;
+        bool mPrevFullUpdate = true;
 
         bool mEnabled = true;
         bool mAnimationChanged = true;
@@ -116,8 +125,6 @@ namespace Falcor
 
         // Skinning
         ComputePass::SharedPtr mpSkinningPass;
-        std::vector<glm::mat4> mSkinningMatrices;
-        std::vector<glm::mat4> mInvTransposeSkinningMatrices;
         uint32_t mSkinningDispatchSize = 0;
         void createSkinningPass(const std::vector<PackedStaticVertexData>& staticVertexData, const std::vector<DynamicVertexData>& dynamicVertexData);
         void executeSkinningPass(RenderContext* pContext);
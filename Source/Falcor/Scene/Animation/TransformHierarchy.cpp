@@ -0,0 +1,145 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "TransformHierarchy.h"
+
+namespace Falcor
+{
+    TransformHierarchy::TransformHierarchy(const std::vector<uint32_t>& parents, const std::vector<glm::mat4>& localToBindSpace)
+        : mParents(parents)
+        , mLocalToBindSpace(localToBindSpace)
+        , mGlobalMatrices(parents.size())
+        , mInvTransposeGlobalMatrices(parents.size())
+        , mIsUpdated(parents.size(), 0)
+    {
+        assert(mLocalToBindSpace.empty() || mLocalToBindSpace.size() == mParents.size());
+        if (!mLocalToBindSpace.empty())
+        {
+            mSkinningMatrices.resize(mParents.size());
+            mInvTransposeSkinningMatrices.resize(mParents.size());
+        }
+
+        // Build the child lists.
+        mChildOffsets.assign(mParents.size() + 1, 0);
+        for (uint32_t i = 0; i < mParents.size(); i++)
+        {
+            assert(mParents[i] == kInvalidNode || mParents[i] < i);
+            if (mParents[i] != kInvalidNode) mChildOffsets[mParents[i] + 1]++;
+        }
+        for (size_t i = 1; i < mChildOffsets.size(); i++) mChildOffsets[i] += mChildOffsets[i - 1];
+
+        mChildren.resize(mChildOffsets.back());
+        std::vector<uint32_t> fill(mChildOffsets.begin(), mChildOffsets.end() - 1);
+        for (uint32_t i = 0; i < mParents.size(); i++)
+        {
+            if (mParents[i] != kInvalidNode) mChildren[fill[mParents[i]]++] = i;
+        }
+    }
+
+    void TransformHierarchy::updateNode(uint32_t node, const std::vector<glm::mat4>& localMatrices)
+    {
+        uint32_t parent = mParents[node];
+        mGlobalMatrices[node] = parent != kInvalidNode ? mGlobalMatrices[parent] * localMatrices[node] : localMatrices[node];
+        mInvTransposeGlobalMatrices[node] = transpose(inverse(mGlobalMatrices[node]));
+
+        if (!mLocalToBindSpace.empty())
+        {
+            mSkinningMatrices[node] = mGlobalMatrices[node] * mLocalToBindSpace[node];
+            mInvTransposeSkinningMatrices[node] = transpose(inverse(mSkinningMatrices[node]));
+        }
+    }
+
+    void TransformHierarchy::updateAll(const std::vector<glm::mat4>& localMatrices)
+    {
+        assert(localMatrices.size() == mParents.size());
+
+        mUpdatedNodes.resize(mParents.size());
+        for (uint32_t i = 0; i < mParents.size(); i++)
+        {
+            updateNode(i, localMatrices);
+            mUpdatedNodes[i] = i;
+        }
+        mIsUpdated.assign(mParents.size(), 1);
+    }
+
+    void TransformHierarchy::update(const std::vector<glm::mat4>& localMatrices, const std::vector<uint32_t>& changedNodes)
+    {
+        assert(localMatrices.size() == mParents.size());
+
+        for (uint32_t node : mUpdatedNodes) mIsUpdated[node] = 0;
+        mUpdatedNodes.clear();
+
+        // Collect the changed nodes and their descendants. Subtrees that were already visited are skipped.
+        for (uint32_t changed : changedNodes)
+        {
+            if (mIsUpdated[changed]) continue;
+            mStack.push_back(changed);
+            mIsUpdated[changed] = 1;
+
+            while (!mStack.empty())
+            {
+                uint32_t node = mStack.back();
+                mStack.pop_back();
+                mUpdatedNodes.push_back(node);
+
+                for (uint32_t c = mChildOffsets[node]; c < mChildOffsets[node + 1]; c++)
+                {
+                    uint32_t child = mChildren[c];
+                    if (mIsUpdated[child]) continue; // Already visited as part of another changed subtree
+                    mIsUpdated[child] = 1;
+                    mStack.push_back(child);
+                }
+            }
+        }
+
+        // Parents have lower indices than their children, so updating in ascending order sees up-to-date parent matrices.
+        std::sort(mUpdatedNodes.begin(), mUpdatedNodes.end());
+        for (uint32_t node : mUpdatedNodes) updateNode(node, localMatrices);
+    }
+
+    std::vector<TransformHierarchy::Range> TransformHierarchy::getRanges(const std::vector<uint32_t>& sortedNodes, uint32_t maxGap)
+    {
+        std::vector<Range> ranges;
+        for (uint32_t node : sortedNodes)
+        {
+            if (!ranges.empty())
+            {
+                Range& last = ranges.back();
+                uint32_t end = last.first + last.count;
+                assert(node >= end);
+                if (node - end <= maxGap)
+                {
+                    last.count = node - last.first + 1;
+                    continue;
+                }
+            }
+            ranges.push_back({ node, 1 });
+        }
+        return ranges;
+    }
+}
@@ -0,0 +1,106 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+
+namespace Falcor
+{
+    /** Computes the global matrices of a node hierarchy and updates them incrementally.
+
+        Nodes must be ordered so that parents come before their children, which is the order the scene builder creates them in.
+        An incremental update only recomputes the nodes whose local matrix changed and their descendants, and reports the
+        updated nodes so that only the corresponding ranges of the GPU buffers need to be uploaded.
+    */
+    class dlldecl TransformHierarchy
+    {
+    public:
+        static const uint32_t kInvalidNode = -1;
+
+        /** Range of consecutive nodes.
+        */
+        struct Range
+        {
+            uint32_t first;
+            uint32_t count;
+        };
+
+        /** Create the hierarchy.
+            \param[in] parents Parent of each node, or kInvalidNode for root nodes. A parent must have a lower index than its children.
+            \param[in] localToBindSpace Local to bind space matrix of each node. If empty, skinning matrices are not computed.
+        */
+        TransformHierarchy(const std::vector<uint32_t>& parents, const std::vector<glm::mat4>& localToBindSpace = {});
+
+        /** Recompute all nodes.
+            \param[in] localMatrices Local matrix of each node.
+        */
+        void updateAll(const std::vector<glm::mat4>& localMatrices);
+
+        /** Recompute the nodes whose local matrix changed, and their descendants.
+            \param[in] localMatrices Local matrix of each node.
+            \param[in] changedNodes Nodes whose local matrix changed since the last update. May contain duplicates.
+        */
+        void update(const std::vector<glm::mat4>& localMatrices, const std::vector<uint32_t>& changedNodes);
+
+        /** Get the nodes recomputed by the last update, in ascending order.
+        */
+        const std::vector<uint32_t>& getUpdatedNodes() const { return mUpdatedNodes; }
+
+        /** Check if a node was recomputed by the last update.
+        */
+        bool isUpdated(uint32_t node) const { return mIsUpdated[node] != 0; }
+
+        /** Merge a sorted list of nodes into ranges of consecutive nodes.
+            \param[in] sortedNodes Nodes in ascending order, without duplicates.
+            \param[in] maxGap Nodes separated by at most this many nodes not in the list are merged into the same range, to reduce the number of ranges.
+            \return List of ranges covering all nodes in the list.
+        */
+        static std::vector<Range> getRanges(const std::vector<uint32_t>& sortedNodes, uint32_t maxGap);
+
+        uint32_t getNodeCount() const { return (uint32_t)mParents.size(); }
+        const std::vector<glm::mat4>& getGlobalMatrices() const { return mGlobalMatrices; }
+        const std::vector<glm::mat4>& getInvTransposeGlobalMatrices() const { return mInvTransposeGlobalMatrices; }
+        const std::vector<glm::mat4>& getSkinningMatrices() const { return mSkinningMatrices; }
+        const std::vector<glm::mat4>& getInvTransposeSkinningMatrices() const { return mInvTransposeSkinningMatrices; }
+
+    private:
+        void updateNode(uint32_t node, const std::vector<glm::mat4>& localMatrices);
+
+        std::vector<uint32_t> mParents;
+        std::vector<uint32_t> mChildOffsets;    // Children of node i are mChildren[mChildOffsets[i]] to mChildren[mChildOffsets[i + 1] - 1]
+        std::vector<uint32_t> mChildren;
+        std::vector<glm::mat4> mLocalToBindSpace;
+
+        std::vector<glm::mat4> mGlobalMatrices;
+        std::vector<glm::mat4> mInvTransposeGlobalMatrices;
+        std::vector<glm::mat4> mSkinningMatrices;
+        std::vector<glm::mat4> mInvTransposeSkinningMatrices;
+
+        std::vector<uint32_t> mUpdatedNodes;
+        std::vector<uint8_t> mIsUpdated;
+        std::vector<uint32_t> mStack;           // Scratch space for the traversal
+    };
+}
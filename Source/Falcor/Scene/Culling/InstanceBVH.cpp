@@ -0,0 +1,524 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "InstanceBVH.h"
+#include <emmintrin.h>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kBinCount = 16;
+        const uint32_t kMaxLeafSize = 4;
+        const float kTraversalCost = 1.f;   // Cost of visiting a node, relative to testing a box.
+        const uint32_t kMaxSAHDepth = 48;   // Nodes below this depth are split at the median, so the depth is at most kMaxSAHDepth + 32.
+        const uint32_t kParallelSubtreeSize = 8192;                         // Frustum queries split the hierarchy into subtrees of at most this many boxes...
+        const uint32_t kParallelQueryMinBoxes = 4 * kParallelSubtreeSize;   // ...if it has at least this many boxes.
+
+        static_assert(kMaxLeafSize <= 4, "Leaves are tested against the frustum planes four boxes at a time");
+
+        struct PlaneSIMD
+        {
+            __m128 x, y, z;             // Plane normal
+            __m128 negW;
+            bool maxX, maxY, maxZ;      // Selects the box corner furthest along the normal
+        };
+
+        enum class Overlap
+        {
+            None,
+            Partial,
+            Full,
+        };
+
+        BBox toBBox(const BoundingBox& box)
+        {
+            BBox b;
+            b.minPoint = box.getMinPos();
+            b.maxPoint = box.getMaxPos();
+            return b;
+        }
+
+        // Corner of the box furthest along the direction.
+        float3 positiveVertex(const BBox& b, const float3& n)
+        {
+            return float3(n.x >= 0.f ? b.maxPoint.x : b.minPoint.x, n.y >= 0.f ? b.maxPoint.y : b.minPoint.y, n.z >= 0.f ? b.maxPoint.z : b.minPoint.z);
+        }
+
+        float3 negativeVertex(const BBox& b, const float3& n)
+        {
+            return float3(n.x >= 0.f ? b.minPoint.x : b.maxPoint.x, n.y >= 0.f ? b.minPoint.y : b.maxPoint.y, n.z >= 0.f ? b.minPoint.z : b.maxPoint.z);
+        }
+
+        Overlap classify(const Frustum& frustum, const BBox& b)
+        {
+            Overlap result = Overlap::Full;
+            for (const float4& plane : frustum.planes)
+            {
+                float3 n = float3(plane);
+                if (glm::dot(positiveVertex(b, n), n) <= -plane.w) return Overlap::None;
+                if (glm::dot(negativeVertex(b, n), n) <= -plane.w) result = Overlap::Partial;
+            }
+            return result;
+        }
+
+        bool overlaps(const BBox& a, const BBox& b)
+        {
+            return glm::all(glm::lessThanEqual(a.minPoint, b.maxPoint)) && glm::all(glm::lessThanEqual(b.minPoint, a.maxPoint));
+        }
+
+        bool contains(const BBox& outer, const BBox& inner)
+        {
+            return glm::all(glm::lessThanEqual(outer.minPoint, inner.minPoint)) && glm::all(glm::lessThanEqual(inner.maxPoint, outer.maxPoint));
+        }
+
+        float distanceSquared(const BBox& b, const float3& p)
+        {
+            float3 d = p - glm::clamp(p, b.minPoint, b.maxPoint);
+            return glm::dot(d, d);
+        }
+
+        float maxDistanceSquared(const BBox& b, const float3& p)
+        {
+            float3 d = glm::max(glm::abs(p - b.minPoint), glm::abs(p - b.maxPoint));
+            return glm::dot(d, d);
+        }
+
+        bool intersectRay(const BBox& b, const float3& origin, const float3& invDir, float tMax, float& tEntry)
+        {
+            float3 t0 = (b.minPoint - origin) * invDir;
+            float3 t1 = (b.maxPoint - origin) * invDir;
+            float3 tNear = glm::min(t0, t1);
+            float3 tFar = glm::max(t0, t1);
+            tEntry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.f));
+            float tExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+            return tEntry <= tExit;
+        }
+    }
+
+    void InstanceBVH::build(const std::vector<BoundingBox>& bounds)
+    {
+        assert(bounds.size() < std::numeric_limits<uint32_t>::max());
+        uint32_t count = (uint32_t)bounds.size();
+
+        mPrimBounds.resize(count);
+        mPrimIndices.resize(count);
+        std::vector<float3> centroids(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            assert(!glm::any(glm::isinf(bounds[i].extent)) && !glm::any(glm::isnan(bounds[i].center)));
+            mPrimBounds[i] = toBBox(bounds[i]);
+            mPrimIndices[i] = i;
+            centroids[i] = mPrimBounds[i].centroid();
+        }
+
+        mNodes.clear();
+        if (count == 0)
+        {
+            updateSortedBounds();
+            return;
+        }
+        mNodes.reserve(2 * (size_t)count);
+        buildNode(0, count, 0, centroids);
+        updateSortedBounds();
+    }
+
+    void InstanceBVH::updateSortedBounds()
+    {
+        size_t paddedCount = mPrimIndices.size() + 3;
+        for (auto v : { &mMinX, &mMinY, &mMinZ, &mMaxX, &mMaxY, &mMaxZ }) v->assign(paddedCount, 0.f);
+
+        for (size_t i = 0; i < mPrimIndices.size(); i++)
+        {
+            const BBox& b = mPrimBounds[mPrimIndices[i]];
+            mMinX[i] = b.minPoint.x;
+            mMinY[i] = b.minPoint.y;
+            mMinZ[i] = b.minPoint.z;
+            mMaxX[i] = b.maxPoint.x;
+            mMaxY[i] = b.maxPoint.y;
+            mMaxZ[i] = b.maxPoint.z;
+        }
+    }
+
+    void InstanceBVH::makeLeaf(uint32_t nodeIndex, const BBox& bounds, uint32_t begin, uint32_t end)
+    {
+        Node& node = mNodes[nodeIndex];
+        node.bounds = bounds;
+        node.firstPrim = begin;
+        node.primCount = end - begin;
+        node.rightChild = 0;
+    }
+
+    uint32_t InstanceBVH::buildNode(uint32_t begin, uint32_t end, uint32_t depth, std::vector<float3>& centroids)
+    {
+        uint32_t nodeIndex = (uint32_t)mNodes.size();
+        mNodes.emplace_back();
+
+        BBox bounds, centroidBounds;
+        for (uint32_t i = begin; i < end; i++)
+        {
+            uint32_t prim = mPrimIndices[i];
+            bounds |= mPrimBounds[prim];
+            centroidBounds |= BBox(centroids[prim]);
+        }
+
+        uint32_t count = end - begin;
+        if (count == 1)
+        {
+            makeLeaf(nodeIndex, bounds, begin, end);
+            return nodeIndex;
+        }
+
+        // Find the best split plane between bins of centroids, on any axis.
+        // The costs below are not normalized by the node's surface area.
+        float3 centroidExtent = centroidBounds.dimensions();
+        float bestCost = std::numeric_limits<float>::infinity();
+        int bestAxis = -1;
+        uint32_t bestBin = 0;
+
+        auto getBin = [&](uint32_t prim, int axis)
+        {
+            float scale = kBinCount / centroidExtent[axis];
+            return std::min(kBinCount - 1, (uint32_t)((centroids[prim][axis] - centroidBounds.minPoint[axis]) * scale));
+        };
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (!(centroidExtent[axis] > 0.f)) continue;
+
+            BBox binBounds[kBinCount];
+            uint32_t binCount[kBinCount] = {};
+            for (uint32_t i = begin; i < end; i++)
+            {
+                uint32_t prim = mPrimIndices[i];
+                uint32_t bin = getBin(prim, axis);
+                binBounds[bin] |= mPrimBounds[prim];
+                binCount[bin]++;
+            }
+
+            // Sweep from the right to get the area and count of the boxes right of each plane.
+            float rightArea[kBinCount] = {};
+            uint32_t rightCount[kBinCount] = {};
+            BBox accBounds;
+            uint32_t accCount = 0;
+            for (uint32_t bin = kBinCount - 1; bin > 0; bin--)
+            {
+                accBounds |= binBounds[bin];
+                accCount += binCount[bin];
+                rightArea[bin] = accCount ? accBounds.surfaceArea() : 0.f;
+                rightCount[bin] = accCount;
+            }
+
+            // Sweep from the left, plane i is between bins i - 1 and i.
+            accBounds = BBox();
+            accCount = 0;
+            for (uint32_t bin = 1; bin < kBinCount; bin++)
+            {
+                accBounds |= binBounds[bin - 1];
+                accCount += binCount[bin - 1];
+                if (accCount == 0 || rightCount[bin] == 0) continue;
+
+                float cost = accBounds.surfaceArea() * accCount + rightArea[bin] * rightCount[bin];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = bin;
+                }
+            }
+        }
+
+        // Small nodes become leaves unless splitting is cheaper.
+        float area = bounds.surfaceArea();
+        float leafCost = area * count;
+        float splitCost = kTraversalCost * area + bestCost;
+        if (count <= kMaxLeafSize && !(splitCost < leafCost))
+        {
+            makeLeaf(nodeIndex, bounds, begin, end);
+            return nodeIndex;
+        }
+
+        uint32_t mid = begin + count / 2;
+        if (depth >= kMaxSAHDepth)
+        {
+            // Degenerate inputs (e.g. exponentially spaced boxes) can make every SAH split peel off a single box.
+            // Deep nodes are therefore split at the median centroid along the largest axis, which halves the count on each level.
+            int axis = centroidExtent.x >= centroidExtent.y && centroidExtent.x >= centroidExtent.z ? 0 : (centroidExtent.y >= centroidExtent.z ? 1 : 2);
+            std::nth_element(mPrimIndices.begin() + begin, mPrimIndices.begin() + mid, mPrimIndices.begin() + end, [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+        }
+        else if (bestAxis >= 0)
+        {
+            auto it = std::partition(mPrimIndices.begin() + begin, mPrimIndices.begin() + end, [&](uint32_t prim) { return getBin(prim, bestAxis) < bestBin; });
+            mid = (uint32_t)(it - mPrimIndices.begin());
+        }
+        // Otherwise all centroids coincide and the boxes are split in the middle of the list.
+        assert(mid > begin && mid < end);
+
+        buildNode(begin, mid, depth + 1, centroids);
+        uint32_t right = buildNode(mid, end, depth + 1, centroids);
+
+        Node& node = mNodes[nodeIndex];
+        node.bounds = bounds;
+        node.firstPrim = begin;
+        node.primCount = count;
+        node.rightChild = right;
+        return nodeIndex;
+    }
+
+    void InstanceBVH::refit(const std::vector<BoundingBox>& bounds)
+    {
+        assert(bounds.size() == mPrimBounds.size());
+        for (size_t i = 0; i < bounds.size(); i++) mPrimBounds[i] = toBBox(bounds[i]);
+        updateSortedBounds();
+
+        // Children come after their parent, so a reverse sweep updates them first.
+        for (size_t i = mNodes.size(); i-- > 0;)
+        {
+            Node& node = mNodes[i];
+            if (node.isLeaf())
+            {
+                BBox b;
+                for (uint32_t j = node.firstPrim; j < node.firstPrim + node.primCount; j++) b |= mPrimBounds[mPrimIndices[j]];
+                node.bounds = b;
+            }
+            else
+            {
+                node.bounds = mNodes[i + 1].bounds | mNodes[node.rightChild].bounds;
+            }
+        }
+    }
+
+    float InstanceBVH::getSAHCost() const
+    {
+        if (mNodes.empty()) return 0.f;
+        float rootArea = mNodes[0].bounds.surfaceArea();
+        if (!(rootArea > 0.f)) return 0.f;
+
+        double cost = 0.0;
+        for (const auto& node : mNodes)
+        {
+            cost += node.bounds.surfaceArea() / rootArea * (node.isLeaf() ? (float)node.primCount : kTraversalCost);
+        }
+        return (float)cost;
+    }
+
+    template<typename NodeTest, typename LeafTest>
+    void InstanceBVH::traverse(uint32_t rootIndex, const NodeTest& nodeTest, const LeafTest& leafTest, std::vector<uint32_t>& result) const
+    {
+        if (mNodes.empty()) return;
+
+        std::vector<uint32_t> stack;
+        stack.reserve(64);
+        stack.push_back(rootIndex);
+
+        while (!stack.empty())
+        {
+            uint32_t nodeIndex = stack.back();
+            stack.pop_back();
+            const Node& node = mNodes[nodeIndex];
+
+            Overlap overlap = nodeTest(node.bounds);
+            if (overlap == Overlap::None) continue;
+
+            if (overlap == Overlap::Full)
+            {
+                // The whole subtree is inside, no need to test the boxes.
+                result.insert(result.end(), mPrimIndices.begin() + node.firstPrim, mPrimIndices.begin() + node.firstPrim + node.primCount);
+            }
+            else if (node.isLeaf())
+            {
+                leafTest(node, result);
+            }
+            else
+            {
+                stack.push_back(node.rightChild);
+                stack.push_back(nodeIndex + 1);
+            }
+        }
+    }
+
+    template<typename PrimTest>
+    void InstanceBVH::testPrims(const Node& node, const PrimTest& primTest, std::vector<uint32_t>& result) const
+    {
+        for (uint32_t i = node.firstPrim; i < node.firstPrim + node.primCount; i++)
+        {
+            uint32_t prim = mPrimIndices[i];
+            if (primTest(mPrimBounds[prim])) result.push_back(prim);
+        }
+    }
+
+    void InstanceBVH::queryFrustums(const std::vector<Frustum>& frustums, std::vector<uint32_t>& result) const
+    {
+        if (mNodes.empty() || frustums.empty()) return;
+
+        std::vector<PlaneSIMD> planes;
+        planes.reserve(frustums.size() * Frustum::kPlaneCount);
+        for (const auto& frustum : frustums)
+        {
+            for (const float4& plane : frustum.planes)
+            {
+                planes.push_back({ _mm_set1_ps(plane.x), _mm_set1_ps(plane.y), _mm_set1_ps(plane.z), _mm_set1_ps(-plane.w), plane.x >= 0.f, plane.y >= 0.f, plane.z >= 0.f });
+            }
+        }
+
+        auto nodeTest = [&](const BBox& b)
+        {
+            Overlap overlap = Overlap::None;
+            for (const auto& frustum : frustums)
+            {
+                Overlap o = classify(frustum, b);
+                if (o == Overlap::Full) return o;
+                if (o == Overlap::Partial) overlap = o;
+            }
+            return overlap;
+        };
+
+        // The boxes of a leaf are adjacent in the sorted bounds, so they are tested against each plane together.
+        // The lanes past the end of the leaf hold other boxes or padding and are ignored.
+        auto leafTest = [&](const Node& node, std::vector<uint32_t>& out)
+        {
+            uint32_t i = node.firstPrim;
+            const __m128 minX = _mm_loadu_ps(&mMinX[i]), minY = _mm_loadu_ps(&mMinY[i]), minZ = _mm_loadu_ps(&mMinZ[i]);
+            const __m128 maxX = _mm_loadu_ps(&mMaxX[i]), maxY = _mm_loadu_ps(&mMaxY[i]), maxZ = _mm_loadu_ps(&mMaxZ[i]);
+
+            int mask = 0;
+            for (size_t f = 0; f < planes.size(); f += Frustum::kPlaneCount)
+            {
+                // Same test as classify(), the corner furthest along the normal must be on the inner side of every plane.
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (size_t p = f; p < f + Frustum::kPlaneCount; p++)
+                {
+                    const PlaneSIMD& plane = planes[p];
+                    __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane.maxX ? maxX : minX, plane.x), _mm_mul_ps(plane.maxY ? maxY : minY, plane.y)), _mm_mul_ps(plane.maxZ ? maxZ : minZ, plane.z));
+                    inside = _mm_and_ps(inside, _mm_cmpgt_ps(d, plane.negW));
+                }
+                mask |= _mm_movemask_ps(inside);
+            }
+
+            for (uint32_t lane = 0; lane < node.primCount; lane++)
+            {
+                if ((mask >> lane) & 1) out.push_back(mPrimIndices[i + lane]);
+            }
+        };
+
+        if (getBoxCount() < kParallelQueryMinBoxes)
+        {
+            traverse(0, nodeTest, leafTest, result);
+            return;
+        }
+
+        // Split the top of the hierarchy into subtrees that are queried in parallel. The subtrees are collected in traversal order
+        // and their results are appended in the same order, so the result is the same as for a sequential traversal.
+        std::vector<uint32_t> subtrees;
+        std::vector<uint32_t> stack = { 0 };
+        while (!stack.empty())
+        {
+            uint32_t nodeIndex = stack.back();
+            stack.pop_back();
+            const Node& node = mNodes[nodeIndex];
+            if (node.isLeaf() || node.primCount <= kParallelSubtreeSize)
+            {
+                subtrees.push_back(nodeIndex);
+                continue;
+            }
+            if (nodeTest(node.bounds) == Overlap::None) continue;
+            stack.push_back(node.rightChild);
+            stack.push_back(nodeIndex + 1);
+        }
+
+        std::vector<std::vector<uint32_t>> subtreeResults(subtrees.size());
+        Threading::parallelFor(0, subtrees.size(), [&](size_t i)
+        {
+            traverse(subtrees[i], nodeTest, leafTest, subtreeResults[i]);
+        }, 1);
+
+        for (const auto& subtreeResult : subtreeResults) result.insert(result.end(), subtreeResult.begin(), subtreeResult.end());
+    }
+
+    void InstanceBVH::queryBox(const BoundingBox& box, std::vector<uint32_t>& result) const
+    {
+        BBox query = toBBox(box);
+        auto nodeTest = [&](const BBox& b)
+        {
+            if (!overlaps(query, b)) return Overlap::None;
+            return contains(query, b) ? Overlap::Full : Overlap::Partial;
+        };
+        auto leafTest = [&](const Node& node, std::vector<uint32_t>& out) { testPrims(node, [&](const BBox& b) { return overlaps(query, b); }, out); };
+        traverse(0, nodeTest, leafTest, result);
+    }
+
+    void InstanceBVH::querySphere(const float3& center, float radius, std::vector<uint32_t>& result) const
+    {
+        float radius2 = radius * radius;
+        auto nodeTest = [&](const BBox& b)
+        {
+            if (distanceSquared(b, center) > radius2) return Overlap::None;
+            return maxDistanceSquared(b, center) <= radius2 ? Overlap::Full : Overlap::Partial;
+        };
+        auto leafTest = [&](const Node& node, std::vector<uint32_t>& out) { testPrims(node, [&](const BBox& b) { return distanceSquared(b, center) <= radius2; }, out); };
+        traverse(0, nodeTest, leafTest, result);
+    }
+
+    void InstanceBVH::queryRay(const float3& origin, const float3& dir, float tMax, std::vector<RayHit>& hits) const
+    {
+        if (mNodes.empty()) return;
+
+        float3 invDir = 1.f / dir;
+        size_t firstHit = hits.size();
+
+        std::vector<uint32_t> stack;
+        stack.reserve(64);
+        stack.push_back(0);
+
+        while (!stack.empty())
+        {
+            uint32_t nodeIndex = stack.back();
+            stack.pop_back();
+            const Node& node = mNodes[nodeIndex];
+
+            float t;
+            if (!intersectRay(node.bounds, origin, invDir, tMax, t)) continue;
+
+            if (node.isLeaf())
+            {
+                for (uint32_t i = node.firstPrim; i < node.firstPrim + node.primCount; i++)
+                {
+                    uint32_t prim = mPrimIndices[i];
+                    if (intersectRay(mPrimBounds[prim], origin, invDir, tMax, t)) hits.push_back({ prim, t });
+                }
+            }
+            else
+            {
+                stack.push_back(node.rightChild);
+                stack.push_back(nodeIndex + 1);
+            }
+        }
+
+        std::sort(hits.begin() + firstHit, hits.end(), [](const RayHit& a, const RayHit& b) { return a.t < b.t || (a.t == b.t && a.index < b.index); });
+    }
+}
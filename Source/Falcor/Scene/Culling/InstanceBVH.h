@@ -0,0 +1,124 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Frustum.h"
+#include "Utils/Math/BBox.h"
+
+namespace Falcor
+{
+    /** Bounding volume hierarchy over a set of bounding boxes, typically the mesh instances of a scene.
+
+        The hierarchy is built with a binned surface area heuristic. When the boxes move it can be refit in linear time,
+        which keeps the topology and only updates the node bounds. Refitting degrades the quality of the hierarchy as the
+        boxes move apart, getSAHCost() can be compared to the cost after the last build to decide when to rebuild.
+
+        Queries return the indices of the boxes, in the order they were found.
+    */
+    class dlldecl InstanceBVH
+    {
+    public:
+        struct Node
+        {
+            BBox bounds;
+            uint32_t firstPrim = 0;     ///< First entry in the primitive index list covered by this node.
+            uint32_t primCount = 0;     ///< Number of primitives covered by this node.
+            uint32_t rightChild = 0;    ///< Index of the right child, or 0 for leaves. The left child directly follows its parent.
+
+            bool isLeaf() const { return rightChild == 0; }
+        };
+
+        struct RayHit
+        {
+            uint32_t index;             ///< Index of the box.
+            float t;                    ///< Distance along the ray to the entry point of the box.
+        };
+
+        /** Build the hierarchy.
+            \param[in] bounds Bounding boxes. The boxes must have finite extents.
+        */
+        void build(const std::vector<BoundingBox>& bounds);
+
+        /** Update the node bounds for moved boxes, keeping the topology.
+            \param[in] bounds Bounding boxes. Must have the same number of boxes as the last build.
+        */
+        void refit(const std::vector<BoundingBox>& bounds);
+
+        /** Compute the surface area heuristic cost of the hierarchy, relative to the surface area of the root.
+        */
+        float getSAHCost() const;
+
+        uint32_t getBoxCount() const { return (uint32_t)mPrimBounds.size(); }
+        const std::vector<Node>& getNodes() const { return mNodes; }
+
+        /** Get the bounds of all boxes. Returns an invalid box if the hierarchy is empty.
+        */
+        BBox getBounds() const { return mNodes.empty() ? BBox() : mNodes[0].bounds; }
+
+        /** Find the boxes that intersect at least one of the frustums.
+            As in Camera::isObjectCulled(), a box intersects a frustum if its corner furthest along each plane normal is on the inner side of the plane.
+            The boxes in a leaf are tested four at a time with SSE. Large hierarchies are split into subtrees that are queried in parallel.
+        */
+        void queryFrustums(const std::vector<Frustum>& frustums, std::vector<uint32_t>& result) const;
+
+        /** Find the boxes that overlap a box.
+        */
+        void queryBox(const BoundingBox& box, std::vector<uint32_t>& result) const;
+
+        /** Find the boxes that overlap a sphere.
+        */
+        void querySphere(const float3& center, float radius, std::vector<uint32_t>& result) const;
+
+        /** Find the boxes hit by a ray.
+            \param[in] origin Ray origin.
+            \param[in] dir Ray direction, does not need to be normalized.
+            \param[in] tMax Maximum distance along the ray, in multiples of dir.
+            \param[out] hits Boxes hit by the ray, sorted by entry distance. Boxes containing the origin have t = 0.
+        */
+        void queryRay(const float3& origin, const float3& dir, float tMax, std::vector<RayHit>& hits) const;
+
+    private:
+        uint32_t buildNode(uint32_t begin, uint32_t end, uint32_t depth, std::vector<float3>& centroids);
+        void makeLeaf(uint32_t nodeIndex, const BBox& bounds, uint32_t begin, uint32_t end);
+
+        void updateSortedBounds();
+
+        template<typename NodeTest, typename LeafTest>
+        void traverse(uint32_t rootIndex, const NodeTest& nodeTest, const LeafTest& leafTest, std::vector<uint32_t>& result) const;
+
+        template<typename PrimTest>
+        void testPrims(const Node& node, const PrimTest& primTest, std::vector<uint32_t>& result) const;
+
+        std::vector<Node> mNodes;                   ///< Nodes in depth-first order. Children always come after their parent.
+        std::vector<uint32_t> mPrimIndices;         ///< Box indices, ordered so that each node covers a contiguous range.
+        std::vector<BBox> mPrimBounds;              ///< Bounds of each box, indexed by box index.
+
+        // Box bounds in structure-of-arrays layout, ordered like mPrimIndices. Padded by three boxes so that four boxes can be loaded at any position.
+        std::vector<float> mMinX, mMinY, mMinZ;
+        std::vector<float> mMaxX, mMaxY, mMaxZ;
+    };
+}
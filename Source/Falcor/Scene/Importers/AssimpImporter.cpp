@@ -33,6 +33,7 @@
 #include "AssimpImporter.h"
 #include "Utils/StringUtils.h"
 #include "Utils/Timing/TimeReport.h"
+#include "Utils/Image/TextureCache.h"
 #include "Core/API/Device.h"
 #include "Scene/SceneBuilder.h"
 
@@ -143,6 +144,14 @@ namespace Falcor
             }
         };
 
+        /** Texture of a material that is decoded in the background.
+        */
+        struct PendingTexture
+        {
+            Material::TextureSlot slot;
+            TextureCache::Request request;
+        };
+
         class ImporterData
         {
         public:
@@ -153,7 +162,7 @@ namespace Falcor
             std::map<uint32_t, Material::SharedPtr> materialMap;
             std::map<std::string, Material::SharedPtr> extraMaterialMap;
             std::map<uint32_t, uint32_t> meshMap; // Assimp mesh index to Falcor mesh ID
-            std::map<const std::string, Texture::SharedPtr> textureCache;
+            std::map<uint32_t, std::vector<PendingTexture>> pendingTextures; // Assimp material index to textures that are being decoded
             const SceneBuilder::InstanceMatrices& modelInstances;
             std::map<std::string, glm::mat4> localToBindPoseMatrices;
 
@@ -511,42 +520,34 @@ namespace Falcor
             const aiScene* pScene = data.pScene;
             const bool loadTangents = is_set(data.builder.getFlags(), SceneBuilder::Flags::UseOriginalTangentSpace);
 
-            // Find the largest mesh.
-            uint64_t largestIndexCount = 0;
-            uint64_t largestVertexCount = 0;
-
-            for (uint32_t i = 0; i < pScene->mNumMeshes; i++)
+            // Converted vertex and index data for each mesh. It has to be kept alive until all meshes are added.
+            struct MeshData
             {
-                const aiMesh* pAiMesh = pScene->mMeshes[i];
-                uint64_t indexCount = pAiMesh->mNumFaces * pAiMesh->mFaces[0].mNumIndices;
-
-                largestIndexCount = std::max(largestIndexCount, indexCount);
-                largestVertexCount = std::max(largestVertexCount, (uint64_t)pAiMesh->mNumVertices);
-            }
-
-            // Reserve memory for the vertex and index data.
-            std::vector<uint32_t> indexList;
-            std::vector<float2> texCrds;
-            std::vector<float4> tangents;
-            indexList.reserve(largestIndexCount);
-            texCrds.reserve(largestVertexCount);
-            if (loadTangents) tangents.reserve(largestVertexCount);
+                std::vector<uint32_t> indexList;
+                std::vector<float2> texCrds;
+                std::vector<float4> tangents;
+                std::vector<uint4> boneIds;
+                std::vector<float4> boneWeights;
+            };
+            std::vector<MeshData> meshData(pScene->mNumMeshes);
+            std::vector<SceneBuilder::Mesh> meshes(pScene->mNumMeshes);
 
-            // Add all the meshes.
+            // Create the mesh descriptions.
             for (uint32_t i = 0; i < pScene->mNumMeshes; i++)
             {
                 const aiMesh* pAiMesh = pScene->mMeshes[i];
                 const uint32_t perFaceIndexCount = pAiMesh->mFaces[0].mNumIndices;
 
-                SceneBuilder::Mesh mesh;
+                SceneBuilder::Mesh& mesh = meshes[i];
+                MeshData& md = meshData[i];
                 mesh.name = pAiMesh->mName.C_Str();
                 mesh.faceCount = pAiMesh->mNumFaces;
 
                 // Indices
-                createIndexList(pAiMesh, indexList);
-                assert(indexList.size() <= std::numeric_limits<uint32_t>::max());
-                mesh.indexCount = (uint32_t)indexList.size();
-                mesh.pIndices = indexList.data();
+                createIndexList(pAiMesh, md.indexList);
+                assert(md.indexList.size() <= std::numeric_limits<uint32_t>::max());
+                mesh.indexCount = (uint32_t)md.indexList.size();
+                mesh.pIndices = md.indexList.data();
 
                 // Vertices
                 assert(pAiMesh->mVertices);
@@ -560,29 +561,26 @@ namespace Falcor
 
                 if (pAiMesh->HasTextureCoords(0))
                 {
-                    createTexCrdList(pAiMesh->mTextureCoords[0], pAiMesh->mNumVertices, texCrds);
-                    assert(!texCrds.empty());
-                    mesh.texCrds.pData = texCrds.data();
+                    createTexCrdList(pAiMesh->mTextureCoords[0], pAiMesh->mNumVertices, md.texCrds);
+                    assert(!md.texCrds.empty());
+                    mesh.texCrds.pData = md.texCrds.data();
                     mesh.texCrds.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
                 }
 
                 if (loadTangents && pAiMesh->HasTangentsAndBitangents())
                 {
-                    createTangentList(pAiMesh->mTangents, pAiMesh->mBitangents, pAiMesh->mNormals, pAiMesh->mNumVertices, tangents);
-                    assert(!tangents.empty());
-                    mesh.tangents.pData = tangents.data();
+                    createTangentList(pAiMesh->mTangents, pAiMesh->mBitangents, pAiMesh->mNormals, pAiMesh->mNumVertices, md.tangents);
+                    assert(!md.tangents.empty());
+                    mesh.tangents.pData = md.tangents.data();
                     mesh.tangents.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
                 }
 
-                std::vector<uint4> boneIds;
-                std::vector<float4> boneWeights;
-
                 if (pAiMesh->HasBones())
                 {
-                    loadBones(pAiMesh, data, boneWeights, boneIds);
-                    mesh.boneIDs.pData = boneIds.data();
+                    loadBones(pAiMesh, data, md.boneWeights, md.boneIds);
+                    mesh.boneIDs.pData = md.boneIds.data();
                     mesh.boneIDs.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
-                    mesh.boneWeights.pData = boneWeights.data();
+                    mesh.boneWeights.pData = md.boneWeights.data();
                     mesh.boneWeights.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
                 }
 
@@ -600,9 +598,11 @@ namespace Falcor
                 if (data.extraMaterialMap.find(MaterialKeys::kAllMesh) != data.extraMaterialMap.end()) mesh.pMaterial = data.extraMaterialMap[MaterialKeys::kAllMesh];
                 if (data.extraMaterialMap.find(mesh.name) != data.extraMaterialMap.end()) mesh.pMaterial = data.extraMaterialMap[mesh.name];
                 assert(mesh.pMaterial);
-                uint32_t meshID = data.builder.addMesh(mesh);
-                data.meshMap[i] = meshID;
             }
+
+            // Add all the meshes. They are processed in parallel.
+            std::vector<uint32_t> meshIDs = data.builder.addMeshes(meshes);
+            for (uint32_t i = 0; i < pScene->mNumMeshes; i++) data.meshMap[i] = meshIDs[i];
         }
 
         bool isBone(ImporterData& data, const std::string& name)
@@ -739,8 +739,9 @@ namespace Falcor
             }
         }
 
-        void loadTextures(ImporterData& data, const aiMaterial* pAiMaterial, const std::string& folder, Material* pMaterial, ImportMode importMode, bool useSrgb)
+        void requestTextures(ImporterData& data, uint32_t materialIndex, const std::string& folder, Material* pMaterial, ImportMode importMode, bool useSrgb)
         {
+            const aiMaterial* pAiMaterial = data.pScene->mMaterials[materialIndex];
             const auto& textureMappings = kTextureMappings[int(importMode)];
 
             for (const auto& source : textureMappings)
@@ -758,34 +759,32 @@ namespace Falcor
                     continue;
                 }
 
-                // Check if the texture was already loaded
-                Texture::SharedPtr pTex;
-                const auto& cacheItem = data.textureCache.find(path);
-                if (cacheItem != data.textureCache.end())
-                {
-                    pTex = cacheItem->second;
-                }
-                else
-                {
-                    // create a new texture
-                    std::string fullpath = folder + '/' + path;
-                    fullpath = replaceSubstring(fullpath, "\\", "/");
-                    pTex = Texture::createFromFile(fullpath, true, useSrgb && pMaterial->isSrgbTextureRequired(source.targetType));
-                    if (pTex)
-                    {
-                        data.textureCache[path] = pTex;
-                    }
-                }
+                // Start decoding the texture. Textures that were already loaded are shared through the process-wide texture cache.
+                std::string fullpath = folder + '/' + path;
+                fullpath = replaceSubstring(fullpath, "\\", "/");
+                auto request = TextureCache::request(fullpath, true, useSrgb && pMaterial->isSrgbTextureRequired(source.targetType));
+                if (request.isValid()) data.pendingTextures[materialIndex].push_back({ source.targetType, request });
+            }
+        }
 
+        void loadTextures(ImporterData& data, uint32_t materialIndex, Material* pMaterial)
+        {
+            auto it = data.pendingTextures.find(materialIndex);
+            if (it == data.pendingTextures.end()) return;
+
+            for (const auto& pending : it->second)
+            {
+                auto pTex = TextureCache::resolve(pending.request);
                 assert(pTex != nullptr);
-                pMaterial->setTexture(source.targetType, pTex);
+                pMaterial->setTexture(pending.slot, pTex);
             }
+            data.pendingTextures.erase(it);
 
             // Flush upload heap after every material so we don't accumulate a ton of memory usage when loading a model with a lot of textures
             gpDevice->flushAndSync();
         }
 
-        Material::SharedPtr createMaterial(ImporterData& data, const aiMaterial* pAiMaterial, const std::string& folder, ImportMode importMode, bool useSrgb)
+        Material::SharedPtr createMaterial(ImporterData& data, const aiMaterial* pAiMaterial, ImportMode importMode)
         {
             aiString name;
             pAiMaterial->Get(AI_MATKEY_NAME, name);
@@ -808,8 +807,16 @@ namespace Falcor
                 pMaterial->setShadingModel(ShadingModelSpecGloss);
             }
 
-            // Load textures. Note that loading is affected by the current shading model.
-            loadTextures(data, pAiMaterial, folder, pMaterial.get(), importMode, useSrgb);
+            return pMaterial;
+        }
+
+        void loadMaterial(ImporterData& data, uint32_t materialIndex, Material* pMaterial, ImportMode importMode)
+        {
+            const aiMaterial* pAiMaterial = data.pScene->mMaterials[materialIndex];
+            const std::string& nameStr = pMaterial->getName();
+
+            // Load textures. They were requested when the material was created and are decoded in the background.
+            loadTextures(data, materialIndex, pMaterial);
 
             // Opacity
             float opacity = 1.f;
@@ -922,8 +929,6 @@ namespace Falcor
                 pMaterial->setSpecularTransmission(1.f - opacity);
                 pMaterial->setDoubleSided(true);
             }
-
-            return pMaterial;
         }
 
         bool createAllMaterials(ImporterData& data, const std::string& modelFolder, ImportMode importMode)
@@ -933,18 +938,29 @@ namespace Falcor
             for (uint32_t i = 0; i < data.pScene->mNumMaterials; i++)
             {
                 const aiMaterial* pAiMaterial = data.pScene->mMaterials[i];
-                auto pMaterial = createMaterial(data, pAiMaterial, modelFolder, importMode, useSrgb);
+                auto pMaterial = createMaterial(data, pAiMaterial, importMode);
                 if (pMaterial == nullptr)
                 {
                     logError("Can't allocate memory for material");
                     return false;
                 }
                 data.materialMap[i] = pMaterial;
+
+                // Start decoding the textures. Note that loading is affected by the current shading model.
+                requestTextures(data, i, modelFolder, pMaterial.get(), importMode, useSrgb);
             }
 
             return true;
         }
 
+        void loadAllMaterials(ImporterData& data, ImportMode importMode)
+        {
+            for (uint32_t i = 0; i < data.pScene->mNumMaterials; i++)
+            {
+                loadMaterial(data, i, data.materialMap.at(i).get(), importMode);
+            }
+        }
+
         void createExtraMaterials(ImporterData& data, const std::vector<Dictionary>& extraMaterial)
         {
             for (const auto& materialSpec : extraMaterial)
@@ -1125,7 +1141,7 @@ namespace Falcor
             logError("Can't create materials for model " + filename);
             return false;
         }
-        timeReport.measure("Creating materials");
+        timeReport.measure("Creating materials and requesting textures");
 
         createExtraMaterials(data, extraMaterials);
         timeReport.measure("Creating extra materials");
@@ -1137,6 +1153,11 @@ namespace Falcor
         }
         timeReport.measure("Creating scene graph");
 
+        // The scene builder inspects the material textures when adding meshes, so the materials are completed first.
+        // The textures have been decoding in the background since the materials were created.
+        loadAllMaterials(data, importMode);
+        timeReport.measure("Loading materials");
+
         createMeshes(data);
         addMeshInstances(data, data.pScene->mRootNode);
         timeReport.measure("Creating meshes");
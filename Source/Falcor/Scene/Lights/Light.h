@@ -115,6 +115,8 @@ namespace Falcor
         void updateFromAnimation(const glm::mat4& transform) override {}
 
     protected:
+        friend class SceneCache;
+
         Light(LightType type);
 
         static const size_t kDataSize = sizeof(LightData);
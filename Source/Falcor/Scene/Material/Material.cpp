@@ -30,6 +30,7 @@
 #include "Core/Program/GraphicsProgram.h"
 #include "Core/Program/ProgramVars.h"
 #include "Utils/Color/ColorHelpers.slang"
+#include "Utils/Image/TextureCache.h"
 
 namespace Falcor
 {
@@ -269,7 +270,7 @@ namespace Falcor
         std::string fullpath;
         if (findFileInDataDirectories(filename, fullpath))
         {
-            auto texture = Texture::createFromFile(fullpath, true, useSrgb && isSrgbTextureRequired(slot));
+            auto texture = TextureCache::load(fullpath, true, useSrgb && isSrgbTextureRequired(slot));
             if (texture)
             {
                 setTexture(slot, texture);
@@ -504,6 +505,40 @@ namespace Falcor
         return true;
     }
 
+    size_t Material::getHash() const
+    {
+        // This must hash the same fields as operator==. Floats are hashed by value, so that -0 and +0 hash equally.
+        size_t hash = 0;
+        auto combine = [&hash](size_t h) { hash ^= h + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2); };
+        auto combineFloats = [&combine](const float* pValues, size_t count)
+        {
+            for (size_t i = 0; i < count; i++) combine(std::hash<float>()(pValues[i] == 0.f ? 0.f : pValues[i]));
+        };
+
+#define hash_field(_a) combineFloats(reinterpret_cast<const float*>(&mData._a), sizeof(mData._a) / sizeof(float))
+        hash_field(baseColor);
+        hash_field(specular);
+        hash_field(emissive);
+        hash_field(emissiveFactor);
+        hash_field(alphaThreshold);
+        hash_field(IoR);
+        hash_field(specularTransmission);
+        hash_field(volumeAbsorption);
+#undef hash_field
+        combine(std::hash<uint32_t>()(mData.flags));
+
+#define hash_texture(_a) combine(std::hash<Texture::SharedPtr>()(mResources._a))
+        hash_texture(baseColor);
+        hash_texture(specular);
+        hash_texture(emissive);
+        hash_texture(normalMap);
+        hash_texture(occlusionMap);
+        hash_texture(specularTransmission);
+#undef hash_texture
+        combine(std::hash<Sampler::SharedPtr>()(mResources.samplerState));
+        return hash;
+    }
+
     void Material::markUpdates(UpdateFlags updates)
     {
         mUpdates |= updates;
@@ -326,6 +326,11 @@ namespace Falcor
         */
         bool operator==(const Material& other) const;
 
+        /** Returns a hash of the material properties and the identities of the bound textures and sampler.
+            Materials that compare equal have the same hash. The name is not included.
+        */
+        size_t getHash() const;
+
         /** Bind a sampler to the material
         */
         void setSampler(Sampler::SharedPtr pSampler);
@@ -343,6 +348,8 @@ namespace Falcor
         const MaterialResources& getResources() const { return mResources; }
 
     private:
+        friend class SceneCache;
+
         void markUpdates(UpdateFlags updates);
 
         void setFlags(uint32_t flags);
@@ -112,8 +112,25 @@ namespace Falcor
 
     void Scene::render(RenderContext* pContext, GraphicsState* pState, GraphicsVars* pVars, RenderFlags flags)
     {
+        if (is_set(flags, RenderFlags::CullInstances))
+        {
+            render(pContext, pState, pVars, { Frustum::fromViewProjMatrix(getCamera()->getViewProjMatrix()) }, flags);
+            return;
+        }
+
         PROFILE("renderScene");
+        drawIndirect(pContext, pState, pVars, mDrawClockwiseMeshes, mDrawCounterClockwiseMeshes, flags);
+    }
 
+    void Scene::render(RenderContext* pContext, GraphicsState* pState, GraphicsVars* pVars, const std::vector<Frustum>& frustums, RenderFlags flags)
+    {
+        PROFILE("renderSceneCulled");
+        cullDrawList(frustums);
+        drawIndirect(pContext, pState, pVars, mCulledDrawClockwiseMeshes, mCulledDrawCounterClockwiseMeshes, flags);
+    }
+
+    void Scene::drawIndirect(RenderContext* pContext, GraphicsState* pState, GraphicsVars* pVars, const DrawArgs& drawClockwise, const DrawArgs& drawCounterClockwise, RenderFlags flags)
+    {
         pState->setVao(mpVao);
         pVars->setParameterBlock("gScene", mpSceneBlock);
 
@@ -121,23 +138,51 @@ namespace Falcor
         auto pCurrentRS = pState->getRasterizerState();
         bool isIndexed = hasIndexBuffer();
 
-        if (mDrawCounterClockwiseMeshes.count)
+        if (drawCounterClockwise.count)
         {
             if (overrideRS) pState->setRasterizerState(nullptr);
-            if (isIndexed) pContext->drawIndexedIndirect(pState, pVars, mDrawCounterClockwiseMeshes.count, mDrawCounterClockwiseMeshes.pBuffer.get(), 0, nullptr, 0);
-            else pContext->drawIndirect(pState, pVars, mDrawCounterClockwiseMeshes.count, mDrawCounterClockwiseMeshes.pBuffer.get(), 0, nullptr, 0);
+            if (isIndexed) pContext->drawIndexedIndirect(pState, pVars, drawCounterClockwise.count, drawCounterClockwise.pBuffer.get(), 0, nullptr, 0);
+            else pContext->drawIndirect(pState, pVars, drawCounterClockwise.count, drawCounterClockwise.pBuffer.get(), 0, nullptr, 0);
         }
 
-        if (mDrawClockwiseMeshes.count)
+        if (drawClockwise.count)
         {
             if (overrideRS) pState->setRasterizerState(mpFrontClockwiseRS);
-            if (isIndexed) pContext->drawIndexedIndirect(pState, pVars, mDrawClockwiseMeshes.count, mDrawClockwiseMeshes.pBuffer.get(), 0, nullptr, 0);
-            else pContext->drawIndirect(pState, pVars, mDrawClockwiseMeshes.count, mDrawClockwiseMeshes.pBuffer.get(), 0, nullptr, 0);
+            if (isIndexed) pContext->drawIndexedIndirect(pState, pVars, drawClockwise.count, drawClockwise.pBuffer.get(), 0, nullptr, 0);
+            else pContext->drawIndirect(pState, pVars, drawClockwise.count, drawClockwise.pBuffer.get(), 0, nullptr, 0);
         }
 
         if (overrideRS) pState->setRasterizerState(pCurrentRS);
     }
 
+    void Scene::cullDrawList(const std::vector<Frustum>& frustums)
+    {
+        PROFILE("cullDrawList");
+
+        // Skinned meshes are transformed on the GPU, their bounds are unknown on the CPU.
+        mVisibleInstances = mSkinnedInstances;
+        mInstanceBVH.queryFrustums(frustums, mVisibleInstances);
+        std::sort(mVisibleInstances.begin(), mVisibleInstances.end());
+        mVisibleInstances.erase(std::unique(mVisibleInstances.begin(), mVisibleInstances.end()), mVisibleInstances.end());
+
+        mCulledClockwiseArgs.clear();
+        mCulledCounterClockwiseArgs.clear();
+        for (uint32_t instanceID : mVisibleInstances)
+        {
+            auto& args = mInstanceDrawClockwise[instanceID] ? mCulledClockwiseArgs : mCulledCounterClockwiseArgs;
+            const uint8_t* pArgs = mInstanceDrawArgs.data() + (size_t)instanceID * mDrawArgsStride;
+            args.insert(args.end(), pArgs, pArgs + mDrawArgsStride);
+        }
+
+        auto upload = [this](DrawArgs& drawArgs, const std::vector<uint8_t>& args)
+        {
+            drawArgs.count = (uint32_t)(args.size() / mDrawArgsStride);
+            if (drawArgs.count) drawArgs.pBuffer->setBlob(args.data(), 0, args.size());
+        };
+        upload(mCulledDrawClockwiseMeshes, mCulledClockwiseArgs);
+        upload(mCulledDrawCounterClockwiseMeshes, mCulledCounterClockwiseArgs);
+    }
+
     void Scene::raytrace(RenderContext* pContext, RtProgram* pProgram, const std::shared_ptr<RtProgramVars>& pVars, uint3 dispatchDims)
     {
         PROFILE("raytraceScene");
@@ -231,22 +276,42 @@ namespace Falcor
 
     void Scene::updateBounds()
     {
+        PROFILE("updateBounds");
+
         const auto& globalMatrices = mpAnimationController->getGlobalMatrices();
-        std::vector<BoundingBox> instanceBBs;
-        instanceBBs.reserve(mMeshInstanceData.size());
+        bool rebuild = mInstanceBBs.size() != mMeshInstanceData.size();
+        mInstanceBBs.resize(mMeshInstanceData.size());
 
-        for (const auto& inst : mMeshInstanceData)
+        for (uint32_t i = 0; i < (uint32_t)mMeshInstanceData.size(); i++)
         {
-            const BoundingBox& meshBB = mMeshBBs[inst.meshID];
-            const glm::mat4& transform = globalMatrices[inst.globalMatrixID];
-            instanceBBs.push_back(meshBB.transform(transform));
+            const auto& inst = mMeshInstanceData[i];
+            if (!rebuild && !mpAnimationController->didMatrixChanged(inst.globalMatrixID)) continue;
+            mInstanceBBs[i] = mMeshBBs[inst.meshID].transform(globalMatrices[inst.globalMatrixID]);
+        }
+
+        if (rebuild)
+        {
+            mSkinnedInstances.clear();
+            for (uint32_t i = 0; i < (uint32_t)mMeshInstanceData.size(); i++)
+            {
+                if (mMeshHasDynamicData[mMeshInstanceData[i].meshID]) mSkinnedInstances.push_back(i);
+            }
+        }
+        else
+        {
+            // Refitting keeps the topology, which gets worse as instances move apart. Rebuild once it is no longer good enough.
+            mInstanceBVH.refit(mInstanceBBs);
+            rebuild = mInstanceBVH.getSAHCost() > 2.f * mInstanceBVHBuildCost;
         }
 
-        mSceneBB = instanceBBs.front();
-        for (const BoundingBox& bb : instanceBBs)
+        if (rebuild)
         {
-            mSceneBB = BoundingBox::fromUnion(mSceneBB, bb);
+            mInstanceBVH.build(mInstanceBBs);
+            mInstanceBVHBuildCost = mInstanceBVH.getSAHCost();
         }
+
+        BBox bounds = mInstanceBVH.getBounds();
+        mSceneBB = BoundingBox::fromMinMax(bounds.minPoint, bounds.maxPoint);
     }
 
     void Scene::updateMeshInstances(bool forceUpdate)
@@ -256,6 +321,8 @@ namespace Falcor
 
         for (auto& inst : mMeshInstanceData)
         {
+            if (!forceUpdate && !mpAnimationController->didMatrixChanged(inst.globalMatrixID)) continue;
+
             uint32_t prevFlags = inst.flags;
             inst.flags = (uint32_t)MeshInstanceFlags::None;
 
@@ -566,6 +633,7 @@ namespace Falcor
         {
             mTlasCache.clear();
             updateMeshInstances(false);
+            updateBounds();
         }
 
         // If a transform in the scene changed, update BLASes with skinned meshes
@@ -875,6 +943,12 @@ namespace Falcor
         mCurrentViewpoint = index;
     }
 
+    const Scene::EmissiveMeshGeometry* Scene::getEmissiveMeshGeometry(uint32_t meshID) const
+    {
+        if (meshID >= mEmissiveMeshGeometry.size() || mEmissiveMeshGeometry[meshID].positions.empty()) return nullptr;
+        return &mEmissiveMeshGeometry[meshID];
+    }
+
     Material::SharedPtr Scene::getMaterialByName(const std::string& name) const
     {
         for (const auto& m : mMaterials)
@@ -932,12 +1006,28 @@ namespace Falcor
 
             size_t drawCount = drawClockwiseMeshes.size() + drawCounterClockwiseMeshes.size();
             assert(drawCount <= std::numeric_limits<uint32_t>::max());
+
+            // Keep the draw arguments in mesh instance order for culling. The culled buffers are large enough to hold all draws.
+            mDrawArgsStride = (uint32_t)sizeof(drawClockwiseMeshes[0]);
+            mInstanceDrawArgs.resize(drawCount * mDrawArgsStride);
+            for (const auto& draw : drawClockwiseMeshes) std::memcpy(&mInstanceDrawArgs[draw.StartInstanceLocation * mDrawArgsStride], &draw, mDrawArgsStride);
+            for (const auto& draw : drawCounterClockwiseMeshes) std::memcpy(&mInstanceDrawArgs[draw.StartInstanceLocation * mDrawArgsStride], &draw, mDrawArgsStride);
+
+            auto createCulledBuffer = [&](DrawArgs& drawArgs, size_t count, const std::string& name)
+            {
+                if (count == 0) return;
+                drawArgs.pBuffer = Buffer::create(count * mDrawArgsStride, Resource::BindFlags::IndirectArg, Buffer::CpuAccess::None, nullptr);
+                drawArgs.pBuffer->setName(name);
+            };
+            createCulledBuffer(mCulledDrawClockwiseMeshes, drawClockwiseMeshes.size(), "Scene::mCulledDrawClockwiseMeshes::pBuffer");
+            createCulledBuffer(mCulledDrawCounterClockwiseMeshes, drawCounterClockwiseMeshes.size(), "Scene::mCulledDrawCounterClockwiseMeshes::pBuffer");
         };
 
         if (hasIndexBuffer())
         {
             std::vector<D3D12_DRAW_INDEXED_ARGUMENTS> drawClockwiseMeshes, drawCounterClockwiseMeshes;
 
+            mInstanceDrawClockwise.clear();
             for (const auto& instance : mMeshInstanceData)
             {
                 const auto& mesh = mMeshDesc[instance.meshID];
@@ -951,6 +1041,7 @@ namespace Falcor
                 draw.StartInstanceLocation = (uint32_t)(drawClockwiseMeshes.size() + drawCounterClockwiseMeshes.size());
 
                 (doesTransformFlip(transform)) ? drawClockwiseMeshes.push_back(draw) : drawCounterClockwiseMeshes.push_back(draw);
+                mInstanceDrawClockwise.push_back(doesTransformFlip(transform));
             }
             createBuffers(drawClockwiseMeshes, drawCounterClockwiseMeshes);
         }
@@ -958,6 +1049,7 @@ namespace Falcor
         {
             std::vector<D3D12_DRAW_ARGUMENTS> drawClockwiseMeshes, drawCounterClockwiseMeshes;
 
+            mInstanceDrawClockwise.clear();
             for (const auto& instance : mMeshInstanceData)
             {
                 const auto& mesh = mMeshDesc[instance.meshID];
@@ -971,6 +1063,7 @@ namespace Falcor
                 draw.StartInstanceLocation = (uint32_t)(drawClockwiseMeshes.size() + drawCounterClockwiseMeshes.size());
 
                 (doesTransformFlip(transform)) ? drawClockwiseMeshes.push_back(draw) : drawCounterClockwiseMeshes.push_back(draw);
+                mInstanceDrawClockwise.push_back(doesTransformFlip(transform));
             }
             createBuffers(drawClockwiseMeshes, drawCounterClockwiseMeshes);
         }
@@ -35,6 +35,7 @@
 #include "Utils/Math/AABB.h"
 #include "Animation/AnimationController.h"
 #include "Camera/CameraController.h"
+#include "Culling/InstanceBVH.h"
 #include "Experimental/Scene/Lights/LightCollection.h"
 #include "Experimental/Scene/Lights/EnvMap.h"
 #include "SceneTypes.slang"
@@ -104,12 +105,23 @@ namespace Falcor
             bool operator!=(const RenderSettings& other) const { return !(*this == other); }
         };
 
+        /** Object-space geometry of a mesh with an emissive material.
+            This is kept on the CPU so that the light collection can be built without reading data back from the GPU.
+            The triangles are non-indexed, with three vertices per triangle in the order of the mesh's triangles.
+        */
+        struct EmissiveMeshGeometry
+        {
+            std::vector<float3> positions;
+            std::vector<float2> texCrds;
+        };
+
         enum class RenderFlags
         {
             None                    = 0x0,
             UserRasterizerState     = 0x1,  ///< Use the rasterizer state currently bound to `pState`. If this flag is not set, the default rasterizer state will be used.
                                             ///< Note that we need to change the rasterizer state during rendering because some meshes have a negative scale factor, and hence the triangles will have a different winding order.
                                             ///< If such meshes exist, overriding the state may result in incorrect rendering output
+            CullInstances           = 0x2,  ///< Skip mesh instances whose bounds are outside the selected camera's view frustum. Culling runs on the CPU.
         };
 
         /** Flags indicating if and what was updated in the scene
@@ -261,6 +273,11 @@ namespace Falcor
         */
         const MeshDesc& getMesh(uint32_t meshID) const { return mMeshDesc[meshID]; }
 
+        /** Get the CPU copy of an emissive mesh's geometry.
+            \return The geometry, or nullptr if it isn't available. This is the case for non-emissive and skinned meshes.
+        */
+        const EmissiveMeshGeometry* getEmissiveMeshGeometry(uint32_t meshID) const;
+
         /** Get the number of mesh instances
         */
         uint32_t getMeshInstanceCount() const { return (uint32_t)mMeshInstanceData.size(); }
@@ -289,6 +306,12 @@ namespace Falcor
         */
         const BoundingBox& getSceneBounds() const { return mSceneBB; }
 
+        /** Get the bounding box hierarchy over the mesh instances.
+            Use it to find the mesh instances in a frustum, box, sphere or along a ray. The box indices are mesh instance IDs.
+            The hierarchy is refit when meshes move. Skinned meshes are included with their bind pose bounds.
+        */
+        const InstanceBVH& getInstanceBVH() const { return mInstanceBVH; }
+
         /** Get a mesh's bounds
         */
         const BoundingBox& getMeshBounds(uint32_t meshID) const { return mMeshBBs[meshID]; }
@@ -359,6 +382,12 @@ namespace Falcor
         */
         void render(RenderContext* pContext, GraphicsState* pState, GraphicsVars* pVars, RenderFlags flags = RenderFlags::None);
 
+        /** Render the mesh instances that intersect at least one of the given frustums using the rasterizer.
+            The instance bounds are culled on the CPU and the visible instances are drawn from compacted draw-argument buffers.
+            \param[in] frustums World space frustums, for example the frustum of each shadow cascade.
+        */
+        void render(RenderContext* pContext, GraphicsState* pState, GraphicsVars* pVars, const std::vector<Frustum>& frustums, RenderFlags flags = RenderFlags::None);
+
         /** Render the scene using raytracing
         */
         void raytrace(RenderContext* pContext, RtProgram* pProgram, const std::shared_ptr<RtProgramVars>& pVars, uint3 dispatchDims);
@@ -480,6 +509,10 @@ namespace Falcor
         */
         void createDrawList();
 
+        /** Update the culled draw-indirect buffers with the mesh instances that intersect the frustums.
+        */
+        void cullDrawList(const std::vector<Frustum>& frustums);
+
         /** Sort meshes into groups by transform. Updates mMeshInstances and mMeshGroups.
         */
         void sortMeshes();
@@ -560,6 +593,17 @@ namespace Falcor
             uint32_t count = 0;
         } mDrawClockwiseMeshes, mDrawCounterClockwiseMeshes;
 
+        // CPU culling
+        uint32_t mDrawArgsStride = 0;                               ///< Size of the draw arguments of a mesh instance.
+        std::vector<uint8_t> mInstanceDrawArgs;                     ///< Draw arguments of each mesh instance, in mesh instance order.
+        std::vector<bool> mInstanceDrawClockwise;                   ///< For each mesh instance, true if it is drawn from the clockwise list.
+        std::vector<uint32_t> mVisibleInstances;                    ///< Mesh instances that passed the last culling.
+        std::vector<uint8_t> mCulledClockwiseArgs;                  ///< Compacted draw arguments of the visible clockwise mesh instances.
+        std::vector<uint8_t> mCulledCounterClockwiseArgs;           ///< Compacted draw arguments of the visible counter-clockwise mesh instances.
+        DrawArgs mCulledDrawClockwiseMeshes, mCulledDrawCounterClockwiseMeshes;
+
+        void drawIndirect(RenderContext* pContext, GraphicsState* pState, GraphicsVars* pVars, const DrawArgs& drawClockwise, const DrawArgs& drawCounterClockwise, RenderFlags flags);
+
         static const uint32_t kInvalidNode = -1;
 
         struct Node
@@ -594,7 +638,12 @@ namespace Falcor
         std::vector<BoundingBox> mMeshBBs;                          ///< Bounding boxes for meshes (not instances)
         std::vector<std::vector<uint32_t>> mMeshIdToInstanceIds;    ///< Mapping of what instances belong to which mesh
         BoundingBox mSceneBB;                                       ///< Bounding boxes of the entire scene
+        std::vector<BoundingBox> mInstanceBBs;                      ///< World space bounding boxes of the mesh instances
+        InstanceBVH mInstanceBVH;                                   ///< Hierarchy over the mesh instance bounding boxes
+        float mInstanceBVHBuildCost = 0.f;                          ///< SAH cost of the instance BVH after the last build, used to decide when refitting is no longer good enough
+        std::vector<uint32_t> mSkinnedInstances;                    ///< Mesh instances of skinned meshes. Their bounds are only known in the bind pose
         std::vector<bool> mMeshHasDynamicData;                      ///< Whether a Mesh has dynamic data, meaning it is skinned
+        std::vector<EmissiveMeshGeometry> mEmissiveMeshGeometry;    ///< CPU copy of the geometry of emissive meshes, indexed by mesh ID. Empty for other meshes.
         SceneStats mSceneStats;                                     ///< Scene statistics.
         RenderSettings mRenderSettings;                             ///< Render settings.
         RenderSettings mPrevRenderSettings;
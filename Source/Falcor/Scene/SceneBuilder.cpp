@@ -28,6 +28,7 @@
 #include "stdafx.h"
 #include "SceneBuilder.h"
 #include "Importer.h"
+#include "SceneCache.h"
 #include "Utils/Math/MathConstants.slangh"
 #include "Utils/Timing/TimeReport.h"
 #include "../Externals/mikktspace/mikktspace.h"
@@ -41,14 +42,31 @@ namespace Falcor
         // We'll log a warning if the maximum quantization error exceeds this value.
         const float kMaxTexelError = 0.5f;
 
+        // Threshold for merging vertex attributes other than the position.
+        const float kVertexCompareThreshold = 1e-6f;
+
+        // Log messages deferred until the mesh is added to the scene.
+        using MessageList = std::vector<std::pair<Logger::Level, std::string>>;
+
+        void logMessage(Logger::Level level, const std::string& msg)
+        {
+            switch (level)
+            {
+            case Logger::Level::Info: logInfo(msg); break;
+            case Logger::Level::Warning: logWarning(msg); break;
+            case Logger::Level::Error: logError(msg); break;
+            default: logFatal(msg); break;
+            }
+        }
+
         class MikkTSpaceWrapper
         {
         public:
-            static std::vector<float4> generateTangents(const SceneBuilder::Mesh& mesh)
+            static std::vector<float4> generateTangents(const SceneBuilder::Mesh& mesh, MessageList& messages)
             {
                 if (!mesh.normals.pData || !mesh.positions.pData || !mesh.texCrds.pData || !mesh.pIndices)
                 {
-                    logWarning("Can't generate tangent space. The mesh '" + mesh.name + "' doesn't have positions/normals/texCrd/indices.");
+                    messages.push_back({ Logger::Level::Warning, "Can't generate tangent space. The mesh '" + mesh.name + "' doesn't have positions/normals/texCrd/indices." });
                     return {};
                 }
 
@@ -68,7 +86,7 @@ namespace Falcor
 
                 if (genTangSpaceDefault(&context) == false)
                 {
-                    logError("Failed to generate MikkTSpace tangents for the mesh '" + mesh.name + "'.");
+                    messages.push_back({ Logger::Level::Error, "Failed to generate MikkTSpace tangents for the mesh '" + mesh.name + "'." });
                     return {};
                 }
 
@@ -111,7 +129,7 @@ namespace Falcor
             if (isZero(v.normal) || isZero(v.tangent.xyz())) zeroCount++;
         }
 
-        bool compareVertices(const SceneBuilder::Mesh::Vertex& lhs, const SceneBuilder::Mesh::Vertex& rhs, float threshold = 1e-6f)
+        bool compareVertices(const SceneBuilder::Mesh::Vertex& lhs, const SceneBuilder::Mesh::Vertex& rhs, float threshold = kVertexCompareThreshold)
         {
             using namespace glm;
             if (lhs.position != rhs.position) return false; // Position need to be exact to avoid cracks
@@ -123,6 +141,162 @@ namespace Falcor
             if (any(greaterThan(abs(lhs.boneWeights - rhs.boneWeights), float4(threshold)))) return false;
             return true;
         }
+
+        using VertexList = std::vector<std::pair<SceneBuilder::Mesh::Vertex, uint32_t>>;
+
+        /** Merges identical vertices using a hash table of quantized vertex attributes.
+            Positions, tangent signs and bone IDs have to match exactly to avoid cracks. The other attributes are quantized
+            to cells of the size of the compareVertices() threshold, so merged vertices are always within the threshold.
+            Unlike the linked-list search, vertices are merged across original vertex indices. This keeps the cost linear
+            for meshes with face-varying attributes or without shared vertices.
+            The table is a flat open-addressing map with linear probing. Slots only store a vertex index and part of its hash,
+            candidates are compared against the merged vertex list. The slot array is taken from a per-thread pool and returned
+            to it when the welder is destroyed, so it is reused across meshes. Arrays larger than kMaxPooledSlots are freed instead.
+        */
+        class HashVertexWelder
+        {
+        public:
+            static constexpr uint32_t kInvalidIndex = 0xffffffff;
+            static constexpr size_t kMaxPooledSlots = 1 << 20;  ///< Largest slot array kept in the pool (8 MB).
+
+            /** Create a welder for a mesh.
+                \param[in] vertices List of merged vertices. The caller appends each vertex reported as inserted by insert().
+                \param[in] cornerCount Number of vertices that will be inserted.
+            */
+            HashVertexWelder(const VertexList& vertices, uint32_t cornerCount)
+                : mVertices(vertices)
+            {
+                uint32_t capacity = 16;
+                while (capacity < 2 * (uint64_t)cornerCount) capacity *= 2;
+                mSlots.swap(sSlotPool);
+                mSlots.assign(capacity, Slot());
+                mMask = capacity - 1;
+                mStats.inputVertexCount = cornerCount;
+            }
+
+            ~HashVertexWelder()
+            {
+                if (mSlots.capacity() <= kMaxPooledSlots) mSlots.swap(sSlotPool);
+            }
+
+            HashVertexWelder(const HashVertexWelder&) = delete;
+            HashVertexWelder& operator=(const HashVertexWelder&) = delete;
+
+            /** Find a vertex, or add it if it doesn't exist.
+                \param[in] v The vertex.
+                \param[out] inserted True if the vertex was added. The caller has to append it to the merged vertex list before the next call.
+                \return Index of the vertex in the merged vertex list.
+            */
+            uint32_t insert(const SceneBuilder::Mesh::Vertex& v, bool& inserted)
+            {
+                assert(mVertices.size() == mStats.outputVertexCount);
+                const Key key = makeKey(v);
+                const uint64_t hash = hashKey(key);
+                const uint32_t tag = (uint32_t)(hash >> 32);
+
+                uint32_t probeLength = 1;
+                uint32_t slot = (uint32_t)hash & mMask;
+                while (mSlots[slot].index != kInvalidIndex)
+                {
+                    uint32_t index = mSlots[slot].index;
+                    if (mSlots[slot].tag == tag && makeKey(mVertices[index].first) == key)
+                    {
+                        recordProbe(probeLength);
+                        inserted = false;
+                        return index;
+                    }
+                    slot = (slot + 1) & mMask;
+                    probeLength++;
+                }
+                recordProbe(probeLength);
+
+                assert(mStats.outputVertexCount < kInvalidIndex);
+                uint32_t index = (uint32_t)mStats.outputVertexCount++;
+                mSlots[slot] = { index, tag };
+                inserted = true;
+                return index;
+            }
+
+            /** Get the statistics for the mesh.
+            */
+            const SceneBuilder::VertexWeldingStats& getStats() const { return mStats; }
+
+        private:
+            struct Key
+            {
+                uint32_t exact[8];          ///< Position, tangent sign and bone IDs.
+                int64_t quantized[12];      ///< Normal, tangent, texture coordinate and bone weights.
+                bool operator==(const Key& other) const { return std::memcmp(this, &other, sizeof(Key)) == 0; }
+            };
+
+            static uint32_t exactBits(float x)
+            {
+                // Map -0 to +0 to match the floating-point comparison in compareVertices().
+                return x == 0.f ? 0u : asuint(x);
+            }
+
+            static int64_t quantize(float x)
+            {
+                const double q = std::floor((double)x * (1.0 / kVertexCompareThreshold));
+                // Values that can't be quantized (inf/nan and huge values) fall back to their bit pattern in a separate range.
+                if (!(std::abs(q) < 4.0e18)) return std::numeric_limits<int64_t>::min() + asuint(x);
+                return (int64_t)q;
+            }
+
+            static Key makeKey(const SceneBuilder::Mesh::Vertex& v)
+            {
+                Key key;
+                key.exact[0] = exactBits(v.position.x);
+                key.exact[1] = exactBits(v.position.y);
+                key.exact[2] = exactBits(v.position.z);
+                key.exact[3] = exactBits(v.tangent.w);
+                for (uint32_t i = 0; i < 4; i++) key.exact[4 + i] = v.boneIDs[i];
+                for (uint32_t i = 0; i < 3; i++) key.quantized[i] = quantize(v.normal[i]);
+                for (uint32_t i = 0; i < 3; i++) key.quantized[3 + i] = quantize(v.tangent[i]);
+                for (uint32_t i = 0; i < 2; i++) key.quantized[6 + i] = quantize(v.texCrd[i]);
+                for (uint32_t i = 0; i < 4; i++) key.quantized[8 + i] = quantize(v.boneWeights[i]);
+                return key;
+            }
+
+            static uint64_t hashKey(const Key& key)
+            {
+                auto mix = [](uint64_t h, uint64_t x)
+                {
+                    h ^= x + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+                    return h;
+                };
+                uint64_t h = 0;
+                for (uint32_t i = 0; i < 8; i += 2) h = mix(h, (uint64_t)key.exact[i] | ((uint64_t)key.exact[i + 1] << 32));
+                for (uint32_t i = 0; i < 12; i++) h = mix(h, (uint64_t)key.quantized[i]);
+
+                // Final avalanche so that the low bits used for the slot index depend on all attributes.
+                h ^= h >> 33;
+                h *= 0xff51afd7ed558ccdull;
+                h ^= h >> 33;
+                return h;
+            }
+
+            void recordProbe(uint32_t probeLength)
+            {
+                mStats.probeCount += probeLength;
+                mStats.maxProbeLength = std::max(mStats.maxProbeLength, probeLength);
+            }
+
+            struct Slot
+            {
+                uint32_t index = kInvalidIndex; ///< Index into the merged vertex list, or kInvalidIndex if the slot is empty.
+                uint32_t tag = 0;               ///< Upper 32 bits of the vertex hash, used to skip most key comparisons.
+            };
+
+            static thread_local std::vector<Slot> sSlotPool;
+
+            const VertexList& mVertices;
+            std::vector<Slot> mSlots;
+            uint32_t mMask = 0;
+            SceneBuilder::VertexWeldingStats mStats;
+        };
+
+        thread_local std::vector<HashVertexWelder::Slot> HashVertexWelder::sSlotPool;
     }
 
     SceneBuilder::SceneBuilder(Flags flags) : mFlags(flags) {};
@@ -140,7 +314,30 @@ namespace Falcor
 
     bool SceneBuilder::import(const std::string& filename, const InstanceMatrices& instances, const Dictionary& dict, const std::vector<Dictionary>& extraMaterials)
     {
+        // The cache only stores the result of importing a single asset without additional parameters.
+        uint64_t cacheKey = 0;
+        std::string cachePath;
+        std::string fullpath;
+        if (is_set(mFlags, Flags::UseCache) && instances.empty() && dict.size() == 0 && extraMaterials.empty() && SceneCache::isCacheableAsset(filename))
+        {
+            if (findFileInDataDirectories(filename, fullpath)) cacheKey = SceneCache::computeKey(fullpath, mFlags);
+            if (cacheKey != 0)
+            {
+                cachePath = SceneCache::getCachePath(cacheKey);
+                if (doesFileExist(cachePath) && SceneCache::read(cachePath, *this, cacheKey))
+                {
+                    logInfo("Loaded '" + filename + "' from scene cache '" + cachePath + "'.");
+                    mFilename = filename;
+                    return true;
+                }
+            }
+        }
+
+        // The cache file can only be written if the builder contains nothing but the imported asset.
+        const bool isEmpty = mSceneGraph.empty() && mMeshes.empty() && mMaterials.empty() && mCameras.empty() && mLights.empty() && mAnimations.empty();
+
         bool success = Importer::import(filename, *this, instances, dict, extraMaterials);
+        if (success && cacheKey != 0 && isEmpty) SceneCache::write(cachePath, *this, cacheKey, fullpath);
         mFilename = filename;
         return success;
     }
@@ -200,7 +397,46 @@ namespace Falcor
 
     uint32_t SceneBuilder::addMesh(const Mesh& meshDesc)
     {
-        logInfo("Adding mesh with name '" + meshDesc.name + "'");
+        return addProcessedMesh(processMesh(meshDesc));
+    }
+
+    std::vector<uint32_t> SceneBuilder::addMeshes(const std::vector<Mesh>& meshDescs)
+    {
+        // Process the meshes in parallel. Errors are recorded per mesh so that we can report the first failing mesh in order.
+        std::vector<ProcessedMesh> processedMeshes(meshDescs.size());
+        std::vector<std::exception_ptr> exceptions(meshDescs.size());
+        Threading::parallelFor(0, meshDescs.size(), [&](size_t i)
+        {
+            try
+            {
+                processedMeshes[i] = processMesh(meshDescs[i]);
+            }
+            catch (...)
+            {
+                exceptions[i] = std::current_exception();
+            }
+        }, 1);
+
+        // Append the meshes in order. This makes the buffer offsets and indices identical to adding the meshes one by one.
+        std::vector<uint32_t> meshIDs;
+        meshIDs.reserve(meshDescs.size());
+        for (size_t i = 0; i < processedMeshes.size(); i++)
+        {
+            if (exceptions[i]) std::rethrow_exception(exceptions[i]);
+            meshIDs.push_back(addProcessedMesh(processedMeshes[i]));
+            processedMeshes[i] = {}; // Release the memory early.
+        }
+        return meshIDs;
+    }
+
+    SceneBuilder::ProcessedMesh SceneBuilder::processMesh(const Mesh& meshDesc) const
+    {
+        ProcessedMesh processedMesh;
+        processedMesh.topology = meshDesc.topology;
+        processedMesh.pMaterial = meshDesc.pMaterial;
+
+        auto& messages = processedMesh.messages;
+        messages.push_back({ Logger::Level::Info, "Adding mesh with name '" + meshDesc.name + "'" });
 
         // Copy the mesh desc so we can update it. The caller retains the ownership of the data.
         Mesh mesh = meshDesc;
@@ -213,7 +449,7 @@ namespace Falcor
 
         auto missing_element_warning = [&](const std::string& element)
         {
-            logWarning("The mesh '" + mesh.name + "' is missing the element " + element + ". This is not an error, the element will be filled with zeros which may result in incorrect rendering.");
+            messages.push_back({ Logger::Level::Warning, "The mesh '" + mesh.name + "' is missing the element " + element + ". This is not an error, the element will be filled with zeros which may result in incorrect rendering." });
         };
 
         if (mesh.topology != Vao::Topology::TriangleList) throw std::runtime_error("Error when adding the mesh '" + mesh.name + "' to the scene.\nOnly triangle list topology is supported.");
@@ -238,7 +474,7 @@ namespace Falcor
         std::vector<float4> tangents;
         if (!is_set(mFlags, Flags::UseOriginalTangentSpace) || !mesh.tangents.pData)
         {
-            tangents = MikkTSpaceWrapper::generateTangents(mesh);
+            tangents = MikkTSpaceWrapper::generateTangents(mesh, messages);
             if (!tangents.empty())
             {
                 assert(tangents.size() == mesh.indexCount);
@@ -262,44 +498,75 @@ namespace Falcor
         // This ensures that adding to the linked lists do not require any dynamic memory allocation.
         //
         const uint32_t invalidIndex = 0xffffffff;
-        std::vector<std::pair<Mesh::Vertex, uint32_t>> vertices;
+        VertexList vertices;
         vertices.reserve(mesh.vertexCount);
         std::vector<uint32_t> indices(mesh.indexCount);
-        std::vector<uint32_t> heads(mesh.vertexCount, invalidIndex);
 
-        for (uint32_t face = 0; face < mesh.faceCount; face++)
+        if (is_set(mFlags, Flags::UseHashVertexWelding))
         {
-            for (uint32_t vert = 0; vert < 3; vert++)
+            // Merge vertices using a hash table, see HashVertexWelder.
+            HashVertexWelder welder(vertices, mesh.indexCount);
+            for (uint32_t face = 0; face < mesh.faceCount; face++)
             {
-                const Mesh::Vertex v = mesh.getVertex(face, vert);
-                const uint32_t origIndex = mesh.pIndices[face * 3 + vert];
-
-                // Iterate over vertex list to check if it already exists.
-                assert(origIndex < heads.size());
-                uint32_t index = heads[origIndex];
-                bool found = false;
-
-                while (index != invalidIndex)
+                for (uint32_t vert = 0; vert < 3; vert++)
                 {
-                    if (compareVertices(v, vertices[index].first))
+                    const Mesh::Vertex v = mesh.getVertex(face, vert);
+                    bool inserted = false;
+                    uint32_t index = welder.insert(v, inserted);
+                    if (inserted)
                     {
-                        found = true;
-                        break;
+                        assert(index == vertices.size());
+                        vertices.push_back({ v, invalidIndex });
                     }
-                    index = vertices[index].second;
+                    indices[face * 3 + vert] = index;
                 }
+            }
+            processedMesh.weldingStats = welder.getStats();
 
-                // Insert new vertex if we couldn't find it.
-                if (!found)
+            const auto& stats = processedMesh.weldingStats;
+            std::ostringstream oss;
+            oss << "Welded mesh '" << mesh.name << "' from " << stats.inputVertexCount << " to " << stats.outputVertexCount << " vertices, average probe length "
+                << (double)stats.probeCount / std::max(stats.inputVertexCount, (uint64_t)1) << ", maximum probe length " << stats.maxProbeLength << ".";
+            messages.push_back({ Logger::Level::Info, oss.str() });
+        }
+        else
+        {
+            std::vector<uint32_t> heads(mesh.vertexCount, invalidIndex);
+
+            for (uint32_t face = 0; face < mesh.faceCount; face++)
+            {
+                for (uint32_t vert = 0; vert < 3; vert++)
                 {
-                    assert(vertices.size() < std::numeric_limits<uint32_t>::max());
-                    index = (uint32_t)vertices.size();
-                    vertices.push_back({ v, heads[origIndex] });
-                    heads[origIndex] = index;
-                }
+                    const Mesh::Vertex v = mesh.getVertex(face, vert);
+                    const uint32_t origIndex = mesh.pIndices[face * 3 + vert];
+
+                    // Iterate over vertex list to check if it already exists.
+                    assert(origIndex < heads.size());
+                    uint32_t index = heads[origIndex];
+                    bool found = false;
+
+                    while (index != invalidIndex)
+                    {
+                        if (compareVertices(v, vertices[index].first))
+                        {
+                            found = true;
+                            break;
+                        }
+                        index = vertices[index].second;
+                    }
 
-                // Store new vertex index.
-                indices[face * 3 + vert] = index;
+                    // Insert new vertex if we couldn't find it.
+                    if (!found)
+                    {
+                        assert(vertices.size() < std::numeric_limits<uint32_t>::max());
+                        index = (uint32_t)vertices.size();
+                        vertices.push_back({ v, heads[origIndex] });
+                        heads[origIndex] = index;
+                    }
+
+                    // Store new vertex index.
+                    indices[face * 3 + vert] = index;
+                }
             }
         }
 
@@ -307,7 +574,7 @@ namespace Falcor
         assert(indices.size() == mesh.indexCount);
         if (vertices.size() != mesh.vertexCount)
         {
-            logInfo("Mesh with name '" + mesh.name + "' had original vertex count " + std::to_string(mesh.vertexCount) + ", new vertex count " + std::to_string(vertices.size()));
+            messages.push_back({ Logger::Level::Info, "Mesh with name '" + mesh.name + "' had original vertex count " + std::to_string(mesh.vertexCount) + ", new vertex count " + std::to_string(vertices.size()) });
         }
 
         // Validate vertex data to check for invalid numbers and missing tangent frame.
@@ -317,8 +584,8 @@ namespace Falcor
         {
             validateVertex(v.first, invalidCount, zeroCount);
         }
-        if (invalidCount > 0) logWarning("The mesh '" + mesh.name + "' has inf/nan vertex attributes at " + std::to_string(invalidCount) + " vertices. Please fix the asset.");
-        if (zeroCount > 0) logWarning("The mesh '" + mesh.name + "' has zero-length normals/tangents at " + std::to_string(zeroCount) + " vertices. Please fix the asset.");
+        if (invalidCount > 0) messages.push_back({ Logger::Level::Warning, "The mesh '" + mesh.name + "' has inf/nan vertex attributes at " + std::to_string(invalidCount) + " vertices. Please fix the asset." });
+        if (zeroCount > 0) messages.push_back({ Logger::Level::Warning, "The mesh '" + mesh.name + "' has zero-length normals/tangents at " + std::to_string(zeroCount) + " vertices. Please fix the asset." });
 
         // Match texture coordinate quantization for textured emissives to match PackedEmissiveTriangle.
         // This is to avoid mismatch when sampling and evaluating emissive triangles.
@@ -341,7 +608,7 @@ namespace Falcor
             float2 maxAbsCrd = max(abs(minTexCrd), abs(maxTexCrd));
             if (maxAbsCrd.x > HLF_MAX || maxAbsCrd.y > HLF_MAX)
             {
-                logWarning("Texture coordinates for emissive textured mesh '" + mesh.name + "' are outside the representable range, expect rendering errors.");
+                messages.push_back({ Logger::Level::Warning, "Texture coordinates for emissive textured mesh '" + mesh.name + "' are outside the representable range, expect rendering errors." });
             }
             else
             {
@@ -357,44 +624,19 @@ namespace Falcor
                     oss << "Texture coordinates for emissive textured mesh '" << mesh.name << "' have a large quantization error of " << maxTexelError << " texels. "
                         << "The coordinate range is [" << minTexCrd.x << ", " << maxTexCrd.x << "] x [" << minTexCrd.y << ", " << maxTexCrd.y << "] for maximum texture dimensions ("
                         << maxTexDim.x << ", " << maxTexDim.y << ").";
-                    logWarning(oss.str());
+                    messages.push_back({ Logger::Level::Warning, oss.str() });
                 }
             }
         }
 
-        // Add the mesh to the scene.
-        // If the non-indexed vertices build flag is set, we will de-index the data below.
+        // Pack the vertex data.
+        // If the non-indexed vertices build flag is set, we will de-index the data here.
         const bool isIndexed = !is_set(mFlags, Flags::NonIndexedVertices);
         const uint32_t outputVertexCount = isIndexed ? (uint32_t)vertices.size() : mesh.indexCount;
 
-        mMeshes.push_back({});
-        MeshSpec& spec = mMeshes.back();
-        assert(mBuffersData.staticData.size() <= std::numeric_limits<uint32_t>::max() && mBuffersData.dynamicData.size() <= std::numeric_limits<uint32_t>::max() && mBuffersData.indices.size() <= std::numeric_limits<uint32_t>::max());
-        spec.staticVertexOffset = (uint32_t)mBuffersData.staticData.size();
-        spec.dynamicVertexOffset = (uint32_t)mBuffersData.dynamicData.size();
+        processedMesh.staticData.reserve(outputVertexCount);
+        if (mesh.hasBones()) processedMesh.dynamicData.reserve(outputVertexCount);
 
-        if (isIndexed)
-        {
-            spec.indexOffset = (uint32_t)mBuffersData.indices.size();
-            spec.indexCount = mesh.indexCount;
-        }
-
-        spec.vertexCount = outputVertexCount;
-        spec.topology = mesh.topology;
-        spec.materialId = addMaterial(mesh.pMaterial, is_set(mFlags, Flags::RemoveDuplicateMaterials));
-
-        if (mesh.hasBones())
-        {
-            spec.hasDynamicData = true;
-        }
-
-        // Copy indices into global index array.
-        if (isIndexed)
-        {
-            mBuffersData.indices.insert(mBuffersData.indices.end(), indices.begin(), indices.end());
-        }
-
-        // Copy vertices into global vertex arrays.
         for (uint32_t i = 0; i < outputVertexCount; i++)
         {
             uint32_t index = isIndexed ? i : indices[i];
@@ -406,19 +648,67 @@ namespace Falcor
             s.normal = v.normal;
             s.texCrd = v.texCrd;
             s.tangent = v.tangent;
-            mBuffersData.staticData.push_back(PackedStaticVertexData(s));
+            processedMesh.staticData.push_back(PackedStaticVertexData(s));
 
             if (mesh.hasBones())
             {
                 DynamicVertexData d;
                 d.boneWeight = v.boneWeights;
                 d.boneID = v.boneIDs;
-                d.staticIndex = (uint32_t)mBuffersData.staticData.size() - 1;
+                d.staticIndex = i; // This will be offset by the mesh's static vertex offset in addProcessedMesh()
                 d.globalMatrixID = 0; // This will be initialized in createMeshData()
-                mBuffersData.dynamicData.push_back(d);
+                processedMesh.dynamicData.push_back(d);
             }
         }
 
+        if (isIndexed) processedMesh.indices = std::move(indices);
+
+        return processedMesh;
+    }
+
+    uint32_t SceneBuilder::addProcessedMesh(const ProcessedMesh& mesh)
+    {
+        for (const auto& [level, msg] : mesh.messages) logMessage(level, msg);
+
+        mVertexWeldingStats.inputVertexCount += mesh.weldingStats.inputVertexCount;
+        mVertexWeldingStats.outputVertexCount += mesh.weldingStats.outputVertexCount;
+        mVertexWeldingStats.probeCount += mesh.weldingStats.probeCount;
+        mVertexWeldingStats.maxProbeLength = std::max(mVertexWeldingStats.maxProbeLength, mesh.weldingStats.maxProbeLength);
+
+        // Add the mesh to the scene.
+        const bool isIndexed = !mesh.indices.empty();
+
+        mMeshes.push_back({});
+        MeshSpec& spec = mMeshes.back();
+        assert(mBuffersData.staticData.size() <= std::numeric_limits<uint32_t>::max() && mBuffersData.dynamicData.size() <= std::numeric_limits<uint32_t>::max() && mBuffersData.indices.size() <= std::numeric_limits<uint32_t>::max());
+        spec.staticVertexOffset = (uint32_t)mBuffersData.staticData.size();
+        spec.dynamicVertexOffset = (uint32_t)mBuffersData.dynamicData.size();
+
+        if (isIndexed)
+        {
+            spec.indexOffset = (uint32_t)mBuffersData.indices.size();
+            spec.indexCount = (uint32_t)mesh.indices.size();
+        }
+
+        spec.vertexCount = (uint32_t)mesh.staticData.size();
+        spec.topology = mesh.topology;
+        spec.materialId = addMaterial(mesh.pMaterial, is_set(mFlags, Flags::RemoveDuplicateMaterials));
+
+        if (!mesh.dynamicData.empty())
+        {
+            spec.hasDynamicData = true;
+        }
+
+        // Copy indices and vertices into the global arrays.
+        mBuffersData.indices.insert(mBuffersData.indices.end(), mesh.indices.begin(), mesh.indices.end());
+        mBuffersData.staticData.insert(mBuffersData.staticData.end(), mesh.staticData.begin(), mesh.staticData.end());
+
+        for (DynamicVertexData d : mesh.dynamicData)
+        {
+            d.staticIndex += spec.staticVertexOffset;
+            mBuffersData.dynamicData.push_back(d);
+        }
+
         mDirty = true;
 
         assert(mMeshes.size() <= std::numeric_limits<uint32_t>::max());
@@ -430,20 +720,23 @@ namespace Falcor
         assert(pMaterial);
 
         // Reuse previously added materials
-        if (auto it = std::find(mMaterials.begin(), mMaterials.end(), pMaterial); it != mMaterials.end())
+        if (auto it = mMaterialToId.find(pMaterial.get()); it != mMaterialToId.end())
         {
-            return (uint32_t)std::distance(mMaterials.begin(), it);
+            return it->second;
         }
 
-        // Try to find previously added material with equal properties (duplicate)
-        if (auto it = std::find_if(mMaterials.begin(), mMaterials.end(), [&pMaterial] (const auto& m) { return *m == *pMaterial; }); it != mMaterials.end())
+        // Try to find previously added material with equal properties (duplicate).
+        // Only materials with the same hash can be equal. The bucket is in insertion order, so this finds the first equal material as a linear search would.
+        // Note that the hash is taken when a material is added, so materials should not be modified after adding them.
+        auto& bucket = mMaterialHashToIds[pMaterial->getHash()];
+        if (auto it = std::find_if(bucket.begin(), bucket.end(), [this, &pMaterial] (uint32_t id) { return *mMaterials[id] == *pMaterial; }); it != bucket.end())
         {
-            const auto& equalMaterial = *it;
+            const auto& equalMaterial = mMaterials[*it];
 
             // ASSIMP sometimes creates internal copies of a material: Always de-duplicate if name and properties are equal.
             if (removeDuplicate || pMaterial->getName() == equalMaterial->getName())
             {
-                return (uint32_t)std::distance(mMaterials.begin(), it);
+                return *it;
             }
             else
             {
@@ -454,7 +747,10 @@ namespace Falcor
         mDirty = true;
         mMaterials.push_back(pMaterial);
         assert(mMaterials.size() <= std::numeric_limits<uint32_t>::max());
-        return (uint32_t)mMaterials.size() - 1;
+        const uint32_t materialID = (uint32_t)mMaterials.size() - 1;
+        mMaterialToId[pMaterial.get()] = materialID;
+        bucket.push_back(materialID);
+        return materialID;
     }
 
     uint32_t SceneBuilder::addCamera(const Camera::SharedPtr& pCamera)
@@ -635,6 +931,7 @@ namespace Falcor
         assert(drawCount <= std::numeric_limits<uint32_t>::max()); // FIXME: it should be: 1 << kMatrixBits
         mpScene->mpVao = createVao(drawCount);
         calculateMeshBoundingBoxes(mpScene.get());
+        captureEmissiveGeometry(mpScene.get());
         createAnimationController(mpScene.get());
         mpScene->finalize();
         mDirty = false;
@@ -666,6 +963,35 @@ namespace Falcor
         }
     }
 
+    void SceneBuilder::captureEmissiveGeometry(Scene* pScene)
+    {
+        // Keep a non-indexed copy of the emissive meshes, so that LightCollection can build its triangle list on the CPU.
+        // Skinned meshes are skipped, their vertices are only known after skinning on the GPU.
+        auto& geometry = pScene->mEmissiveMeshGeometry;
+        geometry.clear();
+        geometry.resize(mMeshes.size());
+
+        Threading::parallelFor(0, mMeshes.size(), [&](size_t meshID)
+        {
+            const auto& mesh = mMeshes[meshID];
+            if (mesh.hasDynamicData || mesh.topology != Vao::Topology::TriangleList || !mMaterials[mesh.materialId]->isEmissive()) return;
+
+            const uint32_t* pIndices = mesh.indexCount > 0 ? &mBuffersData.indices[mesh.indexOffset] : nullptr;
+            const auto* pStaticData = &mBuffersData.staticData[mesh.staticVertexOffset];
+            const uint32_t vertexCount = mesh.indexCount > 0 ? mesh.indexCount : mesh.vertexCount;
+
+            auto& meshGeometry = geometry[meshID];
+            meshGeometry.positions.resize(vertexCount);
+            meshGeometry.texCrds.resize(vertexCount);
+            for (uint32_t i = 0; i < vertexCount; i++)
+            {
+                const auto& vertex = pStaticData[pIndices ? pIndices[i] : i];
+                meshGeometry.positions[i] = vertex.position;
+                meshGeometry.texCrds[i] = vertex.texCrd;
+            }
+        }, 1);
+    }
+
     void SceneBuilder::addAnimation(const Animation::SharedPtr& pAnimation)
     {
         mAnimations.push_back(pAnimation);
@@ -693,6 +1019,8 @@ namespace Falcor
         flags.value("UseSpecGlossMaterials", SceneBuilder::Flags::UseSpecGlossMaterials);
         flags.value("UseMetalRoughMaterials", SceneBuilder::Flags::UseMetalRoughMaterials);
         flags.value("NonIndexedVertices", SceneBuilder::Flags::NonIndexedVertices);
+        flags.value("UseHashVertexWelding", SceneBuilder::Flags::UseHashVertexWelding);
+        flags.value("UseCache", SceneBuilder::Flags::UseCache);
         ScriptBindings::addEnumBinaryOperators(flags);
     }
 }
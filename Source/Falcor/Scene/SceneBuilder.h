@@ -49,6 +49,8 @@ namespace Falcor
             UseSpecGlossMaterials       = 0x20,   ///< Set materials to use Spec-Gloss shading model. Otherwise default is Spec-Gloss for OBJ, Metal-Rough for everything else.
             UseMetalRoughMaterials      = 0x40,   ///< Set materials to use Metal-Rough shading model. Otherwise default is Spec-Gloss for OBJ, Metal-Rough for everything else.
             NonIndexedVertices          = 0x80,   ///< Convert meshes to use non-indexed vertices. This requires more memory but may increase performance.
+            UseHashVertexWelding        = 0x100,  ///< Merge identical vertices using a hash table instead of searching the vertices that share an original vertex index. This also merges vertices with different indices, and is faster for meshes with face-varying attributes.
+            UseCache                    = 0x200,  ///< Store imported assets in a binary scene cache and load them from the cache on subsequent imports. See SceneCache.
 
             Default = None
         };
@@ -143,6 +145,16 @@ namespace Falcor
             }
         };
 
+        /** Statistics of the hash-based vertex welding. See Flags::UseHashVertexWelding.
+        */
+        struct VertexWeldingStats
+        {
+            uint64_t inputVertexCount = 0;      ///< Number of vertices before welding (three per face).
+            uint64_t outputVertexCount = 0;     ///< Number of unique vertices after welding.
+            uint64_t probeCount = 0;            ///< Total number of hash table slots visited.
+            uint32_t maxProbeLength = 0;        ///< Largest number of slots visited for a single vertex.
+        };
+
         static const uint32_t kInvalidNode = Scene::kInvalidNode;
 
         struct Node
@@ -206,6 +218,19 @@ namespace Falcor
         */
         uint32_t addMesh(const Mesh& meshDesc);
 
+        /** Add a batch of meshes.
+            The tangent generation, vertex merging and packing are done for all meshes in parallel. The meshes are then added in order,
+            so the result is identical to calling addMesh() for each mesh in turn. This function will throw an exception if something went wrong,
+            in which case the meshes before the first failing one have been added.
+            \param meshDescs The meshes' descriptions.
+            \return The IDs of the meshes in the scene, in the same order as the descriptions.
+        */
+        std::vector<uint32_t> addMeshes(const std::vector<Mesh>& meshDescs);
+
+        /** Get the number of materials. Materials are added with the meshes, and duplicates are merged.
+        */
+        size_t getMaterialCount() const { return mMaterials.size(); }
+
         /** Add a light source
             \param pLight The light object.
             \return The light ID
@@ -245,6 +270,10 @@ namespace Falcor
         */
         Flags getFlags() const { return mFlags; }
 
+        /** Get the vertex welding statistics accumulated over all added meshes. Only collected if Flags::UseHashVertexWelding is set.
+        */
+        const VertexWeldingStats& getVertexWeldingStats() const { return mVertexWeldingStats; }
+
         /** Add an animation
             \param animation The animation
         */
@@ -255,6 +284,8 @@ namespace Falcor
         void setCameraSpeed(float speed) { mCameraSpeed = speed; }
 
     private:
+        friend class SceneCache;
+
         SceneBuilder(Flags buildFlags);
 
         struct InternalNode : Node
@@ -279,6 +310,19 @@ namespace Falcor
             std::vector<uint32_t> instances; // Node IDs
         };
 
+        /** Mesh after tangent generation, vertex merging and packing, ready to be appended to the global buffers.
+        */
+        struct ProcessedMesh
+        {
+            Vao::Topology topology = Vao::Topology::Undefined;
+            Material::SharedPtr pMaterial;
+            std::vector<uint32_t> indices;                      ///< Mesh-local indices. Empty if the mesh is non-indexed.
+            std::vector<PackedStaticVertexData> staticData;
+            std::vector<DynamicVertexData> dynamicData;         ///< Dynamic vertex data with mesh-local static indices. Empty if the mesh has no bones.
+            VertexWeldingStats weldingStats;
+            std::vector<std::pair<Logger::Level, std::string>> messages; ///< Messages logged when the mesh is added, so that they appear in order when meshes are processed in parallel.
+        };
+
         // Geometry data
         struct BuffersData
         {
@@ -297,8 +341,10 @@ namespace Falcor
         const Flags mFlags;
 
         MeshList mMeshes;
+        VertexWeldingStats mVertexWeldingStats;
         std::vector<Material::SharedPtr> mMaterials;
         std::unordered_map<const Material*, uint32_t> mMaterialToId;
+        std::unordered_map<size_t, std::vector<uint32_t>> mMaterialHashToIds;     ///< Material IDs by Material::getHash(), in the order the materials were added.
 
         std::vector<Camera::SharedPtr> mCameras;
         std::vector<Light::SharedPtr> mLights;
@@ -308,12 +354,15 @@ namespace Falcor
         uint32_t mSelectedCamera = 0;
         float mCameraSpeed = 1.0f;
 
+        ProcessedMesh processMesh(const Mesh& meshDesc) const;
+        uint32_t addProcessedMesh(const ProcessedMesh& mesh);
         uint32_t addMaterial(const Material::SharedPtr& pMaterial, bool removeDuplicate);
         Vao::SharedPtr createVao(uint32_t drawCount);
 
         uint32_t createMeshData(Scene* pScene);
         void createGlobalMatricesBuffer(Scene* pScene);
         void calculateMeshBoundingBoxes(Scene* pScene);
+        void captureEmissiveGeometry(Scene* pScene);
         void createAnimationController(Scene* pScene);
         std::string mFilename;
     };
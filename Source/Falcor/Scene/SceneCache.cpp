@@ -0,0 +1,891 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "SceneCache.h"
+#include "Importer.h"
+#include "Utils/Timing/TimeReport.h"
+#include "Utils/Image/TextureCache.h"
+#include <filesystem>
+
+namespace Falcor
+{
+    const char* SceneCache::kFileExtension = "fcache";
+
+    namespace
+    {
+        const char kMagic[8] = { 'F', 'C', 'A', 'C', 'H', 'E', '\0', '\0' };
+        const uint64_t kSectionAlignment = 16;
+        const uint32_t kInvalidIndex = uint32_t(-1);
+
+        enum class Section : uint32_t
+        {
+            Indices,
+            StaticVertexData,
+            DynamicVertexData,
+            SceneData,
+
+            Count // Must be last
+        };
+
+        struct FileHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t sectionCount;
+            uint64_t key;
+            uint64_t fileSize;
+        };
+
+        struct SectionDesc
+        {
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        const uint64_t kDataOffset = (sizeof(FileHeader) + sizeof(SectionDesc) * (size_t)Section::Count + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+
+        uint64_t fnv1a(const void* pData, size_t size, uint64_t hash = 14695981039346656037ull)
+        {
+            const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pData);
+            for (size_t i = 0; i < size; i++)
+            {
+                hash ^= pBytes[i];
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+
+        /** File a cache file depends on, identified by its size and last write time.
+        */
+        struct Dependency
+        {
+            std::string path;
+            uint64_t size = 0;
+            uint64_t writeTime = 0;
+        };
+
+        bool getFileStamp(const std::filesystem::path& path, uint64_t& size, uint64_t& writeTime)
+        {
+            std::error_code ec;
+            size = std::filesystem::file_size(path, ec);
+            if (ec) return false;
+            auto time = std::filesystem::last_write_time(path, ec);
+            if (ec) return false;
+            writeTime = (uint64_t)time.time_since_epoch().count();
+            return true;
+        }
+
+        /** Appends plain-old-data values to a byte stream.
+        */
+        class DataWriter
+        {
+        public:
+            void writeBytes(const void* pData, size_t size)
+            {
+                const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pData);
+                mData.insert(mData.end(), pBytes, pBytes + size);
+            }
+
+            template<typename T>
+            void write(const T& value) { writeBytes(&value, sizeof(T)); }
+
+            void writeString(const std::string& str)
+            {
+                write((uint32_t)str.size());
+                writeBytes(str.data(), str.size());
+            }
+
+            template<typename T>
+            void writeVector(const std::vector<T>& vec)
+            {
+                write((uint64_t)vec.size());
+                writeBytes(vec.data(), vec.size() * sizeof(T));
+            }
+
+            const std::vector<uint8_t>& getData() const { return mData; }
+
+        private:
+            std::vector<uint8_t> mData;
+        };
+
+        /** Reads plain-old-data values from a byte stream. Throws if reading past the end of the stream.
+        */
+        class DataReader
+        {
+        public:
+            DataReader(const uint8_t* pData, size_t size) : mpData(pData), mSize(size) {}
+
+            void readBytes(void* pDst, size_t size)
+            {
+                if (size > mSize - mOffset) throw std::runtime_error("Unexpected end of scene data");
+                std::memcpy(pDst, mpData + mOffset, size);
+                mOffset += size;
+            }
+
+            template<typename T>
+            T read()
+            {
+                T value;
+                readBytes(&value, sizeof(T));
+                return value;
+            }
+
+            std::string readString()
+            {
+                std::string str(read<uint32_t>(), '\0');
+                readBytes(str.data(), str.size());
+                return str;
+            }
+
+            template<typename T>
+            std::vector<T> readVector()
+            {
+                uint64_t count = read<uint64_t>();
+                if (count > (mSize - mOffset) / sizeof(T)) throw std::runtime_error("Unexpected end of scene data");
+                std::vector<T> vec((size_t)count);
+                readBytes(vec.data(), vec.size() * sizeof(T));
+                return vec;
+            }
+
+            bool isEnd() const { return mOffset == mSize; }
+
+        private:
+            const uint8_t* mpData;
+            size_t mSize;
+            size_t mOffset = 0;
+        };
+
+        /** Read-only view of an array stored in the mapped cache file.
+        */
+        template<typename T>
+        struct ArrayView
+        {
+            const T* pData = nullptr;
+            size_t count = 0;
+
+            const T* begin() const { return pData; }
+            const T* end() const { return pData + count; }
+        };
+
+        /** RAII wrapper of a mapped file.
+        */
+        class MappedFile
+        {
+        public:
+            MappedFile(const std::string& filename) { mpData = reinterpret_cast<const uint8_t*>(mapFileForReading(filename, mSize)); }
+            ~MappedFile() { unmapFile(mpData, mSize); }
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            const uint8_t* getData() const { return mpData; }
+            size_t getSize() const { return mSize; }
+
+        private:
+            const uint8_t* mpData = nullptr;
+            size_t mSize = 0;
+        };
+
+        const Material::TextureSlot kTextureSlots[] =
+        {
+            Material::TextureSlot::BaseColor,
+            Material::TextureSlot::Specular,
+            Material::TextureSlot::Emissive,
+            Material::TextureSlot::Normal,
+            Material::TextureSlot::Occlusion,
+            Material::TextureSlot::SpecularTransmission,
+        };
+        static_assert(arraysize(kTextureSlots) == (size_t)Material::TextureSlot::Count);
+    }
+
+    uint64_t SceneCache::computeKey(const std::string& filename, SceneBuilder::Flags flags)
+    {
+        // The asset is identified by its path, size and last write time. Referenced files are validated when reading the cache file.
+        uint64_t size, writeTime;
+        if (!getFileStamp(filename, size, writeTime)) return 0;
+
+        const std::string path = std::filesystem::absolute(filename).lexically_normal().string();
+        uint64_t key = fnv1a(path.data(), path.size());
+        key = fnv1a(&size, sizeof(size), key);
+        key = fnv1a(&writeTime, sizeof(writeTime), key);
+        uint32_t flagBits = (uint32_t)(flags & ~SceneBuilder::Flags::UseCache);
+        key = fnv1a(&flagBits, sizeof(flagBits), key);
+        key = fnv1a(&kVersion, sizeof(kVersion), key);
+        return key != 0 ? key : 1;
+    }
+
+    std::string SceneCache::getCachePath(uint64_t key)
+    {
+        char name[17];
+        snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+        return getAppDataDirectory() + "/NVIDIA/Falcor/SceneCache/" + name + "." + kFileExtension;
+    }
+
+    bool SceneCache::isCacheableAsset(const std::string& filename)
+    {
+        auto ext = getExtensionFromFile(filename);
+        return ext != "pyscene" && ext != "fscene" && ext != kFileExtension;
+    }
+
+    bool SceneCache::isCacheable(const SceneBuilder& builder, std::string& reason)
+    {
+        if (builder.mpLightProbe || builder.mpEnvMap)
+        {
+            reason = "light probes and environment maps are not supported";
+            return false;
+        }
+
+        for (const auto& pLight : builder.mLights)
+        {
+            if (pLight->getType() != LightType::Point && pLight->getType() != LightType::Directional)
+            {
+                reason = "light '" + pLight->getName() + "' is not a point or directional light";
+                return false;
+            }
+        }
+
+        for (const auto& pMaterial : builder.mMaterials)
+        {
+            if (pMaterial->getSampler())
+            {
+                reason = "material '" + pMaterial->getName() + "' has a custom sampler";
+                return false;
+            }
+
+            for (auto slot : kTextureSlots)
+            {
+                auto pTexture = pMaterial->getTexture(slot);
+                if (pTexture && pTexture->getSourceFilename().empty())
+                {
+                    reason = "material '" + pMaterial->getName() + "' has a texture that was not loaded from a file";
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool SceneCache::write(const std::string& path, const SceneBuilder& builder, uint64_t key, const std::string& assetPath)
+    {
+        std::string reason;
+        if (!isCacheable(builder, reason))
+        {
+            logInfo("Not writing scene cache '" + path + "', " + reason + ".");
+            return false;
+        }
+
+        // Collect the files the imported content depends on. Files referenced by the asset (e.g. .mtl or .bin files) are not
+        // reported by the importers, so all files next to the asset are recorded. Textures are recorded individually.
+        std::vector<std::string> dependencyPaths;
+        std::error_code ec;
+        if (!assetPath.empty())
+        {
+            for (const auto& entry : std::filesystem::directory_iterator(std::filesystem::path(assetPath).parent_path(), ec))
+            {
+                if (entry.is_regular_file(ec)) dependencyPaths.push_back(entry.path().string());
+            }
+        }
+        for (const auto& pMaterial : builder.mMaterials)
+        {
+            for (auto slot : kTextureSlots)
+            {
+                auto pTexture = pMaterial->getTexture(slot);
+                if (pTexture) dependencyPaths.push_back(pTexture->getSourceFilename());
+            }
+        }
+        std::sort(dependencyPaths.begin(), dependencyPaths.end());
+        dependencyPaths.erase(std::unique(dependencyPaths.begin(), dependencyPaths.end()), dependencyPaths.end());
+
+        DataWriter writer;
+
+        // Dependencies. These come first, so stale cache files are rejected before parsing the rest.
+        writer.write((uint32_t)dependencyPaths.size());
+        for (const auto& dependencyPath : dependencyPaths)
+        {
+            Dependency dependency;
+            dependency.path = dependencyPath;
+            if (!getFileStamp(dependency.path, dependency.size, dependency.writeTime))
+            {
+                logInfo("Not writing scene cache '" + path + "', can't access dependency '" + dependency.path + "'.");
+                return false;
+            }
+            writer.writeString(dependency.path);
+            writer.write(dependency.size);
+            writer.write(dependency.writeTime);
+        }
+
+        // Scene graph. The children lists are rebuilt from the parent IDs when reading.
+        writer.write((uint32_t)builder.mSceneGraph.size());
+        for (const auto& node : builder.mSceneGraph)
+        {
+            writer.writeString(node.name);
+            writer.write(node.transform);
+            writer.write(node.localToBindPose);
+            writer.write(node.parent);
+            writer.writeVector(node.meshes);
+        }
+
+        // Meshes.
+        writer.write((uint32_t)builder.mMeshes.size());
+        for (const auto& mesh : builder.mMeshes)
+        {
+            writer.write((uint32_t)mesh.topology);
+            writer.write(mesh.materialId);
+            writer.write(mesh.indexOffset);
+            writer.write(mesh.staticVertexOffset);
+            writer.write(mesh.dynamicVertexOffset);
+            writer.write(mesh.indexCount);
+            writer.write(mesh.vertexCount);
+            writer.write((uint32_t)mesh.hasDynamicData);
+            writer.writeVector(mesh.instances);
+        }
+
+        // Textures, shared between materials.
+        std::vector<Texture::SharedPtr> textures;
+        std::unordered_map<const Texture*, uint32_t> textureIndices;
+        for (const auto& pMaterial : builder.mMaterials)
+        {
+            for (auto slot : kTextureSlots)
+            {
+                auto pTexture = pMaterial->getTexture(slot);
+                if (pTexture && textureIndices.emplace(pTexture.get(), (uint32_t)textures.size()).second) textures.push_back(pTexture);
+            }
+        }
+
+        writer.write((uint32_t)textures.size());
+        for (const auto& pTexture : textures)
+        {
+            writer.writeString(pTexture->getSourceFilename());
+            writer.write((uint32_t)isSrgbFormat(pTexture->getFormat()));
+        }
+
+        // Materials.
+        writer.write((uint32_t)builder.mMaterials.size());
+        for (const auto& pMaterial : builder.mMaterials)
+        {
+            writer.writeString(pMaterial->mName);
+            writer.write(pMaterial->mData);
+            writer.write((uint32_t)pMaterial->mOcclusionMapEnabled);
+            for (auto slot : kTextureSlots)
+            {
+                auto pTexture = pMaterial->getTexture(slot);
+                writer.write(pTexture ? textureIndices.at(pTexture.get()) : kInvalidIndex);
+            }
+        }
+
+        // Animations.
+        writer.write((uint32_t)builder.mAnimations.size());
+        for (const auto& pAnimation : builder.mAnimations)
+        {
+            writer.writeString(pAnimation->getName());
+            writer.write(pAnimation->getDuration());
+            writer.write((uint32_t)pAnimation->getChannelCount());
+            for (uint32_t i = 0; i < (uint32_t)pAnimation->getChannelCount(); i++)
+            {
+                writer.write(pAnimation->getChannelMatrixID(i));
+                writer.write((uint32_t)pAnimation->getInterpolationMode(i));
+                writer.write((uint32_t)pAnimation->isWarpingEnabled(i));
+                writer.writeVector(pAnimation->getKeyframes(i));
+            }
+        }
+
+        // Cameras.
+        writer.write((uint32_t)builder.mCameras.size());
+        for (const auto& pCamera : builder.mCameras)
+        {
+            writer.writeString(pCamera->getName());
+            writer.write(pCamera->getPosition());
+            writer.write(pCamera->getTarget());
+            writer.write(pCamera->getUpVector());
+            writer.write(pCamera->getFocalLength());
+            writer.write(pCamera->getFrameHeight());
+            writer.write(pCamera->getAspectRatio());
+            writer.write(pCamera->getNearPlane());
+            writer.write(pCamera->getFarPlane());
+            writer.write(pCamera->getFocalDistance());
+            writer.write(pCamera->getApertureRadius());
+            writer.write(pCamera->getShutterSpeed());
+            writer.write(pCamera->getISOSpeed());
+            writer.write((uint32_t)pCamera->hasAnimation());
+            writer.write(pCamera->getNodeID());
+        }
+        writer.write(builder.mSelectedCamera);
+        writer.write(builder.mCameraSpeed);
+
+        // Lights.
+        writer.write((uint32_t)builder.mLights.size());
+        for (const auto& pLight : builder.mLights)
+        {
+            writer.writeString(pLight->mName);
+            writer.write(pLight->mData);
+            writer.write((uint32_t)pLight->mActive);
+            writer.write(pLight->mUiLightIntensityColor);
+            writer.write(pLight->mUiLightIntensityScale);
+            writer.write((uint32_t)pLight->hasAnimation());
+            writer.write(pLight->getNodeID());
+        }
+
+        // Lay out the sections.
+        const auto& buffers = builder.mBuffersData;
+        const void* sectionData[] = { buffers.indices.data(), buffers.staticData.data(), buffers.dynamicData.data(), writer.getData().data() };
+        SectionDesc sections[(size_t)Section::Count] =
+        {
+            { 0, buffers.indices.size() * sizeof(uint32_t) },
+            { 0, buffers.staticData.size() * sizeof(PackedStaticVertexData) },
+            { 0, buffers.dynamicData.size() * sizeof(DynamicVertexData) },
+            { 0, writer.getData().size() },
+        };
+
+        uint64_t offset = kDataOffset;
+        for (auto& section : sections)
+        {
+            section.offset = offset;
+            offset = (offset + section.size + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+        }
+
+        FileHeader header = {};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.sectionCount = (uint32_t)Section::Count;
+        header.key = key;
+        header.fileSize = offset;
+
+        // Write to a temporary file first, so that a crash or a concurrent reader never sees a partial cache file.
+        std::filesystem::path cachePath(path);
+        std::filesystem::path tempPath = cachePath;
+        tempPath += ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+        if (cachePath.has_parent_path()) std::filesystem::create_directories(cachePath.parent_path(), ec);
+
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file)
+            {
+                logWarning("Can't create scene cache file '" + tempPath.string() + "'.");
+                return false;
+            }
+
+            const char padding[kSectionAlignment] = {};
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(sections), sizeof(sections));
+            uint64_t position = sizeof(header) + sizeof(sections);
+            for (size_t i = 0; i < (size_t)Section::Count; i++)
+            {
+                file.write(padding, sections[i].offset - position);
+                file.write(reinterpret_cast<const char*>(sectionData[i]), sections[i].size);
+                position = sections[i].offset + sections[i].size;
+            }
+            file.write(padding, header.fileSize - position);
+
+            if (!file)
+            {
+                file.close();
+                std::filesystem::remove(tempPath, ec);
+                logWarning("Can't write scene cache file '" + path + "'.");
+                return false;
+            }
+        }
+
+        std::filesystem::rename(tempPath, cachePath, ec);
+        if (ec)
+        {
+            std::filesystem::remove(tempPath, ec);
+            logWarning("Can't write scene cache file '" + path + "'.");
+            return false;
+        }
+
+        logInfo("Wrote scene cache '" + path + "' (" + std::to_string(header.fileSize) + " bytes).");
+        return true;
+    }
+
+    bool SceneCache::read(const std::string& path, SceneBuilder& builder, uint64_t key)
+    {
+        MappedFile file(path);
+        if (!file.getData())
+        {
+            logWarning("Can't open scene cache file '" + path + "'.");
+            return false;
+        }
+
+        // Validate the header and the section table.
+        FileHeader header;
+        if (file.getSize() < kDataOffset) return false;
+        std::memcpy(&header, file.getData(), sizeof(header));
+        if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion || header.sectionCount != (uint32_t)Section::Count || header.fileSize != file.getSize())
+        {
+            logWarning("Scene cache file '" + path + "' is invalid or was written by a different version.");
+            return false;
+        }
+        if (key != 0 && header.key != key) return false;
+
+        SectionDesc sections[(size_t)Section::Count];
+        std::memcpy(sections, file.getData() + sizeof(header), sizeof(sections));
+        for (const auto& section : sections)
+        {
+            if (section.offset % kSectionAlignment != 0 || section.offset > file.getSize() || section.size > file.getSize() - section.offset)
+            {
+                logWarning("Scene cache file '" + path + "' is corrupt.");
+                return false;
+            }
+        }
+
+        auto getArray = [&](Section s, auto* pType)
+        {
+            using T = std::remove_pointer_t<decltype(pType)>;
+            const auto& section = sections[(size_t)s];
+            return ArrayView<T>{ reinterpret_cast<const T*>(file.getData() + section.offset), (size_t)(section.size / sizeof(T)) };
+        };
+        auto indices = getArray(Section::Indices, (uint32_t*)nullptr);
+        auto staticData = getArray(Section::StaticVertexData, (PackedStaticVertexData*)nullptr);
+        auto dynamicData = getArray(Section::DynamicVertexData, (DynamicVertexData*)nullptr);
+
+        // Parse the scene data into temporaries. The builder is only modified once everything was read successfully.
+        struct CachedTexture { std::string path; bool srgb; };
+        struct CachedMaterial { std::string name; MaterialData data; bool occlusionMapEnabled; uint32_t textures[(size_t)Material::TextureSlot::Count]; };
+        struct CachedChannel { uint32_t matrixID; Animation::InterpolationMode mode; bool enableWarping; std::vector<Animation::Keyframe> keyframes; };
+        struct CachedAnimation { std::string name; double duration; std::vector<CachedChannel> channels; };
+        struct CachedLight { std::string name; LightData data; bool active; float3 uiColor; float uiScale; bool hasAnimation; uint32_t nodeID; };
+
+        std::vector<SceneBuilder::InternalNode> nodes;
+        std::vector<SceneBuilder::MeshSpec> meshes;
+        std::vector<CachedTexture> textures;
+        std::vector<CachedMaterial> materials;
+        std::vector<CachedAnimation> animations;
+        std::vector<Camera::SharedPtr> cameras;
+        std::vector<CachedLight> lights;
+        uint32_t selectedCamera = 0;
+        float cameraSpeed = 1.f;
+
+        try
+        {
+            const auto& section = sections[(size_t)Section::SceneData];
+            DataReader reader(file.getData() + section.offset, (size_t)section.size);
+
+            // Reject the file if any dependency changed. Files loaded directly (without a key) are used as is.
+            const uint32_t dependencyCount = reader.read<uint32_t>();
+            for (uint32_t i = 0; i < dependencyCount; i++)
+            {
+                Dependency dependency;
+                dependency.path = reader.readString();
+                dependency.size = reader.read<uint64_t>();
+                dependency.writeTime = reader.read<uint64_t>();
+
+                uint64_t size, writeTime;
+                if (key != 0 && (!getFileStamp(dependency.path, size, writeTime) || size != dependency.size || writeTime != dependency.writeTime))
+                {
+                    logInfo("Scene cache file '" + path + "' is out of date, '" + dependency.path + "' has changed.");
+                    return false;
+                }
+            }
+
+            nodes.resize(reader.read<uint32_t>());
+            for (auto& node : nodes)
+            {
+                node.name = reader.readString();
+                node.transform = reader.read<glm::mat4>();
+                node.localToBindPose = reader.read<glm::mat4>();
+                node.parent = reader.read<uint32_t>();
+                node.meshes = reader.readVector<uint32_t>();
+            }
+
+            meshes.resize(reader.read<uint32_t>());
+            for (auto& mesh : meshes)
+            {
+                mesh.topology = (Vao::Topology)reader.read<uint32_t>();
+                mesh.materialId = reader.read<uint32_t>();
+                mesh.indexOffset = reader.read<uint32_t>();
+                mesh.staticVertexOffset = reader.read<uint32_t>();
+                mesh.dynamicVertexOffset = reader.read<uint32_t>();
+                mesh.indexCount = reader.read<uint32_t>();
+                mesh.vertexCount = reader.read<uint32_t>();
+                mesh.hasDynamicData = reader.read<uint32_t>() != 0;
+                mesh.instances = reader.readVector<uint32_t>();
+            }
+
+            textures.resize(reader.read<uint32_t>());
+            for (auto& texture : textures)
+            {
+                texture.path = reader.readString();
+                texture.srgb = reader.read<uint32_t>() != 0;
+            }
+
+            materials.resize(reader.read<uint32_t>());
+            for (auto& material : materials)
+            {
+                material.name = reader.readString();
+                material.data = reader.read<MaterialData>();
+                material.occlusionMapEnabled = reader.read<uint32_t>() != 0;
+                for (auto& t : material.textures) t = reader.read<uint32_t>();
+            }
+
+            animations.resize(reader.read<uint32_t>());
+            for (auto& animation : animations)
+            {
+                animation.name = reader.readString();
+                animation.duration = reader.read<double>();
+                animation.channels.resize(reader.read<uint32_t>());
+                for (auto& channel : animation.channels)
+                {
+                    channel.matrixID = reader.read<uint32_t>();
+                    channel.mode = (Animation::InterpolationMode)reader.read<uint32_t>();
+                    channel.enableWarping = reader.read<uint32_t>() != 0;
+                    channel.keyframes = reader.readVector<Animation::Keyframe>();
+                }
+            }
+
+            cameras.resize(reader.read<uint32_t>());
+            for (auto& pCamera : cameras)
+            {
+                pCamera = Camera::create();
+                pCamera->setName(reader.readString());
+                pCamera->setPosition(reader.read<float3>());
+                pCamera->setTarget(reader.read<float3>());
+                pCamera->setUpVector(reader.read<float3>());
+                pCamera->setFocalLength(reader.read<float>());
+                pCamera->setFrameHeight(reader.read<float>());
+                pCamera->setAspectRatio(reader.read<float>());
+                pCamera->setNearPlane(reader.read<float>());
+                pCamera->setFarPlane(reader.read<float>());
+                pCamera->setFocalDistance(reader.read<float>());
+                pCamera->setApertureRadius(reader.read<float>());
+                pCamera->setShutterSpeed(reader.read<float>());
+                pCamera->setISOSpeed(reader.read<float>());
+                pCamera->setHasAnimation(reader.read<uint32_t>() != 0);
+                pCamera->setNodeID(reader.read<uint32_t>());
+            }
+            selectedCamera = reader.read<uint32_t>();
+            cameraSpeed = reader.read<float>();
+
+            lights.resize(reader.read<uint32_t>());
+            for (auto& light : lights)
+            {
+                light.name = reader.readString();
+                light.data = reader.read<LightData>();
+                light.active = reader.read<uint32_t>() != 0;
+                light.uiColor = reader.read<float3>();
+                light.uiScale = reader.read<float>();
+                light.hasAnimation = reader.read<uint32_t>() != 0;
+                light.nodeID = reader.read<uint32_t>();
+            }
+
+            if (!reader.isEnd()) throw std::runtime_error("Unexpected data at the end of the scene data");
+        }
+        catch (const std::exception& e)
+        {
+            logWarning("Scene cache file '" + path + "' is corrupt. " + e.what());
+            return false;
+        }
+
+        // Validate the references between the objects.
+        bool valid = true;
+        auto validNode = [&](uint32_t nodeID) { return nodeID < nodes.size(); };
+        for (size_t i = 0; i < nodes.size(); i++)
+        {
+            if (nodes[i].parent != SceneBuilder::kInvalidNode && nodes[i].parent >= i) valid = false;
+            for (auto meshID : nodes[i].meshes) valid &= meshID < meshes.size();
+        }
+        for (const auto& mesh : meshes)
+        {
+            valid &= mesh.materialId < materials.size();
+            valid &= (uint64_t)mesh.indexOffset + mesh.indexCount <= indices.count;
+            valid &= (uint64_t)mesh.staticVertexOffset + mesh.vertexCount <= staticData.count;
+            valid &= !mesh.hasDynamicData || (uint64_t)mesh.dynamicVertexOffset + mesh.vertexCount <= dynamicData.count;
+            for (auto nodeID : mesh.instances) valid &= validNode(nodeID);
+        }
+        for (const auto& material : materials)
+        {
+            for (auto t : material.textures) valid &= t == kInvalidIndex || t < textures.size();
+        }
+        for (const auto& animation : animations)
+        {
+            for (const auto& channel : animation.channels) valid &= validNode(channel.matrixID);
+        }
+        for (const auto& pCamera : cameras) valid &= !pCamera->hasAnimation() || validNode(pCamera->getNodeID());
+        for (const auto& light : lights)
+        {
+            valid &= light.data.type == (uint32_t)LightType::Point || light.data.type == (uint32_t)LightType::Directional;
+            valid &= !light.hasAnimation || validNode(light.nodeID);
+        }
+        for (const auto& d : dynamicData) valid &= d.staticIndex < staticData.count;
+        if (!valid)
+        {
+            logWarning("Scene cache file '" + path + "' is corrupt.");
+            return false;
+        }
+
+        // Append the content to the builder. All IDs are offset by the builder's current content.
+        const bool isEmpty = builder.mSceneGraph.empty() && builder.mMeshes.empty() && builder.mCameras.empty();
+        const uint32_t nodeOffset = (uint32_t)builder.mSceneGraph.size();
+        const uint32_t meshOffset = (uint32_t)builder.mMeshes.size();
+        const uint32_t indexOffset = (uint32_t)builder.mBuffersData.indices.size();
+        const uint32_t staticOffset = (uint32_t)builder.mBuffersData.staticData.size();
+        const uint32_t dynamicOffset = (uint32_t)builder.mBuffersData.dynamicData.size();
+
+        for (auto& node : nodes)
+        {
+            if (node.parent != SceneBuilder::kInvalidNode) node.parent += nodeOffset;
+            for (auto& meshID : node.meshes) meshID += meshOffset;
+            builder.mSceneGraph.push_back(std::move(node));
+            uint32_t nodeID = (uint32_t)builder.mSceneGraph.size() - 1;
+            uint32_t parent = builder.mSceneGraph.back().parent;
+            if (parent != SceneBuilder::kInvalidNode) builder.mSceneGraph[parent].children.push_back(nodeID);
+        }
+
+        // Textures are loaded once and shared between the materials. All textures are requested first so they are decoded in parallel.
+        std::vector<TextureCache::Request> textureRequests(textures.size());
+        for (size_t i = 0; i < textures.size(); i++) textureRequests[i] = TextureCache::request(textures[i].path, true, textures[i].srgb);
+
+        std::vector<Texture::SharedPtr> loadedTextures(textures.size());
+        for (size_t i = 0; i < textures.size(); i++)
+        {
+            loadedTextures[i] = TextureCache::resolve(textureRequests[i]);
+            if (!loadedTextures[i]) logWarning("Can't load texture '" + textures[i].path + "' referenced by scene cache '" + path + "'.");
+        }
+
+        std::vector<uint32_t> materialIDs(materials.size());
+        for (size_t i = 0; i < materials.size(); i++)
+        {
+            const auto& material = materials[i];
+            auto pMaterial = Material::create(material.name);
+            pMaterial->mData = material.data;
+            pMaterial->mOcclusionMapEnabled = material.occlusionMapEnabled;
+
+            bool missingTexture = false;
+            for (size_t slot = 0; slot < arraysize(kTextureSlots); slot++)
+            {
+                if (material.textures[slot] == kInvalidIndex) continue;
+                auto pTexture = loadedTextures[material.textures[slot]];
+                if (pTexture) pMaterial->setTexture(kTextureSlots[slot], pTexture);
+                else missingTexture = true;
+            }
+
+            // Restore the stored flags, they already account for the textures. Only re-derive them if a texture is missing.
+            pMaterial->mData.flags = material.data.flags;
+            if (missingTexture)
+            {
+                pMaterial->updateBaseColorType();
+                pMaterial->updateSpecularType();
+                pMaterial->updateEmissiveType();
+                pMaterial->updateSpecularTransmissionType();
+                pMaterial->updateOcclusionFlag();
+                if (!pMaterial->getNormalMap()) pMaterial->setFlags(PACK_NORMAL_MAP_TYPE(pMaterial->mData.flags, NormalMapUnused));
+            }
+            pMaterial->markUpdates(Material::UpdateFlags::DataChanged | Material::UpdateFlags::ResourcesChanged);
+
+            materialIDs[i] = builder.addMaterial(pMaterial, is_set(builder.mFlags, SceneBuilder::Flags::RemoveDuplicateMaterials));
+        }
+
+        for (auto& mesh : meshes)
+        {
+            mesh.materialId = materialIDs[mesh.materialId];
+            mesh.indexOffset += indexOffset;
+            mesh.staticVertexOffset += staticOffset;
+            mesh.dynamicVertexOffset += dynamicOffset;
+            for (auto& nodeID : mesh.instances) nodeID += nodeOffset;
+            builder.mMeshes.push_back(std::move(mesh));
+        }
+
+        auto& buffers = builder.mBuffersData;
+        buffers.indices.insert(buffers.indices.end(), indices.begin(), indices.end());
+        buffers.staticData.insert(buffers.staticData.end(), staticData.begin(), staticData.end());
+        buffers.dynamicData.reserve(buffers.dynamicData.size() + dynamicData.count);
+        for (DynamicVertexData d : dynamicData)
+        {
+            d.staticIndex += staticOffset;
+            buffers.dynamicData.push_back(d);
+        }
+
+        for (const auto& animation : animations)
+        {
+            auto pAnimation = Animation::create(animation.name, animation.duration);
+            for (const auto& channel : animation.channels)
+            {
+                uint32_t channelID = pAnimation->addChannel(channel.matrixID + nodeOffset);
+                pAnimation->setInterpolationMode(channelID, channel.mode, channel.enableWarping);
+                for (const auto& keyframe : channel.keyframes) pAnimation->addKeyframe(channelID, keyframe);
+            }
+            builder.mAnimations.push_back(pAnimation);
+        }
+
+        for (const auto& pCamera : cameras)
+        {
+            if (pCamera->hasAnimation()) pCamera->setNodeID(pCamera->getNodeID() + nodeOffset);
+            builder.mCameras.push_back(pCamera);
+        }
+        if (isEmpty)
+        {
+            builder.mSelectedCamera = selectedCamera;
+            builder.mCameraSpeed = cameraSpeed;
+        }
+
+        for (const auto& light : lights)
+        {
+            Light::SharedPtr pLight;
+            if (light.data.type == (uint32_t)LightType::Point) pLight = PointLight::create();
+            else pLight = DirectionalLight::create();
+            pLight->mName = light.name;
+            pLight->mData = light.data;
+            pLight->mPrevData = light.data;
+            pLight->mActive = light.active;
+            pLight->mUiLightIntensityColor = light.uiColor;
+            pLight->mUiLightIntensityScale = light.uiScale;
+            pLight->setHasAnimation(light.hasAnimation);
+            if (light.hasAnimation) pLight->setNodeID(light.nodeID + nodeOffset);
+            builder.mLights.push_back(pLight);
+        }
+
+        builder.mDirty = true;
+        return true;
+    }
+
+    bool SceneCache::import(const std::string& filename, SceneBuilder& builder, const SceneBuilder::InstanceMatrices& instances, const Dictionary& dict, const std::vector<Dictionary>& extraMaterials)
+    {
+        if (!instances.empty()) logWarning("Scene cache files don't support instancing. Ignoring instances.");
+        if (!extraMaterials.empty()) logWarning("Scene cache files don't support extra materials. Ignoring extra materials.");
+
+        std::string fullpath;
+        if (findFileInDataDirectories(filename, fullpath) == false)
+        {
+            logError("Can't find file '" + filename + "'");
+            return false;
+        }
+
+        TimeReport timeReport;
+        bool success = read(fullpath, builder);
+        timeReport.measure("Loading scene cache");
+        timeReport.printToLog();
+        return success;
+    }
+
+    REGISTER_IMPORTER(
+        SceneCache,
+        Importer::ExtensionList({
+            "fcache",
+        })
+    )
+}
@@ -0,0 +1,103 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "SceneBuilder.h"
+
+namespace Falcor
+{
+    /** Binary cache of imported scenes.
+
+        The cache stores the state of a SceneBuilder after importing an asset: the geometry buffers, the scene graph,
+        the mesh specs, materials, animations, cameras and lights. Cache files are keyed by the path, size and last write time
+        of the asset file and the build flags, and are written the first time an asset is imported with SceneBuilder::Flags::UseCache.
+        Later imports of the same asset load the cache file instead of running the asset importer.
+        The cache file also records the size and last write time of the files the asset depends on: all files in the asset's
+        directory, and the textures. The cache file is rejected if any of them changed.
+
+        The file starts with a header and a section table. The index buffer and the vertex buffers are stored as raw,
+        16B aligned arrays that can be used directly from the mapped file, all other data is stored in a compact
+        byte stream. Cache files can also be loaded directly through the importer registered for the `.fcache` extension.
+    */
+    class dlldecl SceneCache
+    {
+    public:
+        static const uint32_t kVersion = 2;     ///< Cache format version. Increment when the format or the SceneBuilder output changes.
+        static const char* kFileExtension;      ///< File extension of cache files.
+
+        /** Compute the cache key of an asset.
+            \param[in] filename Full path of the asset file.
+            \param[in] flags The build flags. SceneBuilder::Flags::UseCache is ignored.
+            \return The cache key, or 0 if the file can't be read.
+        */
+        static uint64_t computeKey(const std::string& filename, SceneBuilder::Flags flags);
+
+        /** Get the path of the cache file for a cache key.
+        */
+        static std::string getCachePath(uint64_t key);
+
+        /** Check if the asset importer for a file can be replaced by the cache.
+            Scripted scenes (.pyscene) and legacy scene files (.fscene) depend on more than the file content and are never cached.
+        */
+        static bool isCacheableAsset(const std::string& filename);
+
+        /** Check if the content of a scene builder can be stored in a cache file.
+            \param[in] builder The scene builder.
+            \param[out] reason Reason why the content can't be cached.
+            \return True if the content can be cached.
+        */
+        static bool isCacheable(const SceneBuilder& builder, std::string& reason);
+
+        /** Write the content of a scene builder to a cache file.
+            The file is first written to a temporary file and then renamed, so readers never see partially written files.
+            \param[in] path Path of the cache file.
+            \param[in] builder The scene builder.
+            \param[in] key The cache key stored in the file.
+            \param[in] assetPath Full path of the imported asset. The files in its directory are recorded as dependencies. Can be empty.
+            \return True if the file was written.
+        */
+        static bool write(const std::string& path, const SceneBuilder& builder, uint64_t key, const std::string& assetPath = "");
+
+        /** Read a cache file and append its content to a scene builder.
+            The file is validated completely before the builder is modified. If reading fails, the builder is left unchanged.
+            \param[in] path Path of the cache file.
+            \param[in] builder The scene builder.
+            \param[in] key The expected cache key, or 0 to accept any key. Dependencies are only checked if a key is given.
+            \return True if the file was read.
+        */
+        static bool read(const std::string& path, SceneBuilder& builder, uint64_t key = 0);
+
+        /** Importer entry point for `.fcache` files.
+        */
+        static bool import(const std::string& filename, SceneBuilder& builder, const SceneBuilder::InstanceMatrices& instances, const Dictionary& dict, const std::vector<Dictionary>& extraMaterials);
+
+    private:
+        SceneCache() = default;
+        SceneCache(const SceneCache&) = delete;
+        void operator=(const SceneCache&) = delete;
+    };
+}
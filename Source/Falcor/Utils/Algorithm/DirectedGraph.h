@@ -27,6 +27,9 @@
  **************************************************************************/
 #pragma once
 #include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <queue>
 
 namespace Falcor
 {
@@ -53,6 +56,9 @@ namespace Falcor
         uint32_t addNode()
         {
             mNodes[mCurrentNodeId] = Node();
+            mPosition.push_back((uint32_t)mOrder.size());
+            mOrder.push_back(mCurrentNodeId);
+            mDirtyNodes.insert(mCurrentNodeId);
             return mCurrentNodeId++;
         }
 
@@ -77,7 +83,13 @@ namespace Falcor
 
             // Remove the index from the map
             mNodes.erase(id);
-            
+            mDirtyNodes.erase(id);
+
+            // Removing a node never invalidates the order, leave a hole and compact once holes dominate
+            mOrder[mPosition[id]] = kInvalidID;
+            mPosition[id] = kInvalidID;
+            if (++mOrderHoles > mNodes.size()) compactOrder();
+
             return removedEdges;
         }
 
@@ -101,6 +113,9 @@ namespace Falcor
             mNodes[dstNode].mIncomingEdges.push_back(mCurrentEdgeId);
 
             mEdges[mCurrentEdgeId] = (Edge(srcNode, dstNode));
+            mDirtyNodes.insert(srcNode);
+            mDirtyNodes.insert(dstNode);
+            if (mOrderValid) mOrderValid = updateOrder(srcNode, dstNode);
             return mCurrentEdgeId++;
         }
 
@@ -117,6 +132,8 @@ namespace Falcor
             const auto& edge = mEdges[edgeId];
             removeEdgeFromNode<true>(edgeId, mNodes[edge.getDestNode()]);
             removeEdgeFromNode<false>(edgeId, mNodes[edge.getSourceNode()]);
+            mDirtyNodes.insert(edge.getDestNode());
+            mDirtyNodes.insert(edge.getSourceNode());
 
             mEdges.erase(edgeId);
         }
@@ -183,6 +200,67 @@ namespace Falcor
 
         uint32_t getCurrentNodeId() const { return mCurrentNodeId; }
         uint32_t getCurrentEdgeId() const { return mCurrentEdgeId; }
+
+        /** Get the nodes in topological order.
+            The order is maintained incrementally as edges are added, so it stays stable across edits and only the nodes between the ends of a new edge are reordered.
+            If the graph has a cycle the order is recomputed on every call and isn't topological.
+        */
+        std::vector<uint32_t> getTopologicalOrder()
+        {
+            if (!mOrderValid) mOrderValid = rebuildOrder();
+
+            std::vector<uint32_t> order;
+            order.reserve(mNodes.size());
+            for (uint32_t node : mOrder)
+            {
+                if (node != kInvalidID) order.push_back(node);
+            }
+            return order;
+        }
+
+        /** Mark a node as changed. Adding or removing a node or an edge marks the nodes it touches automatically.
+        */
+        void markNodeDirty(uint32_t nodeId) { if (doesNodeExist(nodeId)) mDirtyNodes.insert(nodeId); }
+
+        /** Get the nodes changed since the last call to clearDirtyNodes().
+        */
+        const std::unordered_set<uint32_t>& getDirtyNodes() const { return mDirtyNodes; }
+
+        /** Clear the set of changed nodes.
+        */
+        void clearDirtyNodes() { mDirtyNodes.clear(); }
+
+        /** Get all the nodes that can be reached from a set of nodes, including the nodes themselves.
+        */
+        template<typename Container>
+        std::vector<uint32_t> getDownstreamNodes(const Container& roots) const
+        {
+            std::vector<uint32_t> result;
+            std::vector<bool> visited(mCurrentNodeId, false);
+            for (uint32_t root : roots)
+            {
+                if (doesNodeExist(root) && !visited[root])
+                {
+                    visited[root] = true;
+                    result.push_back(root);
+                }
+            }
+
+            // The result doubles as the stack of nodes to visit
+            for (size_t i = 0; i < result.size(); i++)
+            {
+                for (uint32_t e : mNodes.at(result[i]).mOutgoingEdges)
+                {
+                    uint32_t next = mEdges.at(e).mDst;
+                    if (!visited[next])
+                    {
+                        visited[next] = true;
+                        result.push_back(next);
+                    }
+                }
+            }
+            return result;
+        }
      private:
         DirectedGraph() = default;
 
@@ -191,6 +269,150 @@ namespace Falcor
         uint32_t mCurrentNodeId = 0;
         uint32_t mCurrentEdgeId = 0;
 
+        // Topological order. mOrder holds the node at each position, kInvalidID for removed nodes. mPosition holds the position of each node ID.
+        std::vector<uint32_t> mOrder;
+        std::vector<uint32_t> mPosition;
+        uint32_t mOrderHoles = 0;
+        bool mOrderValid = true;
+        std::vector<uint32_t> mVisitMark;
+        uint32_t mVisitEpoch = 0;
+
+        std::unordered_set<uint32_t> mDirtyNodes;
+
+        /** Restore the order after adding the edge src->dst (Pearce and Kelly, "A Dynamic Topological Sort Algorithm for Directed Acyclic Graphs").
+            Only the nodes positioned between dst and src are visited, the nodes reachable from dst are moved after the nodes reaching src.
+            \return false if the edge created a cycle.
+        */
+        bool updateOrder(uint32_t src, uint32_t dst)
+        {
+            uint32_t lower = mPosition[dst];
+            uint32_t upper = mPosition[src];
+            if (lower > upper) return true;
+            if (lower == upper) return false; // Self loop
+
+            mVisitMark.resize(mCurrentNodeId, 0);
+            if (++mVisitEpoch == 0)
+            {
+                std::fill(mVisitMark.begin(), mVisitMark.end(), 0);
+                mVisitEpoch = 1;
+            }
+
+            // Nodes reachable from dst that are currently placed before src
+            std::vector<uint32_t> forward;
+            std::vector<uint32_t> stack = { dst };
+            mVisitMark[dst] = mVisitEpoch;
+            while (!stack.empty())
+            {
+                uint32_t node = stack.back();
+                stack.pop_back();
+                forward.push_back(node);
+                for (uint32_t e : mNodes[node].mOutgoingEdges)
+                {
+                    uint32_t next = mEdges[e].mDst;
+                    if (next == src) return false;
+                    if (mVisitMark[next] != mVisitEpoch && mPosition[next] < upper)
+                    {
+                        mVisitMark[next] = mVisitEpoch;
+                        stack.push_back(next);
+                    }
+                }
+            }
+
+            // Nodes reaching src that are currently placed after dst
+            std::vector<uint32_t> backward;
+            stack = { src };
+            mVisitMark[src] = mVisitEpoch;
+            while (!stack.empty())
+            {
+                uint32_t node = stack.back();
+                stack.pop_back();
+                backward.push_back(node);
+                for (uint32_t e : mNodes[node].mIncomingEdges)
+                {
+                    uint32_t prev = mEdges[e].mSrc;
+                    if (mVisitMark[prev] != mVisitEpoch && mPosition[prev] > lower)
+                    {
+                        mVisitMark[prev] = mVisitEpoch;
+                        stack.push_back(prev);
+                    }
+                }
+            }
+
+            // Reuse the positions of both sets, keeping the relative order within each set
+            auto byPosition = [this](uint32_t a, uint32_t b) { return mPosition[a] < mPosition[b]; };
+            std::sort(forward.begin(), forward.end(), byPosition);
+            std::sort(backward.begin(), backward.end(), byPosition);
+
+            std::vector<uint32_t> positions;
+            positions.reserve(forward.size() + backward.size());
+            for (uint32_t node : backward) positions.push_back(mPosition[node]);
+            for (uint32_t node : forward) positions.push_back(mPosition[node]);
+            std::sort(positions.begin(), positions.end());
+
+            size_t i = 0;
+            for (uint32_t node : backward) mPosition[node] = positions[i++];
+            for (uint32_t node : forward) mPosition[node] = positions[i++];
+            for (uint32_t node : backward) mOrder[mPosition[node]] = node;
+            for (uint32_t node : forward) mOrder[mPosition[node]] = node;
+            return true;
+        }
+
+        /** Recompute the order from scratch using Kahn's algorithm. Ties are broken by the previous order, so valid parts of the order are kept.
+            \return false if the graph has a cycle. The nodes on the cycle are placed at the end.
+        */
+        bool rebuildOrder()
+        {
+            compactOrder();
+
+            std::vector<uint32_t> inDegree(mCurrentNodeId, 0);
+            for (const auto& [id, edge] : mEdges) inDegree[edge.mDst]++;
+
+            std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> ready; // Previous positions of the nodes without pending inputs
+            for (uint32_t node : mOrder)
+            {
+                if (inDegree[node] == 0) ready.push(mPosition[node]);
+            }
+
+            std::vector<uint32_t> order;
+            order.reserve(mOrder.size());
+            std::vector<bool> placed(mCurrentNodeId, false);
+            while (!ready.empty())
+            {
+                uint32_t node = mOrder[ready.top()];
+                ready.pop();
+                order.push_back(node);
+                placed[node] = true;
+                for (uint32_t e : mNodes[node].mOutgoingEdges)
+                {
+                    uint32_t next = mEdges[e].mDst;
+                    if (--inDegree[next] == 0) ready.push(mPosition[next]);
+                }
+            }
+
+            bool acyclic = order.size() == mOrder.size();
+            for (uint32_t node : mOrder)
+            {
+                if (!placed[node]) order.push_back(node);
+            }
+
+            mOrder = std::move(order);
+            for (uint32_t i = 0; i < (uint32_t)mOrder.size(); i++) mPosition[mOrder[i]] = i;
+            return acyclic;
+        }
+
+        void compactOrder()
+        {
+            uint32_t count = 0;
+            for (uint32_t node : mOrder)
+            {
+                if (node == kInvalidID) continue;
+                mPosition[node] = count;
+                mOrder[count++] = node;
+            }
+            mOrder.resize(count);
+            mOrderHoles = 0;
+        }
+
         template<bool removeSrc>
         void findEdgesToRemove(std::vector<uint32_t>& edges, uint32_t nodeToRemove, std::unordered_set<uint32_t>& removedEdges)
         {
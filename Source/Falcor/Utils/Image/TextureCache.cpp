@@ -0,0 +1,309 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "TextureCache.h"
+#include <deque>
+#include <unordered_map>
+
+namespace Falcor
+{
+    struct TextureCache::Entry
+    {
+        std::string fullpath;
+        bool generateMipLevels = false;
+        bool loadAsSrgb = false;
+
+        bool decodeQueued = false;                      ///< True while the image waits in the decode queue.
+        bool decodePending = false;                     ///< True while the image is queued or being decoded.
+        bool createPending = false;                     ///< True while the texture is being created from the decoded image.
+        bool failed = false;                            ///< True if the image or the texture failed to load. Failed entries are removed from the cache.
+        std::shared_ptr<Texture::ImageData> pImage;     ///< Decoded image, released once the texture is created.
+        Texture::WeakPtr pTexture;
+    };
+
+    namespace
+    {
+        const uint64_t kDefaultMaxDecodedBytes = 1ull << 30;
+
+        struct Key
+        {
+            std::string fullpath;
+            bool generateMipLevels;
+            bool loadAsSrgb;
+
+            bool operator==(const Key& other) const
+            {
+                return fullpath == other.fullpath && generateMipLevels == other.generateMipLevels && loadAsSrgb == other.loadAsSrgb;
+            }
+        };
+
+        struct KeyHash
+        {
+            size_t operator()(const Key& key) const
+            {
+                return std::hash<std::string>()(key.fullpath) ^ (size_t(key.generateMipLevels) << 1) ^ (size_t(key.loadAsSrgb) << 2);
+            }
+        };
+
+        std::mutex sMutex;
+        std::condition_variable sDecodeDone;
+        std::unordered_map<Key, TextureCache::EntryPtr, KeyHash> sEntries;
+        std::deque<TextureCache::EntryPtr> sDecodeQueue;    ///< Images waiting to be decoded, in request order.
+        uint32_t sDecodeTaskCount = 0;                      ///< Number of running decode tasks.
+        uint64_t sDecodedBytes = 0;                         ///< Size of the decoded images that haven't been turned into textures yet.
+        uint64_t sMaxDecodedBytes = kDefaultMaxDecodedBytes;
+        TextureCache::Stats sStats;
+
+        /** Remove a failed entry from the cache, so that the file is loaded again on the next request. Must be called with the lock held.
+        */
+        void evict(const TextureCache::EntryPtr& pEntry)
+        {
+            auto it = sEntries.find(Key{ pEntry->fullpath, pEntry->generateMipLevels, pEntry->loadAsSrgb });
+            if (it != sEntries.end() && it->second == pEntry) sEntries.erase(it);
+        }
+
+        std::shared_ptr<Texture::ImageData> decodeImage(const TextureCache::Entry& entry)
+        {
+            try
+            {
+                return Texture::loadImageDataFromFile(entry.fullpath, entry.generateMipLevels, entry.loadAsSrgb);
+            }
+            catch (const std::exception& e)
+            {
+                logError("Error when loading image file " + entry.fullpath + ". " + e.what());
+            }
+            return nullptr;
+        }
+
+        /** Store a decoded image in its entry. Must be called with the lock held.
+        */
+        void finishDecode(const TextureCache::EntryPtr& pEntry, const std::shared_ptr<Texture::ImageData>& pImage)
+        {
+            pEntry->pImage = pImage;
+            pEntry->failed = (pImage == nullptr);
+            pEntry->decodePending = false;
+            if (pImage)
+            {
+                sDecodedBytes += pImage->data.size();
+                sStats.peakDecodedBytes = std::max(sStats.peakDecodedBytes, sDecodedBytes);
+            }
+            else evict(pEntry);
+            sDecodeDone.notify_all();
+        }
+
+        /** Decode queued images until the queue is empty or the decoded images exceed the memory budget.
+        */
+        void runDecodeTask()
+        {
+            std::unique_lock<std::mutex> lock(sMutex);
+            while (!sDecodeQueue.empty() && sDecodedBytes < sMaxDecodedBytes)
+            {
+                auto pEntry = sDecodeQueue.front();
+                sDecodeQueue.pop_front();
+                pEntry->decodeQueued = false;
+
+                lock.unlock();
+                auto pImage = decodeImage(*pEntry);
+                lock.lock();
+                finishDecode(pEntry, pImage);
+            }
+            sDecodeTaskCount--;
+        }
+
+        /** Reserve decode tasks for the queued images. Must be called with the lock held.
+            \return Number of tasks to dispatch once the lock is released.
+        */
+        uint32_t reserveDecodeTasks()
+        {
+            // One task per worker thread, each task decodes images in queue order.
+            const uint32_t maxTaskCount = std::max(1u, Threading::getThreadCount());
+            uint32_t count = 0;
+            while (sDecodeTaskCount < maxTaskCount && count < sDecodeQueue.size() && sDecodedBytes < sMaxDecodedBytes)
+            {
+                sDecodeTaskCount++;
+                count++;
+            }
+            return count;
+        }
+
+        void dispatchDecodeTasks(uint32_t count)
+        {
+            // The tasks run on the calling thread if the thread pool isn't running, so this must be called without holding the lock.
+            for (uint32_t i = 0; i < count; i++) Threading::dispatchTask(runDecodeTask);
+        }
+    }
+
+    TextureCache::Request TextureCache::request(const std::string& filename, bool generateMipLevels, bool loadAsSrgb)
+    {
+        std::string fullpath;
+        if (findFileInDataDirectories(filename, fullpath) == false)
+        {
+            logError("Error when loading image file. Can't find image file " + filename);
+            return Request();
+        }
+
+        EntryPtr pEntry;
+        uint32_t taskCount = 0;
+        {
+            std::lock_guard<std::mutex> lock(sMutex);
+            EntryPtr& pCached = sEntries[Key{ fullpath, generateMipLevels, loadAsSrgb }];
+            if (!pCached)
+            {
+                pCached = std::make_shared<Entry>();
+                pCached->fullpath = fullpath;
+                pCached->generateMipLevels = generateMipLevels;
+                pCached->loadAsSrgb = loadAsSrgb;
+            }
+            pEntry = pCached;
+            sStats.requestCount++;
+
+            // Decode unless the image or the texture is available or in flight.
+            if (!pEntry->decodePending && !pEntry->createPending && !pEntry->pImage && pEntry->pTexture.expired())
+            {
+                pEntry->decodeQueued = true;
+                pEntry->decodePending = true;
+                sDecodeQueue.push_back(pEntry);
+                sStats.decodeCount++;
+                taskCount = reserveDecodeTasks();
+            }
+        }
+
+        dispatchDecodeTasks(taskCount);
+        return Request(pEntry);
+    }
+
+    Texture::SharedPtr TextureCache::resolve(const Request& request)
+    {
+        if (!request.isValid()) return nullptr;
+        const EntryPtr& pEntry = request.mpEntry;
+
+        std::unique_lock<std::mutex> lock(sMutex);
+        if (pEntry->decodeQueued)
+        {
+            // The image is needed now. Decode it on the calling thread, regardless of the memory budget.
+            sDecodeQueue.erase(std::find(sDecodeQueue.begin(), sDecodeQueue.end(), pEntry));
+            pEntry->decodeQueued = false;
+
+            lock.unlock();
+            auto pImage = decodeImage(*pEntry);
+            lock.lock();
+            finishDecode(pEntry, pImage);
+        }
+        sDecodeDone.wait(lock, [&pEntry]() { return !pEntry->decodePending && !pEntry->createPending; });
+
+        if (auto pTexture = pEntry->pTexture.lock()) return pTexture;
+        if (pEntry->failed) return nullptr;
+
+        if (!pEntry->pImage)
+        {
+            // The texture was released after the request was resolved before. Request it again.
+            lock.unlock();
+            return load(pEntry->fullpath, pEntry->generateMipLevels, pEntry->loadAsSrgb);
+        }
+
+        // Create the texture outside of the lock, so that requests and decodes on other threads don't wait for the upload.
+        std::shared_ptr<Texture::ImageData> pImage = std::move(pEntry->pImage);
+        pEntry->pImage = nullptr;
+        pEntry->createPending = true;
+        sDecodedBytes -= pImage->data.size();
+        uint32_t taskCount = reserveDecodeTasks();
+        lock.unlock();
+
+        dispatchDecodeTasks(taskCount);
+        Texture::SharedPtr pTexture = Texture::createFromImageData(*pImage);
+        pImage = nullptr;
+
+        lock.lock();
+        pEntry->createPending = false;
+        pEntry->pTexture = pTexture;
+        pEntry->failed = (pTexture == nullptr);
+        if (pTexture) sStats.textureCount++;
+        else evict(pEntry);
+        sDecodeDone.notify_all();
+        return pTexture;
+    }
+
+    Texture::SharedPtr TextureCache::load(const std::string& filename, bool generateMipLevels, bool loadAsSrgb)
+    {
+        return resolve(request(filename, generateMipLevels, loadAsSrgb));
+    }
+
+    void TextureCache::setMaxDecodedBytes(uint64_t maxBytes)
+    {
+        uint32_t taskCount = 0;
+        {
+            std::lock_guard<std::mutex> lock(sMutex);
+            sMaxDecodedBytes = maxBytes > 0 ? maxBytes : kDefaultMaxDecodedBytes;
+            taskCount = reserveDecodeTasks();
+        }
+        dispatchDecodeTasks(taskCount);
+    }
+
+    void TextureCache::clear()
+    {
+        std::unique_lock<std::mutex> lock(sMutex);
+
+        // Decode the images held back by the memory budget on the calling thread, as no task may pick them up.
+        while (!sDecodeQueue.empty())
+        {
+            auto pEntry = sDecodeQueue.front();
+            sDecodeQueue.pop_front();
+            pEntry->decodeQueued = false;
+
+            lock.unlock();
+            auto pImage = decodeImage(*pEntry);
+            lock.lock();
+            finishDecode(pEntry, pImage);
+        }
+
+        sDecodeDone.wait(lock, []()
+        {
+            for (const auto& it : sEntries)
+            {
+                if (it.second->decodePending || it.second->createPending) return false;
+            }
+            return true;
+        });
+
+        // Drop the decoded images that were never resolved. Outstanding requests decode them again when resolved.
+        for (const auto& it : sEntries)
+        {
+            if (!it.second->pImage) continue;
+            sDecodedBytes -= it.second->pImage->data.size();
+            it.second->pImage = nullptr;
+        }
+        sEntries.clear();
+        sStats = {};
+    }
+
+    TextureCache::Stats TextureCache::getStats()
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        return sStats;
+    }
+}
@@ -0,0 +1,112 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/API/Texture.h"
+#include "Utils/Threading.h"
+
+namespace Falcor
+{
+    /** Process-wide cache of textures loaded from files.
+
+        Textures are keyed by their full path, the sRGB flag and the mip generation flag. Requesting a texture
+        starts decoding the file on the thread pool and returns immediately, so callers can keep working while
+        images are decoded in parallel. The texture is created on the device when it is first resolved, which must
+        happen on the main thread.
+
+        The cache holds weak references to the created textures. As long as a texture is referenced (e.g. by the
+        materials of a scene), requesting the same file again returns the same texture without decoding it again.
+        The decoded image data is released as soon as the texture is created.
+
+        Decoding is limited by a memory budget: once the decoded images waiting to be resolved exceed the budget,
+        further images are queued until textures are created. Images that fail to load are not cached, so
+        requesting the file again retries loading it.
+    */
+    class dlldecl TextureCache
+    {
+    public:
+        struct Entry;
+        using EntryPtr = std::shared_ptr<Entry>;
+
+        /** Handle to a requested texture.
+        */
+        class dlldecl Request
+        {
+        public:
+            Request() = default;
+
+            /** Check if the request refers to a file. Requests for files that can't be found are invalid.
+            */
+            bool isValid() const { return mpEntry != nullptr; }
+
+        private:
+            Request(const EntryPtr& pEntry) : mpEntry(pEntry) {}
+            EntryPtr mpEntry;
+            friend class TextureCache;
+        };
+
+        struct Stats
+        {
+            uint64_t requestCount = 0;      ///< Number of valid texture requests.
+            uint64_t decodeCount = 0;       ///< Number of images that were decoded.
+            uint64_t textureCount = 0;      ///< Number of textures that were created.
+            uint64_t peakDecodedBytes = 0;  ///< Maximum size of the decoded images waiting to be resolved.
+        };
+
+        /** Request a texture. If the texture isn't cached, decoding starts on a worker thread. This call doesn't block.
+            \param[in] filename Filename of the image. Can also include a full path or relative path from a data directory.
+            \param[in] generateMipLevels Whether the mip-chain should be generated.
+            \param[in] loadAsSrgb Load the texture using sRGB format.
+            \return A handle to pass to resolve(). The handle is invalid if the file can't be found.
+        */
+        static Request request(const std::string& filename, bool generateMipLevels, bool loadAsSrgb);
+
+        /** Wait for a requested texture to be decoded and create it. Must be called from the main thread.
+            \param[in] request Handle returned by request().
+            \return The texture, or nullptr if the texture failed to load.
+        */
+        static Texture::SharedPtr resolve(const Request& request);
+
+        /** Load a texture through the cache. Equivalent to resolve(request(...)).
+        */
+        static Texture::SharedPtr load(const std::string& filename, bool generateMipLevels, bool loadAsSrgb);
+
+        /** Set the memory budget for decoded images. Images are decoded ahead of resolve() while the decoded images waiting
+            to be resolved are smaller than the budget. The budget can be exceeded by the images that are being decoded.
+            \param[in] maxBytes The budget in bytes, or 0 to restore the default budget (1 GB).
+        */
+        static void setMaxDecodedBytes(uint64_t maxBytes);
+
+        /** Remove all entries from the cache and reset the statistics. Pending decodes are finished first. Textures that were already created are not affected.
+        */
+        static void clear();
+
+        /** Get the cache statistics.
+        */
+        static Stats getStats();
+    };
+}
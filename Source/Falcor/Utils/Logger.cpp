@@ -27,6 +27,10 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "Logger.h"
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
 
 namespace Falcor
 {
@@ -38,8 +42,74 @@ namespace Falcor
         Logger::Level sVerbosity = Logger::Level::Info;
 
 #if _LOG_ENABLED
+        std::atomic<bool> sFoldRepeated{ true };
+
+        /** Queued message. Flush requests are queued as messages with a promise, which is fulfilled once everything queued before it is written.
+        */
+        struct Message
+        {
+            Message* pNext = nullptr;
+            Logger::Level level = Logger::Level::Info;
+            std::string text;
+            double time = 0;        ///< Seconds since the Unix epoch.
+            uint32_t thread = 0;
+            std::promise<void>* pFlushed = nullptr;
+        };
+
+        // Lock-free multi-producer/single-consumer queue. Producers push onto a stack, the consumer takes the whole stack and reverses it.
+        std::atomic<Message*> sQueueHead{ nullptr };
+
+        enum class WriterState
+        {
+            NotStarted,
+            Running,
+            Stopped,
+        };
+
+        // The writer mutex only guards starting, waking and stopping the writer thread.
+        std::mutex sWriterMutex;
+        std::condition_variable sWriterCondition;
+        std::atomic<WriterState> sWriterState{ WriterState::NotStarted };
+        bool sStopWriter = false;
+        std::thread sWriterThread;
+
+        /** Detaches the writer thread if the logger was never shut down, instead of terminating in the std::thread destructor.
+        */
+        struct WriterThreadGuard
+        {
+            ~WriterThreadGuard()
+            {
+                sWriterState = WriterState::Stopped;
+                if (sWriterThread.joinable()) sWriterThread.detach();
+            }
+        } sWriterThreadGuard;
+
+        // Held while consuming the queue. Guards the sinks and the folding state below.
+        std::mutex sConsumeMutex;
         bool sInitialized = false;
+        bool sLogFileCreated = false;
         FILE* sLogFile = nullptr;
+        FILE* sJsonLogFile = nullptr;
+
+        struct
+        {
+            Logger::Level level = Logger::Level::Info;
+            std::string text;
+            double time = 0;
+            uint32_t thread = 0;
+            uint32_t repeatCount = 0;
+            bool valid = false;
+        } sLastMessage;
+
+        /** Output of one batch of messages, written to the sinks at once.
+        */
+        struct Batch
+        {
+            std::string text;
+            std::string json;
+            std::string console;
+            std::string consoleErrors;
+        };
 
         std::string generateLogFilePath()
         {
@@ -67,10 +137,12 @@ namespace Falcor
                 sLogFilePath = generateLogFilePath();
             }
 
-            pFile = std::fopen(sLogFilePath.c_str(), "w");
+            // Append if the logger was shut down and is used again, so the earlier messages are kept.
+            pFile = std::fopen(sLogFilePath.c_str(), sLogFileCreated ? "a" : "w");
             if (pFile != nullptr)
             {
                 // Success
+                sLogFileCreated = true;
                 return pFile;
             }
 
@@ -79,31 +151,17 @@ namespace Falcor
             return pFile;
         }
 
-        void printToLogFile(const std::string& s)
+        uint32_t getThreadIndex()
         {
-            if (!sInitialized)
-            {
-                sLogFile = openLogFile();
-                sInitialized = true;
-            }
-
-            if (sLogFile)
-            {
-                std::fprintf(sLogFile, "%s", s.c_str());
-                std::fflush(sLogFile);
-            }
+            static std::atomic<uint32_t> sThreadCount{ 0 };
+            thread_local uint32_t index = sThreadCount++;
+            return index;
         }
-#endif
-    }
 
-    void Logger::shutdown()
-    {
-#if _LOG_ENABLED
-        if(sLogFile)
+        double getTime()
         {
-            fclose(sLogFile);
-            sLogFile = nullptr;
-            sInitialized = false;
+            auto duration = std::chrono::system_clock::now().time_since_epoch();
+            return std::chrono::duration<double>(duration).count();
         }
 #endif
     }
@@ -125,28 +183,230 @@ namespace Falcor
         return c;
     }
 
-    void Logger::log(Level L, const std::string& msg, MsgBox mbox, bool terminateOnError)
-    {
 #if _LOG_ENABLED
-        if (L >= sVerbosity)
+    namespace
+    {
+        const char* getLogLevelName(Logger::Level L)
         {
-            std::string s = getLogLevelString(L) + std::string("\t") + msg + "\n";
+            switch (L)
+            {
+            case Logger::Level::Info: return "Info";
+            case Logger::Level::Warning: return "Warning";
+            case Logger::Level::Error: return "Error";
+            case Logger::Level::Fatal: return "Fatal";
+            default:
+                should_not_get_here();
+                return "";
+            }
+        }
+
+        void appendMessage(Batch& batch, Logger::Level level, const std::string& text, double time, uint32_t thread, uint32_t repeatCount)
+        {
+            std::string s = getLogLevelString(level) + std::string("\t") + (repeatCount > 0 ? "Last message repeated " + std::to_string(repeatCount) + " times" : text) + "\n";
+            batch.text += s;
+
+            // Write errors to stderr unconditionally, other messages to stdout if enabled.
+            if (level >= Logger::Level::Error) batch.consoleErrors += s;
+            else if (sLogToConsole) batch.console += s;
 
-            // Write to log file.
-            printToLogFile(s);
+            if (sJsonLogFile)
+            {
+                char prefix[128];
+                snprintf(prefix, sizeof(prefix), "{\"time\":%.6f,\"thread\":%u,\"level\":\"%s\",\"message\":\"", time, thread, getLogLevelName(level));
+                batch.json += prefix;
+                batch.json += escapeJsonString(text);
+                batch.json += repeatCount > 0 ? "\",\"repeated\":" + std::to_string(repeatCount) + "}\n" : "\"}\n";
+            }
+        }
+
+        void appendRepeatCount(Batch& batch)
+        {
+            if (sLastMessage.repeatCount == 0) return;
+            appendMessage(batch, sLastMessage.level, sLastMessage.text, sLastMessage.time, sLastMessage.thread, sLastMessage.repeatCount);
+            sLastMessage.repeatCount = 0;
+        }
+
+        void processMessage(Batch& batch, const Message& msg)
+        {
+            if (sFoldRepeated && sLastMessage.valid && msg.level == sLastMessage.level && msg.text == sLastMessage.text)
+            {
+                sLastMessage.repeatCount++;
+                sLastMessage.time = msg.time;
+                sLastMessage.thread = msg.thread;
+                return;
+            }
+
+            appendRepeatCount(batch);
+            appendMessage(batch, msg.level, msg.text, msg.time, msg.thread, 0);
+            sLastMessage.level = msg.level;
+            sLastMessage.text = msg.text;
+            sLastMessage.valid = true;
+        }
+
+        void writeBatch(const Batch& batch)
+        {
+            if (!sInitialized)
+            {
+                sLogFile = openLogFile();
+                sInitialized = true;
+            }
+
+            if (sLogFile && !batch.text.empty())
+            {
+                std::fwrite(batch.text.data(), 1, batch.text.size(), sLogFile);
+                std::fflush(sLogFile);
+            }
+            if (sJsonLogFile && !batch.json.empty())
+            {
+                std::fwrite(batch.json.data(), 1, batch.json.size(), sJsonLogFile);
+                std::fflush(sJsonLogFile);
+            }
 
             // Write to debug window if debugger is attached.
-            if (isDebuggerPresent()) printToDebugWindow(s);
+            if (!batch.text.empty() && isDebuggerPresent()) printToDebugWindow(batch.text);
 
-            // Write errors to stderr unconditionally, other messages to stdout if enabled.
-            if (L < Logger::Level::Error)
+            if (!batch.console.empty()) std::cout << batch.console << std::flush;
+            if (!batch.consoleErrors.empty()) std::cerr << batch.consoleErrors;
+        }
+
+        /** Take all queued messages and write them as one batch. Repeat counts are written at the end of each batch, which limits the rate of repeated messages.
+        */
+        void consumeQueue()
+        {
+            std::lock_guard<std::mutex> lock(sConsumeMutex);
+
+            Message* pMessage = sQueueHead.exchange(nullptr, std::memory_order_acquire);
+            if (!pMessage) return;
+
+            // Restore the logging order.
+            Message* pFirst = nullptr;
+            while (pMessage)
+            {
+                Message* pNext = pMessage->pNext;
+                pMessage->pNext = pFirst;
+                pFirst = pMessage;
+                pMessage = pNext;
+            }
+
+            Batch batch;
+            std::vector<std::promise<void>*> flushRequests;
+            for (pMessage = pFirst; pMessage; )
+            {
+                if (pMessage->pFlushed) flushRequests.push_back(pMessage->pFlushed);
+                else processMessage(batch, *pMessage);
+                Message* pNext = pMessage->pNext;
+                delete pMessage;
+                pMessage = pNext;
+            }
+            appendRepeatCount(batch);
+            writeBatch(batch);
+
+            for (auto pFlushed : flushRequests) pFlushed->set_value();
+        }
+
+        /** Push a message onto the queue and wake the writer if the queue was empty.
+            \return True if the message will be written by the writer thread, false if the caller has to consume the queue.
+        */
+        bool enqueue(Message* pMessage)
+        {
+            if (sWriterState.load(std::memory_order_acquire) == WriterState::NotStarted)
             {
-                if (sLogToConsole) std::cout << s;
+                std::lock_guard<std::mutex> lock(sWriterMutex);
+                if (sWriterState == WriterState::NotStarted)
+                {
+                    sWriterThread = std::thread([]()
+                    {
+                        while (true)
+                        {
+                            bool stop;
+                            {
+                                std::unique_lock<std::mutex> lock(sWriterMutex);
+                                sWriterCondition.wait(lock, []() { return sStopWriter || sQueueHead.load(std::memory_order_relaxed) != nullptr; });
+                                stop = sStopWriter;
+                            }
+                            consumeQueue();
+                            if (stop) break;
+                        }
+                    });
+                    sWriterState = WriterState::Running;
+                }
             }
-            else
+
+            Message* pHead = sQueueHead.load(std::memory_order_relaxed);
+            do
+            {
+                pMessage->pNext = pHead;
+            } while (!sQueueHead.compare_exchange_weak(pHead, pMessage, std::memory_order_release, std::memory_order_relaxed));
+
+            if (sWriterState.load(std::memory_order_acquire) != WriterState::Running) return false;
+
+            if (pHead == nullptr)
             {
-                std::cerr << s;
+                // Lock the mutex so the wake-up can't be lost between the writer checking the queue and going to sleep.
+                {
+                    std::lock_guard<std::mutex> lock(sWriterMutex);
+                }
+                sWriterCondition.notify_one();
             }
+            return true;
+        }
+    }
+#endif
+
+    void Logger::shutdown()
+    {
+#if _LOG_ENABLED
+        {
+            std::lock_guard<std::mutex> lock(sWriterMutex);
+            sStopWriter = true;
+            sWriterState = WriterState::Stopped;
+        }
+        sWriterCondition.notify_one();
+        if (sWriterThread.joinable()) sWriterThread.join();
+
+        // Write messages queued while the writer was stopping.
+        consumeQueue();
+
+        std::lock_guard<std::mutex> lock(sConsumeMutex);
+        if(sLogFile)
+        {
+            fclose(sLogFile);
+            sLogFile = nullptr;
+            sInitialized = false;
+        }
+        if (sJsonLogFile)
+        {
+            fclose(sJsonLogFile);
+            sJsonLogFile = nullptr;
+        }
+#endif
+    }
+
+    void Logger::flush()
+    {
+#if _LOG_ENABLED
+        std::promise<void> flushed;
+        Message* pMessage = new Message;
+        pMessage->pFlushed = &flushed;
+        if (enqueue(pMessage)) flushed.get_future().wait();
+        else consumeQueue();
+#endif
+    }
+
+    void Logger::log(Level L, const std::string& msg, MsgBox mbox, bool terminateOnError)
+    {
+#if _LOG_ENABLED
+        if (L >= sVerbosity)
+        {
+            Message* pMessage = new Message;
+            pMessage->level = L;
+            pMessage->text = msg;
+            pMessage->time = getTime();
+            pMessage->thread = getThreadIndex();
+            if (!enqueue(pMessage)) consumeQueue();
+
+            // Make sure errors are written before the application shows a message box or terminates.
+            if (L >= Level::Error) flush();
         }
 #endif
 
@@ -177,22 +437,36 @@ namespace Falcor
                 else if (L >= Level::Error) icon = MsgBoxIcon::Error;
 
                 // Show message box
+                flush();
                 auto result = msgBox(msg, buttons, icon);
                 if (result == Debug) debugBreak();
-                else if (result == Abort) exit(1);
+                else if (result == Abort)
+                {
+                    shutdown();
+                    exit(1);
+                }
             }
         }
 
         // Terminate on errors if not displaying message box and terminateOnError is enabled
-        if (L == Level::Error && !sShowBoxOnError && terminateOnError) exit(1);
+        if (L == Level::Error && !sShowBoxOnError && terminateOnError)
+        {
+            shutdown();
+            exit(1);
+        }
 
         // Always terminate on fatal errors
-        if (L == Level::Fatal) exit(1);
+        if (L == Level::Fatal)
+        {
+            shutdown();
+            exit(1);
+        }
     }
 
     bool Logger::setLogFilePath(const std::string& path)
     {
 #if _LOG_ENABLED
+        std::lock_guard<std::mutex> lock(sConsumeMutex);
         if (sLogFile)
         {
             return false;
@@ -207,10 +481,38 @@ namespace Falcor
 #endif
     }
 
+    bool Logger::setJsonLogFilePath(const std::string& path)
+    {
+#if _LOG_ENABLED
+        // Write the pending messages to the previous file.
+        flush();
+
+        std::lock_guard<std::mutex> lock(sConsumeMutex);
+        if (sJsonLogFile)
+        {
+            fclose(sJsonLogFile);
+            sJsonLogFile = nullptr;
+        }
+        if (path.empty()) return true;
+
+        sJsonLogFile = std::fopen(path.c_str(), "w");
+        return sJsonLogFile != nullptr;
+#else
+        return false;
+#endif
+    }
+
     const std::string& Logger::getLogFilePath() { return sLogFilePath; }
     void Logger::logToConsole(bool enable) { sLogToConsole = enable; }
     bool Logger::shouldLogToConsole() { return sLogToConsole; }
     void Logger::showBoxOnError(bool showBox) { sShowBoxOnError = showBox; }
     bool Logger::isBoxShownOnError() { return sShowBoxOnError; }
     void Logger::setVerbosity(Level level) { sVerbosity = level; }
+#if _LOG_ENABLED
+    void Logger::foldRepeatedMessages(bool enable) { sFoldRepeated = enable; }
+    bool Logger::shouldFoldRepeatedMessages() { return sFoldRepeated; }
+#else
+    void Logger::foldRepeatedMessages(bool enable) {}
+    bool Logger::shouldFoldRepeatedMessages() { return false; }
+#endif
 }
@@ -32,6 +32,9 @@ namespace Falcor
     /** Container class for logging messages.
     *   To enable log messages, make sure _LOG_ENABLED is set to true in FalcorConfig.h.
     *   Messages are printed to a log file in the application directory. Using Logger#ShowBoxOnError() you can control if a message box will be shown as well.
+    *   Logging is asynchronous. Messages are pushed onto a lock-free queue and written in batches by a background thread. The queue is flushed before
+    *   showing a message box, on errors, and at shutdown. Call Logger#flush() to wait until all previous messages are written.
+    *   Messages can also be written to a JSON-lines file for machine ingestion, see Logger#setJsonLogFilePath().
     */
     class dlldecl Logger
     {
@@ -57,10 +60,15 @@ namespace Falcor
             None            ///< Don't show a message box.
         };
 
-        /** Shutdown the logger and close the log file.
+        /** Shutdown the logger, write all pending messages and close the log files.
+            Messages logged after shutdown are written synchronously.
         */
         static void shutdown();
 
+        /** Block until all messages logged so far have been written.
+        */
+        static void flush();
+
         /** Set the path of the logfile.
             Note: This only works if the logfile has not been opened for writing yet.
             \param[in] path Logfile path
@@ -73,6 +81,13 @@ namespace Falcor
         */
         static const std::string& getLogFilePath();
 
+        /** Set the path of a JSON-lines log file. Each message is written as a JSON object on a separate line.
+            The file is created immediately. Messages logged before this call aren't written to it.
+            \param[in] path JSON log file path, or an empty string to close the JSON log file.
+            \return Returns true if the file was opened or closed, false otherwise.
+        */
+        static bool setJsonLogFilePath(const std::string& path);
+
         /** Enable/disable logging to the console (stdout).
             \param[in] enable True to enable logging to stdout.
         */
@@ -102,6 +117,16 @@ namespace Falcor
         */
         static void setVerbosity(Level level);
 
+        /** Enable/disable folding of repeated messages.
+            When enabled, consecutive identical messages are written once, followed by a line with the repeat count. The count is written at least once per written batch.
+            \param[in] enable True to fold repeated messages. Enabled by default.
+        */
+        static void foldRepeatedMessages(bool enable);
+
+        /** Returns true if repeated messages are folded.
+        */
+        static bool shouldFoldRepeatedMessages();
+
     private:
         friend void logInfo(const std::string& msg, MsgBox mbox);
         friend void logWarning(const std::string& msg, MsgBox mbox);
@@ -221,6 +221,36 @@ namespace Falcor
         return res;
     }
 
+    /** Escape a string for use inside a JSON string literal. Quotes, backslashes and control characters are escaped.
+        \param input The input string
+        \return The escaped string, without surrounding quotes
+    */
+    inline std::string escapeJsonString(const std::string& input)
+    {
+        std::string res;
+        res.reserve(input.size());
+        for (char c : input)
+        {
+            switch (c)
+            {
+            case '"': res += "\\\""; break;
+            case '\\': res += "\\\\"; break;
+            case '\n': res += "\\n"; break;
+            case '\r': res += "\\r"; break;
+            case '\t': res += "\\t"; break;
+            default:
+                if ((unsigned char)c < 0x20)
+                {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    res += buf;
+                }
+                else res += c;
+            }
+        }
+        return res;
+    }
+
     /** Parses a string in the format <name>[<index>]. If format is valid, outputs the base name and the array index.
         \param[in] name String to parse
         \param[out] nonArray Becomes set to the non-array index portion of the string
@@ -27,69 +27,326 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "Threading.h"
+#include <deque>
 
 namespace Falcor
 {
+    struct Threading::Task::State
+    {
+        std::function<void(void)> func;
+        std::atomic<bool> done = false;
+        std::exception_ptr pException;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<std::shared_ptr<State>> continuations;
+    };
+
     namespace
     {
+        using TaskState = Threading::Task::State;
+
+        struct Worker
+        {
+            std::mutex mutex;
+            std::deque<std::shared_ptr<TaskState>> tasks;
+            std::thread thread;
+        };
+
         struct ThreadingData
         {
             bool initialized = false;
-            std::vector<std::thread> threads;
-            uint32_t current;
+            std::vector<std::unique_ptr<Worker>> workers;
+            std::atomic<uint32_t> current = 0;
+
+            std::atomic<bool> stop = false;
+            std::atomic<uint32_t> queuedTasks = 0;      ///< Number of tasks waiting in a deque.
+            std::atomic<uint32_t> pendingTasks = 0;     ///< Number of tasks queued or executing.
+            std::mutex sleepMutex;
+            std::condition_variable wakeCV;
         } gData;
+
+        /** Index of the worker owned by the current thread, -1 on non-worker threads.
+        */
+        thread_local int32_t sWorkerIndex = -1;
+
+        /** Number of tasks currently executing on the calling thread (tasks can nest when helping while waiting).
+        */
+        thread_local uint32_t sExecutingTasks = 0;
+
+        void pushTask(const std::shared_ptr<TaskState>& pState)
+        {
+            uint32_t workerCount = (uint32_t)gData.workers.size();
+            uint32_t index = sWorkerIndex >= 0 ? (uint32_t)sWorkerIndex : gData.current.fetch_add(1) % workerCount;
+            gData.pendingTasks++;
+            {
+                // Take the sleep lock so that a worker can't miss the wake-up between checking the predicate and going to sleep.
+                std::lock_guard<std::mutex> lock(gData.sleepMutex);
+                gData.queuedTasks++;
+            }
+            {
+                std::lock_guard<std::mutex> lock(gData.workers[index]->mutex);
+                gData.workers[index]->tasks.push_back(pState);
+            }
+            gData.wakeCV.notify_one();
+        }
+
+        std::shared_ptr<TaskState> popTask()
+        {
+            uint32_t workerCount = (uint32_t)gData.workers.size();
+            if (workerCount == 0 || gData.queuedTasks == 0) return nullptr;
+
+            // Pop the most recent task from the own deque first, then steal the oldest task from the other workers.
+            uint32_t start = sWorkerIndex >= 0 ? (uint32_t)sWorkerIndex : gData.current.load() % workerCount;
+            for (uint32_t i = 0; i < workerCount; i++)
+            {
+                uint32_t index = (start + i) % workerCount;
+                Worker& worker = *gData.workers[index];
+                std::lock_guard<std::mutex> lock(worker.mutex);
+                if (worker.tasks.empty()) continue;
+
+                std::shared_ptr<TaskState> pState;
+                if (i == 0 && sWorkerIndex >= 0)
+                {
+                    pState = std::move(worker.tasks.back());
+                    worker.tasks.pop_back();
+                }
+                else
+                {
+                    pState = std::move(worker.tasks.front());
+                    worker.tasks.pop_front();
+                }
+                gData.queuedTasks--;
+                return pState;
+            }
+            return nullptr;
+        }
+
+        void executeTask(const std::shared_ptr<TaskState>& pState)
+        {
+            sExecutingTasks++;
+            try
+            {
+                pState->func();
+            }
+            catch (...)
+            {
+                pState->pException = std::current_exception();
+            }
+            sExecutingTasks--;
+            pState->func = nullptr;
+
+            std::vector<std::shared_ptr<TaskState>> continuations;
+            {
+                std::lock_guard<std::mutex> lock(pState->mutex);
+                pState->done = true;
+                continuations.swap(pState->continuations);
+            }
+            pState->cv.notify_all();
+
+            for (const auto& pNext : continuations) pushTask(pNext);
+            gData.pendingTasks--;
+        }
+
+        /** Execute one queued task on the calling thread.
+            \return True if a task was executed.
+        */
+        bool helpExecute()
+        {
+            auto pState = popTask();
+            if (!pState) return false;
+            executeTask(pState);
+            return true;
+        }
+
+        void workerLoop(int32_t index)
+        {
+            sWorkerIndex = index;
+            while (true)
+            {
+                if (helpExecute()) continue;
+
+                std::unique_lock<std::mutex> lock(gData.sleepMutex);
+                gData.wakeCV.wait(lock, [] { return gData.stop || gData.queuedTasks > 0; });
+                if (gData.stop && gData.queuedTasks == 0) break;
+            }
+            sWorkerIndex = -1;
+        }
+
+        std::shared_ptr<TaskState> createTaskState(const std::function<void(void)>& func)
+        {
+            auto pState = std::make_shared<TaskState>();
+            pState->func = func;
+            return pState;
+        }
     }
 
     void Threading::start(uint32_t threadCount)
     {
         if (gData.initialized) return;
 
-        gData.threads.resize(threadCount);
+        threadCount = std::max(threadCount, 1u);
+        gData.stop = false;
+        gData.workers.resize(threadCount);
+        for (auto& pWorker : gData.workers) pWorker = std::make_unique<Worker>();
+        for (uint32_t i = 0; i < threadCount; i++) gData.workers[i]->thread = std::thread(workerLoop, (int32_t)i);
         gData.initialized = true;
     }
 
     void Threading::shutdown()
     {
-        for (auto& t : gData.threads)
+        if (!gData.initialized) return;
+
+        finish();
+        {
+            std::lock_guard<std::mutex> lock(gData.sleepMutex);
+            gData.stop = true;
+        }
+        gData.wakeCV.notify_all();
+
+        for (auto& pWorker : gData.workers)
         {
-            if (t.joinable()) t.join();
+            if (pWorker->thread.joinable()) pWorker->thread.join();
         }
 
+        gData.workers.clear();
         gData.initialized = false;
     }
 
-    Threading::Task Threading::dispatchTask(const std::function<void(void)>& func)
+    uint32_t Threading::getThreadCount()
     {
-        assert(gData.initialized);
+        return (uint32_t)gData.workers.size();
+    }
 
-        std::thread& t = gData.threads[gData.current];
-        if (t.joinable()) t.join();
-        t = std::thread(func);
-        gData.current = (gData.current + 1) % gData.threads.size();
+    Threading::Task Threading::dispatchTask(const std::function<void(void)>& func)
+    {
+        auto pState = createTaskState(func);
+        if (!gData.initialized)
+        {
+            gData.pendingTasks++;
+            executeTask(pState);
+            return Task(pState);
+        }
 
-        return Task();
+        pushTask(pState);
+        return Task(pState);
     }
 
     void Threading::finish()
     {
-        for (auto& t : gData.threads)
+        // The pending count includes the calling task, so waiting from within a task would never return.
+        assert(sWorkerIndex < 0 && sExecutingTasks == 0);
+        while (gData.pendingTasks > 0)
         {
-            if (t.joinable()) t.join();
+            if (!helpExecute()) std::this_thread::yield();
         }
     }
 
-    Threading::Task::Task()
+    size_t Threading::getGrainSize(size_t begin, size_t end, size_t grainSize)
     {
+        if (grainSize > 0) return grainSize;
+        size_t count = end - begin;
+        return std::max<size_t>(1, (count + kDefaultChunkCount - 1) / kDefaultChunkCount);
     }
 
-    bool Threading::Task::isRunning()
+    void Threading::parallelFor(size_t begin, size_t end, const std::function<void(size_t)>& func, size_t grainSize)
     {
-        logError("Threading::Task::isRunning() not implemented");
-        return true;
+        parallelForRange(begin, end, [&func](size_t first, size_t last)
+        {
+            for (size_t i = first; i < last; i++) func(i);
+        }, grainSize);
     }
 
-    void Threading::Task::finish()
+    void Threading::parallelForRange(size_t begin, size_t end, const std::function<void(size_t, size_t)>& func, size_t grainSize)
     {
-        logError("Threading::Task::finish() not implemented");
+        if (end <= begin) return;
+        grainSize = getGrainSize(begin, end, grainSize);
+        const size_t chunkCount = (end - begin + grainSize - 1) / grainSize;
+
+        // Execute serially if there is nothing to distribute.
+        if (chunkCount == 1 || !gData.initialized)
+        {
+            for (size_t first = begin; first < end; first += grainSize) func(first, std::min(end, first + grainSize));
+            return;
+        }
+
+        // Chunks are claimed from a shared counter by the calling thread and by helper tasks.
+        // The loop state lives on the stack of the calling thread, which waits for all helpers before returning.
+        struct LoopState
+        {
+            std::atomic<size_t> nextChunk = 0;
+            std::atomic<bool> failed = false;
+            std::exception_ptr pException;
+            std::mutex exceptionMutex;
+        } loop;
+
+        auto runChunks = [&]()
+        {
+            size_t chunk;
+            while (!loop.failed && (chunk = loop.nextChunk.fetch_add(1)) < chunkCount)
+            {
+                size_t first = begin + chunk * grainSize;
+                try
+                {
+                    func(first, std::min(end, first + grainSize));
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(loop.exceptionMutex);
+                    if (!loop.pException) loop.pException = std::current_exception();
+                    loop.failed = true;
+                }
+            }
+        };
+
+        const size_t helperCount = std::min<size_t>(chunkCount - 1, gData.workers.size());
+        std::vector<Task> helpers;
+        helpers.reserve(helperCount);
+        for (size_t i = 0; i < helperCount; i++) helpers.push_back(dispatchTask(runChunks));
+
+        runChunks();
+        for (const auto& helper : helpers) helper.finish();
+
+        if (loop.pException) std::rethrow_exception(loop.pException);
+    }
+
+    bool Threading::Task::isRunning() const
+    {
+        return mpState && !mpState->done;
+    }
+
+    void Threading::Task::finish() const
+    {
+        if (!mpState) return;
+
+        while (!mpState->done)
+        {
+            // Help executing other tasks. This avoids deadlocks when waiting from within a task.
+            if (helpExecute()) continue;
+
+            std::unique_lock<std::mutex> lock(mpState->mutex);
+            mpState->cv.wait_for(lock, std::chrono::milliseconds(1), [this] { return mpState->done.load(); });
+        }
+
+        if (mpState->pException) std::rethrow_exception(mpState->pException);
+    }
+
+    Threading::Task Threading::Task::then(const std::function<void(void)>& func) const
+    {
+        // Without a running pool, tasks execute immediately and are always finished.
+        if (!mpState || !gData.initialized) return dispatchTask(func);
+
+        auto pNext = createTaskState(func);
+        {
+            std::lock_guard<std::mutex> lock(mpState->mutex);
+            if (!mpState->done)
+            {
+                // The continuation is queued by the thread finishing this task.
+                mpState->continuations.push_back(pNext);
+                return Task(pNext);
+            }
+        }
+
+        pushTask(pNext);
+        return Task(pNext);
     }
 }
@@ -26,32 +26,65 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #pragma once
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 namespace Falcor
 {
+    /** Global work-stealing thread pool.
+
+        Each worker thread owns a task deque. Tasks dispatched from a worker are pushed onto its own deque
+        and popped in LIFO order, idle workers steal from the other end of the other deques. Tasks dispatched
+        from non-worker threads are distributed round-robin. Threads waiting on a task (or on a parallel loop)
+        help executing queued tasks, so it is safe to wait on tasks from within a task.
+    */
     class dlldecl Threading
     {
     public:
         const static uint32_t kDefaultThreadCount = 16;
 
-        /** Handle to a dispatched task
+        /** Default number of chunks a parallel loop is split into when no grain size is specified.
+            The chunking only depends on the loop range, never on the number of threads, so parallelReduce() is deterministic.
+        */
+        const static uint32_t kDefaultChunkCount = 256;
 
-            TODO: Implementation
+        /** Handle to a dispatched task.
+            Handles are cheap to copy and share the same completion state.
         */
-        class Task
+        class dlldecl Task
         {
         public:
+            /** Create an empty handle. An empty task is never running.
+            */
+            Task() = default;
+
             /** Check if task is still executing
             */
-            bool isRunning();
+            bool isRunning() const;
 
-            /** Wait for task to finish executing
+            /** Wait for task to finish executing.
+                The calling thread executes other queued tasks while waiting.
+                If the task threw an exception, it is rethrown here.
             */
-            void finish();
+            void finish() const;
+
+            /** Dispatch a continuation task that starts once this task has finished.
+                If the task has already finished, the continuation is dispatched immediately.
+                \param[in] func Function to execute.
+                \return Handle to the continuation task.
+            */
+            Task then(const std::function<void(void)>& func) const;
+
+            struct State; ///< Internal completion state, shared between handles.
 
         private:
-            Task();
+            Task(const std::shared_ptr<State>& pState) : mpState(pState) {}
+            std::shared_ptr<State> mpState;
             friend class Threading;
         };
 
@@ -60,7 +93,8 @@ namespace Falcor
         */
         static void start(uint32_t threadCount = kDefaultThreadCount);
 
-        /** Waits for all currently executing threads to finish
+        /** Waits for all currently executing threads to finish.
+            Must not be called from within a task, use Task::finish() to wait on specific tasks instead.
         */
         static void finish();
 
@@ -72,9 +106,63 @@ namespace Falcor
         */
         static uint32_t getLogicalThreadCount() { return std::thread::hardware_concurrency(); }
 
+        /** Returns the number of worker threads in the pool, or 0 if the pool is not running.
+        */
+        static uint32_t getThreadCount();
+
         /** Starts a task on an available thread.
+            If the thread pool is not running, the task is executed immediately on the calling thread.
             \return Handle to the task
         */
         static Task dispatchTask(const std::function<void(void)>& func);
+
+        /** Execute a function for each index in [begin, end) in parallel. The call returns when all iterations have finished.
+            \param[in] begin First index.
+            \param[in] end One past the last index.
+            \param[in] func Function called for each index.
+            \param[in] grainSize Number of indices processed per chunk. If 0, the range is split into kDefaultChunkCount chunks.
+        */
+        static void parallelFor(size_t begin, size_t end, const std::function<void(size_t)>& func, size_t grainSize = 0);
+
+        /** Execute a function for sub-ranges of [begin, end) in parallel. The call returns when all chunks have finished.
+            \param[in] begin First index.
+            \param[in] end One past the last index.
+            \param[in] func Function called with the sub-range [first, last) of each chunk.
+            \param[in] grainSize Number of indices processed per chunk. If 0, the range is split into kDefaultChunkCount chunks.
+        */
+        static void parallelForRange(size_t begin, size_t end, const std::function<void(size_t, size_t)>& func, size_t grainSize = 0);
+
+        /** Parallel reduction over [begin, end).
+            Each chunk is reduced with `reduceRange` starting from `identity`, the per-chunk results are then combined
+            in chunk order on the calling thread. The result is therefore deterministic, even for non-associative operations.
+            \param[in] begin First index.
+            \param[in] end One past the last index.
+            \param[in] identity Identity value of the reduction.
+            \param[in] reduceRange Function reducing the sub-range [first, last) into the passed-in value and returning it.
+            \param[in] combine Function combining two partial results.
+            \param[in] grainSize Number of indices processed per chunk. If 0, the range is split into kDefaultChunkCount chunks.
+            \return The reduced value.
+        */
+        template<typename T, typename ReduceFunc, typename CombineFunc>
+        static T parallelReduce(size_t begin, size_t end, const T& identity, const ReduceFunc& reduceRange, const CombineFunc& combine, size_t grainSize = 0)
+        {
+            if (end <= begin) return identity;
+            grainSize = getGrainSize(begin, end, grainSize);
+            // Not a std::vector, whose bool specialization packs the partial results of different chunks into the same word.
+            size_t chunkCount = (end - begin + grainSize - 1) / grainSize;
+            std::unique_ptr<T[]> partials(new T[chunkCount]);
+            std::fill_n(partials.get(), chunkCount, identity);
+            parallelForRange(begin, end, [&](size_t first, size_t last)
+            {
+                partials[(first - begin) / grainSize] = reduceRange(first, last, identity);
+            }, grainSize);
+
+            T result = identity;
+            for (size_t i = 0; i < chunkCount; i++) result = combine(result, partials[i]);
+            return result;
+        }
+
+    private:
+        static size_t getGrainSize(size_t begin, size_t end, size_t grainSize);
     };
 }
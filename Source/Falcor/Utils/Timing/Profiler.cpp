@@ -30,6 +30,10 @@
 #include "Core/API/GpuTimer.h"
 #include <sstream>
 #include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <set>
+#include <thread>
 #define USE_PIX
 #include "WinPixEventRuntime/Include/WinPixEventRuntime/pix3.h"
 
@@ -37,222 +41,628 @@ namespace Falcor
 {
     bool gProfileEnabled = false;
 
-    std::unordered_map<std::string, Profiler::EventData*> Profiler::sProfilerEvents;
-    std::vector<Profiler::EventData*> Profiler::sRegisteredEvents;
-    std::string curEventName = "";
-    uint32_t Profiler::sCurrentLevel = 0;
-    uint32_t Profiler::sGpuTimerIndex = 0;
-
-    void Profiler::initNewEvent(EventData *pEvent, const std::string& name)
+    namespace
     {
-        pEvent->name = name;
-        sProfilerEvents[curEventName] = pEvent;
-    }
+        using NameID = Profiler::NameID;
 
-    Profiler::EventData* Profiler::createNewEvent(const std::string& name)
-    {
-        EventData *pData = new EventData;
-        initNewEvent(pData, name);
-        return pData;
-    }
+        // Interned names are stored in fixed-size chunks that are never moved or freed, so getName() doesn't need a lock.
+        const uint32_t kNameChunkBits = 10;
+        const uint32_t kNameChunkSize = 1 << kNameChunkBits;
+        const uint32_t kMaxNameChunks = 256;
 
-    Profiler::EventData* Profiler::isEventRegistered(const std::string& name)
-    {
-        auto event = sProfilerEvents.find(name);
-        return (event == sProfilerEvents.end()) ? nullptr : event->second;
-    }
+        const uint64_t kRingBufferSize = 1 << 16;       // Records per thread. Must be a power of two.
 
-    Profiler::EventData* Profiler::getEvent(const std::string& name)
-    {
-        auto event = isEventRegistered(name);
-        return event ? event : createNewEvent(name);
-    }
+        const uint32_t kEndFlag = 0x80000000;           // Set in Record::data for end records.
+        const uint32_t kGpuBufferShift = 30;            // Bit of Record::data holding the GPU timer buffer index.
+        const uint32_t kGpuTimerMask = (1 << kGpuBufferShift) - 1;
+        const uint32_t kNoGpuTimer = kGpuTimerMask;
+        const uint32_t kNotRecorded = 0xffffffff;       // Open event which wasn't recorded, either because profiling was disabled or the buffer was full.
 
-    void Profiler::startEvent(const std::string& name, Flags flags, bool showInMsg)
-    {
-        if (gProfileEnabled && is_set(flags, Flags::Internal))
+        const uint32_t kInvalidNode = 0xffffffff;
+
+        /** Begin or end of an event, as written by the producing thread.
+        */
+        struct Record
+        {
+            int64_t timestamp;      ///< CpuTimer ticks.
+            NameID name;
+            uint32_t data;          ///< kEndFlag for end records. The remaining bits hold the GPU timer buffer and index, or kNoGpuTimer.
+        };
+
+        struct ThreadBuffer
         {
-            curEventName = curEventName + "#" + name;
-            EventData* pData = getEvent(curEventName);
-            pData->triggered++;
-            if (pData->triggered > 1)
+            uint32_t threadIndex = 0;
+            bool isMainThread = false;
+
+            // Single-producer/single-consumer ring, written by the owning thread and drained on the main thread.
+            std::vector<Record> records = std::vector<Record>(kRingBufferSize);
+            std::atomic<uint64_t> writePos{ 0 };
+            std::atomic<uint64_t> readPos{ 0 };
+            std::atomic<uint64_t> droppedEvents{ 0 };
+            std::atomic<bool> exited{ false };
+
+            // Producer state.
+            uint64_t pendingEnds = 0;   ///< Recorded events waiting for their end record. Space is reserved for them in the ring.
+
+            // Consumer state.
+            struct OpenNode
             {
-                logWarning("Profiler event '" + name + "' was triggered while it is already running. Nesting profiler events with the same name is disallowed and you should probably fix that. Ignoring the new call");
-                return;
+                uint32_t node;
+                int64_t start;
+            };
+            std::vector<OpenNode> nodeStack;
+            uint32_t rootNode = kInvalidNode;
+        };
+
+        /** Owns the thread's buffer reference and flags the buffer when the thread exits, so endFrame() can release it.
+        */
+        struct ThreadBufferHolder
+        {
+            std::shared_ptr<ThreadBuffer> pBuffer;
+            ~ThreadBufferHolder() { if (pBuffer) pBuffer->exited = true; }
+        };
+
+        /** Event hierarchy node. Nodes are only accessed on the main thread.
+        */
+        struct Node
+        {
+            NameID name;
+            uint32_t parent;
+            uint32_t threadIndex;
+            int32_t level;              ///< Indentation level. The main thread root has level -1 and isn't displayed.
+            std::string path;
+            std::unordered_map<NameID, uint32_t> children;
+            std::vector<uint32_t> childList;    ///< Children in the order they were created.
+            double cpuTime = 0;         ///< Accumulated in the current frame.
+            double gpuTime = 0;
+            double lastCpuTime = 0;     ///< Result of the last frame.
+            double lastGpuTime = 0;
+            double cpuRunningAverageMS = -1.;   // Negative value to signify invalid
+            double gpuRunningAverageMS = -1.;
+            uint64_t activeFrame = ~0ull;
+#if _PROFILING_LOG == 1
+            int stepNr = 0;
+            int filesWritten = 0;
+            float cpuMs[_PROFILING_LOG_BATCH_SIZE];
+            float gpuMs[_PROFILING_LOG_BATCH_SIZE];
+#endif
+        };
+
+        struct TraceEvent
+        {
+            NameID name;
+            uint32_t threadIndex;
+            int64_t start;
+            int64_t end;
+        };
+
+        const std::thread::id sMainThreadID = std::this_thread::get_id();
+
+        std::mutex sNameMutex;
+        std::unordered_map<std::string, NameID> sNameIDs;
+        std::atomic<std::string*> sNameChunks[kMaxNameChunks];
+        uint32_t sNameCount = 0;
+
+        std::mutex sThreadMutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> sThreadBuffers;
+        uint32_t sThreadCount = 0;
+        uint64_t sDroppedEventsOfExitedThreads = 0;
+
+        std::atomic<bool> sCapturing{ false };
+
+        // Main thread state.
+        std::vector<Node> sNodes;
+        std::unordered_map<std::string, uint32_t> sNodesByPath;
+        std::vector<uint32_t> sRootNodes;       // One root per thread.
+        std::vector<uint32_t> sActiveNodes;     // Nodes that ran in the current frame.
+        std::vector<uint32_t> sFrameNodes;      // Nodes that ran in the last frame, in display order.
+        uint64_t sFrameIndex = 0;
+
+        std::vector<GpuTimer::SharedPtr> sGpuTimers[2]; // Double-buffering, to avoid GPU flushes
+        std::vector<uint32_t> sGpuTimerNodes[2];
+        uint32_t sGpuTimerCount[2] = { 0, 0 };
+        uint32_t sGpuTimerIndex = 0;
+
+        int64_t sCaptureStart = 0;
+        std::vector<TraceEvent> sTraceEvents;
+        std::vector<int64_t> sTraceFrames;
+
+        int64_t getTimestamp()
+        {
+            return CpuTimer::getCurrentTimePoint().time_since_epoch().count();
+        }
+
+        double ticksToMS(int64_t ticks)
+        {
+            using Period = CpuTimer::TimePoint::period;
+            return (double)ticks * 1000.0 * Period::num / Period::den;
+        }
+
+        std::shared_ptr<ThreadBuffer> registerThread()
+        {
+            auto pBuffer = std::make_shared<ThreadBuffer>();
+            pBuffer->isMainThread = std::this_thread::get_id() == sMainThreadID;
+
+            std::lock_guard<std::mutex> lock(sThreadMutex);
+            pBuffer->threadIndex = pBuffer->isMainThread ? 0 : ++sThreadCount;
+            sThreadBuffers.push_back(pBuffer);
+            return pBuffer;
+        }
+
+        ThreadBuffer& getThreadBuffer()
+        {
+            thread_local ThreadBufferHolder holder;
+            if (!holder.pBuffer) holder.pBuffer = registerThread();
+            return *holder.pBuffer;
+        }
+
+        /** Per-thread stack with one entry per open event, holding its Record::data or kNotRecorded.
+            Kept apart from the thread buffer so that the ring is only allocated once a thread records an event.
+        */
+        std::vector<uint32_t>& getOpenEvents()
+        {
+            thread_local std::vector<uint32_t> openEvents;
+            return openEvents;
+        }
+
+        /** Append a record to the ring, keeping 'reserve' free slots for end records. Only called by the owning thread.
+        */
+        bool pushRecord(ThreadBuffer& buffer, const Record& record, uint64_t reserve)
+        {
+            uint64_t writePos = buffer.writePos.load(std::memory_order_relaxed);
+            uint64_t used = writePos - buffer.readPos.load(std::memory_order_acquire);
+            if (used + reserve >= kRingBufferSize) return false;
+            buffer.records[writePos & (kRingBufferSize - 1)] = record;
+            buffer.writePos.store(writePos + 1, std::memory_order_release);
+            return true;
+        }
+
+        uint32_t createNode(NameID name, uint32_t parent, uint32_t threadIndex)
+        {
+            Node node;
+            node.name = name;
+            node.parent = parent;
+            node.threadIndex = threadIndex;
+            node.level = parent == kInvalidNode ? (threadIndex == 0 ? -1 : 0) : sNodes[parent].level + 1;
+            node.path = parent == kInvalidNode ? (threadIndex == 0 ? "" : "#" + Profiler::getName(name)) : sNodes[parent].path + "#" + Profiler::getName(name);
+
+            uint32_t index = (uint32_t)sNodes.size();
+            sNodesByPath[node.path] = index;
+            sNodes.push_back(std::move(node));
+            if (parent == kInvalidNode) sRootNodes.push_back(index);
+            else sNodes[parent].childList.push_back(index);
+            return index;
+        }
+
+        uint32_t getChildNode(uint32_t parent, NameID name)
+        {
+            auto it = sNodes[parent].children.find(name);
+            if (it != sNodes[parent].children.end()) return it->second;
+            uint32_t child = createNode(name, parent, sNodes[parent].threadIndex);
+            sNodes[parent].children[name] = child;
+            return child;
+        }
+
+        void appendActiveNodes(uint32_t index, std::vector<uint32_t>& nodes)
+        {
+            if (sNodes[index].activeFrame != sFrameIndex) return;
+            if (sNodes[index].level >= 0) nodes.push_back(index);
+            for (uint32_t child : sNodes[index].childList) appendActiveNodes(child, nodes);
+        }
+
+        void activateNode(uint32_t index)
+        {
+            Node& node = sNodes[index];
+            if (node.activeFrame == sFrameIndex) return;
+            if (node.parent != kInvalidNode) activateNode(node.parent);
+            sNodes[index].activeFrame = sFrameIndex;
+            sActiveNodes.push_back(index);
+        }
+
+        /** Consume the records written by a thread and accumulate them into the event hierarchy.
+        */
+        void drainThread(ThreadBuffer& buffer)
+        {
+            if (buffer.rootNode == kInvalidNode)
+            {
+                NameID rootName = buffer.isMainThread ? Profiler::getNameID("Main thread") : Profiler::getNameID("Thread " + std::to_string(buffer.threadIndex));
+                buffer.rootNode = createNode(rootName, kInvalidNode, buffer.threadIndex);
             }
 
-            pData->showInMsg = showInMsg;
-            pData->level = sCurrentLevel;
-            pData->cpuStart = CpuTimer::getCurrentTimePoint();
-            EventData::FrameData& frame = pData->frameData[sGpuTimerIndex];
-            if (frame.currentTimer >= frame.pTimers.size())
+            uint64_t readPos = buffer.readPos.load(std::memory_order_relaxed);
+            const uint64_t writePos = buffer.writePos.load(std::memory_order_acquire);
+            bool capturing = sCapturing.load(std::memory_order_relaxed);
+
+            for (; readPos < writePos; readPos++)
             {
-                frame.pTimers.push_back(GpuTimer::create());
+                const Record& record = buffer.records[readPos & (kRingBufferSize - 1)];
+                if ((record.data & kEndFlag) == 0)
+                {
+                    uint32_t parent = buffer.nodeStack.empty() ? buffer.rootNode : buffer.nodeStack.back().node;
+                    uint32_t node = getChildNode(parent, record.name);
+                    activateNode(node);
+                    buffer.nodeStack.push_back({ node, record.timestamp });
+                }
+                else
+                {
+                    assert(!buffer.nodeStack.empty());
+                    if (buffer.nodeStack.empty()) continue;
+                    auto open = buffer.nodeStack.back();
+                    buffer.nodeStack.pop_back();
+                    assert(sNodes[open.node].name == record.name);
+
+                    activateNode(open.node);
+                    sNodes[open.node].cpuTime += ticksToMS(record.timestamp - open.start);
+
+                    uint32_t gpuTimer = record.data & kGpuTimerMask;
+                    if (gpuTimer != kNoGpuTimer)
+                    {
+                        uint32_t gpuBuffer = (record.data & ~kEndFlag) >> kGpuBufferShift;
+                        sGpuTimerNodes[gpuBuffer][gpuTimer] = open.node;
+                    }
+
+                    if (capturing && open.start >= sCaptureStart)
+                    {
+                        sTraceEvents.push_back({ record.name, buffer.threadIndex, open.start, record.timestamp });
+                    }
+                }
+            }
+
+            buffer.readPos.store(readPos, std::memory_order_release);
+        }
+
+        /** Drain all thread buffers and release the buffers of threads that exited.
+        */
+        void drainAllThreads()
+        {
+            assert(std::this_thread::get_id() == sMainThreadID);
+
+            std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+            {
+                std::lock_guard<std::mutex> lock(sThreadMutex);
+                buffers = sThreadBuffers;
             }
-            frame.pTimers[frame.currentTimer]->begin();
-            pData->callStack.push(frame.currentTimer);
-            frame.currentTimer++;
-            sCurrentLevel++;
 
-            if (!pData->registered)
+            for (const auto& pBuffer : buffers)
             {
-                sRegisteredEvents.push_back(pData);
-                pData->registered = true;
+                // Read the exit flag before draining, records written before the thread exited are then guaranteed to be visible.
+                bool exited = pBuffer->exited.load();
+                drainThread(*pBuffer);
+                if (exited)
+                {
+                    std::lock_guard<std::mutex> lock(sThreadMutex);
+                    sDroppedEventsOfExitedThreads += pBuffer->droppedEvents.load();
+                    sThreadBuffers.erase(std::find(sThreadBuffers.begin(), sThreadBuffers.end(), pBuffer));
+                }
             }
         }
-        if (is_set(flags, Flags::Pix))
+
+#if _PROFILING_LOG == 1
+        void writeLog(Node& node)
         {
-            PIXBeginEvent((ID3D12GraphicsCommandList*)gpDevice->getRenderContext()->getLowLevelData()->getCommandList(), PIX_COLOR(0, 0, 0), name.c_str());
+            std::ostringstream logOss, fileOss;
+            logOss << "dumping " << "profile_" << node.path << "_" << node.filesWritten;
+            logInfo(logOss.str());
+            fileOss << "profile_" << node.path << "_" << node.filesWritten++;
+            std::ofstream out(fileOss.str().c_str());
+            for (int i = 0; i < node.stepNr; ++i)
+            {
+                out << node.cpuMs[i] << " " << node.gpuMs[i] << "\n";
+            }
+            node.stepNr = 0;
         }
+#endif
     }
 
-    void Profiler::endEvent(const std::string& name, Flags flags)
+    Profiler::NameID Profiler::getNameID(const std::string& name)
     {
-        if (gProfileEnabled && is_set(flags, Flags::Internal))
-        {
-            assert(isEventRegistered(curEventName));
-            EventData* pData = getEvent(curEventName);
-            pData->triggered--;
-            if (pData->triggered != 0) return;
-
-            pData->cpuEnd = CpuTimer::getCurrentTimePoint();
-            pData->cpuTotal += CpuTimer::calcDuration(pData->cpuStart, pData->cpuEnd);
-
-            pData->frameData[sGpuTimerIndex].pTimers[pData->callStack.top()]->end();
-            pData->callStack.pop();
+        std::lock_guard<std::mutex> lock(sNameMutex);
+        auto it = sNameIDs.find(name);
+        if (it != sNameIDs.end()) return it->second;
 
-            sCurrentLevel--;
-            curEventName.erase(curEventName.find_last_of("#"));
+        if (sNameCount == kNameChunkSize * kMaxNameChunks)
+        {
+            logError("Profiler ran out of event names, '" + name + "' can't be registered.");
+            return 0;
         }
-        if (is_set(flags, Flags::Pix))
+
+        NameID id = sNameCount++;
+        uint32_t chunk = id >> kNameChunkBits;
+        std::string* pChunk = sNameChunks[chunk].load(std::memory_order_relaxed);
+        if (!pChunk)
         {
-            PIXEndEvent((ID3D12GraphicsCommandList*)gpDevice->getRenderContext()->getLowLevelData()->getCommandList());
+            pChunk = new std::string[kNameChunkSize];
+            sNameChunks[chunk].store(pChunk, std::memory_order_release);
         }
+        pChunk[id & (kNameChunkSize - 1)] = name;
+        sNameIDs[name] = id;
+        return id;
     }
 
-    double Profiler::getEventGpuTime(const std::string& name)
+    const std::string& Profiler::getName(NameID id)
     {
-        const auto& pEvent = getEvent(name);
-        return pEvent ? getGpuTime(pEvent) : 0;
+        assert(id < kNameChunkSize * kMaxNameChunks);
+        std::string* pChunk = sNameChunks[id >> kNameChunkBits].load(std::memory_order_acquire);
+        assert(pChunk);
+        return pChunk[id & (kNameChunkSize - 1)];
     }
 
-    double Profiler::getEventCpuTime(const std::string& name)
+    void Profiler::startEvent(NameID id, Flags flags)
     {
-        const auto& pEvent = getEvent(name);
-        return pEvent ? getCpuTime(pEvent) : 0;
+        if (is_set(flags, Flags::Internal))
+        {
+            uint32_t data = kNotRecorded;
+
+            if (gProfileEnabled || sCapturing.load(std::memory_order_relaxed))
+            {
+                ThreadBuffer& buffer = getThreadBuffer();
+                data = kNoGpuTimer;
+                if (buffer.isMainThread)
+                {
+                    uint32_t& timerCount = sGpuTimerCount[sGpuTimerIndex];
+                    auto& timers = sGpuTimers[sGpuTimerIndex];
+                    if (timerCount >= timers.size())
+                    {
+                        timers.push_back(GpuTimer::create());
+                        sGpuTimerNodes[sGpuTimerIndex].push_back(kInvalidNode);
+                    }
+                    data = (sGpuTimerIndex << kGpuBufferShift) | timerCount;
+                }
+
+                if (pushRecord(buffer, { getTimestamp(), id, data }, buffer.pendingEnds + 1))
+                {
+                    buffer.pendingEnds++;
+                    if (buffer.isMainThread)
+                    {
+                        sGpuTimers[sGpuTimerIndex][sGpuTimerCount[sGpuTimerIndex]++]->begin();
+                    }
+                }
+                else
+                {
+                    buffer.droppedEvents.fetch_add(1, std::memory_order_relaxed);
+                    data = kNotRecorded;
+                }
+            }
+            getOpenEvents().push_back(data);
+        }
+
+        if (is_set(flags, Flags::Pix) && std::this_thread::get_id() == sMainThreadID)
+        {
+            PIXBeginEvent((ID3D12GraphicsCommandList*)gpDevice->getRenderContext()->getLowLevelData()->getCommandList(), PIX_COLOR(0, 0, 0), getName(id).c_str());
+        }
     }
 
-    double Profiler::getGpuTime(const EventData* pData)
+    void Profiler::endEvent(NameID id, Flags flags)
     {
-        double gpuTime = 0;
-        for (size_t i = 0; i < pData->frameData[1 - sGpuTimerIndex].currentTimer; i++)
+        if (is_set(flags, Flags::Internal))
+        {
+            std::vector<uint32_t>& openEvents = getOpenEvents();
+            assert(!openEvents.empty());
+            if (!openEvents.empty())
+            {
+                uint32_t data = openEvents.back();
+                openEvents.pop_back();
+
+                if (data != kNotRecorded)
+                {
+                    ThreadBuffer& buffer = getThreadBuffer();
+                    // Space for the end record was reserved by startEvent().
+                    int64_t timestamp = getTimestamp();
+                    uint32_t gpuTimer = data & kGpuTimerMask;
+                    if (gpuTimer != kNoGpuTimer) sGpuTimers[data >> kGpuBufferShift][gpuTimer]->end();
+                    pushRecord(buffer, { timestamp, id, data | kEndFlag }, 0);
+                    buffer.pendingEnds--;
+                }
+            }
+        }
+
+        if (is_set(flags, Flags::Pix) && std::this_thread::get_id() == sMainThreadID)
         {
-            gpuTime += pData->frameData[1 - sGpuTimerIndex].pTimers[i]->getElapsedTime();
+            PIXEndEvent((ID3D12GraphicsCommandList*)gpDevice->getRenderContext()->getLowLevelData()->getCommandList());
         }
-        return gpuTime;
     }
 
-    double Profiler::getCpuTime(const EventData* pData)
+    double Profiler::getEventGpuTime(const std::string& name)
+    {
+        auto it = sNodesByPath.find(name);
+        return it != sNodesByPath.end() ? sNodes[it->second].lastGpuTime : 0;
+    }
+
+    double Profiler::getEventCpuTime(const std::string& name)
     {
-        return pData->cpuTotal;
+        auto it = sNodesByPath.find(name);
+        return it != sNodesByPath.end() ? sNodes[it->second].lastCpuTime : 0;
     }
 
     std::string Profiler::getEventsString()
     {
         std::string results("Name\t\t\t\t\tCPU time(ms)\t\t  GPU time(ms)\n");
 
-        for (EventData* pData : sRegisteredEvents)
+        for (uint32_t index : sFrameNodes)
         {
-            assert(pData->triggered == 0);
-            if(pData->showInMsg == false) continue;
-
-            double gpuTime = getGpuTime(pData);
-            assert(pData->callStack.empty());
-
+            const Node& node = sNodes[index];
+            const std::string& name = getName(node.name);
             char event[1000];
-            uint32_t nameIndent = pData->level * 2 + 1;
-            uint32_t cpuIndent = 30 - (nameIndent + (uint32_t)pData->name.substr(pData->name.find_last_of("#") + 1).size());
-            snprintf(event, 1000, "%*s%s %*.2f (%.2f) %14.2f (%.2f)\n", nameIndent, " ", pData->name.substr(pData->name.find_last_of("#") + 1).c_str(), cpuIndent, getCpuTime(pData),
-                     pData->cpuRunningAverageMS, gpuTime, pData->gpuRunningAverageMS);
-#if _PROFILING_LOG == 1
-            pData->cpuMs[pData->stepNr] = (float)pData->cpuTotal;
-            pData->gpuMs[pData->stepNr] = (float)gpuTime;
-            pData->stepNr++;
-            if (pData->stepNr == _PROFILING_LOG_BATCH_SIZE)
+            uint32_t nameIndent = node.level * 2 + 1;
+
+            if (node.parent == kInvalidNode)
             {
-                std::ostringstream logOss, fileOss;
-                logOss << "dumping " << "profile_" << pData->name << "_" << pData->filesWritten;
-                logInfo(logOss.str());
-                fileOss << "profile_" << pData->name << "_" << pData->filesWritten++;
-                std::ofstream out(fileOss.str().c_str());
-                for (int i = 0; i < _PROFILING_LOG_BATCH_SIZE; ++i)
-                {
-                    out << pData->cpuMs[i] << " " << pData->gpuMs[i] << "\n";
-                }
-                pData->stepNr = 0;
+                // Thread root, only shown as a header for the events of worker threads.
+                snprintf(event, 1000, "%*s%s\n", nameIndent, " ", name.c_str());
+            }
+            else
+            {
+                uint32_t cpuIndent = 30 - (nameIndent + (uint32_t)name.size());
+                snprintf(event, 1000, "%*s%s %*.2f (%.2f) %14.2f (%.2f)\n", nameIndent, " ", name.c_str(), cpuIndent, node.lastCpuTime,
+                         node.cpuRunningAverageMS, node.lastGpuTime, node.gpuRunningAverageMS);
             }
-#endif
             results += event;
         }
 
+        uint64_t droppedEvents = getDroppedEventCount();
+        if (droppedEvents > 0) results += "\n" + std::to_string(droppedEvents) + " events were dropped because a thread's event buffer was full.\n";
+
         return results;
     }
 
     void Profiler::endFrame()
     {
-        for (EventData* pData : sRegisteredEvents)
+        drainAllThreads();
+
+        // Collect the GPU times of the previous frame.
+        uint32_t prevIndex = 1 - sGpuTimerIndex;
+        for (uint32_t i = 0; i < sGpuTimerCount[prevIndex]; i++)
+        {
+            uint32_t node = sGpuTimerNodes[prevIndex][i];
+            if (node == kInvalidNode) continue;
+            sNodes[node].gpuTime += sGpuTimers[prevIndex][i]->getElapsedTime();
+            activateNode(node);
+            sGpuTimerNodes[prevIndex][i] = kInvalidNode;
+        }
+        sGpuTimerCount[prevIndex] = 0;
+
+        for (uint32_t index : sFrameNodes)
         {
+            sNodes[index].lastCpuTime = 0;
+            sNodes[index].lastGpuTime = 0;
+        }
+
+        for (uint32_t index : sActiveNodes)
+        {
+            Node& node = sNodes[index];
+
             // Update CPU/GPU time running averages.
-            const double cpuTime = getCpuTime(pData);
-            const double gpuTime = getGpuTime(pData);
+            const double cpuTime = node.cpuTime;
+            const double gpuTime = node.gpuTime;
             // With sigma = 0.98, then after 100 frames, a given value's contribution is down to ~1.7% of
             // the running average, which seems to provide a reasonable trade-off of temporal smoothing
             // versus setting in to a new value when something has changed.
             const double sigma = .98;
-            if (pData->cpuRunningAverageMS < 0.) pData->cpuRunningAverageMS = cpuTime;
-            else pData->cpuRunningAverageMS = sigma * pData->cpuRunningAverageMS + (1. - sigma) * cpuTime;
-            if (pData->gpuRunningAverageMS < 0.) pData->gpuRunningAverageMS = gpuTime;
-            else pData->gpuRunningAverageMS = sigma * pData->gpuRunningAverageMS + (1. - sigma) * gpuTime;
-
-            pData->showInMsg = false;
-            pData->cpuTotal = 0;
-            pData->triggered = 0;
-            pData->frameData[1 - sGpuTimerIndex].currentTimer = 0;
-            pData->registered = false;
+            if (node.cpuRunningAverageMS < 0.) node.cpuRunningAverageMS = cpuTime;
+            else node.cpuRunningAverageMS = sigma * node.cpuRunningAverageMS + (1. - sigma) * cpuTime;
+            if (node.gpuRunningAverageMS < 0.) node.gpuRunningAverageMS = gpuTime;
+            else node.gpuRunningAverageMS = sigma * node.gpuRunningAverageMS + (1. - sigma) * gpuTime;
+
+            node.lastCpuTime = cpuTime;
+            node.lastGpuTime = gpuTime;
+            node.cpuTime = 0;
+            node.gpuTime = 0;
+
+#if _PROFILING_LOG == 1
+            node.cpuMs[node.stepNr] = (float)cpuTime;
+            node.gpuMs[node.stepNr] = (float)gpuTime;
+            node.stepNr++;
+            if (node.stepNr == _PROFILING_LOG_BATCH_SIZE) writeLog(node);
+#endif
         }
-        sRegisteredEvents.clear();
-        sGpuTimerIndex = 1 - sGpuTimerIndex;
+
+        // List the events in hierarchy order, the main thread first, then the worker threads.
+        std::stable_sort(sRootNodes.begin(), sRootNodes.end(), [](uint32_t a, uint32_t b) { return sNodes[a].threadIndex < sNodes[b].threadIndex; });
+        sFrameNodes.clear();
+        for (uint32_t root : sRootNodes) appendActiveNodes(root, sFrameNodes);
+        sActiveNodes.clear();
+        sFrameIndex++;
+        sGpuTimerIndex = prevIndex;
+
+        if (sCapturing) sTraceFrames.push_back(getTimestamp());
     }
 
 #if _PROFILING_LOG == 1
     void Profiler::flushLog()
     {
-        for (EventData* pData : sRegisteredEvents)
-        {
-            std::ostringstream logOss, fileOss;
-            logOss << "dumping " << "profile_" << pData->name << "_" << pData->filesWritten;
-            logInfo(logOss.str());
-            fileOss << "profile_" << pData->name << "_" << pData->filesWritten++;
-            std::ofstream out(fileOss.str().c_str());
-            for (int i = 0; i < pData->stepNr; ++i)
-            {
-                out << pData->cpuMs[i] << " " << pData->gpuMs[i] << "\n";
-            }
-            pData->stepNr = 0;
-        }
+        for (uint32_t index : sFrameNodes) writeLog(sNodes[index]);
     }
 #endif
 
     void Profiler::clearEvents()
     {
-        for (EventData* pData : sRegisteredEvents)
+        drainAllThreads();
+
+        for (Node& node : sNodes)
+        {
+            node.cpuTime = node.gpuTime = 0;
+            node.lastCpuTime = node.lastGpuTime = 0;
+            node.cpuRunningAverageMS = node.gpuRunningAverageMS = -1.;
+            node.activeFrame = ~0ull;
+        }
+        sActiveNodes.clear();
+        sFrameNodes.clear();
+    }
+
+    void Profiler::startCapture()
+    {
+        if (sCapturing)
         {
-            delete pData;
+            logWarning("Profiler::startCapture() called while a capture is in progress. Ignoring call.");
+            return;
         }
-        sProfilerEvents.clear();
-        sRegisteredEvents.clear();
-        sCurrentLevel = 0;
-        sGpuTimerIndex = 0;
-        curEventName = "";
+
+        // Events recorded before the capture started are accumulated as usual, but not exported.
+        drainAllThreads();
+        sTraceEvents.clear();
+        sTraceFrames.clear();
+        sCaptureStart = getTimestamp();
+        sCapturing = true;
+    }
+
+    bool Profiler::endCapture(const std::string& filename)
+    {
+        if (!sCapturing)
+        {
+            logWarning("Profiler::endCapture() called without an active capture. Ignoring call.");
+            return false;
+        }
+
+        drainAllThreads();
+        sCapturing = false;
+
+        std::ofstream out(filename, std::ofstream::trunc);
+        if (!out.is_open())
+        {
+            logError("Failed to open file '" + filename + "' for writing.");
+            return false;
+        }
+
+        // Timestamps are written in microseconds relative to the start of the capture.
+        auto toUS = [](int64_t ticks) { return ticksToMS(ticks - sCaptureStart) * 1000.0; };
+
+        std::set<uint32_t> threads;
+        for (const auto& e : sTraceEvents) threads.insert(e.threadIndex);
+
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"Falcor\"}}";
+        for (uint32_t t : threads)
+        {
+            std::string threadName = t == 0 ? "Main thread" : "Thread " + std::to_string(t);
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << t << ",\"args\":{\"name\":\"" << threadName << "\"}}";
+        }
+        for (size_t i = 0; i < sTraceFrames.size(); i++)
+        {
+            out << ",\n{\"name\":\"Frame " << i << "\",\"cat\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":" << toUS(sTraceFrames[i]) << "}";
+        }
+        for (const auto& e : sTraceEvents)
+        {
+            out << ",\n{\"name\":\"" << escapeJsonString(getName(e.name)) << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.threadIndex
+                << ",\"ts\":" << toUS(e.start) << ",\"dur\":" << ticksToMS(e.end - e.start) * 1000.0 << "}";
+        }
+        out << "\n]}\n";
+
+        sTraceEvents.clear();
+        sTraceFrames.clear();
+        return out.good();
+    }
+
+    bool Profiler::isCapturing()
+    {
+        return sCapturing;
+    }
+
+    uint64_t Profiler::getDroppedEventCount()
+    {
+        std::lock_guard<std::mutex> lock(sThreadMutex);
+        uint64_t count = sDroppedEventsOfExitedThreads;
+        for (const auto& pBuffer : sThreadBuffers) count += pBuffer->droppedEvents.load(std::memory_order_relaxed);
+        return count;
     }
 }
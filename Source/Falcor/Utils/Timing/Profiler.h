@@ -26,20 +26,18 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #pragma once
-#include <stack>
-#include <unordered_map>
+#include <atomic>
 #include "CpuTimer.h"
-#include "Core/API/GpuTimer.h"
 
 namespace Falcor
 {
     extern dlldecl bool gProfileEnabled;
 
-    class GpuTimer;
-
     /** Container class for CPU/GPU profiling.
-        This class uses the most accurately available CPU and GPU timers to profile given events. It automatically creates event hierarchies based on the order of the calls made.
-        This class uses a double-buffering scheme for GPU profiling to avoid GPU stalls.
+        Events are identified by interned name IDs. The PROFILE macro resolves the ID once per call site, so recording an event doesn't touch any strings.
+        Each thread records begin/end timestamps into its own lock-free ring buffer. endFrame() drains the buffers on the main thread and builds the event hierarchies, per thread, based on the order of the calls made.
+        GPU timers and PIX markers are only issued for events on the main thread, which owns the render context. GPU timers use a double-buffering scheme to avoid GPU stalls.
+        A capture range can be exported in the Chrome trace-event JSON format (chrome://tracing, Perfetto) using startCapture()/endCapture().
         ProfilerEvent is a wrapper class which together with scoping can simplify event profiling.
     */
     class dlldecl Profiler
@@ -59,99 +57,102 @@ namespace Falcor
             Default = Internal | Pix
         };
 
-        struct EventData
+        using NameID = uint32_t;
+        static const NameID kInvalidNameID = 0xffffffff;
+
+        /** Caches the interned ID of an event name. The PROFILE macro creates one static instance per call site.
+            Names passed as 'const char*' are cached by address, so they must be string literals or otherwise immutable. std::string names are looked up on every call.
+        */
+        class NameCache
         {
-            virtual ~EventData() {}
-            std::string name;
-            struct FrameData
+        public:
+            NameID get(const char* name)
             {
-                std::vector<GpuTimer::SharedPtr> pTimers;
-                size_t currentTimer = 0;
-            };
-            FrameData frameData[2]; // Double-buffering, to avoid GPU flushes
-            bool showInMsg;
-            std::stack<size_t> callStack;
-            CpuTimer::TimePoint cpuStart;
-            CpuTimer::TimePoint cpuEnd;
-            double cpuTotal = 0;
-            double cpuRunningAverageMS = -1.f;   // Negative value to signify invalid
-            double gpuRunningAverageMS = -1.f;
-            uint32_t level;
-            uint32_t triggered = 0;
-            bool registered = false;
-#if _PROFILING_LOG == 1
-            int stepNr = 0;
-            int filesWritten = 0;
-            float cpuMs[_PROFILING_LOG_BATCH_SIZE];
-            float gpuMs[_PROFILING_LOG_BATCH_SIZE];
-#endif
+                if (mpName.load(std::memory_order_acquire) == name) return mID.load(std::memory_order_relaxed);
+                NameID id = getNameID(name);
+                mID.store(id, std::memory_order_relaxed);
+                mpName.store(name, std::memory_order_release);
+                return id;
+            }
+
+            NameID get(const std::string& name) { return getNameID(name); }
+
+        private:
+            std::atomic<const char*> mpName{ nullptr };
+            std::atomic<NameID> mID{ kInvalidNameID };
         };
 
-        /** Start profiling a new event and update the events hierarchies.
-            \param[in] name The event name.
+        /** Get the interned ID of an event name, registering the name if it's new. Thread-safe.
         */
-        static void startEvent(const std::string& name, Flags flags = Flags::Default, bool showInMsg = true);
+        static NameID getNameID(const std::string& name);
 
-        /** Finish profiling a new event and update the events hierarchies.
-            \param[in] name The event name.
+        /** Get the name of an interned ID. Thread-safe.
         */
-        static void endEvent(const std::string& name, Flags flags = Flags::Default);
+        static const std::string& getName(NameID id);
 
-        /** Finish profiling for the entire frame.
-            Due to the double-buffering nature of the profiler, the results returned are for the previous frame.
-            \param[out] profileResults A string containing the the profiling results.
+        /** Start profiling a new event and update the events hierarchies. Can be called from any thread.
+            \param[in] id The interned event name.
         */
-        static void endFrame();
+        static void startEvent(NameID id, Flags flags = Flags::Default);
 
-        /** Get a string with the current frame results
+        /** Finish profiling an event and update the events hierarchies. Must be called on the thread that started the event.
+            \param[in] id The interned event name.
         */
-        static std::string getEventsString();
+        static void endEvent(NameID id, Flags flags = Flags::Default);
+
+        /** Start profiling a new event and update the events hierarchies.
+            \param[in] name The event name.
+        */
+        static void startEvent(const std::string& name, Flags flags = Flags::Default) { startEvent(getNameID(name), flags); }
 
-        /** Create a new event and register and initialize it using \ref initNewEvent.
+        /** Finish profiling an event and update the events hierarchies.
             \param[in] name The event name.
         */
-        static EventData* createNewEvent(const std::string& name);
-        
-        /** Initialize a previously generated event.
-            Used to do the default initialization without creating the actual event instance, to support derived event types. See \ref Cuda::Profiler::EventData.
-            \param[out] pEvent Event to initialize
-            \param[in] name New event name
+        static void endEvent(const std::string& name, Flags flags = Flags::Default) { endEvent(getNameID(name), flags); }
+
+        /** Finish profiling for the entire frame. Must be called on the main thread.
+            Collects the events recorded by all threads since the last call. Due to the double-buffering nature of the profiler, the GPU times are for the previous frame.
         */
-        static void initNewEvent(EventData *pEvent, const std::string& name);
+        static void endFrame();
 
-        /** Get the event, or create a new one if the event does not yet exist.
-            This is a public interface to facilitate more complicated construction of event names and finegrained control over the profiled region.
+        /** Get a string with the results of the last frame.
         */
-        static EventData* getEvent(const std::string& name);
+        static std::string getEventsString();
 
-        /** Get the event, or create a new one if the event does not yet exist.
-        This is a public interface to facilitate more complicated construction of event names and finegrained control over the profiled region.
+        /** Get the CPU time of an event in the last frame.
+            \param[in] name The event path, the names of the event and its parents each prefixed with '#', e.g. "#onFrameRender#RenderGraphExe::execute()".
+            \return The time in milliseconds, or 0 if the event didn't run.
         */
         static double getEventCpuTime(const std::string& name);
 
-        /** Get the event, or create a new one if the event does not yet exist.
-        This is a public interface to facilitate more complicated construction of event names and finegrained control over the profiled region.
+        /** Get the GPU time of an event in the last frame.
+            \param[in] name The event path, see getEventCpuTime().
+            \return The time in milliseconds, or 0 if the event didn't run.
         */
         static double getEventGpuTime(const std::string& name);
 
-        /** Returns the event or \c nullptr if the event is not known.
-            Can be used as a predicate.
-        */
-        static EventData* isEventRegistered(const std::string& name);
-
-        /** Clears all the events. 
+        /** Clears the statistics of all the events.
             Useful if you want to start profiling a different technique with different events.
         */
         static void clearEvents();
 
-    private:
-        static double getGpuTime(const EventData* pData);
-        static double getCpuTime(const EventData* pData);
+        /** Start capturing events for export as a trace. Events are recorded on all threads while capturing, even if gProfileEnabled is false. Must be called on the main thread.
+        */
+        static void startCapture();
+
+        /** End the capture and write the events that completed during the capture range to a file in the Chrome trace-event JSON format. Must be called on the main thread.
+            \param[in] filename Output filename.
+            \return True if the file was written.
+        */
+        static bool endCapture(const std::string& filename);
 
-        static std::unordered_map<std::string, EventData*> sProfilerEvents;
-        static std::vector<EventData*> sRegisteredEvents;
-        static uint32_t sCurrentLevel;
-        static uint32_t sGpuTimerIndex;
+        /** Check if a capture is in progress.
+        */
+        static bool isCapturing();
+
+        /** Get the number of events that were dropped because a thread's event buffer was full.
+        */
+        static uint64_t getDroppedEventCount();
     };
 
     /** Helper class for starting and ending profiling events.
@@ -163,19 +164,20 @@ namespace Falcor
     public:
         /** C'tor
         */
-        ProfilerEvent(const std::string& name, Profiler::Flags flags = Profiler::Flags::Default) : mName(name), mFlags(flags) { Profiler::startEvent(name, flags); }
+        ProfilerEvent(Profiler::NameID id, Profiler::Flags flags = Profiler::Flags::Default) : mID(id), mFlags(flags) { Profiler::startEvent(id, flags); }
+        ProfilerEvent(const std::string& name, Profiler::Flags flags = Profiler::Flags::Default) : ProfilerEvent(Profiler::getNameID(name), flags) {}
         /** D'tor
         */
-        ~ProfilerEvent() { Profiler::endEvent(mName, mFlags); }
+        ~ProfilerEvent() { Profiler::endEvent(mID, mFlags); }
 
     private:
-        const std::string mName;
+        const Profiler::NameID mID;
         Profiler::Flags mFlags;
     };
 
 #if _PROFILING_ENABLED
-#define PROFILE_ALL_FLAGS(_name) Falcor::ProfilerEvent _profileEvent##__LINE__(_name)
-#define PROFILE_SOME_FLAGS(_name, _flags) Falcor::ProfilerEvent _profileEvent##__LINE__(_name, _flags)
+#define PROFILE_ALL_FLAGS(_name) static Falcor::Profiler::NameCache _profileName##__LINE__; Falcor::ProfilerEvent _profileEvent##__LINE__(_profileName##__LINE__.get(_name))
+#define PROFILE_SOME_FLAGS(_name, _flags) static Falcor::Profiler::NameCache _profileName##__LINE__; Falcor::ProfilerEvent _profileEvent##__LINE__(_profileName##__LINE__.get(_name), _flags)
 
 #define GET_PROFILE(_1, _2, NAME, ...) NAME
 #define PROFILE(...) GET_PROFILE(__VA_ARGS__, PROFILE_SOME_FLAGS, PROFILE_ALL_FLAGS)(__VA_ARGS__)
@@ -34,6 +34,7 @@ namespace Mogwai
     {
         const std::string kScriptVar = "tc";
         const std::string kCaptureFrameTime = "captureFrameTime";
+        const std::string kCaptureTrace = "captureTrace";
     }
 
     MOGWAI_EXTENSION(TimingCapture);
@@ -43,6 +44,11 @@ namespace Mogwai
         return UniquePtr(new TimingCapture(pRenderer));
     }
 
+    TimingCapture::~TimingCapture()
+    {
+        if (!mTraceFilename.empty()) captureTrace("");
+    }
+
     void TimingCapture::scriptBindings(Bindings& bindings)
     {
         auto& m = bindings.getModule();
@@ -53,6 +59,7 @@ namespace Mogwai
 
         // Members
         timingCapture.def(kCaptureFrameTime.c_str(), &TimingCapture::captureFrameTime, "filename"_a);
+        timingCapture.def(kCaptureTrace.c_str(), &TimingCapture::captureTrace, "filename"_a);
     }
 
     void TimingCapture::beginFrame(RenderContext* pRenderContext, const Fbo::SharedPtr& pTargetFbo)
@@ -89,4 +96,24 @@ namespace Mogwai
         if (frameRate.getFrameCount() > 1)
             mFrameTimeFile << frameRate.getLastFrameTime() << std::endl;
     }
+
+    void TimingCapture::captureTrace(std::string filename)
+    {
+        if (!mTraceFilename.empty())
+        {
+            if (Profiler::endCapture(mTraceFilename)) logInfo("Profiler trace written to '" + mTraceFilename + "'.");
+            mTraceFilename.clear();
+        }
+
+        if (!filename.empty())
+        {
+            if (doesFileExist(filename))
+            {
+                logWarning("Trace in file '" + filename + "' will be overwritten.");
+            }
+
+            Profiler::startCapture();
+            mTraceFilename = filename;
+        }
+    }
 }
@@ -33,7 +33,7 @@ namespace Mogwai
     class TimingCapture : public Extension
     {
     public:
-        virtual ~TimingCapture() = default;
+        virtual ~TimingCapture();
         static UniquePtr create(Renderer* pRenderer);
 
         virtual void beginFrame(RenderContext* pRenderContext, const Fbo::SharedPtr& pTargetFbo) override;
@@ -47,6 +47,11 @@ namespace Mogwai
         void captureFrameTime(std::string filename);
         void recordPreviousFrameTime();
 
+        /** Start capturing profiler events on all threads, or end the capture and write it as a Chrome trace to the file given when starting if filename is empty.
+        */
+        void captureTrace(std::string filename);
+
         std::ofstream   mFrameTimeFile;     ///< Frame times are appended to this file when it's open.
+        std::string     mTraceFilename;     ///< Trace file of the active capture, empty if not capturing.
     };
 }
@@ -616,7 +616,19 @@ void CSM::renderScene(RenderContext* pCtx)
 
     pCB->setBlob(&mCsmData, 0, sizeof(mCsmData));
     mpLightCamera->setProjectionMatrix(mCsmData.globalMat);
-    mpScene->render(pCtx, mShadowPass.pState.get(), mShadowPass.pVars.get());
+
+    // All cascades are rendered in a single pass, so draw the instances that overlap any of them.
+    std::vector<Frustum> cascadeFrustums(mCsmData.cascadeCount);
+    for (uint32_t c = 0; c < mCsmData.cascadeCount; c++)
+    {
+        glm::mat4 cascadeMat = glm::scale(glm::translate(glm::mat4(1.f), float3(mCsmData.cascadeOffset[c])), float3(mCsmData.cascadeScale[c])) * mCsmData.globalMat;
+        Frustum& frustum = cascadeFrustums[c];
+        frustum = Frustum::fromViewProjMatrix(cascadeMat);
+
+        // Casters between the light and the near plane still cast shadows into the cascade, so only cull against the side planes.
+        frustum.planes[Frustum::kNear] = frustum.planes[Frustum::kFar] = float4(0.f, 0.f, 0.f, 1.f);
+    }
+    mpScene->render(pCtx, mShadowPass.pState.get(), mShadowPass.pVars.get(), cascadeFrustums);
     //        mpCsmSceneRenderer->renderScene(pCtx, mShadowPass.pState.get(), mShadowPass.pVars.get(), mpLightCamera.get());
 }
 
@@ -735,7 +747,12 @@ void CSM::setupVisibilityPassFbo(const Texture::SharedPtr& pVisBuffer)
 
 void CSM::execute(RenderContext* pContext, const RenderData& renderData)
 {
-    if (!mpLight || !mpScene) return;
+    // If we have no light or scene, just clear the output and return.
+    if (!mpLight || !mpScene)
+    {
+        pContext->clearTexture(renderData[kVisibility]->asTexture().get());
+        return;
+    }
 
     setupVisibilityPassFbo(renderData[kVisibility]->asTexture());
     const auto& pDepth = renderData[kDepth]->asTexture();
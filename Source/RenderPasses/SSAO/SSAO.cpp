@@ -160,7 +160,12 @@ void SSAO::compile(RenderContext* pRenderContext, const CompileData& compileData
 
 void SSAO::execute(RenderContext* pRenderContext, const RenderData& renderData)
 {
-    if (!mpScene) return;
+    // If we have no scene, just clear the output and return.
+    if (!mpScene)
+    {
+        pRenderContext->clearTexture(renderData[kColorOut]->asTexture().get());
+        return;
+    }
 
     // Run the AO pass
     auto pDepth = renderData[kDepth]->asTexture();
@@ -71,6 +71,24 @@ namespace
 
     // Output buffer name
     const char kOutputBufferFilteredImage[] = "Filtered image";
+
+    // Resource handles, in the order the fields are added in reflect()
+    enum : uint32_t
+    {
+        kHandleAlbedo,
+        kHandleColor,
+        kHandleEmission,
+        kHandleWorldPosition,
+        kHandleWorldNormal,
+        kHandlePosNormalFwidth,
+        kHandleLinearZ,
+        kHandleMotionVector,
+        kHandlePreviousLinearZAndNormal,
+        kHandlePreviousLighting,
+        kHandlePreviousMoments,
+        kHandleFilteredImage,
+        kHandleCount
+    };
 }
 
 // Don't remove this. it's required for hot-reload to function properly
@@ -166,6 +184,7 @@ RenderPassReflection SVGFPass::reflect(const CompileData& compileData)
 
     reflector.addOutput(kOutputBufferFilteredImage, "Filtered image").format(ResourceFormat::RGBA16Float);
 
+    assert(reflector.getFieldCount() == kHandleCount);
     return reflector;
 }
 
@@ -177,16 +196,16 @@ void SVGFPass::compile(RenderContext* pRenderContext, const CompileData& compile
 
 void SVGFPass::execute(RenderContext* pRenderContext, const RenderData& renderData)
 {
-    Texture::SharedPtr pAlbedoTexture = renderData[kInputBufferAlbedo]->asTexture();
-    Texture::SharedPtr pColorTexture = renderData[kInputBufferColor]->asTexture();
-    Texture::SharedPtr pEmissionTexture = renderData[kInputBufferEmission]->asTexture();
-    Texture::SharedPtr pWorldPositionTexture = renderData[kInputBufferWorldPosition]->asTexture();
-    Texture::SharedPtr pWorldNormalTexture = renderData[kInputBufferWorldNormal]->asTexture();
-    Texture::SharedPtr pPosNormalFwidthTexture = renderData[kInputBufferPosNormalFwidth]->asTexture();
-    Texture::SharedPtr pLinearZTexture = renderData[kInputBufferLinearZ]->asTexture();
-    Texture::SharedPtr pMotionVectorTexture = renderData[kInputBufferMotionVector]->asTexture();
+    Texture::SharedPtr pAlbedoTexture = renderData.getResource(kHandleAlbedo)->asTexture();
+    Texture::SharedPtr pColorTexture = renderData.getResource(kHandleColor)->asTexture();
+    Texture::SharedPtr pEmissionTexture = renderData.getResource(kHandleEmission)->asTexture();
+    Texture::SharedPtr pWorldPositionTexture = renderData.getResource(kHandleWorldPosition)->asTexture();
+    Texture::SharedPtr pWorldNormalTexture = renderData.getResource(kHandleWorldNormal)->asTexture();
+    Texture::SharedPtr pPosNormalFwidthTexture = renderData.getResource(kHandlePosNormalFwidth)->asTexture();
+    Texture::SharedPtr pLinearZTexture = renderData.getResource(kHandleLinearZ)->asTexture();
+    Texture::SharedPtr pMotionVectorTexture = renderData.getResource(kHandleMotionVector)->asTexture();
 
-    Texture::SharedPtr pOutputTexture = renderData[kOutputBufferFilteredImage]->asTexture();
+    Texture::SharedPtr pOutputTexture = renderData.getResource(kHandleFilteredImage)->asTexture();
 
     assert(mpFilteredIlluminationFbo &&
            mpFilteredIlluminationFbo->getWidth() == pAlbedoTexture->getWidth() &&
@@ -209,7 +228,7 @@ void SVGFPass::execute(RenderContext* pRenderContext, const RenderData& renderDa
         // Stores the result as well as initial moments and an updated
         // per-pixel history length in mpCurReprojFbo.
         Texture::SharedPtr pPrevLinearZAndNormalTexture =
-            renderData[kInternalBufferPreviousLinearZAndNormal]->asTexture();
+            renderData.getResource(kHandlePreviousLinearZAndNormal)->asTexture();
         computeReprojection(pRenderContext, pAlbedoTexture, pColorTexture, pEmissionTexture,
                             pMotionVectorTexture, pPosNormalFwidthTexture,
                             pPrevLinearZAndNormalTexture);
@@ -291,9 +310,9 @@ void SVGFPass::clearBuffers(RenderContext* pRenderContext, const RenderData& ren
     pRenderContext->clearFbo(mpPrevReprojFbo.get(), float4(0), 1.0f, 0, FboAttachmentType::All);
     pRenderContext->clearFbo(mpFilteredIlluminationFbo.get(), float4(0), 1.0f, 0, FboAttachmentType::All);
 
-    pRenderContext->clearTexture(renderData[kInternalBufferPreviousLinearZAndNormal]->asTexture().get());
-    pRenderContext->clearTexture(renderData[kInternalBufferPreviousLighting]->asTexture().get());
-    pRenderContext->clearTexture(renderData[kInternalBufferPreviousMoments]->asTexture().get());
+    pRenderContext->clearTexture(renderData.getResource(kHandlePreviousLinearZAndNormal)->asTexture().get());
+    pRenderContext->clearTexture(renderData.getResource(kHandlePreviousLighting)->asTexture().get());
+    pRenderContext->clearTexture(renderData.getResource(kHandlePreviousMoments)->asTexture().get());
 }
 
 // Extracts linear z and its derivative from the linear Z texture and packs
@@ -89,7 +89,8 @@ RenderPassReflection TemporalDelayPass::reflect(const CompileData& compileData)
         formatField(r.addOutput(kMaxDelay, std::to_string(mDelay) + " frame(s) delayed"));
         if (mDelay > 0)
         {
-            for (uint32_t i = mDelay - 1; i > 0; --i) formatField(r.addOutput(kMaxDelay + "-" + std::to_string(i), std::to_string(mDelay - i) + " frame(s) delayed"));
+            // The intermediate outputs carry the delayed frames to the next execution, so they must not be aliased with other resources.
+            for (uint32_t i = mDelay - 1; i > 0; --i) formatField(r.addOutput(kMaxDelay + "-" + std::to_string(i), std::to_string(mDelay - i) + " frame(s) delayed").flags(RenderPassReflection::Field::Flags::Persistent));
             formatField(r.addInternal(kMaxDelay + "-" + std::to_string(mDelay), "Internal copy of the current frame"));
         }
         mReady = true;
@@ -100,7 +101,7 @@ RenderPassReflection TemporalDelayPass::reflect(const CompileData& compileData)
         r.addOutput(kMaxDelay, std::to_string(mDelay) + " frame(s) delayed");
         if (mDelay > 0)
         {
-            for (uint32_t i = mDelay - 1; i > 0; --i) r.addOutput(kMaxDelay + "-" + std::to_string(i), std::to_string(mDelay - i) + " frame(s) delayed");
+            for (uint32_t i = mDelay - 1; i > 0; --i) r.addOutput(kMaxDelay + "-" + std::to_string(i), std::to_string(mDelay - i) + " frame(s) delayed").flags(RenderPassReflection::Field::Flags::Persistent);
             r.addInternal(kMaxDelay + "-" + std::to_string(mDelay), "Internal copy of the current frame");
         }
     }
@@ -0,0 +1,292 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include <set>
+#include <tuple>
+
+namespace Falcor
+{
+    namespace
+    {
+        using Flavor = ParameterBlockReflection::ResourceRangeBindingInfo::Flavor;
+
+        /** Builds a parameter block reflector by hand, without going through Slang.
+        */
+        class SyntheticReflector
+        {
+        public:
+            SyntheticReflector(size_t uniformSize, uint32_t space)
+                : mpType(ReflectionStructType::create(uniformSize, "S", nullptr))
+                , mpReflector(ParameterBlockReflection::createEmpty(nullptr))
+                , mSpace(space)
+            {
+                mpReflector->setElementType(mpType);
+            }
+
+            void addTexture(const std::string& name)
+            {
+                auto pType = ReflectionResourceType::create(ReflectionResourceType::Type::Texture, ReflectionResourceType::Dimensions::Texture2D,
+                    ReflectionResourceType::StructuredType::Invalid, ReflectionResourceType::ReturnType::Float, ReflectionResourceType::ShaderAccess::Read, nullptr);
+                addMember(name, pType, Flavor::Simple, nullptr);
+            }
+
+            void addSampler(const std::string& name)
+            {
+                auto pType = ReflectionResourceType::create(ReflectionResourceType::Type::Sampler, ReflectionResourceType::Dimensions::Unknown,
+                    ReflectionResourceType::StructuredType::Invalid, ReflectionResourceType::ReturnType::Unknown, ReflectionResourceType::ShaderAccess::Undefined, nullptr);
+                addMember(name, pType, Flavor::Simple, nullptr);
+            }
+
+            void addConstantBuffer(const std::string& name, const ParameterBlockReflection::SharedConstPtr& pSubObject, uint32_t arraySize = 0)
+            {
+                auto pType = ReflectionResourceType::create(ReflectionResourceType::Type::ConstantBuffer, ReflectionResourceType::Dimensions::Buffer,
+                    ReflectionResourceType::StructuredType::Invalid, ReflectionResourceType::ReturnType::Unknown, ReflectionResourceType::ShaderAccess::Read, nullptr);
+                pType->setStructType(pSubObject->getElementType());
+                pType->setParameterBlockReflector(pSubObject);
+                ReflectionType::SharedConstPtr pMemberType = pType;
+                if (arraySize) pMemberType = ReflectionArrayType::create(arraySize, 0, pType, 0, nullptr);
+                addMember(name, pMemberType, Flavor::ConstantBuffer, pSubObject);
+            }
+
+            void addInterface(const std::string& name, const ParameterBlockReflection::SharedConstPtr& pSubObject)
+            {
+                addMember(name, ReflectionInterfaceType::create(nullptr), Flavor::Interface, pSubObject);
+            }
+
+            ParameterBlockReflection::SharedPtr finalize()
+            {
+                ParameterBlockReflection::DefaultConstantBufferBindingInfo defaultBindingInfo;
+                defaultBindingInfo.regIndex = mNextRegIndex++;
+                defaultBindingInfo.regSpace = mSpace;
+                mpReflector->setDefaultConstantBufferBindingInfo(defaultBindingInfo);
+                mpReflector->finalize();
+                return mpReflector;
+            }
+
+        private:
+            void addMember(const std::string& name, const ReflectionType::SharedConstPtr& pType, Flavor flavor, const ParameterBlockReflection::SharedConstPtr& pSubObject)
+            {
+                auto rangeIndex = mpType->getResourceRangeCount();
+                mpType->addMember(ReflectionVar::create(name, pType, ShaderVarOffset(UniformShaderVarOffset::kZero, ResourceShaderVarOffset(rangeIndex, 0))), mBuildState);
+                assert(pType->getResourceRangeCount() == 1);
+
+                ParameterBlockReflection::ResourceRangeBindingInfo bindingInfo;
+                bindingInfo.flavor = flavor;
+                bindingInfo.regIndex = mNextRegIndex;
+                bindingInfo.regSpace = mSpace;
+                bindingInfo.pSubObjectReflector = pSubObject;
+                mpReflector->addResourceRange(bindingInfo);
+                mNextRegIndex += pType->getResourceRange(0).count;
+            }
+
+            ReflectionStructType::SharedPtr mpType;
+            ReflectionStructType::BuildState mBuildState;
+            ParameterBlockReflection::SharedPtr mpReflector;
+            uint32_t mSpace;
+            uint32_t mNextRegIndex = 0;
+        };
+
+        /** Exposes the change tracking of a parameter block without binding it to a program.
+        */
+        class TestBlock : public ParameterBlock
+        {
+        public:
+            static std::shared_ptr<TestBlock> create(const ParameterBlockReflection::SharedConstPtr& pReflection)
+            {
+                return std::shared_ptr<TestBlock>(new TestBlock(pReflection));
+            }
+
+            /** Check for indirect changes and return the epoch of the last change to this block.
+            */
+            ChangeEpoch validate() { return computeEpochOfLastChange(this); }
+
+        private:
+            TestBlock(const ParameterBlockReflection::SharedConstPtr& pReflection) : ParameterBlock(nullptr, pReflection) {}
+        };
+
+        /** Reflector for a block with uniform data and a texture, which are bound through the descriptor set of its parent.
+        */
+        ParameterBlockReflection::SharedPtr createLeafReflector()
+        {
+            SyntheticReflector leaf(16, 0);
+            leaf.addTexture("tex");
+            return leaf.finalize();
+        }
+
+        /** Reflector for a block with `count` constant buffers named cb0, cb1, ..
+        */
+        ParameterBlockReflection::SharedPtr createParentReflector(const ParameterBlockReflection::SharedConstPtr& pSubObject, uint32_t count)
+        {
+            SyntheticReflector parent(16, 0);
+            parent.addTexture("tex");
+            for (uint32_t i = 0; i < count; i++) parent.addConstantBuffer("cb" + std::to_string(i), pSubObject);
+            return parent.finalize();
+        }
+    }
+
+    CPU_TEST(BindingPlanLayout)
+    {
+        SyntheticReflector leaf(16, 0);
+        leaf.addTexture("tex");
+        leaf.addSampler("samp");
+        auto pLeaf = leaf.finalize();
+        const uint32_t leafSetCount = pLeaf->getDescriptorSetCount();
+        EXPECT_GE(leafSetCount, 1u);
+        EXPECT(pLeaf->getBindingPlan().subObjects.empty());
+        EXPECT(pLeaf->getBindingPlan().setDependencies.empty());
+
+        SyntheticReflector root(16, 0);
+        root.addTexture("tex");
+        root.addConstantBuffer("single", pLeaf);
+        root.addConstantBuffer("array", pLeaf, 3);
+        root.addInterface("iface", pLeaf);
+        auto pRoot = root.finalize();
+
+        // Every array element gets its own sub-object entry, indexed by its flat sub-object slot.
+        const auto& plan = pRoot->getBindingPlan();
+        EXPECT_EQ(plan.subObjects.size(), 5);
+        for (uint32_t i = 0; i < (uint32_t)plan.subObjects.size() && i < 5; i++)
+        {
+            EXPECT_EQ(plan.subObjects[i].flatIndex, i);
+            EXPECT_EQ(plan.subObjects[i].pReflector, pLeaf.get());
+            EXPECT_EQ(plan.subObjects[i].isInterface, i == 4);
+        }
+
+        // Each sub-object depends on all of its sets, and the dependencies match the reflector's sub-object info.
+        EXPECT_EQ(plan.setDependencies.size(), 5 * leafSetCount);
+        std::set<std::tuple<uint32_t, uint32_t, uint32_t>> expected;
+        for (uint32_t s = 0; s < pRoot->getDescriptorSetCount(); s++)
+        {
+            for (const auto& subObjectInfo : pRoot->getDescriptorSetInfo(s).subObjects)
+            {
+                auto baseIndex = pRoot->getResourceRange(subObjectInfo.resourceRangeIndexOfSubObject).baseIndex;
+                auto count = pRoot->getResourceRange(subObjectInfo.resourceRangeIndexOfSubObject).count;
+                for (uint32_t i = 0; i < count; i++) expected.insert({ baseIndex + i, subObjectInfo.setIndexInSubObject, s });
+            }
+        }
+        std::set<std::tuple<uint32_t, uint32_t, uint32_t>> actual;
+        for (const auto& dependency : plan.setDependencies)
+        {
+            EXPECT_LT(dependency.subObjectIndex, plan.subObjects.size());
+            EXPECT_LT(dependency.setIndexInSubObject, leafSetCount);
+            EXPECT_LT(dependency.setIndex, pRoot->getDescriptorSetCount());
+            if (dependency.subObjectIndex < plan.subObjects.size())
+            {
+                actual.insert({ plan.subObjects[dependency.subObjectIndex].flatIndex, dependency.setIndexInSubObject, dependency.setIndex });
+            }
+        }
+        EXPECT(actual == expected);
+    }
+
+    CPU_TEST(BindingPlanChangePropagation)
+    {
+        auto pLeafReflector = createLeafReflector();
+        auto pMidReflector = createParentReflector(pLeafReflector, 2);
+        auto pRootReflector = createParentReflector(pMidReflector, 2);
+
+        auto pRoot = TestBlock::create(pRootReflector);
+        ParameterBlock::SharedPtr pMid = pRoot->getRootVar()["cb1"].getParameterBlock();
+        ParameterBlock::SharedPtr pLeaf = pMid->getRootVar()["cb0"].getParameterBlock();
+        EXPECT(pMid && pLeaf);
+
+        // A clean block keeps its epoch.
+        auto epoch = pRoot->validate();
+        EXPECT_EQ(pRoot->validate(), epoch);
+
+        // A change two levels down invalidates the root's descriptor set, once.
+        pLeaf->markUniformDataDirty();
+        auto dirtyEpoch = pRoot->validate();
+        EXPECT_GT(dirtyEpoch, epoch);
+        EXPECT_EQ(pRoot->validate(), dirtyEpoch);
+
+        // Blocks that were replaced no longer affect the root.
+        auto pNewMid = ParameterBlock::create(pMidReflector);
+        pRoot->getRootVar()["cb1"].setParameterBlock(pNewMid);
+        epoch = pRoot->validate();
+        pLeaf->markUniformDataDirty();
+        pMid->markUniformDataDirty();
+        EXPECT_EQ(pRoot->validate(), epoch);
+        pNewMid->markUniformDataDirty();
+        EXPECT_GT(pRoot->validate(), epoch);
+
+        // Changes to a shared block are seen by every parent, regardless of which one validates first.
+        auto pOtherRoot = TestBlock::create(pRootReflector);
+        pOtherRoot->getRootVar()["cb0"].setParameterBlock(pNewMid);
+        epoch = pRoot->validate();
+        auto otherEpoch = pOtherRoot->validate();
+        pNewMid->getRootVar()["cb1"].getParameterBlock()->markUniformDataDirty();
+        EXPECT_GT(pRoot->validate(), epoch);
+        EXPECT_GT(pOtherRoot->validate(), otherEpoch);
+
+        // Sub-objects outlive their parents safely.
+        pRoot.reset();
+        pOtherRoot.reset();
+        pNewMid->markUniformDataDirty();
+    }
+
+    CPU_TEST(BindingPlanBenchmark, "Long running benchmark, enable manually.")
+    {
+        // Two levels of constant buffers below a root, similar to a material or scene block.
+        const uint32_t kSubObjectCount = 16;
+        const uint32_t kIterations = 100000;
+
+        auto pLeafReflector = createLeafReflector();
+        auto pMidReflector = createParentReflector(pLeafReflector, kSubObjectCount);
+        auto pRootReflector = createParentReflector(pMidReflector, kSubObjectCount);
+        auto pRoot = TestBlock::create(pRootReflector);
+
+        std::vector<ParameterBlock::SharedPtr> leaves;
+        for (uint32_t i = 0; i < kSubObjectCount; i++)
+        {
+            ParameterBlock::SharedPtr pMid = pRoot->getRootVar()["cb" + std::to_string(i)].getParameterBlock();
+            for (uint32_t j = 0; j < kSubObjectCount; j++) leaves.push_back(pMid->getRootVar()["cb" + std::to_string(j)].getParameterBlock());
+        }
+        pRoot->validate();
+
+        auto measure = [&](auto change)
+        {
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            for (uint32_t i = 0; i < kIterations; i++)
+            {
+                change(i);
+                pRoot->validate();
+            }
+            return CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint()) * 1000.0 / kIterations;
+        };
+
+        // Clean blocks return immediately, a single change only walks the blocks on its path,
+        // and a change in every leaf walks the whole tree like every validation did before.
+        double cleanTime = measure([](uint32_t) {});
+        double singleTime = measure([&](uint32_t i) { leaves[i % leaves.size()]->markUniformDataDirty(); });
+        double allTime = measure([&](uint32_t) { for (const auto& pLeaf : leaves) pLeaf->markUniformDataDirty(); });
+
+        logInfo("BindingPlanBenchmark: " + std::to_string(leaves.size()) + " sub-objects, per validation: clean " + std::to_string(cleanTime) + " us, one change "
+            + std::to_string(singleTime) + " us, all changed " + std::to_string(allTime) + " us");
+        EXPECT_LT(cleanTime, allTime);
+    }
+}
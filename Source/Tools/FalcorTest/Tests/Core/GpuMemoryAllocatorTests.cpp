@@ -0,0 +1,205 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Core/API/GpuMemoryAllocator.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        const size_t kPageSize = 1024 * 1024;
+
+        /** Stand-in for a GpuFence. Work recorded before signal() completes when complete() is called.
+        */
+        struct FakeFence
+        {
+            uint64_t cpuValue = 1;
+            uint64_t gpuValue = 0;
+
+            void signal() { cpuValue++; }
+            void complete() { gpuValue = cpuValue - 1; }
+        };
+
+        /** Allocator with callbacks that track the backing memory.
+        */
+        struct TestAllocator
+        {
+            std::map<uint32_t, size_t> pages;
+            GpuMemoryAllocator allocator;
+
+            TestAllocator()
+                : allocator(kPageSize, { [this](uint32_t pageIndex, size_t size) { pages[pageIndex] = size; }, [this](uint32_t pageIndex) { pages.erase(pageIndex); } })
+            {}
+        };
+    }
+
+    CPU_TEST(GpuMemoryAllocatorBlockSize)
+    {
+        size_t prevBlockSize = 0;
+        for (size_t size = 1; size < (size_t(1) << 32); size = size * 5 / 4 + 1)
+        {
+            size_t blockSize = GpuMemoryAllocator::getBlockSize(size);
+            EXPECT_GE(blockSize, size);
+            EXPECT_GE(blockSize, prevBlockSize);
+            EXPECT_EQ(blockSize % (64 * 1024), 0);
+            if (size > 4 * 64 * 1024) EXPECT_LT(blockSize - size, size / 4) << "size " << size;
+            prevBlockSize = blockSize;
+        }
+        EXPECT_EQ(GpuMemoryAllocator::getBlockSize(kPageSize), kPageSize);
+        EXPECT_EQ(GpuMemoryAllocator::getBlockSize(kPageSize + 1), kPageSize + kPageSize / 4);
+    }
+
+    CPU_TEST(GpuMemoryAllocatorPages)
+    {
+        TestAllocator t;
+        FakeFence fence;
+        auto& allocator = t.allocator;
+
+        // Allocations are placed linearly with the requested alignment.
+        auto a = allocator.allocate(100);
+        auto b = allocator.allocate(1000, 256);
+        EXPECT_EQ(a.pageIndex, b.pageIndex);
+        EXPECT_EQ(a.offset, 0);
+        EXPECT_EQ(b.offset, 256);
+        EXPECT_EQ(t.pages.size(), 1);
+
+        // A new page is started when the active page is full.
+        std::vector<GpuMemoryAllocator::Allocation> allocations = { a, b };
+        for (uint32_t i = 0; i < 8; i++) allocations.push_back(allocator.allocate(kPageSize / 4));
+        EXPECT_EQ(t.pages.size(), 3);
+        EXPECT_EQ(allocator.getStats().pagesCreated, 3);
+
+        // Pages are not reused before the GPU is done with them.
+        for (const auto& allocation : allocations) allocator.release(allocation, fence.cpuValue);
+        fence.signal();
+        allocator.executeDeferredReleases(fence.gpuValue);
+        EXPECT_EQ(allocator.getStats().bytesInFlight, 1100 + 2 * kPageSize);
+        for (uint32_t i = 0; i < 4; i++) allocator.allocate(kPageSize / 4);
+        EXPECT_EQ(allocator.getStats().pagesCreated, 4);
+
+        // Once retired, the pages are recycled and no new memory is created.
+        fence.complete();
+        allocator.executeDeferredReleases(fence.gpuValue);
+        EXPECT_EQ(allocator.getStats().bytesInFlight, kPageSize);
+        EXPECT_EQ(allocator.getStats().peakBytesInFlight, 1100 + 3 * kPageSize);
+        for (uint32_t i = 0; i < 8; i++) allocator.allocate(kPageSize / 4);
+        EXPECT_EQ(allocator.getStats().pagesCreated, 4);
+        EXPECT_EQ(allocator.getStats().pagesRecycled, 2);
+        EXPECT_EQ(t.pages.size(), allocator.getStats().pageCount);
+    }
+
+    CPU_TEST(GpuMemoryAllocatorBlocks)
+    {
+        TestAllocator t;
+        FakeFence fence;
+        auto& allocator = t.allocator;
+
+        // Large allocations get dedicated blocks rounded up to the size class.
+        const size_t size = 3 * kPageSize + 12345;
+        auto a = allocator.allocate(size, 256);
+        EXPECT_EQ(a.offset, 0);
+        EXPECT_EQ(t.pages[a.pageIndex], GpuMemoryAllocator::getBlockSize(size));
+        EXPECT_EQ(allocator.getStats().blockCount, 1);
+        EXPECT_EQ(allocator.getStats().pageCount, 0);
+
+        // Streaming the same size every frame reuses the blocks once the GPU is done with them.
+        allocator.release(a, fence.cpuValue);
+        for (uint32_t frame = 0; frame < 100; frame++)
+        {
+            auto b = allocator.allocate(size - frame);
+            allocator.release(b, fence.cpuValue);
+            fence.signal();
+            fence.complete();
+            allocator.executeDeferredReleases(fence.gpuValue);
+        }
+        const auto& stats = allocator.getStats();
+        EXPECT_LE(stats.blocksCreated, 2);
+        EXPECT_EQ(stats.blocksCreated + stats.blocksRecycled, 101);
+        EXPECT_EQ(stats.bytesInFlight, 0);
+        EXPECT_EQ(stats.bytesReserved, stats.blockCount * GpuMemoryAllocator::getBlockSize(size));
+
+        // A different size class gets its own block.
+        auto c = allocator.allocate(8 * kPageSize);
+        EXPECT_EQ(t.pages[c.pageIndex], 8 * kPageSize);
+        EXPECT_EQ(allocator.getStats().blocksCreated, stats.blocksCreated);
+    }
+
+    CPU_TEST(GpuMemoryAllocatorTrim)
+    {
+        TestAllocator t;
+        FakeFence fence;
+        auto& allocator = t.allocator;
+        allocator.setIdleTrimThreshold(10);
+
+        std::vector<GpuMemoryAllocator::Allocation> allocations;
+        for (uint32_t i = 0; i < 12; i++) allocations.push_back(allocator.allocate(kPageSize / 4));
+        allocations.push_back(allocator.allocate(2 * kPageSize));
+        allocations.push_back(allocator.allocate(5 * kPageSize));
+        EXPECT_EQ(allocator.getStats().pageCount, 3);
+        EXPECT_EQ(allocator.getStats().blockCount, 2);
+        const uint64_t peakReserved = allocator.getStats().bytesReserved;
+
+        for (const auto& allocation : allocations) allocator.release(allocation, fence.cpuValue);
+        fence.signal();
+        fence.complete();
+        allocator.executeDeferredReleases(fence.gpuValue);
+
+        // Unused memory is kept until it has been idle for longer than the threshold. The active page is kept.
+        for (uint32_t i = 0; i < 10; i++)
+        {
+            fence.signal();
+            fence.complete();
+            allocator.executeDeferredReleases(fence.gpuValue);
+        }
+        EXPECT_EQ(allocator.getStats().bytesReserved, peakReserved);
+        fence.signal();
+        fence.complete();
+        allocator.executeDeferredReleases(fence.gpuValue);
+        EXPECT_EQ(allocator.getStats().pageCount, 1);
+        EXPECT_EQ(allocator.getStats().blockCount, 0);
+        EXPECT_EQ(allocator.getStats().pagesTrimmed, 2);
+        EXPECT_EQ(allocator.getStats().blocksTrimmed, 2);
+        EXPECT_EQ(allocator.getStats().bytesReserved, kPageSize);
+        EXPECT_EQ(allocator.getStats().peakBytesReserved, peakReserved);
+        EXPECT_EQ(t.pages.size(), 1);
+
+        // Explicit trimming releases all unused memory regardless of the threshold.
+        allocator.setIdleTrimThreshold(std::numeric_limits<uint64_t>::max());
+        auto a = allocator.allocate(2 * kPageSize);
+        for (uint32_t i = 0; i < 4; i++) allocator.allocate(kPageSize / 4);
+        allocator.release(a, fence.cpuValue);
+        fence.signal();
+        fence.complete();
+        allocator.executeDeferredReleases(fence.gpuValue);
+        EXPECT_EQ(allocator.getStats().blockCount, 1);
+        allocator.trim();
+        EXPECT_EQ(allocator.getStats().blockCount, 0);
+        EXPECT_EQ(allocator.getStats().pageCount, 1);
+        EXPECT_EQ(t.pages.size(), 1);
+    }
+}
@@ -0,0 +1,134 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        const std::string kShaderFile = "Tests/Core/BufferTests.cs.slang";
+        const std::string kEntryPoints[] = { "clearBuffer", "updateBuffer", "readBuffer" };
+        const uint32_t kTypeCount = 3;
+
+        std::vector<Program::SharedPtr> createPrograms()
+        {
+            std::vector<Program::SharedPtr> programs;
+            for (uint32_t type = 0; type < kTypeCount; type++)
+            {
+                for (const auto& entryPoint : kEntryPoints)
+                {
+                    programs.push_back(ComputeProgram::createFromFile(kShaderFile, entryPoint, Program::DefineList({ { "TYPE", std::to_string(type) } })));
+                }
+            }
+            return programs;
+        }
+    }
+
+    GPU_TEST(ProgramBatchLink)
+    {
+        auto programs = createPrograms();
+        auto pending = Program::getProgramsRequiringLink();
+        for (const auto& pProgram : programs)
+        {
+            EXPECT(std::find(pending.begin(), pending.end(), pProgram) != pending.end());
+        }
+
+        // Duplicates are linked once.
+        auto batch = programs;
+        batch.push_back(programs[0]);
+        EXPECT_EQ(Program::linkPrograms(batch), (uint32_t)programs.size());
+        EXPECT_EQ(Program::linkPrograms(batch), 0);
+
+        // Batch-linked programs have the same reflection as programs linked on first use.
+        auto reference = createPrograms();
+        for (size_t i = 0; i < programs.size(); i++)
+        {
+            const auto& pReflector = programs[i]->getReflector();
+            const auto& pRefReflector = reference[i]->getReflector();
+            EXPECT(pReflector != nullptr);
+            EXPECT_EQ(pReflector->getThreadGroupSize().x, pRefReflector->getThreadGroupSize().x);
+            EXPECT_EQ(pReflector->getDefaultParameterBlock()->getResourceRangeCount(), pRefReflector->getDefaultParameterBlock()->getResourceRangeCount());
+            EXPECT(pReflector->getResource("buffer") != nullptr);
+            EXPECT(pReflector->getResource("result") != nullptr);
+        }
+
+        // Changing the defines requires a new version, which is compiled by the next batch.
+        programs[0]->addDefine("TYPE", "2");
+        pending = Program::getProgramsRequiringLink();
+        EXPECT(std::find(pending.begin(), pending.end(), programs[0]) != pending.end());
+        EXPECT_EQ(Program::linkPrograms({ programs[0] }), 1);
+        EXPECT(programs[0]->getReflector()->getResource("buffer") != nullptr);
+    }
+
+    GPU_TEST(ProgramLinkRecorder)
+    {
+        auto pOutside = ComputeProgram::createFromFile(kShaderFile, kEntryPoints[0]);
+
+        std::vector<std::weak_ptr<Program>> recorded;
+        std::vector<std::weak_ptr<Program>> nested;
+        Program::SharedPtr pCreated;
+        {
+            Program::LinkRecorder recorder(recorded);
+            pCreated = ComputeProgram::createFromFile(kShaderFile, kEntryPoints[1]);
+            {
+                // Programs are only recorded by the innermost recorder.
+                Program::LinkRecorder nestedRecorder(nested);
+                pOutside->addDefine("TYPE", "1");
+            }
+        }
+        pOutside->addDefine("TYPE", "2");
+
+        EXPECT_EQ(recorded.size(), 1);
+        EXPECT(recorded[0].lock() == pCreated);
+        EXPECT_EQ(nested.size(), 1);
+        EXPECT(nested[0].lock() == pOutside);
+
+        // Only the recorded programs are linked.
+        EXPECT_EQ(Program::linkPrograms({ recorded[0].lock() }), 1);
+        auto pending = Program::getProgramsRequiringLink();
+        EXPECT(std::find(pending.begin(), pending.end(), pCreated) == pending.end());
+        EXPECT(std::find(pending.begin(), pending.end(), pOutside) != pending.end());
+    }
+
+    GPU_TEST(ProgramBatchLinkBenchmark, "Long running benchmark, enable manually.")
+    {
+        auto sequentialPrograms = createPrograms();
+        auto start = CpuTimer::getCurrentTimePoint();
+        for (const auto& pProgram : sequentialPrograms) pProgram->getActiveVersion();
+        double sequentialTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        auto batchPrograms = createPrograms();
+        start = CpuTimer::getCurrentTimePoint();
+        EXPECT_EQ(Program::linkPrograms(batchPrograms), (uint32_t)batchPrograms.size());
+        double batchTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        logInfo("ProgramBatchLinkBenchmark: " + std::to_string(batchPrograms.size()) + " programs, " + std::to_string(Threading::getThreadCount()) + " threads" +
+            "\n  sequential: " + std::to_string(sequentialTime) + " ms" +
+            "\n  batch: " + std::to_string(batchTime) + " ms");
+    }
+}
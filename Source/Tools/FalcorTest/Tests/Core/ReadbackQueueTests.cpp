@@ -0,0 +1,183 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Core/API/ReadbackQueue.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Fence that completes when the test says so. Waiting completes the fence immediately, like a GPU that finishes its work.
+        */
+        class FakeFence : public ReadbackQueue::Fence
+        {
+        public:
+            uint64_t getCompletedValue() const override { return completedValue; }
+            void wait(uint64_t value) override
+            {
+                waits.push_back(value);
+                completedValue = std::max(completedValue, value);
+            }
+
+            uint64_t completedValue = 0;
+            std::vector<uint64_t> waits;
+        };
+
+        /** Records processed and retired readbacks.
+        */
+        struct Recorder
+        {
+            std::mutex mutex;
+            std::vector<uint32_t> processed;
+            std::vector<uint32_t> retired;
+
+            std::function<void()> process(uint32_t id)
+            {
+                return [this, id]() { std::lock_guard<std::mutex> lock(mutex); processed.push_back(id); };
+            }
+
+            std::function<void()> retire(uint32_t id)
+            {
+                return [this, id]() { retired.push_back(id); };
+            }
+
+            std::vector<uint32_t> getProcessed()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto result = processed;
+                std::sort(result.begin(), result.end());
+                return result;
+            }
+        };
+
+        void updateUntil(ReadbackQueue& queue, uint32_t pendingCount)
+        {
+            for (uint32_t i = 0; i < 100000 && queue.getPendingCount() > pendingCount; i++)
+            {
+                queue.update();
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    CPU_TEST(ReadbackQueueRetire)
+    {
+        auto pFence = std::make_shared<FakeFence>();
+        auto pQueue = ReadbackQueue::create(pFence);
+        Recorder recorder;
+
+        for (uint32_t i = 0; i < 3; i++) pQueue->submit(i + 1, 10, recorder.process(i), recorder.retire(i));
+        EXPECT_EQ(pQueue->getPendingCount(), 3);
+        EXPECT_EQ(pQueue->getStats().bytesInFlight, 30);
+
+        // Nothing is processed before the fence is reached.
+        EXPECT_EQ(pQueue->update(), 0);
+        EXPECT(recorder.getProcessed().empty());
+
+        // Readbacks are processed once their fence value is reached, without waiting on the fence.
+        pFence->completedValue = 2;
+        updateUntil(*pQueue, 1);
+        EXPECT_EQ(pQueue->getPendingCount(), 1);
+        EXPECT(recorder.getProcessed() == std::vector<uint32_t>({ 0, 1 }));
+        EXPECT(pFence->waits.empty());
+
+        // Flushing waits for the remaining ones.
+        pQueue->flush();
+        EXPECT_EQ(pQueue->getPendingCount(), 0);
+        EXPECT(recorder.getProcessed() == std::vector<uint32_t>({ 0, 1, 2 }));
+        EXPECT(pFence->waits == std::vector<uint64_t>({ 3 }));
+
+        // Retire callbacks run on the queue's thread in submission order.
+        EXPECT(recorder.retired == std::vector<uint32_t>({ 0, 1, 2 }));
+
+        const auto& stats = pQueue->getStats();
+        EXPECT_EQ(stats.submitCount, 3);
+        EXPECT_EQ(stats.retireCount, 3);
+        EXPECT_EQ(stats.stallCount, 0);
+        EXPECT_EQ(stats.bytesInFlight, 0);
+        EXPECT_EQ(stats.peakBytesInFlight, 30);
+    }
+
+    CPU_TEST(ReadbackQueueBudget)
+    {
+        auto pFence = std::make_shared<FakeFence>();
+        auto pQueue = ReadbackQueue::create(pFence, 100);
+        Recorder recorder;
+
+        pQueue->submit(1, 40, recorder.process(0), recorder.retire(0));
+        pQueue->submit(2, 40, recorder.process(1), recorder.retire(1));
+        EXPECT_EQ(pQueue->getStats().stallCount, 0);
+        EXPECT(pFence->waits.empty());
+
+        // The third readback doesn't fit, so the oldest one is retired first.
+        pQueue->submit(3, 40, recorder.process(2), recorder.retire(2));
+        EXPECT_EQ(pQueue->getStats().stallCount, 1);
+        EXPECT(pFence->waits == std::vector<uint64_t>({ 1 }));
+        EXPECT(recorder.retired == std::vector<uint32_t>({ 0 }));
+        EXPECT_EQ(pQueue->getStats().bytesInFlight, 80);
+        EXPECT_LE(pQueue->getStats().peakBytesInFlight, 100);
+
+        // A readback larger than the budget waits for all others.
+        pQueue->submit(4, 150, recorder.process(3), recorder.retire(3));
+        EXPECT_EQ(pQueue->getStats().stallCount, 2);
+        EXPECT(recorder.retired == std::vector<uint32_t>({ 0, 1, 2 }));
+        EXPECT_EQ(pQueue->getPendingCount(), 1);
+
+        pQueue->flush();
+        EXPECT(recorder.getProcessed() == std::vector<uint32_t>({ 0, 1, 2, 3 }));
+        EXPECT(recorder.retired == std::vector<uint32_t>({ 0, 1, 2, 3 }));
+        EXPECT_EQ(pQueue->getStats().bytesInFlight, 0);
+    }
+
+    CPU_TEST(ReadbackQueueException)
+    {
+        auto pFence = std::make_shared<FakeFence>();
+        auto pQueue = ReadbackQueue::create(pFence);
+        Recorder recorder;
+
+        pQueue->submit(1, 10, []() { throw std::runtime_error("encode failed"); });
+        pQueue->submit(2, 10, recorder.process(1), recorder.retire(1));
+
+        bool thrown = false;
+        try
+        {
+            pQueue->flush();
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        EXPECT(thrown);
+
+        // The failed readback is retired, the queue keeps working.
+        pQueue->flush();
+        EXPECT_EQ(pQueue->getPendingCount(), 0);
+        EXPECT(recorder.retired == std::vector<uint32_t>({ 1 }));
+        EXPECT_EQ(pQueue->getStats().bytesInFlight, 0);
+    }
+}
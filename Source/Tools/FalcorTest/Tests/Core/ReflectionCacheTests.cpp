@@ -0,0 +1,201 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include <filesystem>
+
+namespace Falcor
+{
+    namespace
+    {
+        struct TestProgram
+        {
+            std::string path;
+            std::string entryPoint;
+            Program::DefineList defines;
+            std::string shaderModel;
+        };
+
+        /** Compute programs of the unit tests. Together they cover constant buffers, parameter blocks,
+            root buffers, structured and typed buffers, textures and entry point uniform parameters.
+        */
+        const TestProgram kTestPrograms[] =
+        {
+            { "Tests/Core/BufferTests.cs.slang", "clearBuffer", { { "TYPE", "1" } }, "" },
+            { "Tests/Core/BufferAccessTests.cs.slang", "readback", {}, "" },
+            { "Tests/Core/ConstantBufferTests.cs.slang", "testCbuffer1", {}, "" },
+            { "Tests/Core/UserConstantBufferTests.cs.slang", "test", {}, "" },
+            { "Tests/Core/ParamBlockReflection.cs.slang", "main", {}, "5_1" },
+            { "Tests/Core/RootBufferTests.cs.slang", "main", { { "USE_UAV", "1" } }, "6_0" },
+            { "Tests/Core/RootBufferStructTests.cs.slang", "main", { { "USE_UAV", "0" } }, "6_0" },
+            { "Tests/Core/RootBufferParamBlockTests.cs.slang", "main", { { "USE_UAV", "1" } }, "6_3" },
+            { "Tests/Utils/HashUtilsTests.cs.slang", "testJenkinsHash", {}, "" },
+            { "Tests/Sampling/PseudorandomTests.cs.slang", "testXoshiro", {}, "" },
+            { "Tests/ShadingUtils/ShadingUtilsTests.cs.slang", "testRand", {}, "" },
+            { "Tests/Slang/SlangTests.cs.slang", "testScalarTypes", {}, "6_2" },
+        };
+
+        ProgramReflection::SharedPtr createReflection(GPUUnitTestContext& ctx, const TestProgram& program)
+        {
+            ctx.createProgram(program.path, program.entryPoint, program.defines, Shader::CompilerFlags::None, program.shaderModel, false);
+            return ctx.getProgram()->getReflector();
+        }
+
+        void compareBlocks(GPUUnitTestContext& ctx, const ParameterBlockReflection* pExpected, const ParameterBlockReflection* pBlock)
+        {
+            EXPECT(*pBlock->getElementType() == *pExpected->getElementType());
+            EXPECT_EQ(pBlock->getResourceRangeCount(), pExpected->getResourceRangeCount());
+            EXPECT_EQ(pBlock->getRootDescriptorRangeCount(), pExpected->getRootDescriptorRangeCount());
+            EXPECT_EQ(pBlock->getParameterBlockSubObjectRangeCount(), pExpected->getParameterBlockSubObjectRangeCount());
+            EXPECT_EQ(pBlock->getBindingPlan().subObjects.size(), pExpected->getBindingPlan().subObjects.size());
+            EXPECT_EQ(pBlock->getBindingPlan().setDependencies.size(), pExpected->getBindingPlan().setDependencies.size());
+            EXPECT_EQ(pBlock->getDefaultConstantBufferBindingInfo().descriptorSetIndex, pExpected->getDefaultConstantBufferBindingInfo().descriptorSetIndex);
+
+            EXPECT_EQ(pBlock->getDescriptorSetCount(), pExpected->getDescriptorSetCount());
+            if (pBlock->getDescriptorSetCount() != pExpected->getDescriptorSetCount()) return;
+
+            for (uint32_t s = 0; s < pBlock->getDescriptorSetCount(); s++)
+            {
+                const auto& layout = pBlock->getDescriptorSetLayout(s);
+                const auto& expectedLayout = pExpected->getDescriptorSetLayout(s);
+                EXPECT_EQ(layout.getRangeCount(), expectedLayout.getRangeCount());
+                if (layout.getRangeCount() != expectedLayout.getRangeCount()) continue;
+
+                for (size_t r = 0; r < layout.getRangeCount(); r++)
+                {
+                    EXPECT(layout.getRange(r).type == expectedLayout.getRange(r).type);
+                    EXPECT_EQ(layout.getRange(r).baseRegIndex, expectedLayout.getRange(r).baseRegIndex);
+                    EXPECT_EQ(layout.getRange(r).descCount, expectedLayout.getRange(r).descCount);
+                    EXPECT_EQ(layout.getRange(r).regSpace, expectedLayout.getRange(r).regSpace);
+                }
+            }
+        }
+    }
+
+    GPU_TEST(ReflectionCacheRoundTrip)
+    {
+        for (const auto& program : kTestPrograms)
+        {
+            auto pReflector = createReflection(ctx, program);
+            EXPECT(pReflector != nullptr);
+            if (!pReflector) continue;
+
+            std::vector<uint8_t> data;
+            EXPECT(pReflector->serialize(data));
+
+            auto pLoaded = ProgramReflection::deserialize(ctx.getProgram()->getActiveVersion().get(), nullptr, data.data(), data.size());
+            EXPECT(pLoaded != nullptr);
+            if (!pLoaded) continue;
+
+            // The loaded reflection must serialize to the same bytes.
+            std::vector<uint8_t> roundTripData;
+            EXPECT(pLoaded->serialize(roundTripData));
+            EXPECT(roundTripData == data);
+
+            // The derived binding data is rebuilt when loading and must match.
+            compareBlocks(ctx, pReflector->getDefaultParameterBlock().get(), pLoaded->getDefaultParameterBlock().get());
+            EXPECT_EQ(pLoaded->getEntryPointGroups().size(), pReflector->getEntryPointGroups().size());
+            for (uint32_t i = 0; i < pLoaded->getEntryPointGroups().size() && i < pReflector->getEntryPointGroups().size(); i++)
+            {
+                compareBlocks(ctx, pReflector->getEntryPointGroup(i).get(), pLoaded->getEntryPointGroup(i).get());
+            }
+            EXPECT(pLoaded->getThreadGroupSize() == pReflector->getThreadGroupSize());
+        }
+    }
+
+    GPU_TEST(ReflectionCacheParameterBlock)
+    {
+        auto pReflector = createReflection(ctx, kTestPrograms[3]);
+        std::vector<uint8_t> data;
+        EXPECT(pReflector->serialize(data));
+        auto pLoaded = ProgramReflection::deserialize(ctx.getProgram()->getActiveVersion().get(), nullptr, data.data(), data.size());
+        EXPECT(pLoaded != nullptr);
+        if (!pLoaded) return;
+
+        // Loaded types are shared like the original ones, and member lookups work without Slang.
+        auto pBlockReflector = pLoaded->getParameterBlock("params");
+        EXPECT(pBlockReflector != nullptr);
+        if (!pBlockReflector) return;
+        EXPECT(pBlockReflector->findMember("c") != nullptr);
+        EXPECT_EQ(pBlockReflector->findMember("c")->getByteOffset(), pReflector->getParameterBlock("params")->findMember("c")->getByteOffset());
+        EXPECT(pLoaded->getResource("params")->getType()->asResourceType()->getParameterBlockReflector() == pBlockReflector);
+
+        // Parameter blocks created from the loaded reflection have no Slang layouts to specialize or size from.
+        auto pExpectedBlock = ParameterBlock::create(pReflector->getParameterBlock("params"));
+        auto pBlock = ParameterBlock::create(pBlockReflector);
+        pBlock["b"] = 11;
+        EXPECT_EQ(pBlock->getUnderlyingConstantBuffer()->getSize(), pExpectedBlock->getUnderlyingConstantBuffer()->getSize());
+
+        auto pVars = ComputeVars::create(pLoaded);
+        EXPECT(pVars != nullptr);
+    }
+
+    GPU_TEST(ReflectionCacheInvalidData)
+    {
+        auto pReflector = createReflection(ctx, kTestPrograms[0]);
+        auto pVersion = ctx.getProgram()->getActiveVersion().get();
+        std::vector<uint8_t> data;
+        EXPECT(pReflector->serialize(data));
+
+        EXPECT(ProgramReflection::deserialize(pVersion, nullptr, data.data(), 0) == nullptr);
+        EXPECT(ProgramReflection::deserialize(pVersion, nullptr, data.data(), data.size() / 2) == nullptr);
+        EXPECT(ProgramReflection::deserialize(pVersion, nullptr, data.data(), data.size() - 1) == nullptr);
+
+        auto badMagic = data;
+        badMagic[0] ^= 0xff;
+        EXPECT(ProgramReflection::deserialize(pVersion, nullptr, badMagic.data(), badMagic.size()) == nullptr);
+
+        auto badVersion = data;
+        badVersion[4] ^= 0xff;
+        EXPECT(ProgramReflection::deserialize(pVersion, nullptr, badVersion.data(), badVersion.size()) == nullptr);
+    }
+
+    GPU_TEST(ReflectionCacheProgram)
+    {
+        ShaderCache::SharedPtr pPreviousCache = Program::getShaderCache();
+        std::string directory = getTempFilename() + "_reflectioncache";
+        ShaderCache::SharedPtr pCache = ShaderCache::create(directory);
+        EXPECT(pCache != nullptr);
+        if (!pCache) return;
+        Program::setShaderCache(pCache);
+
+        // The first compilation stores the reflection, the second one loads it from the cache.
+        std::vector<uint8_t> data;
+        EXPECT(createReflection(ctx, kTestPrograms[7])->serialize(data));
+        ShaderCache::Stats stats = pCache->getStats();
+
+        std::vector<uint8_t> cachedData;
+        EXPECT(createReflection(ctx, kTestPrograms[7])->serialize(cachedData));
+        EXPECT_GT(pCache->getStats().hitCount, stats.hitCount);
+        EXPECT(cachedData == data);
+
+        Program::setShaderCache(pPreviousCache);
+        pCache->clear();
+        std::error_code ec;
+        std::filesystem::remove_all(directory, ec);
+    }
+}
@@ -0,0 +1,209 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Core/Program/ShaderCache.h"
+#include <filesystem>
+#include <fstream>
+
+namespace Falcor
+{
+    namespace
+    {
+        std::vector<uint8_t> createBlob(size_t size, uint8_t seed)
+        {
+            std::vector<uint8_t> blob(size);
+            for (size_t i = 0; i < size; i++) blob[i] = uint8_t(i * 31 + seed);
+            return blob;
+        }
+
+        ShaderCache::Key createKey(uint32_t i)
+        {
+            return ShaderCache::KeyBuilder().addValue(i).getKey();
+        }
+
+        std::string createTempDirectory()
+        {
+            std::string directory = getTempFilename() + "_shadercache";
+            std::error_code ec;
+            std::filesystem::remove_all(directory, ec);
+            return directory;
+        }
+    }
+
+    CPU_TEST(ShaderCacheKey)
+    {
+        using KeyBuilder = ShaderCache::KeyBuilder;
+
+        // Keys are deterministic and depend on the value order and string boundaries.
+        EXPECT(KeyBuilder().addString("ab").addString("c").getKey() == KeyBuilder().addString("ab").addString("c").getKey());
+        EXPECT(KeyBuilder().addString("ab").addString("c").getKey() != KeyBuilder().addString("a").addString("bc").getKey());
+        EXPECT(KeyBuilder().addValue(1u).addValue(2u).getKey() != KeyBuilder().addValue(2u).addValue(1u).getKey());
+        EXPECT(KeyBuilder().getKey() != KeyBuilder().addString("").getKey());
+
+        // Extending a key is equivalent to hashing it as a value.
+        ShaderCache::Key base = KeyBuilder().addString("base").getKey();
+        EXPECT(KeyBuilder(base).addValue(7u).getKey() == KeyBuilder().addKey(base).addValue(7u).getKey());
+        EXPECT(KeyBuilder(base).addValue(7u).getKey() != KeyBuilder(base).addValue(8u).getKey());
+
+        // Define lists are hashed by name and value.
+        Shader::DefineList defines = { { "A", "1" }, { "B", "0" } };
+        Shader::DefineList otherDefines = { { "A", "1" }, { "B", "1" } };
+        EXPECT(KeyBuilder().addMap(defines).getKey() == KeyBuilder().addMap(Shader::DefineList(defines)).getKey());
+        EXPECT(KeyBuilder().addMap(defines).getKey() != KeyBuilder().addMap(otherDefines).getKey());
+
+        // String conversion round-trips.
+        ShaderCache::Key key = KeyBuilder().addString("roundtrip").getKey();
+        std::string str = key.toString();
+        EXPECT_EQ(str.size(), 32);
+        ShaderCache::Key parsed;
+        EXPECT(ShaderCache::Key::fromString(str, parsed));
+        EXPECT(parsed == key);
+        EXPECT(!ShaderCache::Key::fromString("0123", parsed));
+        EXPECT(!ShaderCache::Key::fromString(std::string(31, '0') + "x", parsed));
+
+        // File keys depend on the file content.
+        std::string filename = getTempFilename();
+        {
+            std::ofstream file(filename, std::ios::binary);
+            file << "float4 main() : SV_Target { return 0; }";
+        }
+        KeyBuilder fileKey;
+        EXPECT(fileKey.addFile(filename));
+        {
+            std::ofstream file(filename, std::ios::binary);
+            file << "float4 main() : SV_Target { return 1; }";
+        }
+        KeyBuilder changedKey;
+        EXPECT(changedKey.addFile(filename));
+        EXPECT(fileKey.getKey() != changedKey.getKey());
+
+        std::error_code ec;
+        std::filesystem::remove(filename, ec);
+        KeyBuilder missingKey;
+        EXPECT(!missingKey.addFile(filename));
+    }
+
+    CPU_TEST(ShaderCacheStore)
+    {
+        std::string directory = createTempDirectory();
+        ShaderCache::SharedPtr pCache = ShaderCache::create(directory);
+        EXPECT(pCache != nullptr);
+        if (!pCache) return;
+
+        std::vector<uint8_t> data;
+        EXPECT(!pCache->load(createKey(0), data));
+
+        auto blob = createBlob(1000, 3);
+        EXPECT(pCache->store(createKey(0), blob.data(), blob.size()));
+        EXPECT(pCache->contains(createKey(0)));
+        EXPECT(pCache->load(createKey(0), data));
+        EXPECT(data == blob);
+
+        // Storing the same key replaces the entry.
+        auto newBlob = createBlob(500, 5);
+        EXPECT(pCache->store(createKey(0), newBlob.data(), newBlob.size()));
+        EXPECT(pCache->load(createKey(0), data));
+        EXPECT(data == newBlob);
+
+        ShaderCache::Stats stats = pCache->getStats();
+        EXPECT_EQ(stats.hitCount, 2);
+        EXPECT_EQ(stats.missCount, 1);
+        EXPECT_EQ(stats.storeCount, 2);
+        EXPECT_EQ(stats.entryCount, 1);
+        EXPECT_GT(stats.sizeInBytes, newBlob.size());
+
+        // A new cache in the same directory sees the stored entries.
+        pCache = ShaderCache::create(directory);
+        EXPECT(pCache->load(createKey(0), data));
+        EXPECT(data == newBlob);
+        EXPECT_EQ(pCache->getStats().entryCount, 1);
+
+        // Corrupt entries are removed and reported as misses.
+        {
+            std::fstream file(directory + "/" + createKey(0).toString() + "." + ShaderCache::kFileExtension, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(-1, std::ios::end);
+            file.put(0x7f);
+        }
+        EXPECT(!pCache->load(createKey(0), data));
+        EXPECT(!pCache->contains(createKey(0)));
+        EXPECT_EQ(pCache->getStats().entryCount, 0);
+
+        pCache->clear();
+        std::error_code ec;
+        std::filesystem::remove_all(directory, ec);
+    }
+
+    CPU_TEST(ShaderCacheEviction)
+    {
+        const size_t kBlobSize = 1000;
+        const uint32_t kMaxEntries = 4;
+
+        std::string directory = createTempDirectory();
+        ShaderCache::SharedPtr pCache = ShaderCache::create(directory);
+        EXPECT(pCache != nullptr);
+        if (!pCache) return;
+
+        // Measure the stored size of one entry to set the limit to a whole number of entries.
+        auto blob = createBlob(kBlobSize, 0);
+        pCache->store(createKey(0), blob.data(), blob.size());
+        uint64_t entrySize = pCache->getStats().sizeInBytes;
+        pCache->setMaxSize(entrySize * kMaxEntries);
+
+        for (uint32_t i = 1; i < kMaxEntries; i++) pCache->store(createKey(i), blob.data(), blob.size());
+        EXPECT_EQ(pCache->getStats().entryCount, kMaxEntries);
+        EXPECT_EQ(pCache->getStats().evictionCount, 0);
+
+        // Touch the oldest entry so that entry 1 becomes the least recently used.
+        std::vector<uint8_t> data;
+        EXPECT(pCache->load(createKey(0), data));
+
+        pCache->store(createKey(kMaxEntries), blob.data(), blob.size());
+        EXPECT_EQ(pCache->getStats().entryCount, kMaxEntries);
+        EXPECT_EQ(pCache->getStats().evictionCount, 1);
+        EXPECT(pCache->contains(createKey(0)));
+        EXPECT(!pCache->contains(createKey(1)));
+        EXPECT(pCache->contains(createKey(kMaxEntries)));
+        EXPECT(!std::filesystem::exists(directory + "/" + createKey(1).toString() + "." + ShaderCache::kFileExtension));
+
+        // Lowering the limit evicts the least recently used entries.
+        pCache->setMaxSize(entrySize * 2);
+        EXPECT_EQ(pCache->getStats().entryCount, 2);
+        EXPECT(pCache->contains(createKey(kMaxEntries)));
+        EXPECT(pCache->contains(createKey(0)));
+
+        // Opening the directory with a smaller limit evicts on creation.
+        pCache = ShaderCache::create(directory, entrySize);
+        EXPECT_EQ(pCache->getStats().entryCount, 1);
+
+        pCache->clear();
+        EXPECT_EQ(pCache->getStats().entryCount, 0);
+        EXPECT_EQ(pCache->getStats().sizeInBytes, 0);
+        std::error_code ec;
+        std::filesystem::remove_all(directory, ec);
+    }
+}
@@ -0,0 +1,239 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "RenderGraph/RenderGraph.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kChannelCount = 6;
+        const char kExternalInput[] = "external";
+
+        /** Pass that only fetches its resources. Used for validating the handles and for measuring the dispatch overhead of the graph.
+        */
+        class FetchPass : public RenderPass
+        {
+        public:
+            using SharedPtr = std::shared_ptr<FetchPass>;
+
+            static SharedPtr create(bool hasInputs) { return SharedPtr(new FetchPass(hasInputs)); }
+
+            RenderPassReflection reflect(const CompileData& compileData) override
+            {
+                RenderPassReflection reflector;
+                for (const auto& name : mFieldNames)
+                {
+                    if (name == kExternalInput) reflector.addInput(name, "").flags(RenderPassReflection::Field::Flags::Optional);
+                    else if (name[0] == 'i') reflector.addInput(name, "");
+                    else reflector.addOutput(name, "").texture2D(8, 8).format(ResourceFormat::R8Unorm);
+                }
+                return reflector;
+            }
+
+            void execute(RenderContext* pRenderContext, const RenderData& renderData) override
+            {
+                if (mValidate)
+                {
+                    mByHandle.clear();
+                    mByName.clear();
+                    for (uint32_t i = 0; i < (uint32_t)mFieldNames.size(); i++)
+                    {
+                        mByHandle.push_back(renderData.getResource(i));
+                        mByName.push_back(renderData[mFieldNames[i]]);
+                        if (renderData.getHandle(mFieldNames[i]) != i) mHandleMismatches++;
+                    }
+                    if (renderData.getHandle("missing") != RenderData::kInvalidHandle) mHandleMismatches++;
+                    if (renderData.getResource(RenderData::kInvalidHandle) != nullptr || renderData["missing"] != nullptr) mHandleMismatches++;
+                    return;
+                }
+
+                for (uint32_t i = 0; i < (uint32_t)mFieldNames.size(); i++)
+                {
+                    const auto& pResource = mUseHandles ? renderData.getResource(i) : renderData[mFieldNames[i]];
+                    if (pResource) mFetchCount++;
+                }
+            }
+
+            std::string getDesc() override { return "Fetches its resources"; }
+
+            std::vector<std::string> mFieldNames;
+            std::vector<Resource::SharedPtr> mByHandle;
+            std::vector<Resource::SharedPtr> mByName;
+            uint32_t mHandleMismatches = 0;
+            uint64_t mFetchCount = 0;
+            bool mUseHandles = false;
+            bool mValidate = false;
+
+        private:
+            FetchPass(bool hasInputs)
+            {
+                for (uint32_t i = 0; i < kChannelCount; i++)
+                {
+                    if (hasInputs) mFieldNames.push_back("in" + std::to_string(i));
+                    mFieldNames.push_back("out" + std::to_string(i));
+                }
+                if (hasInputs) mFieldNames.push_back(kExternalInput);
+            }
+        };
+
+        /** Create a chain of passes where all the outputs of a pass are connected to the inputs of the next one.
+        */
+        RenderGraph::SharedPtr createChain(uint32_t passCount, std::vector<FetchPass::SharedPtr>& passes)
+        {
+            auto pGraph = RenderGraph::create("FetchChain");
+            for (uint32_t p = 0; p < passCount; p++)
+            {
+                passes.push_back(FetchPass::create(p > 0));
+                pGraph->addPass(passes.back(), "Pass" + std::to_string(p));
+                if (p == 0) continue;
+                for (uint32_t i = 0; i < kChannelCount; i++)
+                {
+                    pGraph->addEdge("Pass" + std::to_string(p - 1) + ".out" + std::to_string(i), "Pass" + std::to_string(p) + ".in" + std::to_string(i));
+                }
+            }
+            pGraph->markOutput("Pass" + std::to_string(passCount - 1) + ".out0");
+            return pGraph;
+        }
+    }
+
+    GPU_TEST(RenderDataHandles)
+    {
+        RenderContext* pRenderContext = ctx.getRenderContext();
+        std::vector<FetchPass::SharedPtr> passes;
+        auto pGraph = createChain(2, passes);
+        for (auto& pPass : passes) pPass->mValidate = true;
+
+        pGraph->execute(pRenderContext);
+        const auto& first = *passes[0];
+        const auto& second = *passes[1];
+        EXPECT_EQ(first.mHandleMismatches, 0u);
+        EXPECT_EQ(second.mHandleMismatches, 0u);
+
+        // Handles and names resolve to the same resources, and the inputs are the outputs of the previous pass.
+        EXPECT_EQ(first.mByHandle.size(), kChannelCount);
+        EXPECT_EQ(second.mByHandle.size(), 2 * kChannelCount + 1);
+        if (first.mByHandle.size() != kChannelCount || second.mByHandle.size() != 2 * kChannelCount + 1) return;
+        for (size_t i = 0; i < second.mByHandle.size(); i++) EXPECT(second.mByHandle[i] == second.mByName[i]);
+        for (uint32_t i = 0; i < kChannelCount; i++)
+        {
+            EXPECT(first.mByHandle[i] != nullptr);
+            EXPECT(second.mByHandle[2 * i] == first.mByHandle[i]);
+            EXPECT(second.mByHandle[2 * i + 1] != nullptr);
+        }
+        EXPECT(second.mByHandle.back() == nullptr);
+
+        // Setting an input doesn't recompile the graph, the handle must follow the external resource.
+        auto pExternal = Texture::create2D(8, 8, ResourceFormat::R8Unorm, 1, 1, nullptr, ResourceBindFlags::ShaderResource);
+        pGraph->setInput("Pass1." + std::string(kExternalInput), pExternal);
+        pGraph->execute(pRenderContext);
+        EXPECT(second.mByHandle.back() == pExternal);
+        EXPECT(second.mByName.back() == pExternal);
+
+        pGraph->setInput("Pass1." + std::string(kExternalInput), nullptr);
+        pGraph->execute(pRenderContext);
+        EXPECT(second.mByHandle.back() == nullptr);
+        EXPECT(second.mByName.back() == nullptr);
+    }
+
+    GPU_TEST(RenderGraphDispatchBenchmark, "Long running benchmark, enable manually.")
+    {
+        RenderContext* pRenderContext = ctx.getRenderContext();
+        const uint32_t passCount = 16;
+        const uint32_t frameCount = 1000;
+        const uint32_t fieldsPerPass = 2 * kChannelCount;
+
+        // Per-fetch cost of the resource cache. Previously every fetch built the full name and looked it up in the external and internal maps.
+        auto pCache = ResourceCache::create();
+        std::vector<std::string> passNames, fieldNames;
+        for (uint32_t p = 0; p < passCount; p++) passNames.push_back("Pass" + std::to_string(p));
+        for (uint32_t f = 0; f < fieldsPerPass; f++) fieldNames.push_back("field" + std::to_string(f));
+        for (uint32_t p = 0; p < passCount; p++)
+        {
+            for (const auto& fieldName : fieldNames)
+            {
+                RenderPassReflection::Field field(fieldName, "", RenderPassReflection::Field::Visibility::Output);
+                field.texture2D(8, 8).format(ResourceFormat::R8Unorm);
+                pCache->registerField(passNames[p] + '.' + fieldName, field, p);
+            }
+        }
+        pCache->registerExternalResource("Pass0.external", Texture::create2D(8, 8, ResourceFormat::R8Unorm, 1, 1, nullptr, ResourceBindFlags::ShaderResource));
+        pCache->allocateResources({ uint2(8), ResourceFormat::R8Unorm });
+
+        std::vector<uint32_t> slots;
+        for (uint32_t p = 0; p < passCount; p++)
+        {
+            for (const auto& fieldName : fieldNames) slots.push_back(pCache->getResourceSlot(passNames[p] + '.' + fieldName));
+        }
+
+        uint64_t nameCount = 0, slotCount = 0;
+        auto start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t frame = 0; frame < frameCount; frame++)
+        {
+            for (uint32_t p = 0; p < passCount; p++)
+            {
+                for (const auto& fieldName : fieldNames) nameCount += pCache->getResource(passNames[p] + '.' + fieldName) ? 1 : 0;
+            }
+        }
+        double nameTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t frame = 0; frame < frameCount; frame++)
+        {
+            for (uint32_t slot : slots) slotCount += pCache->getResource(slot) ? 1 : 0;
+        }
+        double slotTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        EXPECT_EQ(nameCount, uint64_t(frameCount) * passCount * fieldsPerPass);
+        EXPECT_EQ(slotCount, nameCount);
+
+        // Dispatch overhead of a whole graph, fetching the resources by name and by handle.
+        std::vector<FetchPass::SharedPtr> passes;
+        auto pGraph = createChain(passCount, passes);
+        pGraph->execute(pRenderContext);
+
+        double graphTime[2];
+        for (uint32_t useHandles = 0; useHandles < 2; useHandles++)
+        {
+            for (auto& pPass : passes) pPass->mUseHandles = useHandles != 0;
+            start = CpuTimer::getCurrentTimePoint();
+            for (uint32_t frame = 0; frame < frameCount; frame++) pGraph->execute(pRenderContext);
+            graphTime[useHandles] = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        }
+
+        // The first pass only has outputs, the others also fetch their inputs. The optional external input is never bound.
+        uint64_t totalFetchCount = 0;
+        for (const auto& pPass : passes) totalFetchCount += pPass->mFetchCount;
+        EXPECT_EQ(totalFetchCount, uint64_t(2 * frameCount + 1) * (kChannelCount + (passCount - 1) * 2 * kChannelCount));
+
+        uint64_t fetchCount = uint64_t(frameCount) * passCount * fieldsPerPass;
+        logInfo("RenderGraphDispatchBenchmark: " + std::to_string(passCount) + " passes, " + std::to_string(fieldsPerPass) + " resources per pass, " + std::to_string(frameCount) + " frames" +
+            "\n  resource cache: " + std::to_string(nameTime * 1e6 / fetchCount) + " ns per fetch by full name (previous path), " + std::to_string(slotTime * 1e6 / fetchCount) + " ns per fetch by slot" +
+            "\n  graph execute: " + std::to_string(graphTime[0] * 1e3 / frameCount) + " us per frame by name, " + std::to_string(graphTime[1] * 1e3 / frameCount) + " us per frame by handle" +
+            " (" + std::to_string(kChannelCount + (passCount - 1) * (2 * kChannelCount + 1)) + " fetches per frame)");
+    }
+}
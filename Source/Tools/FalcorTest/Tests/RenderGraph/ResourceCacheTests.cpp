@@ -0,0 +1,163 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "RenderGraph/ResourceCache.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        using Lifetime = ResourceCache::Lifetime;
+
+        /** Check that resources sharing an allocation have the same description and non-overlapping lifetimes.
+        */
+        bool isValidPacking(const std::vector<Lifetime>& lifetimes, const std::vector<uint32_t>& allocation)
+        {
+            for (size_t i = 0; i < lifetimes.size(); i++)
+            {
+                for (size_t j = i + 1; j < lifetimes.size(); j++)
+                {
+                    if (allocation[i] != allocation[j]) continue;
+                    if (lifetimes[i].descIndex != lifetimes[j].descIndex) return false;
+                    bool overlap = lifetimes[i].first <= lifetimes[j].last && lifetimes[j].first <= lifetimes[i].last;
+                    if (overlap) return false;
+                }
+            }
+            return true;
+        }
+
+        /** Compute the lower bound of the allocation count, the sum over the descriptions of the maximum number of simultaneously live resources.
+        */
+        uint32_t getMinAllocationCount(const std::vector<Lifetime>& lifetimes, uint32_t descCount, uint32_t timeCount)
+        {
+            uint32_t count = 0;
+            for (uint32_t d = 0; d < descCount; d++)
+            {
+                uint32_t maxLive = 0;
+                for (uint32_t t = 0; t < timeCount; t++)
+                {
+                    uint32_t live = 0;
+                    for (const auto& l : lifetimes) live += (l.descIndex == d && l.first <= t && t <= l.last) ? 1 : 0;
+                    maxLive = std::max(maxLive, live);
+                }
+                count += maxLive;
+            }
+            return count;
+        }
+
+        /** Create the lifetimes of a synthetic graph. Each pass produces a few resources that are consumed by later passes.
+        */
+        std::vector<Lifetime> createRandomGraph(std::mt19937& rng, uint32_t passCount, uint32_t descCount)
+        {
+            std::vector<Lifetime> lifetimes;
+            for (uint32_t pass = 0; pass < passCount; pass++)
+            {
+                uint32_t outputCount = 1 + rng() % 3;
+                for (uint32_t o = 0; o < outputCount; o++)
+                {
+                    uint32_t lastConsumer = std::min(passCount - 1, pass + rng() % 6);
+                    lifetimes.push_back({ pass, lastConsumer, uint32_t(rng() % descCount) });
+                }
+            }
+            return lifetimes;
+        }
+    }
+
+    CPU_TEST(ResourceAliasingChain)
+    {
+        // A chain of passes where each output is consumed by the next pass only needs two allocations.
+        const uint32_t passCount = 100;
+        std::vector<Lifetime> lifetimes;
+        for (uint32_t i = 0; i < passCount; i++) lifetimes.push_back({ i, std::min(i + 1, passCount - 1), 0 });
+
+        uint32_t allocationCount = 0;
+        auto allocation = ResourceCache::packLifetimes(lifetimes, allocationCount);
+        EXPECT_EQ(allocationCount, 2u);
+        EXPECT(isValidPacking(lifetimes, allocation));
+        for (uint32_t i = 0; i < passCount; i++) EXPECT_EQ(allocation[i], i % 2);
+    }
+
+    CPU_TEST(ResourceAliasingDescriptions)
+    {
+        // Resources with different descriptions never share an allocation, even if their lifetimes don't overlap.
+        std::vector<Lifetime> lifetimes = { { 0, 0, 0 }, { 1, 1, 1 }, { 2, 2, 0 }, { 3, 3, 1 } };
+
+        uint32_t allocationCount = 0;
+        auto allocation = ResourceCache::packLifetimes(lifetimes, allocationCount);
+        EXPECT_EQ(allocationCount, 2u);
+        EXPECT_EQ(allocation[0], allocation[2]);
+        EXPECT_EQ(allocation[1], allocation[3]);
+        EXPECT_NE(allocation[0], allocation[1]);
+
+        // Lifetimes are inclusive, resources used in the same pass can't alias.
+        lifetimes = { { 0, 2, 0 }, { 2, 4, 0 }, { 3, 5, 0 }, { 5, 6, 0 } };
+        allocation = ResourceCache::packLifetimes(lifetimes, allocationCount);
+        EXPECT_EQ(allocationCount, 2u);
+        EXPECT(isValidPacking(lifetimes, allocation));
+
+        // Empty input.
+        allocation = ResourceCache::packLifetimes({}, allocationCount);
+        EXPECT_EQ(allocationCount, 0u);
+        EXPECT(allocation.empty());
+    }
+
+    CPU_TEST(ResourceAliasingRandomGraphs)
+    {
+        std::mt19937 rng(42);
+        const uint32_t descCount = 4;
+
+        for (uint32_t graph = 0; graph < 50; graph++)
+        {
+            uint32_t passCount = 1 + rng() % 40;
+            auto lifetimes = createRandomGraph(rng, passCount, descCount);
+
+            uint32_t allocationCount = 0;
+            auto allocation = ResourceCache::packLifetimes(lifetimes, allocationCount);
+            EXPECT(isValidPacking(lifetimes, allocation));
+
+            // Greedy interval partitioning is optimal.
+            EXPECT_EQ(allocationCount, getMinAllocationCount(lifetimes, descCount, passCount));
+            EXPECT_LE(allocationCount, lifetimes.size());
+
+            // All allocation indices are used.
+            std::vector<bool> used(allocationCount, false);
+            for (uint32_t a : allocation)
+            {
+                EXPECT_LT(a, allocationCount);
+                if (a < allocationCount) used[a] = true;
+            }
+            for (bool u : used) EXPECT(u);
+
+            // The result is deterministic.
+            uint32_t allocationCount2 = 0;
+            EXPECT(ResourceCache::packLifetimes(lifetimes, allocationCount2) == allocation);
+            EXPECT_EQ(allocationCount, allocationCount2);
+        }
+    }
+}
@@ -0,0 +1,152 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        const double kDuration = 10.0;
+
+        /** Create an animation with one channel per matrix, with random keyframes, interpolation modes and warping.
+        */
+        Animation::SharedPtr createAnimation(std::mt19937& rng, uint32_t channelCount, uint32_t maxKeyframes)
+        {
+            std::uniform_real_distribution<float> u(-1.f, 1.f);
+            std::uniform_real_distribution<double> time(0.0, kDuration);
+
+            auto pAnimation = Animation::create("test", kDuration);
+            glm::quat rotation(1.f, 0.f, 0.f, 0.f);
+            for (uint32_t i = 0; i < channelCount; i++)
+            {
+                uint32_t channel = pAnimation->addChannel(i);
+                auto mode = rng() % 2 ? Animation::InterpolationMode::Hermite : Animation::InterpolationMode::Linear;
+                pAnimation->setInterpolationMode(channel, mode, rng() % 2 == 0);
+
+                uint32_t keyframeCount = 1 + rng() % maxKeyframes;
+                for (uint32_t k = 0; k < keyframeCount; k++)
+                {
+                    Animation::Keyframe keyframe;
+                    keyframe.time = k == 0 && rng() % 2 ? 0.0 : time(rng);
+                    keyframe.translation = float3(u(rng), u(rng), u(rng)) * 10.f;
+                    keyframe.scaling = float3(1.f) + float3(u(rng), u(rng), u(rng)) * 0.5f;
+
+                    // Mix in unchanged and flipped rotations to cover the special cases of slerp.
+                    switch (rng() % 4)
+                    {
+                    case 0: break;
+                    case 1: rotation = -rotation; break;
+                    default: rotation = glm::normalize(glm::quat(u(rng), u(rng), u(rng), u(rng)) + glm::quat(0.1f, 0.f, 0.f, 0.f));
+                    }
+                    keyframe.rotation = rotation;
+                    pAnimation->addKeyframe(channel, keyframe);
+                }
+            }
+            return pAnimation;
+        }
+
+        float maxDifference(const std::vector<glm::mat4>& a, const std::vector<glm::mat4>& b)
+        {
+            float maxDiff = 0.f;
+            for (size_t i = 0; i < a.size(); i++)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    for (int r = 0; r < 4; r++)
+                    {
+                        float diff = std::abs(a[i][c][r] - b[i][c][r]) / std::max(1.f, std::abs(b[i][c][r]));
+                        maxDiff = std::max(maxDiff, diff);
+                    }
+                }
+            }
+            return maxDiff;
+        }
+    }
+
+    CPU_TEST(AnimationBatchedEquivalence)
+    {
+        std::mt19937 rng(3);
+        const uint32_t channelCount = 1000;
+        auto pAnimation = createAnimation(rng, channelCount, 12);
+
+        std::vector<glm::mat4> batched(channelCount);
+        std::vector<glm::mat4> reference(channelCount);
+
+        // Advance in small steps past the end of the animation, then jump around.
+        std::vector<double> times;
+        for (double t = 0.0; t < 2.5 * kDuration; t += 1.0 / 30.0) times.push_back(t);
+        std::uniform_real_distribution<double> time(0.0, 3.0 * kDuration);
+        for (uint32_t i = 0; i < 200; i++) times.push_back(time(rng));
+
+        float maxDiff = 0.f;
+        for (double t : times)
+        {
+            pAnimation->animate(t, batched);
+            pAnimation->animateReference(t, reference);
+            maxDiff = std::max(maxDiff, maxDifference(batched, reference));
+        }
+        EXPECT_LE(maxDiff, 1e-4f);
+
+        // Changing the keyframes must be picked up by the batched path.
+        Animation::Keyframe keyframe;
+        keyframe.time = 0.0;
+        keyframe.translation = float3(100.f, 0.f, 0.f);
+        pAnimation->setInterpolationMode(0, Animation::InterpolationMode::Linear, false);
+        pAnimation->addKeyframe(0, keyframe);
+        pAnimation->addKeyframe(1, keyframe);
+
+        pAnimation->animate(1.0, batched);
+        pAnimation->animateReference(1.0, reference);
+        EXPECT_LE(maxDifference(batched, reference), 1e-4f);
+    }
+
+    CPU_TEST(AnimationBatchedBenchmark, "Long running benchmark, enable manually.")
+    {
+        std::mt19937 rng(5);
+        const uint32_t channelCount = 50000;
+        const uint32_t frameCount = 100;
+        auto pAnimation = createAnimation(rng, channelCount, 32);
+        std::vector<glm::mat4> matrices(channelCount);
+
+        // Build the keyframe buffer before timing.
+        pAnimation->animate(0.0, matrices);
+
+        auto start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < frameCount; i++) pAnimation->animateReference(i / 60.0, matrices);
+        double referenceTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / frameCount;
+
+        start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < frameCount; i++) pAnimation->animate(i / 60.0, matrices);
+        double batchedTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / frameCount;
+
+        logInfo("AnimationBatchedBenchmark: " + std::to_string(channelCount) + " channels, per channel " + std::to_string(referenceTime) +
+            " ms/frame, batched " + std::to_string(batchedTime) + " ms/frame");
+        EXPECT_GT(batchedTime, 0.0);
+    }
+}
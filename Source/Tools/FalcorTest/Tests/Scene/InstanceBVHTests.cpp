@@ -0,0 +1,415 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        std::vector<BoundingBox> createBoxes(std::mt19937& rng, size_t count, float range)
+        {
+            std::uniform_real_distribution<float> pos(-range, range);
+            std::uniform_real_distribution<float> size(0.01f, 2.f);
+            std::vector<BoundingBox> boxes(count);
+            for (auto& box : boxes)
+            {
+                box.center = float3(pos(rng), pos(rng), pos(rng));
+                box.extent = float3(size(rng), size(rng), size(rng));
+            }
+            return boxes;
+        }
+
+        void moveBoxes(std::mt19937& rng, std::vector<BoundingBox>& boxes, float fraction, float distance)
+        {
+            std::uniform_real_distribution<float> u(-distance, distance);
+            size_t count = size_t(fraction * boxes.size());
+            for (size_t i = 0; i < count; i++)
+            {
+                auto& box = boxes[rng() % boxes.size()];
+                box.center += float3(u(rng), u(rng), u(rng));
+            }
+        }
+
+        // Check that the nodes enclose their children and that each box is in exactly one leaf.
+        bool validate(const InstanceBVH& bvh, const std::vector<BoundingBox>& boxes)
+        {
+            const auto& nodes = bvh.getNodes();
+            std::vector<uint32_t> leafPrimCount(boxes.size(), 0);
+            auto encloses = [](const BBox& outer, const BBox& inner)
+            {
+                return glm::all(glm::lessThanEqual(outer.minPoint, inner.minPoint)) && glm::all(glm::lessThanEqual(inner.maxPoint, outer.maxPoint));
+            };
+
+            uint32_t primCount = 0;
+            for (uint32_t i = 0; i < (uint32_t)nodes.size(); i++)
+            {
+                const auto& node = nodes[i];
+                if (node.isLeaf())
+                {
+                    primCount += node.primCount;
+                    continue;
+                }
+                if (node.rightChild <= i + 1 || node.rightChild >= nodes.size()) return false;
+                const auto& left = nodes[i + 1];
+                const auto& right = nodes[node.rightChild];
+                if (!encloses(node.bounds, left.bounds) || !encloses(node.bounds, right.bounds)) return false;
+                if (left.firstPrim != node.firstPrim || right.firstPrim != left.firstPrim + left.primCount || left.primCount + right.primCount != node.primCount) return false;
+            }
+            return primCount == boxes.size() && (nodes.empty() || nodes[0].primCount == boxes.size());
+        }
+
+        uint32_t getDepth(const InstanceBVH& bvh)
+        {
+            const auto& nodes = bvh.getNodes();
+            uint32_t maxDepth = 0;
+            std::vector<std::pair<uint32_t, uint32_t>> stack;
+            if (!nodes.empty()) stack.push_back({ 0, 1 });
+            while (!stack.empty())
+            {
+                auto [nodeIndex, depth] = stack.back();
+                stack.pop_back();
+                maxDepth = std::max(maxDepth, depth);
+                if (nodes[nodeIndex].isLeaf()) continue;
+                stack.push_back({ nodeIndex + 1, depth + 1 });
+                stack.push_back({ nodes[nodeIndex].rightChild, depth + 1 });
+            }
+            return maxDepth;
+        }
+
+        std::vector<uint32_t> sorted(std::vector<uint32_t> v)
+        {
+            std::sort(v.begin(), v.end());
+            return v;
+        }
+
+        // Brute force versions of the queries.
+        bool insideFrustum(const Frustum& frustum, const BoundingBox& box)
+        {
+            float3 minPoint = box.getMinPos(), maxPoint = box.getMaxPos();
+            for (const float4& plane : frustum.planes)
+            {
+                float3 n = float3(plane);
+                float3 p = float3(n.x >= 0.f ? maxPoint.x : minPoint.x, n.y >= 0.f ? maxPoint.y : minPoint.y, n.z >= 0.f ? maxPoint.z : minPoint.z);
+                if (glm::dot(p, n) <= -plane.w) return false;
+            }
+            return true;
+        }
+
+        template<typename Func>
+        std::vector<uint32_t> bruteForce(const std::vector<BoundingBox>& boxes, const Func& func)
+        {
+            std::vector<uint32_t> result;
+            for (uint32_t i = 0; i < (uint32_t)boxes.size(); i++) if (func(boxes[i])) result.push_back(i);
+            return result;
+        }
+
+        Camera::SharedPtr createCamera(const float3& pos, const float3& target)
+        {
+            auto pCamera = Camera::create();
+            pCamera->setPosition(pos);
+            pCamera->setTarget(target);
+            pCamera->setUpVector(float3(0.f, 1.f, 0.f));
+            pCamera->setAspectRatio(16.f / 9.f);
+            pCamera->setDepthRange(0.1f, 100.f);
+            return pCamera;
+        }
+
+        std::vector<uint32_t> cullReference(const std::vector<Camera::SharedPtr>& cameras, const std::vector<BoundingBox>& boxes)
+        {
+            std::vector<uint32_t> visible;
+            for (uint32_t i = 0; i < (uint32_t)boxes.size(); i++)
+            {
+                for (const auto& pCamera : cameras)
+                {
+                    if (!pCamera->isObjectCulled(boxes[i]))
+                    {
+                        visible.push_back(i);
+                        break;
+                    }
+                }
+            }
+            return visible;
+        }
+
+        void checkQueries(CPUUnitTestContext& ctx, std::mt19937& rng, const InstanceBVH& bvh, const std::vector<BoundingBox>& boxes)
+        {
+            std::uniform_real_distribution<float> u(-1.f, 1.f);
+            std::vector<uint32_t> result;
+
+            for (uint32_t i = 0; i < 10; i++)
+            {
+                auto pCamera = Camera::create();
+                pCamera->setPosition(float3(u(rng), u(rng), u(rng)) * 50.f);
+                pCamera->setTarget(float3(u(rng), u(rng), u(rng)) * 50.f);
+                pCamera->setDepthRange(0.1f, 60.f);
+                Frustum frustum = Frustum::fromViewProjMatrix(pCamera->getViewProjMatrix());
+                result.clear();
+                bvh.queryFrustums({ frustum }, result);
+                EXPECT(sorted(result) == bruteForce(boxes, [&](const BoundingBox& b) { return insideFrustum(frustum, b); }));
+
+                BoundingBox query = { float3(u(rng), u(rng), u(rng)) * 50.f, float3(u(rng), u(rng), u(rng)) * 10.f + float3(10.f) };
+                result.clear();
+                bvh.queryBox(query, result);
+                EXPECT(sorted(result) == bruteForce(boxes, [&](const BoundingBox& b) { return glm::all(glm::lessThanEqual(glm::abs(b.center - query.center), b.extent + query.extent)); }));
+
+                float3 center = float3(u(rng), u(rng), u(rng)) * 50.f;
+                float radius = 5.f + 10.f * std::abs(u(rng));
+                result.clear();
+                bvh.querySphere(center, radius, result);
+                EXPECT(sorted(result) == bruteForce(boxes, [&](const BoundingBox& b)
+                {
+                    float3 d = center - glm::clamp(center, b.getMinPos(), b.getMaxPos());
+                    return glm::dot(d, d) <= radius * radius;
+                }));
+
+                // Rays towards random boxes, so that there is something to hit.
+                float3 origin = float3(u(rng), u(rng), u(rng)) * 80.f;
+                float3 dir = boxes[rng() % boxes.size()].center - origin;
+                std::vector<InstanceBVH::RayHit> hits;
+                bvh.queryRay(origin, dir, 2.f, hits);
+                EXPECT(!hits.empty());
+                std::vector<uint32_t> hitIndices;
+                for (size_t h = 0; h < hits.size(); h++)
+                {
+                    hitIndices.push_back(hits[h].index);
+                    if (h > 0) EXPECT_LE(hits[h - 1].t, hits[h].t);
+                }
+                EXPECT(sorted(hitIndices) == bruteForce(boxes, [&](const BoundingBox& b)
+                {
+                    float3 invDir = 1.f / dir;
+                    float3 t0 = (b.getMinPos() - origin) * invDir, t1 = (b.getMaxPos() - origin) * invDir;
+                    float3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+                    return std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.f)) <= std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, 2.f));
+                }));
+            }
+        }
+    }
+
+    CPU_TEST(InstanceBVH)
+    {
+        std::mt19937 rng(17);
+        auto boxes = createBoxes(rng, 20000, 100.f);
+
+        InstanceBVH bvh;
+        bvh.build(boxes);
+        EXPECT_EQ(bvh.getBoxCount(), boxes.size());
+        EXPECT(validate(bvh, boxes));
+        EXPECT_GT(bvh.getSAHCost(), 0.f);
+        checkQueries(ctx, rng, bvh, boxes);
+
+        // Refit after moving boxes.
+        moveBoxes(rng, boxes, 0.2f, 5.f);
+        bvh.refit(boxes);
+        EXPECT(validate(bvh, boxes));
+        checkQueries(ctx, rng, bvh, boxes);
+
+        // Identical boxes cannot be split by their centroids.
+        std::vector<BoundingBox> identical(100, BoundingBox{ float3(1.f), float3(1.f) });
+        bvh.build(identical);
+        EXPECT(validate(bvh, identical));
+        std::vector<uint32_t> result;
+        bvh.querySphere(float3(1.f), 0.5f, result);
+        EXPECT_EQ(result.size(), identical.size());
+
+        bvh.build({});
+        EXPECT(bvh.getNodes().empty());
+        EXPECT(!bvh.getBounds().valid());
+        result.clear();
+        bvh.queryBox(BoundingBox{ float3(0.f), float3(1.f) }, result);
+        EXPECT(result.empty());
+    }
+
+    CPU_TEST(InstanceBVHDegenerate)
+    {
+        // Exponentially spaced boxes make every SAH split separate the outermost box from the others.
+        const uint32_t boxCount = 120;
+        std::vector<BoundingBox> boxes(boxCount);
+        for (uint32_t i = 0; i < boxCount; i++)
+        {
+            boxes[i].center = float3(std::ldexp(1.f, (int)i), 0.f, 0.f);
+            boxes[i].extent = float3(0.25f);
+        }
+
+        InstanceBVH bvh;
+        bvh.build(boxes);
+        EXPECT(validate(bvh, boxes));
+        EXPECT_LE(getDepth(bvh), 80u);
+    }
+
+    CPU_TEST(InstanceBVHFrustumCulling)
+    {
+        std::mt19937 rng(11);
+        auto pCamera = createCamera(float3(0.f, 0.f, 0.f), float3(1.f, 0.2f, -1.f));
+        Frustum frustum = Frustum::fromViewProjMatrix(pCamera->getViewProjMatrix());
+
+        // Enough boxes for the query to run in parallel, and a count that is not a multiple of four.
+        auto boxes = createBoxes(rng, 50003, 150.f);
+        InstanceBVH bvh;
+        bvh.build(boxes);
+
+        std::vector<uint32_t> visible;
+        bvh.queryFrustums({ frustum }, visible);
+        auto expected = cullReference({ pCamera }, boxes);
+        EXPECT_GT(expected.size(), 0);
+        EXPECT_LT(expected.size(), boxes.size());
+        EXPECT(sorted(visible) == expected);
+
+        // The result doesn't depend on how the subtrees are scheduled.
+        std::vector<uint32_t> visible2;
+        bvh.queryFrustums({ frustum }, visible2);
+        EXPECT(visible == visible2);
+
+        // A box is visible if it intersects any of the frustums.
+        auto pCamera2 = createCamera(float3(10.f, 0.f, 0.f), float3(10.f, 0.f, 1.f));
+        visible.clear();
+        bvh.queryFrustums({ frustum, Frustum::fromViewProjMatrix(pCamera2->getViewProjMatrix()) }, visible);
+        auto expected2 = cullReference({ pCamera, pCamera2 }, boxes);
+        EXPECT_GT(expected2.size(), expected.size());
+        EXPECT(sorted(visible) == expected2);
+
+        visible.clear();
+        bvh.queryFrustums({}, visible);
+        EXPECT(visible.empty());
+    }
+
+    CPU_TEST(InstanceBVHFrustumPlanes)
+    {
+        auto pCamera = createCamera(float3(0.f, 0.f, 0.f), float3(0.f, 0.f, -1.f));
+        Frustum frustum = Frustum::fromViewProjMatrix(pCamera->getViewProjMatrix());
+
+        std::vector<BoundingBox> boxes =
+        {
+            { float3(0.f, 0.f, -10.f), float3(1.f) },    // Inside
+            { float3(0.f, 0.f, 10.f), float3(1.f) },     // Behind the camera
+            { float3(0.f, 0.f, -1000.f), float3(1.f) },  // Beyond the far plane
+            { float3(500.f, 0.f, -10.f), float3(1.f) },  // Outside the side planes
+            { float3(0.f, 0.f, -99.f), float3(2.f) },    // Crossing the far plane
+        };
+
+        InstanceBVH bvh;
+        bvh.build(boxes);
+        std::vector<uint32_t> visible;
+        bvh.queryFrustums({ frustum }, visible);
+        EXPECT(sorted(visible) == std::vector<uint32_t>({ 0, 4 }));
+
+        // Without the near and far planes, boxes beyond the far plane are visible. Boxes behind the camera are still outside the side planes.
+        frustum.planes[Frustum::kNear] = frustum.planes[Frustum::kFar] = float4(0.f, 0.f, 0.f, 1.f);
+        visible.clear();
+        bvh.queryFrustums({ frustum }, visible);
+        EXPECT(sorted(visible) == std::vector<uint32_t>({ 0, 2, 4 }));
+    }
+
+    CPU_TEST(InstanceBVHFrustumCullingBenchmark, "Long running benchmark, enable manually.")
+    {
+        std::mt19937 rng(13);
+        const size_t boxCount = 1000000;
+        const uint32_t iterations = 10;
+
+        auto pCamera = createCamera(float3(0.f, 0.f, 0.f), float3(1.f, 0.f, -1.f));
+        std::vector<Frustum> frustums = { Frustum::fromViewProjMatrix(pCamera->getViewProjMatrix()) };
+        auto boxes = createBoxes(rng, boxCount, 150.f);
+
+        InstanceBVH bvh;
+        auto start = CpuTimer::getCurrentTimePoint();
+        bvh.build(boxes);
+        double buildTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        std::vector<uint32_t> visible;
+        start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            visible.clear();
+            bvh.queryFrustums(frustums, visible);
+        }
+        double cullTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / iterations;
+
+        start = CpuTimer::getCurrentTimePoint();
+        std::vector<uint32_t> expected = cullReference({ pCamera }, boxes);
+        double referenceTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        EXPECT(sorted(visible) == expected);
+        logInfo("InstanceBVHFrustumCullingBenchmark: " + std::to_string(boxCount) + " boxes, " + std::to_string(visible.size()) + " visible, " + std::to_string(Threading::getThreadCount()) +
+            " threads. build " + std::to_string(buildTime) + " ms, cull " + std::to_string(cullTime) + " ms, Camera::isObjectCulled() loop " + std::to_string(referenceTime) + " ms");
+    }
+
+    CPU_TEST(InstanceBVHBenchmark, "Long running benchmark, enable manually.")
+    {
+        std::mt19937 rng(19);
+        const size_t boxCount = 200000;
+        const uint32_t frameCount = 20;
+        auto boxes = createBoxes(rng, boxCount, 1000.f);
+
+        auto pCamera = Camera::create();
+        pCamera->setPosition(float3(0.f));
+        pCamera->setTarget(float3(1.f, 0.f, 0.f));
+        pCamera->setDepthRange(0.1f, 300.f);
+        std::vector<Frustum> frustums = { Frustum::fromViewProjMatrix(pCamera->getViewProjMatrix()) };
+
+        std::string report = "InstanceBVHBenchmark: " + std::to_string(boxCount) + " instances, " + std::to_string(frameCount) + " frames";
+        for (float fraction : { 0.01f, 0.1f, 1.f })
+        {
+            auto animated = boxes;
+            InstanceBVH refitBVH, rebuildBVH;
+            refitBVH.build(animated);
+            float buildCost = refitBVH.getSAHCost();
+
+            double refitTime = 0.0, buildTime = 0.0, refitQueryTime = 0.0, rebuildQueryTime = 0.0;
+            std::vector<uint32_t> visible;
+            for (uint32_t frame = 0; frame < frameCount; frame++)
+            {
+                moveBoxes(rng, animated, fraction, 10.f);
+
+                auto start = CpuTimer::getCurrentTimePoint();
+                refitBVH.refit(animated);
+                refitTime += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+                start = CpuTimer::getCurrentTimePoint();
+                rebuildBVH.build(animated);
+                buildTime += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+                start = CpuTimer::getCurrentTimePoint();
+                visible.clear();
+                refitBVH.queryFrustums(frustums, visible);
+                refitQueryTime += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+                start = CpuTimer::getCurrentTimePoint();
+                visible.clear();
+                rebuildBVH.queryFrustums(frustums, visible);
+                rebuildQueryTime += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+            }
+
+            report += "\n  animated " + std::to_string(fraction * 100.f) + "%: refit " + std::to_string(refitTime / frameCount) + " ms, rebuild " + std::to_string(buildTime / frameCount) +
+                " ms, frustum query " + std::to_string(refitQueryTime / frameCount) + " ms refit / " + std::to_string(rebuildQueryTime / frameCount) + " ms rebuilt, SAH cost " +
+                std::to_string(buildCost) + " -> " + std::to_string(refitBVH.getSAHCost()) + " refit / " + std::to_string(rebuildBVH.getSAHCost()) + " rebuilt";
+            EXPECT(validate(refitBVH, animated));
+        }
+
+        logInfo(report);
+    }
+}
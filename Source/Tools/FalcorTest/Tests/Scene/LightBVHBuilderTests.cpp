@@ -0,0 +1,214 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Experimental/Scene/Lights/LightBVHBuilder.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        using MeshLightTriangle = LightCollection::MeshLightTriangle;
+
+        /** Generates a synthetic set of emissive triangles.
+            The triangles are clustered to mimic the structure of real scenes with many small emitters.
+        */
+        std::vector<MeshLightTriangle> createTriangles(uint32_t triangleCount, uint32_t seed = 0)
+        {
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<float> u(0.f, 1.f);
+            auto randomPoint = [&]() { return float3(u(rng), u(rng), u(rng)); };
+
+            const uint32_t clusterCount = std::max(1u, triangleCount / 1000);
+            std::vector<float3> clusterCenters(clusterCount);
+            for (auto& c : clusterCenters) c = randomPoint() * 1000.f;
+
+            std::vector<MeshLightTriangle> triangles(triangleCount);
+            for (uint32_t i = 0; i < triangleCount; i++)
+            {
+                auto& tri = triangles[i];
+                float3 p = clusterCenters[i % clusterCount] + randomPoint() * 10.f;
+                for (uint32_t j = 0; j < 3; j++) tri.vtx[j].pos = p + (randomPoint() - 0.5f) * 0.1f;
+
+                float3 n = glm::cross(tri.vtx[1].pos - tri.vtx[0].pos, tri.vtx[2].pos - tri.vtx[0].pos);
+                tri.area = 0.5f * glm::length(n);
+                tri.normal = tri.area > 0.f ? glm::normalize(n) : float3(0.f, 0.f, 1.f);
+                tri.flux = u(rng) < 0.05f ? 0.f : u(rng) * 10.f; // Some triangles are culled by pre-integration.
+                tri.lightIdx = 0;
+            }
+            return triangles;
+        }
+
+        /** Generates emissive triangles that hit the edge cases of the binning.
+            All triangles are axis-aligned and coplanar, many of them share the same centroid, and the normals of neighboring triangles cancel out.
+        */
+        std::vector<MeshLightTriangle> createDegenerateTriangles(uint32_t triangleCount, uint32_t seed = 0)
+        {
+            std::mt19937 rng(seed);
+            std::uniform_int_distribution<int> cell(0, 63);
+
+            std::vector<MeshLightTriangle> triangles(triangleCount);
+            for (uint32_t i = 0; i < triangleCount; i++)
+            {
+                auto& tri = triangles[i];
+                float3 p = float3((float)cell(rng), (float)cell(rng), 0.f);
+                tri.vtx[0].pos = p;
+                tri.vtx[1].pos = p + float3(1.f, 0.f, 0.f);
+                tri.vtx[2].pos = p + float3(0.f, 1.f, 0.f);
+                tri.area = 0.5f;
+                tri.normal = float3(0.f, 0.f, i % 2 == 0 ? 1.f : -1.f);
+                tri.flux = 1.f;
+                tri.lightIdx = 0;
+            }
+            return triangles;
+        }
+
+        struct BuildResult
+        {
+            std::vector<PackedNode> nodes;
+            std::vector<uint32_t> triangleIndices;
+            std::vector<uint64_t> triangleBitmasks;
+        };
+
+        BuildResult build(const std::vector<MeshLightTriangle>& triangles, const LightBVHBuilder::Options& options)
+        {
+            BuildResult result;
+            LightBVHBuilder::create(options)->buildNodes(triangles, result.nodes, result.triangleIndices, result.triangleBitmasks);
+            return result;
+        }
+
+        void expectIdentical(CPUUnitTestContext& ctx, const BuildResult& a, const BuildResult& b, const std::string& desc)
+        {
+            EXPECT(!a.nodes.empty()) << desc;
+            EXPECT_EQ(a.nodes.size(), b.nodes.size()) << desc;
+            EXPECT(a.triangleIndices == b.triangleIndices) << desc;
+            EXPECT(a.triangleBitmasks == b.triangleBitmasks) << desc;
+            if (a.nodes.size() == b.nodes.size())
+            {
+                EXPECT_EQ(std::memcmp(a.nodes.data(), b.nodes.data(), a.nodes.size() * sizeof(PackedNode)), 0) << desc;
+            }
+        }
+
+        void runBenchmark(const std::vector<uint32_t>& triangleCounts)
+        {
+            std::string report = "LightBVHBuilder benchmark (" + std::to_string(Threading::getThreadCount()) + " worker threads):";
+            for (uint32_t triangleCount : triangleCounts)
+            {
+                auto triangles = createTriangles(triangleCount);
+
+                auto timeBuild = [&](bool useSIMD, bool useParallelBuild, size_t& nodeCount)
+                {
+                    LightBVHBuilder::Options options;
+                    options.useSIMD = useSIMD;
+                    options.useParallelBuild = useParallelBuild;
+                    auto start = CpuTimer::getCurrentTimePoint();
+                    nodeCount = build(triangles, options).nodes.size();
+                    return CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+                };
+
+                size_t nodeCount = 0;
+                double scalarTime = timeBuild(false, false, nodeCount);
+                double simdTime = timeBuild(true, false, nodeCount);
+                double parallelTime = timeBuild(true, true, nodeCount);
+
+                report += "\n  " + std::to_string(triangleCount) + " triangles: scalar " + std::to_string(scalarTime) + " ms, SIMD " + std::to_string(simdTime) +
+                    " ms (" + std::to_string(scalarTime / simdTime) + "x), SIMD parallel " + std::to_string(parallelTime) + " ms (" + std::to_string(scalarTime / parallelTime) + "x), " +
+                    std::to_string(nodeCount) + " nodes";
+            }
+            logInfo(report);
+        }
+    }
+
+    CPU_TEST(LightBVHBuilderParallelDeterminism)
+    {
+        // Use enough triangles to exercise both the parallel binning and the subtree tasks.
+        auto triangles = createTriangles(200000, 1);
+
+        for (auto heuristic : { LightBVHBuilder::SplitHeuristic::Equal, LightBVHBuilder::SplitHeuristic::BinnedSAH, LightBVHBuilder::SplitHeuristic::BinnedSAOH })
+        {
+            for (bool splitAlongLargest : { false, true })
+            {
+                LightBVHBuilder::Options options;
+                options.splitHeuristicSelection = heuristic;
+                options.splitAlongLargest = splitAlongLargest;
+
+                options.useParallelBuild = false;
+                auto serial = build(triangles, options);
+                options.useParallelBuild = true;
+                auto parallel = build(triangles, options);
+
+                expectIdentical(ctx, serial, parallel, "heuristic=" + std::to_string((uint32_t)heuristic));
+            }
+        }
+    }
+
+    CPU_TEST(LightBVHBuilderSIMD)
+    {
+        // The SIMD code path must make the same split choices as the scalar code path, so the trees should be identical.
+        const std::vector<std::pair<std::string, std::vector<MeshLightTriangle>>> inputs =
+        {
+            { "random", createTriangles(100000, 2) },
+            { "degenerate", createDegenerateTriangles(5000, 3) },
+        };
+
+        for (const auto& input : inputs)
+        {
+            for (auto heuristic : { LightBVHBuilder::SplitHeuristic::BinnedSAH, LightBVHBuilder::SplitHeuristic::BinnedSAOH })
+            {
+                for (uint32_t variant = 0; variant < 5; variant++)
+                {
+                    LightBVHBuilder::Options options;
+                    options.splitHeuristicSelection = heuristic;
+                    options.useParallelBuild = false;
+                    options.splitAlongLargest = variant == 1;
+                    options.useVolumeOverSA = variant == 2;
+                    options.useLightingCones = variant != 3;
+                    options.createLeavesASAP = variant != 4;
+                    options.binCount = variant == 4 ? 7 : 16;
+
+                    options.useSIMD = false;
+                    auto scalar = build(input.second, options);
+                    options.useSIMD = true;
+                    auto simd = build(input.second, options);
+
+                    expectIdentical(ctx, scalar, simd, input.first + " heuristic=" + std::to_string((uint32_t)heuristic) + " variant=" + std::to_string(variant));
+                }
+            }
+        }
+    }
+
+    CPU_TEST(LightBVHBuilderBenchmark, "Long running benchmark, enable manually.")
+    {
+        runBenchmark({ 10000, 100000, 1000000 });
+    }
+
+    CPU_TEST(LightBVHBuilderBenchmarkLarge, "Long running benchmark, enable manually.")
+    {
+        runBenchmark({ 10000000 });
+    }
+}
@@ -0,0 +1,168 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneBuilder.h"
+#include "Experimental/Scene/Lights/LightCollection.h"
+#include <cstdio>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kTextureSize = 16;
+        const uint32_t kGridSize = 6;
+
+        /** Storage for a synthetic mesh. The mesh description points into the vectors.
+        */
+        struct MeshStorage
+        {
+            std::vector<uint32_t> indices;
+            std::vector<float3> positions;
+            std::vector<float2> texCrds;
+        };
+
+        /** Generates a flat grid with texture coordinates spanning more than one texture repetition.
+            The texture coordinates are offset so that the vertices don't fall on texel centers.
+        */
+        SceneBuilder::Mesh createGridMesh(const std::string& name, const Material::SharedPtr& pMaterial, const float2& uvOffset, MeshStorage& s)
+        {
+            static const float3 kNormal = float3(0.f, 1.f, 0.f);
+
+            for (uint32_t y = 0; y <= kGridSize; y++)
+            {
+                for (uint32_t x = 0; x <= kGridSize; x++)
+                {
+                    float2 uv = float2(x, y) / (float)kGridSize;
+                    s.positions.push_back(float3(uv.x, 0.1f * uv.x * uv.y, uv.y));
+                    s.texCrds.push_back(uvOffset + uv * 2.3f);
+                }
+            }
+            for (uint32_t y = 0; y < kGridSize; y++)
+            {
+                for (uint32_t x = 0; x < kGridSize; x++)
+                {
+                    uint32_t i = y * (kGridSize + 1) + x;
+                    s.indices.insert(s.indices.end(), { i, i + kGridSize + 1, i + 1, i + 1, i + kGridSize + 1, i + kGridSize + 2 });
+                }
+            }
+
+            SceneBuilder::Mesh mesh;
+            mesh.name = name;
+            mesh.faceCount = (uint32_t)s.indices.size() / 3;
+            mesh.vertexCount = (uint32_t)s.positions.size();
+            mesh.indexCount = (uint32_t)s.indices.size();
+            mesh.pIndices = s.indices.data();
+            mesh.topology = Vao::Topology::TriangleList;
+            mesh.pMaterial = pMaterial;
+            mesh.positions = { s.positions.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+            mesh.normals = { &kNormal, SceneBuilder::Mesh::AttributeFrequency::Constant };
+            mesh.texCrds = { s.texCrds.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+            return mesh;
+        }
+
+        bool isClose(float a, float b, float relTol = 1e-3f)
+        {
+            return std::abs(a - b) <= relTol * std::max(std::abs(a), std::abs(b)) + 1e-6f;
+        }
+
+        bool isClose(const float3& a, const float3& b, float relTol = 1e-3f)
+        {
+            return isClose(a.x, b.x, relTol) && isClose(a.y, b.y, relTol) && isClose(a.z, b.z, relTol);
+        }
+    }
+
+    GPU_TEST(LightCollectionBuildOnCPU)
+    {
+        // Create an sRGB emissive texture on disk, so that the CPU path can decode it.
+        std::vector<uint8_t> pixels(kTextureSize * kTextureSize * 4);
+        for (size_t i = 0; i < pixels.size(); i++) pixels[i] = uint8_t(i * 37 + (i >> 6) * 11);
+        std::string filename = getTempFilename() + ".png";
+        Bitmap::saveImage(filename, kTextureSize, kTextureSize, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::ExportAlpha, ResourceFormat::RGBA8Unorm, true, pixels.data());
+
+        auto pTextured = Material::create("Textured");
+        pTextured->setEmissiveTexture(Texture::createFromFile(filename, false, true));
+        pTextured->setEmissiveFactor(2.f);
+        auto pConstant = Material::create("Constant");
+        pConstant->setEmissiveColor(float3(0.5f, 1.f, 2.f));
+
+        // Build a scene with a transformed textured mesh and a constant emissive mesh.
+        MeshStorage texturedStorage, constantStorage;
+        auto pBuilder = SceneBuilder::create();
+        uint32_t texturedMeshID = pBuilder->addMesh(createGridMesh("Textured", pTextured, float2(-0.61f, 0.27f), texturedStorage));
+        uint32_t constantMeshID = pBuilder->addMesh(createGridMesh("Constant", pConstant, float2(0.f), constantStorage));
+
+        SceneBuilder::Node node;
+        node.name = "Textured";
+        node.transform = glm::translate(glm::scale(glm::mat4(1.f), float3(2.f, 1.f, 3.f)), float3(1.f, 2.f, 3.f));
+        node.localToBindPose = glm::mat4(1.f);
+        pBuilder->addMeshInstance(pBuilder->addNode(node), texturedMeshID);
+        node.name = "Constant";
+        node.transform = glm::mat4(1.f);
+        pBuilder->addMeshInstance(pBuilder->addNode(node), constantMeshID);
+
+        auto pScene = pBuilder->getScene();
+        EXPECT(pScene != nullptr);
+        if (!pScene) return;
+
+        // Build the light collection on the CPU and with the GPU passes.
+        auto pCPU = LightCollection::create(ctx.getRenderContext(), pScene, true);
+        auto pGPU = LightCollection::create(ctx.getRenderContext(), pScene, false);
+        EXPECT(pCPU != nullptr);
+        EXPECT(pGPU != nullptr);
+        if (!pCPU || !pGPU) return;
+
+        EXPECT(pCPU->isBuiltOnCPU());
+        EXPECT(!pGPU->isBuiltOnCPU());
+        EXPECT_EQ(pCPU->getTotalLightCount(), 2 * kGridSize * kGridSize * 2);
+        EXPECT_EQ(pCPU->getTotalLightCount(), pGPU->getTotalLightCount());
+
+        // The triangle data and pre-integrated flux must match.
+        const auto& cpuTriangles = pCPU->getMeshLightTriangles();
+        const auto& gpuTriangles = pGPU->getMeshLightTriangles();
+        EXPECT_EQ(cpuTriangles.size(), gpuTriangles.size());
+        for (size_t i = 0; i < std::min(cpuTriangles.size(), gpuTriangles.size()); i++)
+        {
+            const auto& c = cpuTriangles[i];
+            const auto& g = gpuTriangles[i];
+            EXPECT_EQ(c.lightIdx, g.lightIdx) << "triangle " << i;
+            EXPECT(isClose(c.area, g.area)) << "triangle " << i << " area " << c.area << " vs " << g.area;
+            EXPECT(isClose(c.normal, g.normal)) << "triangle " << i;
+            for (uint32_t j = 0; j < 3; j++)
+            {
+                EXPECT(isClose(c.vtx[j].pos, g.vtx[j].pos)) << "triangle " << i << " vertex " << j;
+                EXPECT(c.vtx[j].uv == g.vtx[j].uv) << "triangle " << i << " vertex " << j;
+            }
+            EXPECT(isClose(c.flux, g.flux)) << "triangle " << i << " flux " << c.flux << " vs " << g.flux;
+            EXPECT(isClose(c.averageRadiance, g.averageRadiance)) << "triangle " << i;
+        }
+
+        EXPECT_EQ(pCPU->getActiveLightCount(), pGPU->getActiveLightCount());
+
+        std::remove(filename.c_str());
+    }
+}
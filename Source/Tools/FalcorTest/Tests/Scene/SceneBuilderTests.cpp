@@ -0,0 +1,560 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneBuilder.h"
+#include "Scene/SceneCache.h"
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Storage for a synthetic mesh. The mesh description points into the vectors.
+        */
+        struct MeshStorage
+        {
+            std::vector<uint32_t> indices;
+            std::vector<float3> positions;
+            std::vector<float3> normals;
+            std::vector<float2> texCrds;
+        };
+
+        /** Generates a set of wavy grid meshes with varying sizes.
+            Every other mesh uses per-face normals, so that the vertex merging has to split vertices.
+        */
+        std::vector<SceneBuilder::Mesh> createMeshes(uint32_t meshCount, uint32_t maxGridSize, std::vector<MeshStorage>& storage, uint32_t seed = 0)
+        {
+            std::mt19937 rng(seed);
+            std::uniform_int_distribution<uint32_t> gridSize(1, maxGridSize);
+            std::uniform_real_distribution<float> u(0.f, 1.f);
+
+            auto pMaterial = Material::create("Synthetic");
+
+            storage.resize(meshCount);
+            std::vector<SceneBuilder::Mesh> meshes(meshCount);
+            for (uint32_t m = 0; m < meshCount; m++)
+            {
+                const uint32_t n = gridSize(rng);
+                const float amplitude = u(rng);
+                const float3 offset = float3(u(rng), u(rng), u(rng)) * 100.f;
+                const bool flatShaded = m % 2 == 1;
+
+                auto& s = storage[m];
+                for (uint32_t y = 0; y <= n; y++)
+                {
+                    for (uint32_t x = 0; x <= n; x++)
+                    {
+                        float2 uv = float2(x, y) / (float)n;
+                        float h = amplitude * std::sin(uv.x * 6.f) * std::cos(uv.y * 6.f);
+                        s.positions.push_back(offset + float3(uv.x, h, uv.y));
+                        s.normals.push_back(glm::normalize(float3(-amplitude * std::cos(uv.x * 6.f), 1.f, amplitude * std::sin(uv.y * 6.f))));
+                        s.texCrds.push_back(uv * 4.f);
+                    }
+                }
+                for (uint32_t y = 0; y < n; y++)
+                {
+                    for (uint32_t x = 0; x < n; x++)
+                    {
+                        uint32_t i = y * (n + 1) + x;
+                        s.indices.insert(s.indices.end(), { i, i + n + 1, i + 1, i + 1, i + n + 1, i + n + 2 });
+                    }
+                }
+                if (flatShaded)
+                {
+                    std::vector<float3> faceNormals;
+                    for (size_t i = 0; i < s.indices.size(); i += 3)
+                    {
+                        const float3& p0 = s.positions[s.indices[i]];
+                        faceNormals.push_back(glm::normalize(glm::cross(s.positions[s.indices[i + 1]] - p0, s.positions[s.indices[i + 2]] - p0)));
+                    }
+                    s.normals = std::move(faceNormals);
+                }
+
+                auto& mesh = meshes[m];
+                mesh.name = "Mesh" + std::to_string(m);
+                mesh.faceCount = (uint32_t)s.indices.size() / 3;
+                mesh.vertexCount = (uint32_t)s.positions.size();
+                mesh.indexCount = (uint32_t)s.indices.size();
+                mesh.pIndices = s.indices.data();
+                mesh.topology = Vao::Topology::TriangleList;
+                mesh.pMaterial = pMaterial;
+                mesh.positions = { s.positions.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+                mesh.normals = { s.normals.data(), flatShaded ? SceneBuilder::Mesh::AttributeFrequency::Uniform : SceneBuilder::Mesh::AttributeFrequency::Vertex };
+                mesh.texCrds = { s.texCrds.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+            }
+            return meshes;
+        }
+
+        /** Generates a triangle soup of a flat n x n quad grid. Every face has its own three vertices, so the mesh has no shared vertices.
+            \param[in] chain If true, all indices point to the same original vertex. This is the worst case for the linked-list vertex search.
+        */
+        SceneBuilder::Mesh createSoupMesh(uint32_t n, bool chain, MeshStorage& s)
+        {
+            static const float3 kNormal = float3(0.f, 1.f, 0.f);
+
+            for (uint32_t y = 0; y < n; y++)
+            {
+                for (uint32_t x = 0; x < n; x++)
+                {
+                    const uint2 corners[] = { { x, y }, { x, y + 1 }, { x + 1, y }, { x + 1, y }, { x, y + 1 }, { x + 1, y + 1 } };
+                    for (auto c : corners)
+                    {
+                        s.indices.push_back(chain ? 0 : (uint32_t)s.positions.size());
+                        s.positions.push_back(float3(c.x, 0.f, c.y));
+                    }
+                }
+            }
+
+            SceneBuilder::Mesh mesh;
+            mesh.name = chain ? "Chain" : "Soup";
+            mesh.faceCount = (uint32_t)s.indices.size() / 3;
+            mesh.vertexCount = chain ? 1 : (uint32_t)s.positions.size();
+            mesh.indexCount = (uint32_t)s.indices.size();
+            mesh.pIndices = s.indices.data();
+            mesh.topology = Vao::Topology::TriangleList;
+            mesh.pMaterial = Material::create("Soup");
+            mesh.positions = { s.positions.data(), SceneBuilder::Mesh::AttributeFrequency::FaceVarying };
+            mesh.normals = { &kNormal, SceneBuilder::Mesh::AttributeFrequency::Constant };
+            return mesh;
+        }
+
+        /** Creates a single triangle mesh with the given material. The mesh data is shared by all meshes.
+        */
+        SceneBuilder::Mesh createTriangleMesh(const Material::SharedPtr& pMaterial)
+        {
+            static const uint32_t kIndices[] = { 0, 1, 2 };
+            static const float3 kPositions[] = { float3(0.f), float3(1.f, 0.f, 0.f), float3(0.f, 0.f, 1.f) };
+            static const float3 kNormal = float3(0.f, 1.f, 0.f);
+
+            SceneBuilder::Mesh mesh;
+            mesh.name = "Triangle";
+            mesh.faceCount = 1;
+            mesh.vertexCount = 3;
+            mesh.indexCount = 3;
+            mesh.pIndices = kIndices;
+            mesh.topology = Vao::Topology::TriangleList;
+            mesh.pMaterial = pMaterial;
+            mesh.positions = { kPositions, SceneBuilder::Mesh::AttributeFrequency::Vertex };
+            mesh.normals = { &kNormal, SceneBuilder::Mesh::AttributeFrequency::Constant };
+            return mesh;
+        }
+
+        /** Measures adding meshes with one material each, where every other material is a duplicate with a different name.
+        */
+        void runMaterialDedupBenchmark(CPUUnitTestContext& ctx, const std::vector<uint32_t>& materialCounts)
+        {
+            std::string report = "Material deduplication benchmark:";
+            for (uint32_t materialCount : materialCounts)
+            {
+                std::vector<SceneBuilder::Mesh> meshes;
+                for (uint32_t i = 0; i < materialCount; i++)
+                {
+                    auto pMaterial = Material::create("Material" + std::to_string(i));
+                    const uint32_t j = i / 2;
+                    pMaterial->setBaseColor(float4((j & 0xff) / 255.f, ((j >> 8) & 0xff) / 255.f, (j >> 16) / 255.f, 1.f));
+                    meshes.push_back(createTriangleMesh(pMaterial));
+                }
+
+                auto start = CpuTimer::getCurrentTimePoint();
+                auto pBuilder = SceneBuilder::create(SceneBuilder::Flags::RemoveDuplicateMaterials);
+                pBuilder->addMeshes(meshes);
+                double time = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+                EXPECT_EQ(pBuilder->getMaterialCount(), (materialCount + 1) / 2);
+
+                report += "\n  " + std::to_string(materialCount) + " materials: " + std::to_string(time) + " ms (" + std::to_string(time * 1000.0 / materialCount) + " us per mesh)";
+            }
+            logInfo(report);
+        }
+
+        void runWeldingBenchmark(uint32_t soupGridSize, uint32_t chainGridSize)
+        {
+            auto timeAdd = [](const SceneBuilder::Mesh& mesh, SceneBuilder::Flags flags, SceneBuilder::VertexWeldingStats& stats)
+            {
+                auto start = CpuTimer::getCurrentTimePoint();
+                auto pBuilder = SceneBuilder::create(flags);
+                pBuilder->addMesh(mesh);
+                double time = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+                stats = pBuilder->getVertexWeldingStats();
+                return time;
+            };
+
+            std::string report = "Vertex welding benchmark:";
+            for (bool chain : { false, true })
+            {
+                MeshStorage storage;
+                auto mesh = createSoupMesh(chain ? chainGridSize : soupGridSize, chain, storage);
+
+                SceneBuilder::VertexWeldingStats stats;
+                double listTime = timeAdd(mesh, SceneBuilder::Flags::Default, stats);
+                double hashTime = timeAdd(mesh, SceneBuilder::Flags::UseHashVertexWelding, stats);
+
+                report += "\n  " + mesh.name + " with " + std::to_string(mesh.faceCount) + " triangles: linked list " + std::to_string(listTime) + " ms, hash " + std::to_string(hashTime) +
+                    " ms (" + std::to_string(listTime / hashTime) + "x), " + std::to_string(stats.inputVertexCount) + " -> " + std::to_string(stats.outputVertexCount) + " vertices, average probe length " +
+                    std::to_string((double)stats.probeCount / stats.inputVertexCount) + ", maximum probe length " + std::to_string(stats.maxProbeLength);
+            }
+            logInfo(report);
+        }
+
+        SceneBuilder::SharedPtr createBuilder(SceneBuilder::Flags flags, const std::vector<SceneBuilder::Mesh>& meshes, bool batched)
+        {
+            auto pBuilder = SceneBuilder::create(flags);
+            std::vector<uint32_t> meshIDs;
+            if (batched)
+            {
+                meshIDs = pBuilder->addMeshes(meshes);
+            }
+            else
+            {
+                for (const auto& mesh : meshes) meshIDs.push_back(pBuilder->addMesh(mesh));
+            }
+
+            SceneBuilder::Node node;
+            node.name = "Root";
+            node.transform = glm::mat4(1.f);
+            node.localToBindPose = glm::mat4(1.f);
+            uint32_t nodeID = pBuilder->addNode(node);
+            for (uint32_t meshID : meshIDs) pBuilder->addMeshInstance(nodeID, meshID);
+            return pBuilder;
+        }
+
+        std::vector<uint8_t> readBuffer(GPUUnitTestContext& ctx, const Buffer::SharedPtr& pBuffer)
+        {
+            if (!pBuffer) return {};
+            auto pStaging = Buffer::create(pBuffer->getSize(), Resource::BindFlags::None, Buffer::CpuAccess::Read);
+            ctx.getRenderContext()->copyBufferRegion(pStaging.get(), 0, pBuffer.get(), 0, pBuffer->getSize());
+            ctx.getRenderContext()->flush(true);
+
+            const uint8_t* pData = static_cast<const uint8_t*>(pStaging->map(Buffer::MapType::Read));
+            std::vector<uint8_t> data(pData, pData + pBuffer->getSize());
+            pStaging->unmap();
+            return data;
+        }
+
+        std::vector<uint8_t> readBinaryFile(const std::string& path)
+        {
+            std::ifstream file(path, std::ios::binary);
+            return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        /** Creates a builder with a scene graph, meshes with several materials, an animation, cameras and lights.
+        */
+        SceneBuilder::SharedPtr createCacheTestBuilder(const std::vector<SceneBuilder::Mesh>& meshes)
+        {
+            auto pBuilder = SceneBuilder::create();
+
+            SceneBuilder::Node root;
+            root.name = "Root";
+            root.transform = glm::scale(glm::mat4(1.f), float3(2.f));
+            uint32_t rootID = pBuilder->addNode(root);
+
+            auto meshIDs = pBuilder->addMeshes(meshes);
+            for (size_t i = 0; i < meshIDs.size(); i++)
+            {
+                SceneBuilder::Node node;
+                node.name = "Node" + std::to_string(i);
+                node.transform = glm::translate(glm::mat4(1.f), float3((float)i, 0.f, 0.f));
+                node.parent = rootID;
+                uint32_t nodeID = pBuilder->addNode(node);
+                pBuilder->addMeshInstance(nodeID, meshIDs[i]);
+                if (i % 3 == 0) pBuilder->addMeshInstance(rootID, meshIDs[i]);
+            }
+
+            auto pAnimation = Animation::create("Animation", 2.0);
+            uint32_t channel = pAnimation->addChannel(rootID + 1);
+            pAnimation->setInterpolationMode(channel, Animation::InterpolationMode::Hermite, false);
+            for (uint32_t i = 0; i <= 4; i++)
+            {
+                Animation::Keyframe keyframe;
+                keyframe.time = i * 0.5;
+                keyframe.translation = float3(i, i * i, 0.f);
+                keyframe.rotation = glm::angleAxis((float)i, float3(0.f, 1.f, 0.f));
+                pAnimation->addKeyframe(channel, keyframe);
+            }
+            pBuilder->addAnimation(pAnimation);
+
+            auto pCamera = Camera::create();
+            pCamera->setName("Camera");
+            pCamera->setPosition(float3(1.f, 2.f, 3.f));
+            pCamera->setTarget(float3(0.f));
+            pCamera->setFocalLength(50.f);
+            pCamera->setDepthRange(0.01f, 500.f);
+            pCamera->setNodeID(rootID + 1);
+            pCamera->setHasAnimation(true);
+            pBuilder->addCamera(pCamera);
+
+            auto pPointLight = PointLight::create();
+            pPointLight->setName("PointLight");
+            pPointLight->setWorldPosition(float3(0.f, 5.f, 0.f));
+            pPointLight->setOpeningAngle(1.f);
+            pPointLight->setIntensity(float3(10.f));
+            pBuilder->addLight(pPointLight);
+
+            auto pDirLight = DirectionalLight::create();
+            pDirLight->setName("DirLight");
+            pDirLight->setWorldDirection(float3(1.f, -1.f, 0.f));
+            pBuilder->addLight(pDirLight);
+
+            return pBuilder;
+        }
+    }
+
+    GPU_TEST(SceneBuilderAddMeshes)
+    {
+        std::vector<MeshStorage> storage;
+        auto meshes = createMeshes(200, 16, storage, 1);
+
+        for (auto flags : { SceneBuilder::Flags::Default, SceneBuilder::Flags::NonIndexedVertices })
+        {
+            auto pSerial = createBuilder(flags, meshes, false)->getScene();
+            auto pBatched = createBuilder(flags, meshes, true)->getScene();
+            EXPECT(pSerial && pBatched);
+            if (!pSerial || !pBatched) return;
+
+            // The mesh offsets and buffer contents have to be identical.
+            EXPECT_EQ(pSerial->getMeshCount(), pBatched->getMeshCount());
+            for (uint32_t i = 0; i < std::min(pSerial->getMeshCount(), pBatched->getMeshCount()); i++)
+            {
+                const auto& a = pSerial->getMesh(i);
+                const auto& b = pBatched->getMesh(i);
+                EXPECT_EQ(a.vbOffset, b.vbOffset) << "mesh " << i;
+                EXPECT_EQ(a.ibOffset, b.ibOffset) << "mesh " << i;
+                EXPECT_EQ(a.vertexCount, b.vertexCount) << "mesh " << i;
+                EXPECT_EQ(a.indexCount, b.indexCount) << "mesh " << i;
+                EXPECT_EQ(a.materialID, b.materialID) << "mesh " << i;
+            }
+
+            const auto& pSerialVao = pSerial->getVao();
+            const auto& pBatchedVao = pBatched->getVao();
+            EXPECT(readBuffer(ctx, pSerialVao->getIndexBuffer()) == readBuffer(ctx, pBatchedVao->getIndexBuffer())) << "index buffers differ";
+            EXPECT_EQ(pSerialVao->getVertexBuffersCount(), pBatchedVao->getVertexBuffersCount());
+            for (uint32_t i = 0; i < std::min(pSerialVao->getVertexBuffersCount(), pBatchedVao->getVertexBuffersCount()); i++)
+            {
+                EXPECT(readBuffer(ctx, pSerialVao->getVertexBuffer(i)) == readBuffer(ctx, pBatchedVao->getVertexBuffer(i))) << "vertex buffer " << i << " differs";
+            }
+        }
+    }
+
+    GPU_TEST(SceneBuilderHashVertexWelding)
+    {
+        // The synthetic meshes only have identical vertices at the same original index, so both welding modes have to give the same result.
+        std::vector<MeshStorage> storage;
+        auto meshes = createMeshes(50, 16, storage, 2);
+
+        auto pList = createBuilder(SceneBuilder::Flags::Default, meshes, true)->getScene();
+        auto pHash = createBuilder(SceneBuilder::Flags::UseHashVertexWelding, meshes, true)->getScene();
+        EXPECT(pList && pHash);
+        if (!pList || !pHash) return;
+
+        EXPECT(readBuffer(ctx, pList->getVao()->getIndexBuffer()) == readBuffer(ctx, pHash->getVao()->getIndexBuffer())) << "index buffers differ";
+        EXPECT(readBuffer(ctx, pList->getVao()->getVertexBuffer(0)) == readBuffer(ctx, pHash->getVao()->getVertexBuffer(0))) << "vertex buffers differ";
+    }
+
+    CPU_TEST(SceneBuilderHashVertexWeldingSoup)
+    {
+        const uint32_t n = 64;
+        for (bool chain : { false, true })
+        {
+            MeshStorage storage;
+            auto mesh = createSoupMesh(n, chain, storage);
+
+            auto pBuilder = SceneBuilder::create(SceneBuilder::Flags::UseHashVertexWelding);
+            pBuilder->addMesh(mesh);
+            const auto& stats = pBuilder->getVertexWeldingStats();
+            EXPECT_EQ(stats.inputVertexCount, mesh.indexCount);
+            EXPECT_EQ(stats.outputVertexCount, (n + 1) * (n + 1)) << mesh.name;
+            EXPECT_GE(stats.probeCount, stats.inputVertexCount);
+        }
+    }
+
+    CPU_TEST(SceneCacheRoundTrip)
+    {
+        std::vector<MeshStorage> storage;
+        auto meshes = createMeshes(20, 16, storage, 3);
+        auto pEmissive = Material::create("Emissive");
+        pEmissive->setEmissiveColor(float3(1.f, 0.5f, 0.f));
+        pEmissive->setDoubleSided(true);
+        auto pRough = Material::create("Rough");
+        pRough->setShadingModel(ShadingModelMetalRough);
+        pRough->setRoughness(0.8f);
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            if (i % 4 == 1) meshes[i].pMaterial = pEmissive;
+            if (i % 4 == 2) meshes[i].pMaterial = pRough;
+        }
+
+        auto pBuilder = createCacheTestBuilder(meshes);
+        const uint64_t key = 0x1234;
+        const std::string path = getTempFilename();
+        const std::string rewrittenPath = getTempFilename();
+
+        // Reading a cache file and writing it again must give identical bytes.
+        EXPECT(SceneCache::write(path, *pBuilder, key));
+        auto pLoaded = SceneBuilder::create();
+        EXPECT(SceneCache::read(path, *pLoaded, key));
+        EXPECT_EQ(pLoaded->getCameraCount(), 1);
+        EXPECT_EQ(pLoaded->getLightCount(), 2);
+        EXPECT(SceneCache::write(rewrittenPath, *pLoaded, key));
+        auto original = readBinaryFile(path);
+        EXPECT(!original.empty());
+        EXPECT(original == readBinaryFile(rewrittenPath)) << "cache files differ after round trip";
+
+        // Files with a different key or truncated files are rejected and leave the builder unchanged.
+        auto pOther = SceneBuilder::create();
+        EXPECT(!SceneCache::read(path, *pOther, key + 1));
+        {
+            std::ofstream file(rewrittenPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(original.data()), original.size() / 2);
+        }
+        EXPECT(!SceneCache::read(rewrittenPath, *pOther, key));
+        EXPECT_EQ(pOther->getCameraCount(), 0);
+        EXPECT_EQ(pOther->getLightCount(), 0);
+
+        // Cache files can be appended to a builder that already has content.
+        EXPECT(SceneCache::read(path, *pLoaded, 0));
+        EXPECT_EQ(pLoaded->getCameraCount(), 2);
+        EXPECT_EQ(pLoaded->getLightCount(), 4);
+
+        std::remove(path.c_str());
+        std::remove(rewrittenPath.c_str());
+    }
+
+    CPU_TEST(SceneCacheDependencies)
+    {
+        std::vector<MeshStorage> storage;
+        auto meshes = createMeshes(4, 4, storage, 4);
+        auto pBuilder = createCacheTestBuilder(meshes);
+
+        // Simulate an asset with a referenced file in its own directory.
+        const auto assetDir = std::filesystem::temp_directory_path() / "FalcorSceneCacheDependencies";
+        const auto assetPath = assetDir / "asset.obj";
+        const auto materialPath = assetDir / "asset.mtl";
+        auto writeTextFile = [](const std::filesystem::path& path, const std::string& content)
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file << content;
+        };
+        std::filesystem::create_directories(assetDir);
+        writeTextFile(assetPath, "mtllib asset.mtl");
+        writeTextFile(materialPath, "newmtl A");
+
+        const uint64_t key = SceneCache::computeKey(assetPath.string(), SceneBuilder::Flags::Default);
+        EXPECT_NE(key, 0ull);
+        EXPECT_EQ(key, SceneCache::computeKey(assetPath.string(), SceneBuilder::Flags::UseCache));
+        EXPECT_NE(key, SceneCache::computeKey(assetPath.string(), SceneBuilder::Flags::UseHashVertexWelding));
+
+        const std::string path = getTempFilename();
+        EXPECT(SceneCache::write(path, *pBuilder, key, assetPath.string()));
+        EXPECT(SceneCache::read(path, *SceneBuilder::create(), key));
+
+        // Changing a file next to the asset invalidates the cache file, unless it is loaded without a key.
+        writeTextFile(materialPath, "newmtl Changed");
+        EXPECT(!SceneCache::read(path, *SceneBuilder::create(), key));
+        EXPECT(SceneCache::read(path, *SceneBuilder::create(), 0));
+
+        std::remove(path.c_str());
+        std::error_code ec;
+        std::filesystem::remove_all(assetDir, ec);
+    }
+
+    CPU_TEST(SceneBuilderAddMeshesBenchmark, "Long running benchmark, enable manually.")
+    {
+        std::vector<MeshStorage> storage;
+        auto meshes = createMeshes(5000, 32, storage);
+
+        auto timeAdd = [&](bool batched)
+        {
+            auto start = CpuTimer::getCurrentTimePoint();
+            auto pBuilder = SceneBuilder::create();
+            if (batched) pBuilder->addMeshes(meshes);
+            else for (const auto& mesh : meshes) pBuilder->addMesh(mesh);
+            return CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        };
+
+        double serialTime = timeAdd(false);
+        double batchedTime = timeAdd(true);
+        logInfo("SceneBuilder::addMeshes benchmark (" + std::to_string(Threading::getThreadCount()) + " worker threads): " + std::to_string(meshes.size()) + " meshes, serial " +
+            std::to_string(serialTime) + " ms, batched " + std::to_string(batchedTime) + " ms (" + std::to_string(serialTime / batchedTime) + "x)");
+    }
+
+    CPU_TEST(SceneBuilderMaterialDedup)
+    {
+        auto createMaterial = [](const std::string& name, float g)
+        {
+            auto pMaterial = Material::create(name);
+            pMaterial->setBaseColor(float4(0.5f, g, 0.25f, 1.f));
+            return pMaterial;
+        };
+
+        auto pA = createMaterial("A", 0.f);
+        auto pB = createMaterial("B", 0.f);
+        auto pA2 = createMaterial("A", -0.f);
+        auto pC = createMaterial("C", 1.f);
+        auto pB2 = createMaterial("B", 0.f);
+        EXPECT(*pA == *pA2);
+        EXPECT_EQ(pA->getHash(), pA2->getHash());
+        EXPECT_EQ(pA->getHash(), pB->getHash());
+
+        // Materials are merged if they're the same object, or if the first material with equal properties has the same name.
+        // Without the flag, B2 is kept, as the first equal material is A.
+        const std::vector<Material::SharedPtr> materials = { pA, pB, pA2, pC, pA, pB2 };
+        const size_t expectedCounts[] = { 1, 2, 2, 3, 3, 4 };
+        const size_t expectedCountsRemoveDuplicates[] = { 1, 1, 1, 2, 2, 2 };
+        for (auto flags : { SceneBuilder::Flags::Default, SceneBuilder::Flags::RemoveDuplicateMaterials })
+        {
+            auto pBuilder = SceneBuilder::create(flags);
+            for (size_t i = 0; i < materials.size(); i++)
+            {
+                pBuilder->addMesh(createTriangleMesh(materials[i]));
+                size_t expected = flags == SceneBuilder::Flags::Default ? expectedCounts[i] : expectedCountsRemoveDuplicates[i];
+                EXPECT_EQ(pBuilder->getMaterialCount(), expected) << "mesh " << i;
+            }
+        }
+    }
+
+    CPU_TEST(SceneBuilderMaterialDedupBenchmark, "Long running benchmark, enable manually.")
+    {
+        runMaterialDedupBenchmark(ctx, { 1000, 10000 });
+    }
+
+    CPU_TEST(SceneBuilderMaterialDedupBenchmarkLarge, "Long running benchmark, enable manually.")
+    {
+        runMaterialDedupBenchmark(ctx, { 1000, 10000, 50000, 100000 });
+    }
+
+    CPU_TEST(SceneBuilderVertexWeldingBenchmark)
+    {
+        runWeldingBenchmark(128, 64);
+    }
+
+    CPU_TEST(SceneBuilderVertexWeldingBenchmarkLarge, "Long running benchmark, enable manually.")
+    {
+        runWeldingBenchmark(708, 128); // 1M triangle soup.
+    }
+}
@@ -0,0 +1,167 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Animation/TransformHierarchy.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kInvalidNode = TransformHierarchy::kInvalidNode;
+
+        /** Create a random hierarchy. Parents are picked among the preceding nodes so the trees are reasonably shallow.
+        */
+        std::vector<uint32_t> createParents(std::mt19937& rng, uint32_t nodeCount)
+        {
+            std::vector<uint32_t> parents(nodeCount);
+            for (uint32_t i = 0; i < nodeCount; i++)
+            {
+                bool isRoot = i == 0 || rng() % 64 == 0;
+                parents[i] = isRoot ? kInvalidNode : i - 1 - rng() % std::min(i, 64u);
+            }
+            return parents;
+        }
+
+        glm::mat4 createMatrix(std::mt19937& rng)
+        {
+            std::uniform_real_distribution<float> u(-1.f, 1.f);
+            glm::mat4 m = glm::translate(glm::mat4(1.f), glm::vec3(u(rng), u(rng), u(rng)));
+            m = glm::rotate(m, u(rng) * 3.f, glm::normalize(glm::vec3(u(rng), u(rng), u(rng)) + glm::vec3(0.f, 0.f, 2.f)));
+            return glm::scale(m, glm::vec3(1.f + 0.1f * u(rng)));
+        }
+
+        std::vector<uint32_t> pickNodes(std::mt19937& rng, uint32_t nodeCount, uint32_t count)
+        {
+            std::vector<uint32_t> nodes(count);
+            for (auto& n : nodes) n = rng() % nodeCount;
+            return nodes;
+        }
+    }
+
+    CPU_TEST(TransformHierarchyIncremental)
+    {
+        std::mt19937 rng(7);
+        const uint32_t nodeCount = 5000;
+
+        auto parents = createParents(rng, nodeCount);
+        std::vector<glm::mat4> localMatrices(nodeCount);
+        std::vector<glm::mat4> localToBindSpace(nodeCount);
+        for (auto& m : localMatrices) m = createMatrix(rng);
+        for (auto& m : localToBindSpace) m = createMatrix(rng);
+
+        TransformHierarchy incremental(parents, localToBindSpace);
+        TransformHierarchy reference(parents, localToBindSpace);
+        incremental.updateAll(localMatrices);
+        EXPECT_EQ(incremental.getUpdatedNodes().size(), nodeCount);
+
+        for (uint32_t frame = 0; frame < 20; frame++)
+        {
+            auto changed = pickNodes(rng, nodeCount, 1 + rng() % 50);
+            for (uint32_t n : changed) localMatrices[n] = createMatrix(rng);
+
+            incremental.update(localMatrices, changed);
+            reference.updateAll(localMatrices);
+
+            // The updated nodes are the changed nodes and all their descendants.
+            std::vector<bool> dirty(nodeCount, false);
+            for (uint32_t n : changed) dirty[n] = true;
+            std::vector<uint32_t> expected;
+            for (uint32_t i = 0; i < nodeCount; i++)
+            {
+                if (parents[i] != kInvalidNode && dirty[parents[i]]) dirty[i] = true;
+                if (dirty[i]) expected.push_back(i);
+                EXPECT_EQ(incremental.isUpdated(i), dirty[i]);
+            }
+            EXPECT(incremental.getUpdatedNodes() == expected);
+
+            // Matrices are computed the same way, so they must match exactly.
+            EXPECT(incremental.getGlobalMatrices() == reference.getGlobalMatrices());
+            EXPECT(incremental.getInvTransposeGlobalMatrices() == reference.getInvTransposeGlobalMatrices());
+            EXPECT(incremental.getSkinningMatrices() == reference.getSkinningMatrices());
+            EXPECT(incremental.getInvTransposeSkinningMatrices() == reference.getInvTransposeSkinningMatrices());
+        }
+
+        // Nothing changed.
+        incremental.update(localMatrices, {});
+        EXPECT(incremental.getUpdatedNodes().empty());
+        for (uint32_t i = 0; i < nodeCount; i++) EXPECT(!incremental.isUpdated(i));
+    }
+
+    CPU_TEST(TransformHierarchyRanges)
+    {
+        auto ranges = TransformHierarchy::getRanges({ 0, 1, 2, 5, 6, 20 }, 0);
+        EXPECT_EQ(ranges.size(), 3);
+        EXPECT(ranges[0].first == 0 && ranges[0].count == 3);
+        EXPECT(ranges[1].first == 5 && ranges[1].count == 2);
+        EXPECT(ranges[2].first == 20 && ranges[2].count == 1);
+
+        // Gaps of at most two nodes are merged.
+        ranges = TransformHierarchy::getRanges({ 0, 1, 2, 5, 6, 20 }, 2);
+        EXPECT_EQ(ranges.size(), 2);
+        EXPECT(ranges[0].first == 0 && ranges[0].count == 7);
+        EXPECT(ranges[1].first == 20 && ranges[1].count == 1);
+
+        EXPECT(TransformHierarchy::getRanges({}, 16).empty());
+    }
+
+    CPU_TEST(TransformHierarchyBenchmark, "Long running benchmark, enable manually.")
+    {
+        std::mt19937 rng(1);
+        const uint32_t nodeCount = 200000;
+        const uint32_t iterations = 10;
+
+        auto parents = createParents(rng, nodeCount);
+        std::vector<glm::mat4> localMatrices(nodeCount);
+        for (auto& m : localMatrices) m = createMatrix(rng);
+
+        TransformHierarchy hierarchy(parents);
+        hierarchy.updateAll(localMatrices);
+
+        std::string report = "TransformHierarchyBenchmark: " + std::to_string(nodeCount) + " nodes";
+        for (float fraction : { 0.0001f, 0.001f, 0.01f, 0.1f, 1.f })
+        {
+            auto changed = pickNodes(rng, nodeCount, std::max(1u, uint32_t(fraction * nodeCount)));
+
+            auto start = CpuTimer::getCurrentTimePoint();
+            for (uint32_t i = 0; i < iterations; i++) hierarchy.updateAll(localMatrices);
+            double fullTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / iterations;
+
+            start = CpuTimer::getCurrentTimePoint();
+            for (uint32_t i = 0; i < iterations; i++) hierarchy.update(localMatrices, changed);
+            double incrementalTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / iterations;
+
+            size_t updatedCount = hierarchy.getUpdatedNodes().size();
+            size_t rangeCount = TransformHierarchy::getRanges(hierarchy.getUpdatedNodes(), 16).size();
+            report += "\n  animated " + std::to_string(fraction * 100.f) + "%: full " + std::to_string(fullTime) + " ms, incremental " + std::to_string(incrementalTime) +
+                " ms (" + std::to_string(updatedCount) + " nodes updated, " + std::to_string(rangeCount) + " upload ranges)";
+            EXPECT_GT(updatedCount, 0);
+        }
+        logInfo(report);
+    }
+}
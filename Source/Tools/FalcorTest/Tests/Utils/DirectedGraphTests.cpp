@@ -0,0 +1,288 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include <numeric>
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Check that an order contains each node of the graph once and that every edge goes forward.
+        */
+        bool isTopological(const DirectedGraph::SharedPtr& pGraph, const std::vector<uint32_t>& order, const std::vector<uint32_t>& nodes)
+        {
+            if (order.size() != nodes.size()) return false;
+
+            std::vector<uint32_t> position(pGraph->getCurrentNodeId(), DirectedGraph::kInvalidID);
+            for (uint32_t i = 0; i < (uint32_t)order.size(); i++)
+            {
+                if (!pGraph->doesNodeExist(order[i]) || position[order[i]] != DirectedGraph::kInvalidID) return false;
+                position[order[i]] = i;
+            }
+
+            for (uint32_t node : nodes)
+            {
+                const DirectedGraph::Node* pNode = pGraph->getNode(node);
+                for (uint32_t e = 0; e < pNode->getOutgoingEdgeCount(); e++)
+                {
+                    uint32_t next = pGraph->getEdge(pNode->getOutgoingEdge(e))->getDestNode();
+                    if (position[node] >= position[next]) return false;
+                }
+            }
+            return true;
+        }
+
+        /** Reference for DirectedGraph::getDownstreamNodes() using a traversal from each root.
+        */
+        std::unordered_set<uint32_t> getDownstreamReference(const DirectedGraph::SharedPtr& pGraph, const std::vector<uint32_t>& roots)
+        {
+            std::unordered_set<uint32_t> result;
+            for (uint32_t root : roots)
+            {
+                DirectedGraphBfsTraversal bfs(pGraph, root, DirectedGraphBfsTraversal::Flags::IgnoreVisited);
+                for (uint32_t node = bfs.traverse(); node != DirectedGraph::kInvalidID; node = bfs.traverse()) result.insert(node);
+            }
+            return result;
+        }
+
+        /** Add an edge unless it would create a cycle, like RenderGraph::addEdge() does.
+        */
+        uint32_t addAcyclicEdge(const DirectedGraph::SharedPtr& pGraph, uint32_t src, uint32_t dst)
+        {
+            if (src == dst || DirectedGraphPathDetector::hasPath(pGraph, dst, src)) return DirectedGraph::kInvalidID;
+            return pGraph->addEdge(src, dst);
+        }
+    }
+
+    CPU_TEST(DirectedGraphTopologicalOrder)
+    {
+        std::mt19937 rng(7);
+        auto pGraph = DirectedGraph::create();
+        std::vector<uint32_t> nodes;
+        std::vector<uint32_t> edges;
+        for (uint32_t i = 0; i < 500; i++) nodes.push_back(pGraph->addNode());
+
+        for (uint32_t op = 0; op < 5000; op++)
+        {
+            uint32_t action = rng() % 100;
+            if (action < 60 && nodes.size() > 1)
+            {
+                // The order only changes between the ends of the new edge
+                uint32_t src = nodes[rng() % nodes.size()];
+                uint32_t dst = nodes[rng() % nodes.size()];
+                auto before = pGraph->getTopologicalOrder();
+                uint32_t e = addAcyclicEdge(pGraph, src, dst);
+                if (e == DirectedGraph::kInvalidID) continue;
+                edges.push_back(e);
+
+                auto after = pGraph->getTopologicalOrder();
+                size_t lower = std::find(before.begin(), before.end(), dst) - before.begin();
+                size_t upper = std::find(before.begin(), before.end(), src) - before.begin();
+                if (lower > upper) EXPECT(before == after);
+                else
+                {
+                    bool kept = true;
+                    for (size_t i = 0; i < before.size(); i++) kept = kept && ((i >= lower && i <= upper) || before[i] == after[i]);
+                    EXPECT(kept);
+                }
+            }
+            else if (action < 80 && !edges.empty())
+            {
+                size_t i = rng() % edges.size();
+                if (pGraph->doesEdgeExist(edges[i])) pGraph->removeEdge(edges[i]);
+                edges[i] = edges.back();
+                edges.pop_back();
+            }
+            else if (action < 85 && !nodes.empty())
+            {
+                size_t i = rng() % nodes.size();
+                pGraph->removeNode(nodes[i]);
+                nodes[i] = nodes.back();
+                nodes.pop_back();
+            }
+            else
+            {
+                nodes.push_back(pGraph->addNode());
+            }
+
+            if (op % 50 == 0) EXPECT(isTopological(pGraph, pGraph->getTopologicalOrder(), nodes));
+        }
+        EXPECT(isTopological(pGraph, pGraph->getTopologicalOrder(), nodes));
+    }
+
+    CPU_TEST(DirectedGraphCycle)
+    {
+        auto pGraph = DirectedGraph::create();
+        uint32_t a = pGraph->addNode();
+        uint32_t b = pGraph->addNode();
+        uint32_t c = pGraph->addNode();
+        uint32_t d = pGraph->addNode();
+        pGraph->addEdge(c, b);
+        pGraph->addEdge(b, a);
+        EXPECT(isTopological(pGraph, pGraph->getTopologicalOrder(), { a, b, c, d }));
+
+        // The graph doesn't forbid cycles. The order isn't topological while the cycle exists, but still lists every node.
+        uint32_t e = pGraph->addEdge(a, c);
+        auto order = pGraph->getTopologicalOrder();
+        EXPECT_EQ(order.size(), 4u);
+        EXPECT(!isTopological(pGraph, order, { a, b, c, d }));
+
+        // Removing the edge restores the order.
+        pGraph->removeEdge(e);
+        EXPECT(isTopological(pGraph, pGraph->getTopologicalOrder(), { a, b, c, d }));
+        pGraph->addEdge(a, d);
+        EXPECT(isTopological(pGraph, pGraph->getTopologicalOrder(), { a, b, c, d }));
+
+        // Self loops are cycles too.
+        e = pGraph->addEdge(d, d);
+        EXPECT(!isTopological(pGraph, pGraph->getTopologicalOrder(), { a, b, c, d }));
+        pGraph->removeEdge(e);
+        EXPECT(isTopological(pGraph, pGraph->getTopologicalOrder(), { a, b, c, d }));
+    }
+
+    CPU_TEST(DirectedGraphDirtyNodes)
+    {
+        auto pGraph = DirectedGraph::create();
+        std::vector<uint32_t> nodes;
+        for (uint32_t i = 0; i < 6; i++) nodes.push_back(pGraph->addNode());
+        EXPECT_EQ(pGraph->getDirtyNodes().size(), 6u);
+        pGraph->clearDirtyNodes();
+        EXPECT(pGraph->getDirtyNodes().empty());
+
+        // Adding or removing an edge marks both ends.
+        uint32_t e = pGraph->addEdge(nodes[0], nodes[1]);
+        EXPECT(pGraph->getDirtyNodes() == std::unordered_set<uint32_t>({ nodes[0], nodes[1] }));
+        pGraph->clearDirtyNodes();
+        pGraph->removeEdge(e);
+        EXPECT(pGraph->getDirtyNodes() == std::unordered_set<uint32_t>({ nodes[0], nodes[1] }));
+
+        // Removing a node marks its neighbors, but not the removed node.
+        pGraph->addEdge(nodes[2], nodes[3]);
+        pGraph->addEdge(nodes[3], nodes[4]);
+        pGraph->clearDirtyNodes();
+        pGraph->removeNode(nodes[3]);
+        EXPECT(pGraph->getDirtyNodes() == std::unordered_set<uint32_t>({ nodes[2], nodes[4] }));
+
+        pGraph->clearDirtyNodes();
+        pGraph->markNodeDirty(nodes[5]);
+        pGraph->markNodeDirty(nodes[3]); // Doesn't exist anymore
+        EXPECT(pGraph->getDirtyNodes() == std::unordered_set<uint32_t>({ nodes[5] }));
+    }
+
+    CPU_TEST(DirectedGraphDownstreamNodes)
+    {
+        std::mt19937 rng(3);
+        auto pGraph = DirectedGraph::create();
+        const uint32_t nodeCount = 2000;
+        for (uint32_t i = 0; i < nodeCount; i++) pGraph->addNode();
+        for (uint32_t i = 0; i < 3 * nodeCount; i++)
+        {
+            // Edges go from lower to higher IDs, which keeps the graph acyclic
+            uint32_t src = rng() % nodeCount;
+            uint32_t dst = std::min(nodeCount - 1, src + 1 + uint32_t(rng() % 50));
+            if (src != dst) pGraph->addEdge(src, dst);
+        }
+
+        for (uint32_t test = 0; test < 20; test++)
+        {
+            std::vector<uint32_t> roots;
+            uint32_t rootCount = 1 + rng() % 4;
+            for (uint32_t i = 0; i < rootCount; i++) roots.push_back(rng() % nodeCount);
+            auto downstream = pGraph->getDownstreamNodes(roots);
+            EXPECT(std::unordered_set<uint32_t>(downstream.begin(), downstream.end()) == getDownstreamReference(pGraph, roots));
+            EXPECT_EQ(downstream.size(), getDownstreamReference(pGraph, roots).size()); // No duplicates
+        }
+        EXPECT(pGraph->getDownstreamNodes(std::vector<uint32_t>()).empty());
+    }
+
+    CPU_TEST(DirectedGraphIncrementalBenchmark, "Long running benchmark, enable manually.")
+    {
+        // A layered graph similar to a large render graph. The node IDs are unrelated to the layers, so new edges often go against the current order.
+        std::mt19937 rng(11);
+        const uint32_t layerCount = 100;
+        const uint32_t nodeCount = 10000;
+        const uint32_t editCount = 1000;
+
+        auto pGraph = DirectedGraph::create();
+        std::vector<uint32_t> layer(nodeCount);
+        std::vector<std::vector<uint32_t>> layers(layerCount);
+        for (uint32_t i = 0; i < nodeCount; i++)
+        {
+            pGraph->addNode();
+            layer[i] = rng() % layerCount;
+            layers[layer[i]].push_back(i);
+        }
+
+        auto randomEdge = [&]()
+        {
+            uint32_t src = rng() % nodeCount;
+            while (layer[src] == layerCount - 1) src = rng() % nodeCount;
+            uint32_t dstLayer = layer[src] + 1 + rng() % std::min(3u, layerCount - 1 - layer[src]);
+            const auto& candidates = layers[dstLayer];
+            return std::make_pair(src, candidates[rng() % candidates.size()]);
+        };
+
+        auto start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < 2 * nodeCount; i++)
+        {
+            auto [src, dst] = randomEdge();
+            pGraph->addEdge(src, dst);
+        }
+        double buildTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        std::vector<uint32_t> allNodes(nodeCount);
+        std::iota(allNodes.begin(), allNodes.end(), 0);
+        EXPECT(isTopological(pGraph, pGraph->getTopologicalOrder(), allNodes));
+
+        // Each edit adds an edge, updates the order and finds the nodes to recompile, compared to sorting the whole graph after each edit.
+        double incrementalTime = 0.0, fullTime = 0.0;
+        size_t downstreamCount = 0;
+        for (uint32_t i = 0; i < editCount; i++)
+        {
+            auto [src, dst] = randomEdge();
+            pGraph->clearDirtyNodes();
+
+            start = CpuTimer::getCurrentTimePoint();
+            pGraph->addEdge(src, dst);
+            downstreamCount += pGraph->getDownstreamNodes(pGraph->getDirtyNodes()).size();
+            incrementalTime += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+            start = CpuTimer::getCurrentTimePoint();
+            auto order = DirectedGraphTopologicalSort::sort(pGraph.get());
+            fullTime += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+            EXPECT_EQ(order.size(), nodeCount);
+        }
+        EXPECT(isTopological(pGraph, pGraph->getTopologicalOrder(), allNodes));
+
+        logInfo("DirectedGraphIncrementalBenchmark: " + std::to_string(nodeCount) + " nodes, " + std::to_string(pGraph->getCurrentEdgeId()) + " edges" +
+            "\n  build with incremental order: " + std::to_string(buildTime) + " ms" +
+            "\n  per edit: incremental order and downstream nodes " + std::to_string(incrementalTime * 1e3 / editCount) + " us (" + std::to_string(downstreamCount / editCount) +
+            " downstream nodes on average), full topological sort " + std::to_string(fullTime * 1e3 / editCount) + " us");
+    }
+}
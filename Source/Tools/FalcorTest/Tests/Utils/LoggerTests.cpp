@@ -0,0 +1,174 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kThreadCount = 4;
+
+        std::vector<std::string> readLines(const std::string& path)
+        {
+            std::vector<std::string> lines;
+            std::ifstream file(path);
+            for (std::string line; std::getline(file, line);) lines.push_back(line);
+            return lines;
+        }
+
+        std::string getJsonField(const std::string& line, const std::string& field)
+        {
+            std::string key = "\"" + field + "\":";
+            size_t start = line.find(key);
+            if (start == std::string::npos) return "";
+            start += key.size();
+            if (line[start] != '"') return line.substr(start, line.find_first_of(",}", start) - start);
+
+            // String value, find the closing quote. The value is returned without unescaping.
+            size_t end = start + 1;
+            while (end < line.size() && line[end] != '"') end += line[end] == '\\' ? 2 : 1;
+            return line.substr(start + 1, end - start - 1);
+        }
+
+        /** Reimplementation of the previous synchronous file sink, used as benchmark baseline only.
+        */
+        class SyncFileLog
+        {
+        public:
+            SyncFileLog(const std::string& path) : mpFile(std::fopen(path.c_str(), "w")) {}
+            ~SyncFileLog() { if (mpFile) std::fclose(mpFile); }
+
+            void log(const std::string& msg)
+            {
+                std::string s = "(Logger::Level::Info)\t" + msg + "\n";
+                std::lock_guard<std::mutex> lock(mMutex);
+                std::fprintf(mpFile, "%s", s.c_str());
+                std::fflush(mpFile);
+            }
+
+        private:
+            std::mutex mMutex;
+            FILE* mpFile;
+        };
+
+        template<typename LogFunc>
+        double timeMultiThreadLogging(uint32_t messagesPerThread, LogFunc logFunc)
+        {
+            auto start = CpuTimer::getCurrentTimePoint();
+            std::vector<std::thread> threads;
+            for (uint32_t t = 0; t < kThreadCount; t++)
+            {
+                threads.emplace_back([t, messagesPerThread, &logFunc]()
+                {
+                    for (uint32_t i = 0; i < messagesPerThread; i++) logFunc("LoggerBenchmark thread " + std::to_string(t) + " message " + std::to_string(i));
+                });
+            }
+            for (auto& t : threads) t.join();
+            return CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        }
+    }
+
+    CPU_TEST(LoggerJsonSink)
+    {
+        const uint32_t messagesPerThread = 100;
+        const uint32_t repeatCount = 50;
+        const std::string path = getTempFilename();
+        const bool fold = Logger::shouldFoldRepeatedMessages();
+        Logger::foldRepeatedMessages(true);
+        EXPECT(Logger::setJsonLogFilePath(path));
+
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < kThreadCount; t++)
+        {
+            threads.emplace_back([t, messagesPerThread]()
+            {
+                for (uint32_t i = 0; i < messagesPerThread; i++) logInfo("LoggerJsonSink " + std::to_string(t) + " " + std::to_string(i));
+            });
+        }
+        for (auto& t : threads) t.join();
+        for (uint32_t i = 0; i < repeatCount; i++) logInfo("LoggerJsonSink \"repeated\"");
+
+        // Closing the JSON log writes all pending messages.
+        EXPECT(Logger::setJsonLogFilePath(""));
+        Logger::foldRepeatedMessages(fold);
+
+        // Messages of each thread must be written in order, repeated messages must add up.
+        std::vector<int> lastIndex(kThreadCount, -1);
+        uint32_t repeated = 0;
+        for (const auto& line : readLines(path))
+        {
+            EXPECT(line.front() == '{' && line.back() == '}') << line;
+            EXPECT_EQ(getJsonField(line, "level"), "Info");
+            std::string message = getJsonField(line, "message");
+            if (message == "LoggerJsonSink \\\"repeated\\\"")
+            {
+                std::string count = getJsonField(line, "repeated");
+                repeated += count.empty() ? 1 : std::stoi(count);
+            }
+            else if (hasPrefix(message, "LoggerJsonSink "))
+            {
+                auto parts = splitString(message, " ");
+                uint32_t t = std::stoi(parts[1]);
+                int i = std::stoi(parts[2]);
+                EXPECT_EQ(i, lastIndex[t] + 1) << "thread " << t;
+                lastIndex[t] = i;
+            }
+        }
+        for (uint32_t t = 0; t < kThreadCount; t++) EXPECT_EQ(lastIndex[t], (int)messagesPerThread - 1);
+        EXPECT_EQ(repeated, repeatCount);
+        std::remove(path.c_str());
+    }
+
+    CPU_TEST(LoggerThroughputBenchmark, "Long running benchmark, enable manually.")
+    {
+        const uint32_t messagesPerThread = 25000;
+        const uint32_t messageCount = kThreadCount * messagesPerThread;
+
+        const std::string path = getTempFilename();
+        double syncTime = 0;
+        {
+            SyncFileLog syncLog(path);
+            syncTime = timeMultiThreadLogging(messagesPerThread, [&syncLog](const std::string& msg) { syncLog.log(msg); });
+        }
+        std::remove(path.c_str());
+
+        // Measure the time until the messages are written, not only queued.
+        auto start = CpuTimer::getCurrentTimePoint();
+        double queueTime = timeMultiThreadLogging(messagesPerThread, [](const std::string& msg) { logInfo(msg); });
+        Logger::flush();
+        double asyncTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        logInfo("LoggerThroughputBenchmark: " + std::to_string(messageCount) + " messages from " + std::to_string(kThreadCount) + " threads\n" +
+            "  synchronous fprintf/fflush: " + std::to_string(syncTime) + " ms (" + std::to_string(messageCount / syncTime) + " messages/ms)\n" +
+            "  asynchronous, queued:       " + std::to_string(queueTime) + " ms (" + std::to_string(messageCount / queueTime) + " messages/ms)\n" +
+            "  asynchronous, written:      " + std::to_string(asyncTime) + " ms (" + std::to_string(messageCount / asyncTime) + " messages/ms)");
+    }
+}
@@ -0,0 +1,128 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kThreadCount = 4;
+        const uint32_t kIterations = 1000;
+
+        std::string readTextFile(const std::string& path)
+        {
+            std::ifstream file(path);
+            std::stringstream ss;
+            ss << file.rdbuf();
+            return ss.str();
+        }
+
+        size_t countOccurrences(const std::string& text, const std::string& pattern)
+        {
+            size_t count = 0;
+            for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + pattern.size())) count++;
+            return count;
+        }
+
+        void profileNested(uint32_t iterations)
+        {
+            for (uint32_t i = 0; i < iterations; i++)
+            {
+                PROFILE("ProfilerTests::outer");
+                {
+                    PROFILE("ProfilerTests::inner");
+                }
+            }
+        }
+    }
+
+    CPU_TEST(ProfilerNameIDs)
+    {
+        Profiler::NameID a = Profiler::getNameID("ProfilerTests::a");
+        Profiler::NameID b = Profiler::getNameID("ProfilerTests::b");
+        EXPECT_NE(a, b);
+        EXPECT_EQ(a, Profiler::getNameID(std::string("ProfilerTests::") + "a"));
+        EXPECT_EQ(Profiler::getName(a), "ProfilerTests::a");
+
+        // The cache resolves literals by address and strings by value.
+        Profiler::NameCache cache;
+        EXPECT_EQ(cache.get("ProfilerTests::a"), a);
+        EXPECT_EQ(cache.get("ProfilerTests::a"), a);
+        EXPECT_EQ(cache.get(std::string("ProfilerTests::b")), b);
+    }
+
+    CPU_TEST(ProfilerMultiThreadTrace)
+    {
+        // Events are recorded on worker threads only, the main thread events would issue GPU timers.
+        const std::string path = getTempFilename();
+        Profiler::startCapture();
+        EXPECT(Profiler::isCapturing());
+
+        std::vector<std::thread> threads;
+        for (uint32_t i = 0; i < kThreadCount; i++) threads.emplace_back(profileNested, kIterations);
+        for (auto& t : threads) t.join();
+
+        Profiler::endFrame();
+        EXPECT(Profiler::getEventsString().find("ProfilerTests::inner") != std::string::npos);
+
+        EXPECT(Profiler::endCapture(path));
+        EXPECT(!Profiler::isCapturing());
+
+        std::string trace = readTextFile(path);
+        EXPECT(trace.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[") == 0);
+        EXPECT_EQ(countOccurrences(trace, "\"name\":\"ProfilerTests::outer\""), kThreadCount * kIterations);
+        EXPECT_EQ(countOccurrences(trace, "\"name\":\"ProfilerTests::inner\""), kThreadCount * kIterations);
+        EXPECT_EQ(countOccurrences(trace, "\"name\":\"thread_name\""), kThreadCount);
+        std::remove(path.c_str());
+    }
+
+    CPU_TEST(ProfilerBufferOverflow)
+    {
+        // Record more events than fit in a thread's buffer without draining. Dropped events must not unbalance the hierarchy.
+        const uint32_t iterations = 50000;
+        const std::string path = getTempFilename();
+        const uint64_t droppedBefore = Profiler::getDroppedEventCount();
+
+        Profiler::startCapture();
+        std::thread t(profileNested, iterations);
+        t.join();
+        EXPECT(Profiler::endCapture(path));
+
+        const uint64_t dropped = Profiler::getDroppedEventCount() - droppedBefore;
+        std::string trace = readTextFile(path);
+        size_t outer = countOccurrences(trace, "\"name\":\"ProfilerTests::outer\"");
+        size_t inner = countOccurrences(trace, "\"name\":\"ProfilerTests::inner\"");
+        EXPECT_GT(dropped, 0u);
+        EXPECT_EQ(outer + inner + dropped, 2 * iterations);
+        EXPECT_LE(inner, outer) << "inner events must only be recorded inside recorded outer events";
+        std::remove(path.c_str());
+    }
+}
@@ -0,0 +1,127 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Image/TextureCache.h"
+#include <cstdio>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kImageSize = 16;
+        const uint32_t kImageCount = 8;
+
+        std::vector<std::string> createTestImages()
+        {
+            std::vector<std::string> filenames;
+            for (uint32_t i = 0; i < kImageCount; i++)
+            {
+                std::vector<uint8_t> pixels(kImageSize * kImageSize * 4);
+                for (size_t j = 0; j < pixels.size(); j++) pixels[j] = uint8_t(j * 7 + i * 13);
+
+                std::string filename = getTempFilename() + ".png";
+                Bitmap::saveImage(filename, kImageSize, kImageSize, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::ExportAlpha, ResourceFormat::RGBA8Unorm, true, pixels.data());
+                filenames.push_back(filename);
+            }
+            return filenames;
+        }
+    }
+
+    GPU_TEST(TextureCache)
+    {
+        TextureCache::clear();
+        auto filenames = createTestImages();
+
+        // Request all images so they are decoded in parallel, then create the textures.
+        std::vector<TextureCache::Request> requests;
+        for (const auto& filename : filenames) requests.push_back(TextureCache::request(filename, false, true));
+        std::vector<Texture::SharedPtr> textures;
+        for (const auto& request : requests) textures.push_back(TextureCache::resolve(request));
+
+        auto stats = TextureCache::getStats();
+        EXPECT_EQ(stats.requestCount, kImageCount);
+        EXPECT_EQ(stats.decodeCount, kImageCount);
+        EXPECT_EQ(stats.textureCount, kImageCount);
+
+        // The textures must match the ones created without the cache.
+        for (uint32_t i = 0; i < kImageCount; i++)
+        {
+            EXPECT_NE(textures[i], nullptr);
+            if (!textures[i]) continue;
+            auto pRef = Texture::createFromFile(filenames[i], false, true);
+            EXPECT_EQ(textures[i]->getFormat(), pRef->getFormat());
+            EXPECT_EQ(textures[i]->getWidth(), pRef->getWidth());
+            EXPECT_EQ(textures[i]->getHeight(), pRef->getHeight());
+            EXPECT_EQ(textures[i]->getMipCount(), pRef->getMipCount());
+            EXPECT_EQ(textures[i]->getSourceFilename(), pRef->getSourceFilename());
+            EXPECT(ctx.getRenderContext()->readTextureSubresource(textures[i].get(), 0) == ctx.getRenderContext()->readTextureSubresource(pRef.get(), 0));
+        }
+
+        // Requesting the same file again returns the same texture without decoding.
+        EXPECT_EQ(TextureCache::load(filenames[0], false, true), textures[0]);
+        EXPECT_EQ(TextureCache::getStats().decodeCount, kImageCount);
+
+        // The sRGB flag is part of the key.
+        auto pLinear = TextureCache::load(filenames[0], false, false);
+        EXPECT_NE(pLinear, nullptr);
+        EXPECT_NE(pLinear, textures[0]);
+        if (pLinear) EXPECT_EQ(pLinear->getFormat(), ResourceFormat::BGRA8Unorm);
+        EXPECT_EQ(TextureCache::getStats().decodeCount, kImageCount + 1);
+
+        // Released textures are decoded again.
+        textures[1] = nullptr;
+        auto pReloaded = TextureCache::load(filenames[1], false, true);
+        EXPECT_NE(pReloaded, nullptr);
+        EXPECT_EQ(TextureCache::getStats().decodeCount, kImageCount + 2);
+
+        TextureCache::clear();
+        for (const auto& filename : filenames) std::remove(filename.c_str());
+    }
+
+    GPU_TEST(TextureCacheMemoryBudget)
+    {
+        TextureCache::clear();
+        auto filenames = createTestImages();
+
+        // With the smallest budget, every decode task stops after a single image until textures are created.
+        // resolve() decodes a queued image on the calling thread, which can add one more image.
+        TextureCache::setMaxDecodedBytes(1);
+        std::vector<TextureCache::Request> requests;
+        for (const auto& filename : filenames) requests.push_back(TextureCache::request(filename, false, true));
+        for (const auto& request : requests) EXPECT_NE(TextureCache::resolve(request), nullptr);
+
+        auto stats = TextureCache::getStats();
+        EXPECT_EQ(stats.decodeCount, kImageCount);
+        EXPECT_EQ(stats.textureCount, kImageCount);
+        EXPECT_LE(stats.peakDecodedBytes, (uint64_t)(std::max(1u, Threading::getThreadCount()) + 1) * kImageSize * kImageSize * 4);
+
+        TextureCache::setMaxDecodedBytes(0);
+        TextureCache::clear();
+        for (const auto& filename : filenames) std::remove(filename.c_str());
+    }
+}
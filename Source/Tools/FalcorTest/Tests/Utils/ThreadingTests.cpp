@@ -0,0 +1,219 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include <atomic>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Reimplementation of the previous dispatcher, which spawned one OS thread per task and
+            joined the thread occupying the next round-robin slot. Used as benchmark baseline only.
+        */
+        class LegacyDispatcher
+        {
+        public:
+            LegacyDispatcher(uint32_t threadCount) : mThreads(threadCount) {}
+
+            void dispatchTask(const std::function<void(void)>& func)
+            {
+                std::thread& t = mThreads[mCurrent];
+                if (t.joinable()) t.join();
+                t = std::thread(func);
+                mCurrent = (mCurrent + 1) % mThreads.size();
+            }
+
+            void finish()
+            {
+                for (auto& t : mThreads)
+                {
+                    if (t.joinable()) t.join();
+                }
+            }
+
+        private:
+            std::vector<std::thread> mThreads;
+            size_t mCurrent = 0;
+        };
+
+        const uint32_t kBenchmarkTaskCount = 4096;
+
+        void busyWork(std::atomic<uint64_t>& sink)
+        {
+            uint64_t x = 0;
+            for (uint32_t i = 0; i < 1000; i++) x = x * 6364136223846793005ull + i;
+            sink += x;
+        }
+    }
+
+    CPU_TEST(ThreadingTask)
+    {
+        std::atomic<uint32_t> counter = 0;
+        std::vector<Threading::Task> tasks;
+        for (uint32_t i = 0; i < 1000; i++) tasks.push_back(Threading::dispatchTask([&counter]() { counter++; }));
+        for (const auto& task : tasks) task.finish();
+        EXPECT_EQ(counter.load(), 1000u);
+        for (const auto& task : tasks) EXPECT(!task.isRunning());
+
+        // Empty handles are never running.
+        Threading::Task empty;
+        EXPECT(!empty.isRunning());
+        empty.finish();
+    }
+
+    CPU_TEST(ThreadingContinuation)
+    {
+        std::atomic<bool> release = false;
+        std::vector<uint32_t> order;
+
+        auto task = Threading::dispatchTask([&]() { while (!release) std::this_thread::yield(); order.push_back(0); });
+        auto next = task.then([&]() { order.push_back(1); });
+        auto last = next.then([&]() { order.push_back(2); });
+        EXPECT(task.isRunning());
+        EXPECT(last.isRunning());
+
+        release = true;
+        last.finish();
+        EXPECT(!task.isRunning());
+        EXPECT(!next.isRunning());
+        EXPECT_EQ(order.size(), 3);
+        for (uint32_t i = 0; i < order.size(); i++) EXPECT_EQ(order[i], i);
+
+        // Continuations on a finished task run as well.
+        bool ran = false;
+        task.then([&ran]() { ran = true; }).finish();
+        EXPECT(ran);
+    }
+
+    CPU_TEST(ThreadingException)
+    {
+        auto task = Threading::dispatchTask([]() { throw std::runtime_error("task failed"); });
+        bool caught = false;
+        try
+        {
+            task.finish();
+        }
+        catch (const std::runtime_error&)
+        {
+            caught = true;
+        }
+        EXPECT(caught);
+    }
+
+    CPU_TEST(ThreadingParallelFor)
+    {
+        for (size_t count : { 0, 1, 7, 1000, 100000 })
+        {
+            std::vector<uint32_t> values(count, 0);
+            Threading::parallelFor(0, count, [&values](size_t i) { values[i]++; });
+            for (size_t i = 0; i < count; i++) EXPECT_EQ(values[i], 1u) << "count=" << count << " i=" << i;
+        }
+
+        // Nested loops must not deadlock.
+        std::atomic<uint32_t> counter = 0;
+        Threading::parallelFor(0, 64, [&counter](size_t)
+        {
+            Threading::parallelFor(0, 100, [&counter](size_t) { counter++; }, 8);
+        }, 1);
+        EXPECT_EQ(counter.load(), 6400u);
+
+        // Sub-ranges cover the loop range exactly.
+        std::vector<uint32_t> values(1000, 0);
+        Threading::parallelForRange(10, 1000, [&values](size_t first, size_t last)
+        {
+            for (size_t i = first; i < last; i++) values[i]++;
+        }, 33);
+        for (size_t i = 0; i < values.size(); i++) EXPECT_EQ(values[i], i < 10 ? 0u : 1u) << "i=" << i;
+    }
+
+    CPU_TEST(ThreadingParallelReduce)
+    {
+        const size_t count = 1000000;
+        std::vector<float> values(count);
+        for (size_t i = 0; i < count; i++) values[i] = 1.f / (float)(i + 1);
+
+        auto reduce = [&values](size_t first, size_t last, float sum)
+        {
+            for (size_t i = first; i < last; i++) sum += values[i];
+            return sum;
+        };
+        auto combine = [](float a, float b) { return a + b; };
+
+        // Floating-point sums must be bit-identical between runs.
+        float reference = Threading::parallelReduce(0, count, 0.f, reduce, combine);
+        for (uint32_t i = 0; i < 10; i++) EXPECT_EQ(reference, Threading::parallelReduce(0, count, 0.f, reduce, combine));
+
+        uint64_t sum = Threading::parallelReduce(0, count, uint64_t(0), [](size_t first, size_t last, uint64_t s)
+        {
+            for (size_t i = first; i < last; i++) s += i;
+            return s;
+        }, [](uint64_t a, uint64_t b) { return a + b; }, 1000);
+        EXPECT_EQ(sum, uint64_t(count) * (count - 1) / 2);
+
+        EXPECT_EQ(Threading::parallelReduce(5, 5, 42.f, reduce, combine), 42.f);
+
+        // Boolean partial results of neighboring chunks are written concurrently.
+        auto allPositive = [&values](size_t first, size_t last, bool result)
+        {
+            for (size_t i = first; i < last; i++) result = result && values[i] > 0.f;
+            return result;
+        };
+        auto both = [](bool a, bool b) { return a && b; };
+        for (uint32_t i = 0; i < 10; i++) EXPECT(Threading::parallelReduce(0, count, true, allPositive, both, 64));
+        values[count / 2] = 0.f;
+        EXPECT(!Threading::parallelReduce(0, count, true, allPositive, both, 64));
+    }
+
+    CPU_TEST(ThreadingBenchmark, "Long running benchmark, enable manually.")
+    {
+        std::atomic<uint64_t> sink = 0;
+
+        auto start = CpuTimer::getCurrentTimePoint();
+        {
+            LegacyDispatcher legacy(Threading::kDefaultThreadCount);
+            for (uint32_t i = 0; i < kBenchmarkTaskCount; i++) legacy.dispatchTask([&sink]() { busyWork(sink); });
+            legacy.finish();
+        }
+        double legacyTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < kBenchmarkTaskCount; i++) Threading::dispatchTask([&sink]() { busyWork(sink); });
+        Threading::finish();
+        double poolTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        start = CpuTimer::getCurrentTimePoint();
+        Threading::parallelFor(0, kBenchmarkTaskCount, [&sink](size_t) { busyWork(sink); });
+        double parallelForTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        logInfo("ThreadingBenchmark: " + std::to_string(kBenchmarkTaskCount) + " tasks, " + std::to_string(Threading::getThreadCount()) + " workers\n" +
+            "  thread per task: " + std::to_string(legacyTime) + " ms (" + std::to_string(kBenchmarkTaskCount / legacyTime) + " tasks/ms)\n" +
+            "  task pool:       " + std::to_string(poolTime) + " ms (" + std::to_string(kBenchmarkTaskCount / poolTime) + " tasks/ms)\n" +
+            "  parallelFor:     " + std::to_string(parallelForTime) + " ms (" + std::to_string(kBenchmarkTaskCount / parallelForTime) + " tasks/ms)");
+        EXPECT_GT(sink.load(), 0ull);
+    }
+}
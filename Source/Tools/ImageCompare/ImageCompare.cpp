@@ -35,6 +35,20 @@
 #include <stdexcept>
 #include <map>
 #include <functional>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <immintrin.h>
 
 template<typename T>
 T sqr(T x) { return x * x; }
@@ -159,80 +173,186 @@ private:
     {}
 };
 
+/** Error metrics.
+    Each metric computes the per-channel error of one RGBA pixel held in an SSE register.
+    The per-pixel error is the average over the compared channels, multiplied by kScale.
+*/
 struct MSE
 {
-    double operator()(const float* a, const float* b, size_t count) const
+    static constexpr float kScale = 1.f;
+    __m128 operator()(__m128 a, __m128 b) const
     {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i) { error += sqr(a[i] - b[i]); }
-        return error / count;
+        __m128 d = _mm_sub_ps(a, b);
+        return _mm_mul_ps(d, d);
     }
 };
 
 struct RMSE
 {
-    double operator()(const float* a, const float* b, size_t count) const
+    static constexpr float kScale = 1.f;
+    __m128 operator()(__m128 a, __m128 b) const
     {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i) { error += sqr(a[i] - b[i]) / (sqr(a[i]) + 1e-3); }
-        return error / count;
+        __m128 d = _mm_sub_ps(a, b);
+        return _mm_div_ps(_mm_mul_ps(d, d), _mm_add_ps(_mm_mul_ps(a, a), _mm_set1_ps(1e-3f)));
     }
 };
 
 struct MAE
 {
-    double operator()(const float* a, const float* b, size_t count) const
+    static constexpr float kScale = 1.f;
+    __m128 operator()(__m128 a, __m128 b) const
     {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i) { error += std::fabs(sqr(a[i] - b[i])); }
-        return error / count;
+        return abs(_mm_sub_ps(a, b));
     }
+    static __m128 abs(__m128 x) { return _mm_andnot_ps(_mm_set1_ps(-0.f), x); }
 };
 
 struct MAPE
 {
-    double operator()(const float* a, const float* b, size_t count) const
+    static constexpr float kScale = 100.f;
+    __m128 operator()(__m128 a, __m128 b) const
     {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i) { error += std::fabs((a[i] - b[i]) / (a[i] + 1e-3)); }
-        return 100.0 * error / count;
+        return MAE::abs(_mm_div_ps(_mm_sub_ps(a, b), _mm_add_ps(a, _mm_set1_ps(1e-3f))));
     }
 };
 
+/** Compares a range of rows of two images.
+    Four pixels are processed per iteration: their per-channel errors are transposed so that the
+    per-pixel errors end up in the lanes of a single register. Errors are accumulated in double precision.
+    \param[in] errorMap Optional per-pixel error output for the given rows.
+    \return Sum of the per-pixel errors.
+*/
 template<typename Metric>
-double compare(const Image& imageA, const Image& imageB, bool alpha, float* errorMap)
+double compareRows(const Image& imageA, const Image& imageB, uint32_t firstRow, uint32_t rowCount, bool alpha, float* errorMap)
 {
     Metric metric;
-    double sum = 0.0;
-    const float* a = imageA.getData();
-    const float* b = imageB.getData();
-    size_t count = imageA.getWidth() * imageA.getHeight();
-    for (size_t i = 0; i < count; ++i)
-    {
-        double error = metric(a, b, alpha ? 4 : 3);
-        if (errorMap) *errorMap++ = float(error);
-        sum += error;
-        a += 4;
-        b += 4;
-    }
-    return sum / count;
+    const size_t offset = size_t(firstRow) * imageA.getWidth() * 4;
+    const size_t count = size_t(rowCount) * imageA.getWidth();
+    const float* a = imageA.getData() + offset;
+    const float* b = imageB.getData() + offset;
+
+    const __m128 channelMask = _mm_castsi128_ps(_mm_set_epi32(alpha ? -1 : 0, -1, -1, -1));
+    const __m128 channelCount = _mm_set1_ps(alpha ? 4.f : 3.f);
+    const __m128 scale = _mm_set1_ps(Metric::kScale);
+    auto error = [&] (size_t i) { return _mm_and_ps(metric(_mm_loadu_ps(a + i * 4), _mm_loadu_ps(b + i * 4)), channelMask); };
+
+    __m128d sum0 = _mm_setzero_pd();
+    __m128d sum1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 e0 = error(i), e1 = error(i + 1), e2 = error(i + 2), e3 = error(i + 3);
+        _MM_TRANSPOSE4_PS(e0, e1, e2, e3);
+        __m128 pixelError = _mm_mul_ps(_mm_div_ps(_mm_add_ps(_mm_add_ps(e0, e1), _mm_add_ps(e2, e3)), channelCount), scale);
+        if (errorMap) _mm_storeu_ps(errorMap + i, pixelError);
+        sum0 = _mm_add_pd(sum0, _mm_cvtps_pd(pixelError));
+        sum1 = _mm_add_pd(sum1, _mm_cvtps_pd(_mm_movehl_ps(pixelError, pixelError)));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+    double sum = lanes[0] + lanes[1];
+
+    for (; i < count; ++i)
+    {
+        float e[4];
+        _mm_storeu_ps(e, error(i));
+        float pixelError = (e[0] + e[1]) + (e[2] + e[3]);
+        pixelError = pixelError / (alpha ? 4.f : 3.f) * Metric::kScale;
+        if (errorMap) errorMap[i] = pixelError;
+        sum += pixelError;
+    }
+
+    return sum;
 }
 
 struct ErrorMetric
 {
     std::string name;
     std::string desc;
-    std::function<double(const Image& imageA, const Image& imageB, bool alpha, float* errorMap)> compare;
+    std::function<double(const Image& imageA, const Image& imageB, uint32_t firstRow, uint32_t rowCount, bool alpha, float* errorMap)> compareRows;
 };
 
 static const std::vector<ErrorMetric> errorMetrics =
 {
-    { "mse", "Mean Squared Error", compare<MSE> },
-    { "rmse", "Relative Mean Squared Error", compare<RMSE> },
-    { "mae", "Mean Absolute Error", compare<MAE> },
-    { "mape", "Mean Absolute Percentage Error", compare<MAPE> },
+    { "mse", "Mean Squared Error", compareRows<MSE> },
+    { "rmse", "Relative Mean Squared Error", compareRows<RMSE> },
+    { "mae", "Mean Absolute Error", compareRows<MAE> },
+    { "mape", "Mean Absolute Percentage Error", compareRows<MAPE> },
 };
 
+/** Runs func on the calling thread and threadCount - 1 additional threads.
+*/
+template<typename Func>
+void runOnThreads(uint32_t threadCount, Func func)
+{
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < threadCount; ++i) threads.emplace_back(func);
+    func();
+    for (auto& thread : threads) thread.join();
+}
+
+struct CompareOptions
+{
+    bool alpha = false;
+    bool earlyOut = false;          ///< Stop as soon as the error is known to exceed the threshold.
+    uint32_t threadCount = 1;       ///< Number of threads used to compare the tiles of one image pair.
+};
+
+struct TileResult
+{
+    double error = 0.0;
+    bool earlyOut = false;          ///< True if comparison stopped early. The error is then a lower bound of the full error.
+};
+
+/** Compares two images of equal size. The images are split into tiles of kTileRows rows which are
+    distributed over options.threadCount threads. As all metrics are non-negative, the partial error sum
+    divided by the full pixel count is a lower bound of the final error, which allows stopping early.
+    Tile sums are reduced in tile order so that the result does not depend on the thread count.
+*/
+static TileResult compareTiles(const ErrorMetric& metric, const Image& imageA, const Image& imageB, double threshold, const CompareOptions& options, float* errorMap)
+{
+    static const uint32_t kTileRows = 32;
+
+    const uint32_t width = imageA.getWidth();
+    const uint32_t height = imageA.getHeight();
+    const uint32_t tileCount = (height + kTileRows - 1) / kTileRows;
+    const double pixelCount = double(width) * height;
+    const bool earlyOut = options.earlyOut && !errorMap;
+    const double maxSum = threshold * pixelCount;
+
+    std::vector<double> tileSums(tileCount, 0.0);
+    std::atomic<uint32_t> nextTile{ 0 };
+    std::atomic<double> partialSum{ 0.0 };
+    std::atomic<bool> exceeded{ false };
+
+    auto worker = [&] ()
+    {
+        while (!exceeded)
+        {
+            uint32_t tile = nextTile++;
+            if (tile >= tileCount) break;
+            uint32_t firstRow = tile * kTileRows;
+            uint32_t rowCount = std::min(kTileRows, height - firstRow);
+            double sum = metric.compareRows(imageA, imageB, firstRow, rowCount, options.alpha, errorMap ? errorMap + size_t(firstRow) * width : nullptr);
+            tileSums[tile] = sum;
+            if (earlyOut)
+            {
+                double total = partialSum.load();
+                while (!partialSum.compare_exchange_weak(total, total + sum)) {}
+                // Negated comparison so that nans also stop the comparison.
+                if (!(total + sum <= maxSum)) exceeded = true;
+            }
+        }
+    };
+    runOnThreads(std::min(options.threadCount, tileCount), worker);
+
+    if (exceeded) return { partialSum.load() / pixelCount, true };
+    double sum = 0.0;
+    for (double tileSum : tileSums) sum += tileSum;
+    return { sum / pixelCount, false };
+}
+
 static Image::SharedPtr generateHeatMap(uint32_t width, uint32_t height, const float* errorMap)
 {
     auto writeColor = [] (float t, float* dst)
@@ -264,9 +384,30 @@ static Image::SharedPtr generateHeatMap(uint32_t width, uint32_t height, const f
     return image;
 }
 
-static bool compareImages(const std::string& filenameA, const std::string& filenameB, ErrorMetric metric, float threshold, bool alpha, const std::string& heatMapFilename)
+struct ComparePair
+{
+    std::string name;               ///< Name used for reporting.
+    std::string filenameA;
+    std::string filenameB;
+    double threshold = 0.0;
+    std::string heatMapFilename;    ///< Heat map output filename, empty if no heat map is generated.
+};
+
+struct CompareResult
 {
-    auto loadImage = [] (const std::string& filename)
+    bool compared = false;          ///< True if the images were loaded and compared.
+    bool passed = false;
+    bool earlyOut = false;          ///< True if comparison stopped early. The error is then a lower bound of the full error.
+    double error = 0.0;
+    uint64_t pixelCount = 0;
+    std::string message;            ///< Reason for failing to compare, or warning.
+};
+
+static CompareResult compareImages(const ComparePair& pair, const ErrorMetric& metric, const CompareOptions& options)
+{
+    CompareResult result;
+
+    auto loadImage = [] (const std::string& filename, std::string& message)
     {
         try
         {
@@ -274,12 +415,12 @@ static bool compareImages(const std::string& filenameA, const std::string& filen
         }
         catch (const std::runtime_error& e)
         {
-            std::cerr << "Cannot load image from '" << filename << "' (Error: " << e.what() << ")." << std::endl;
+            message = "Cannot load image from '" + filename + "' (Error: " + e.what() + ").";
             return Image::SharedPtr();
         }
     };
 
-    auto saveImage = [] (const Image& image, const std::string& filename)
+    auto saveImage = [] (const Image& image, const std::string& filename, std::string& message)
     {
         try
         {
@@ -287,43 +428,305 @@ static bool compareImages(const std::string& filenameA, const std::string& filen
         }
         catch (const std::runtime_error& e)
         {
-            std::cerr << "Cannot save image to '" << filename << "' (Error: " << e.what() << ")." << std::endl;
+            message = "Cannot save image to '" + filename + "' (Error: " + e.what() + ").";
         }
     };
 
-    // Load images.
-    auto imageA = loadImage(filenameA);
-    if (!imageA) return false;
-    auto imageB = loadImage(filenameB);
-    if (!imageB) return false;
+    // Load images. The second image is loaded concurrently if we have threads to spare.
+    std::string messageB;
+    auto futureB = std::async(options.threadCount > 1 ? std::launch::async : std::launch::deferred, loadImage, pair.filenameB, std::ref(messageB));
+    auto imageA = loadImage(pair.filenameA, result.message);
+    if (!imageA) return result;
+    auto imageB = futureB.get();
+    if (!imageB)
+    {
+        result.message = messageB;
+        return result;
+    }
 
     // Check resolution.
     if (imageA->getWidth() != imageB->getWidth() || imageA->getHeight() != imageB->getHeight())
     {
-        std::cerr << "Cannot compare images with different resolutions." << std::endl;
-        return false;
+        result.message = "Cannot compare images with different resolutions.";
+        return result;
     }
 
     uint32_t width = imageA->getWidth();
     uint32_t height = imageB->getHeight();
 
     // Compare images.
-    std::unique_ptr<float[]> errorMap = heatMapFilename.empty() ? nullptr : std::make_unique<float[]>(width * height);
-    double error = metric.compare(*imageA, *imageB, alpha, errorMap.get());
+    std::unique_ptr<float[]> errorMap = pair.heatMapFilename.empty() ? nullptr : std::make_unique<float[]>(size_t(width) * height);
+    auto tileResult = compareTiles(metric, *imageA, *imageB, pair.threshold, options, errorMap.get());
+    result.compared = true;
+    result.error = tileResult.error;
+    result.earlyOut = tileResult.earlyOut;
+    result.pixelCount = uint64_t(width) * height;
 
     // Generate heat map.
     if (errorMap)
     {
         auto heatMap = generateHeatMap(width, height, errorMap.get());
-        saveImage(*heatMap, heatMapFilename);
+        saveImage(*heatMap, pair.heatMapFilename, result.message);
     }
 
-    std::cout << error << std::endl;
-
     // Treat nans and infs as errors.
-    if (std::isnan(error) || std::isinf(error)) return false;
+    result.passed = !std::isnan(result.error) && !std::isinf(result.error) && !result.earlyOut && result.error <= pair.threshold;
+
+    return result;
+}
+
+/** Compares a list of image pairs.
+    Loading dominates the runtime, so threads are first distributed over image pairs. Threads left over
+    when there are fewer pairs than threads are used to compare the tiles of each pair.
+    Note that each thread working on a pair holds both images in memory.
+*/
+static std::vector<CompareResult> comparePairs(const std::vector<ComparePair>& pairs, const ErrorMetric& metric, CompareOptions options, uint32_t threadCount)
+{
+    uint32_t pairThreadCount = std::max(1u, std::min(threadCount, uint32_t(pairs.size())));
+    options.threadCount = std::max(1u, threadCount / pairThreadCount);
+
+    std::vector<CompareResult> results(pairs.size());
+    std::atomic<size_t> nextPair{ 0 };
+    runOnThreads(pairThreadCount, [&] ()
+    {
+        for (size_t i = nextPair++; i < pairs.size(); i = nextPair++) results[i] = compareImages(pairs[i], metric, options);
+    });
+
+    return results;
+}
+
+/** Collects image pairs from two directories. Images are matched by their path relative to the directory.
+    Images that only exist in one of the directories are reported as failed comparisons.
+*/
+static std::vector<ComparePair> collectDirectoryPairs(const std::string& dirA, const std::string& dirB, double threshold, const std::string& heatMapSuffix)
+{
+    namespace fs = std::filesystem;
+
+    auto collectImages = [&heatMapSuffix] (const fs::path& dir, std::set<std::string>& images)
+    {
+        if (!fs::is_directory(dir)) throw std::runtime_error("'" + dir.string() + "' is not a directory");
+        for (const auto& entry : fs::recursive_directory_iterator(dir))
+        {
+            if (!entry.is_regular_file()) continue;
+            std::string filename = entry.path().string();
+            // Skip previously generated heat maps.
+            if (!heatMapSuffix.empty() && filename.size() >= heatMapSuffix.size() && filename.compare(filename.size() - heatMapSuffix.size(), heatMapSuffix.size(), heatMapSuffix) == 0) continue;
+            if (FreeImage_GetFIFFromFilename(filename.c_str()) == FIF_UNKNOWN) continue;
+            images.insert(fs::relative(entry.path(), dir).generic_string());
+        }
+    };
+
+    std::set<std::string> images;
+    collectImages(dirA, images);
+    collectImages(dirB, images);
+
+    std::vector<ComparePair> pairs;
+    for (const auto& image : images)
+    {
+        ComparePair pair;
+        pair.name = image;
+        pair.filenameA = (fs::path(dirA) / image).string();
+        pair.filenameB = (fs::path(dirB) / image).string();
+        pair.threshold = threshold;
+        if (!heatMapSuffix.empty()) pair.heatMapFilename = pair.filenameB + heatMapSuffix;
+        pairs.push_back(pair);
+    }
+
+    return pairs;
+}
+
+/** Reads image pairs from a manifest file.
+    Each line contains the two images and an optional threshold overriding the default threshold.
+    Columns are separated by tabs, or by whitespace if the line contains no tabs. Empty lines and lines
+    starting with '#' are ignored. Relative paths are relative to the directory containing the manifest.
+*/
+static std::vector<ComparePair> readManifest(const std::string& filename, double threshold, const std::string& heatMapSuffix)
+{
+    namespace fs = std::filesystem;
+
+    std::ifstream stream(filename);
+    if (!stream) throw std::runtime_error("Cannot open manifest '" + filename + "'");
+
+    const fs::path baseDir = fs::path(filename).parent_path();
+    auto resolve = [&baseDir] (const std::string& path) { return fs::path(path).is_relative() ? (baseDir / path).string() : path; };
+
+    std::vector<ComparePair> pairs;
+    std::string line;
+    for (uint32_t lineNumber = 1; std::getline(stream, line); ++lineNumber)
+    {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+
+        std::vector<std::string> columns;
+        if (line.find('\t') != std::string::npos)
+        {
+            std::istringstream lineStream(line);
+            for (std::string column; std::getline(lineStream, column, '\t');) columns.push_back(column);
+        }
+        else
+        {
+            std::istringstream lineStream(line);
+            for (std::string column; lineStream >> column;) columns.push_back(column);
+        }
+
+        auto error = [&] () { return std::runtime_error("Invalid entry in manifest '" + filename + "' line " + std::to_string(lineNumber)); };
+        if (columns.size() < 2 || columns.size() > 3) throw error();
 
-    return error <= threshold;
+        ComparePair pair;
+        pair.name = columns[0];
+        pair.filenameA = resolve(columns[0]);
+        pair.filenameB = resolve(columns[1]);
+        pair.threshold = threshold;
+        if (columns.size() == 3)
+        {
+            char* end = nullptr;
+            pair.threshold = float(std::strtod(columns[2].c_str(), &end));
+            if (end == columns[2].c_str() || *end != '\0') throw error();
+        }
+        if (!heatMapSuffix.empty()) pair.heatMapFilename = pair.filenameB + heatMapSuffix;
+        pairs.push_back(pair);
+    }
+
+    return pairs;
+}
+
+static std::string toJsonString(const std::string& str)
+{
+    std::string result = "\"";
+    for (char c : str)
+    {
+        switch (c)
+        {
+        case '"': result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n"; break;
+        case '\r': result += "\\r"; break;
+        case '\t': result += "\\t"; break;
+        default:
+            if (uint8_t(c) < 0x20)
+            {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                result += buf;
+            }
+            else
+            {
+                result += c;
+            }
+        }
+    }
+    return result + "\"";
+}
+
+static std::string toJsonNumber(double value)
+{
+    // JSON has no representation for nans and infs.
+    if (std::isnan(value) || std::isinf(value)) return "null";
+    std::ostringstream stream;
+    stream << std::setprecision(std::numeric_limits<double>::max_digits10) << value;
+    return stream.str();
+}
+
+static void printJson(const ErrorMetric& metric, const std::vector<ComparePair>& pairs, const std::vector<CompareResult>& results, double seconds, std::ostream& stream = std::cout)
+{
+    uint32_t passedCount = 0;
+    uint64_t pixelCount = 0;
+
+    stream << "{" << std::endl;
+    stream << "  \"metric\": " << toJsonString(metric.name) << "," << std::endl;
+    stream << "  \"images\": [";
+    for (size_t i = 0; i < pairs.size(); ++i)
+    {
+        const auto& pair = pairs[i];
+        const auto& result = results[i];
+        if (result.passed) passedCount++;
+        pixelCount += result.pixelCount;
+
+        stream << (i > 0 ? "," : "") << std::endl;
+        stream << "    { ";
+        stream << "\"name\": " << toJsonString(pair.name) << ", ";
+        stream << "\"imageA\": " << toJsonString(pair.filenameA) << ", ";
+        stream << "\"imageB\": " << toJsonString(pair.filenameB) << ", ";
+        stream << "\"error\": " << (result.compared ? toJsonNumber(result.error) : "null") << ", ";
+        stream << "\"threshold\": " << toJsonNumber(pair.threshold) << ", ";
+        stream << "\"passed\": " << (result.passed ? "true" : "false") << ", ";
+        stream << "\"earlyOut\": " << (result.earlyOut ? "true" : "false") << ", ";
+        stream << "\"message\": " << toJsonString(result.message);
+        stream << " }";
+    }
+    stream << std::endl << "  ]," << std::endl;
+    stream << "  \"passed\": " << passedCount << "," << std::endl;
+    stream << "  \"failed\": " << pairs.size() - passedCount << "," << std::endl;
+    stream << "  \"seconds\": " << toJsonNumber(seconds) << "," << std::endl;
+    stream << "  \"megapixelsPerSecond\": " << toJsonNumber(seconds > 0.0 ? pixelCount / seconds * 1e-6 : 0.0) << std::endl;
+    stream << "}" << std::endl;
+}
+
+static void printResults(const std::vector<ComparePair>& pairs, const std::vector<CompareResult>& results, double seconds, std::ostream& stream = std::cout)
+{
+    uint32_t passedCount = 0;
+    uint64_t pixelCount = 0;
+
+    for (size_t i = 0; i < pairs.size(); ++i)
+    {
+        const auto& result = results[i];
+        if (result.passed) passedCount++;
+        pixelCount += result.pixelCount;
+
+        stream << (result.passed ? "PASSED " : "FAILED ") << pairs[i].name;
+        if (result.compared) stream << " " << result.error << (result.earlyOut ? " (early out, lower bound)" : "");
+        if (!result.message.empty()) stream << " " << result.message;
+        stream << std::endl;
+    }
+
+    stream << "Compared " << pairs.size() << " image pairs: " << passedCount << " passed, " << pairs.size() - passedCount << " failed";
+    stream << " (" << seconds << " s, " << (seconds > 0.0 ? pixelCount / seconds * 1e-6 : 0.0) << " MPixel/s)." << std::endl;
+}
+
+/** Measures the throughput of the error metrics on synthetic 4K images, excluding image loading.
+*/
+static void runBenchmark(const std::vector<ErrorMetric>& metrics, uint32_t threadCount)
+{
+    const uint32_t kWidth = 3840;
+    const uint32_t kHeight = 2160;
+    const uint32_t kIterations = 10;
+
+    auto imageA = Image::create(kWidth, kHeight);
+    auto imageB = Image::create(kWidth, kHeight);
+    uint32_t state = 1;
+    auto random = [&state] () { state = state * 1664525u + 1013904223u; return float(state >> 8) / float(1 << 24); };
+    for (size_t i = 0; i < size_t(kWidth) * kHeight * 4; ++i)
+    {
+        imageA->getData()[i] = random();
+        imageB->getData()[i] = imageA->getData()[i] + 0.01f * (random() - 0.5f);
+    }
+
+    std::cout << "Comparing " << kWidth << "x" << kHeight << " images, best of " << kIterations << " iterations." << std::endl;
+
+    std::vector<uint32_t> threadCounts = { 1 };
+    if (threadCount > 1) threadCounts.push_back(threadCount);
+
+    for (const auto& metric : metrics)
+    {
+        for (uint32_t threads : threadCounts)
+        {
+            CompareOptions options;
+            options.threadCount = threads;
+
+            double bestTime = std::numeric_limits<double>::infinity();
+            double error = 0.0;
+            for (uint32_t i = 0; i < kIterations; ++i)
+            {
+                auto startTime = std::chrono::high_resolution_clock::now();
+                error = compareTiles(metric, *imageA, *imageB, 0.0, options, nullptr).error;
+                bestTime = std::min(bestTime, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count());
+            }
+
+            double pixelCount = double(kWidth) * kHeight;
+            std::cout << "  " << metric.name << ", " << threads << " thread(s): " << bestTime * 1e3 << " ms, ";
+            std::cout << pixelCount / bestTime * 1e-6 << " MPixel/s, " << 2 * pixelCount * 4 * sizeof(float) / bestTime * 1e-9 << " GB/s (error " << error << ")" << std::endl;
+        }
+    }
 }
 
 static void printMetrics(std::ostream &stream = std::cout)
@@ -344,9 +747,15 @@ int main(int argc, char** argv)
     args::ValueFlag<std::string> metricFlag(parser, "metric", "The error metric.", {'m'});
     args::ValueFlag<float> thresholdFlag(parser, "threshold", "The error threshold.", {'t'});
     args::Flag alphaFlag(parser, "", "Include alpha channel.", {'a'});
-    args::ValueFlag<std::string> heatMapFlag(parser, "filename", "Generate error heat map.", {'e'});
-    args::Positional<std::string> image1(parser, "image1", "The first image.", args::Options::Required);
-    args::Positional<std::string> image2(parser, "image2", "The second image.", args::Options::Required);
+    args::ValueFlag<std::string> heatMapFlag(parser, "filename", "Generate error heat map. In batch mode, this is a suffix appended to the second image's filename.", {'e'});
+    args::Flag batchFlag(parser, "", "Compare all images in directory image1 with the images at the same relative paths in directory image2.", {'b', "batch"});
+    args::ValueFlag<std::string> manifestFlag(parser, "filename", "Compare the image pairs listed in a manifest file. Each line contains 'image1 image2 [threshold]'.", {"manifest"});
+    args::ValueFlag<uint32_t> threadsFlag(parser, "count", "Number of threads (default: number of hardware threads).", {'j', "threads"});
+    args::Flag earlyOutFlag(parser, "", "Stop comparing as soon as the error exceeds the threshold. The reported error is then a lower bound.", {"early-out"});
+    args::Flag jsonFlag(parser, "", "Print results in JSON format.", {"json"});
+    args::Flag benchmarkFlag(parser, "", "Measure the throughput of the error metrics on synthetic images.", {"benchmark"});
+    args::Positional<std::string> image1(parser, "image1", "The first image (or directory in batch mode).");
+    args::Positional<std::string> image2(parser, "image2", "The second image (or directory in batch mode).");
     args::CompletionFlag completionFlag(parser, {"complete"});
 
     try
@@ -396,12 +805,61 @@ int main(int argc, char** argv)
         metric = *it;
     }
 
-    return compareImages(
-        args::get(image1),
-        args::get(image2),
-        metric,
-        thresholdFlag ? args::get(thresholdFlag) : 0.f,
-        alphaFlag ? args::get(alphaFlag) : false,
-        heatMapFlag ? args::get(heatMapFlag) : ""
-    ) ? 0 : 1;
+    uint32_t threadCount = threadsFlag ? args::get(threadsFlag) : std::thread::hardware_concurrency();
+    threadCount = std::max(1u, threadCount);
+
+    if (benchmarkFlag)
+    {
+        runBenchmark(metricFlag ? std::vector<ErrorMetric>{ metric } : errorMetrics, threadCount);
+        return 0;
+    }
+
+    if (!manifestFlag && (!image1 || !image2))
+    {
+        std::cerr << "Two images are required." << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    double threshold = thresholdFlag ? args::get(thresholdFlag) : 0.f;
+    std::string heatMap = heatMapFlag ? args::get(heatMapFlag) : "";
+    bool batch = batchFlag || manifestFlag;
+
+    std::vector<ComparePair> pairs;
+    try
+    {
+        if (manifestFlag) pairs = readManifest(args::get(manifestFlag), threshold, heatMap);
+        else if (batchFlag) pairs = collectDirectoryPairs(args::get(image1), args::get(image2), threshold, heatMap);
+        else pairs.push_back({ args::get(image1), args::get(image1), args::get(image2), threshold, heatMap });
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    CompareOptions options;
+    options.alpha = alphaFlag;
+    options.earlyOut = earlyOutFlag;
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    auto results = comparePairs(pairs, metric, options, threadCount);
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+    if (jsonFlag)
+    {
+        printJson(metric, pairs, results, seconds);
+    }
+    else if (batch)
+    {
+        printResults(pairs, results, seconds);
+    }
+    else
+    {
+        if (!results[0].message.empty()) std::cerr << results[0].message << std::endl;
+        if (results[0].compared) std::cout << results[0].error << std::endl;
+    }
+
+    bool passed = std::all_of(results.begin(), results.end(), [] (const CompareResult& result) { return result.passed; });
+    return passed ? 0 : 1;
 }
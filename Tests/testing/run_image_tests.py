@@ -11,6 +11,7 @@ import datetime
 import argparse
 import subprocess
 import shutil
+import tempfile
 from pathlib import Path
 from enum import Enum
 
@@ -163,18 +164,34 @@ class Test:
 
         return Test.Result.PASSED, []
 
-    def compare_image(self, ref_file, result_file, error_file, tolerance, image_compare_exe):
+    def compare_image_pairs(self, pairs, tolerance, image_compare_exe):
         '''
-        Compare two images using ImageCompare.
-        Returns a tuple containing the a boolean to indicate success and the measured error.
+        Compare a list of (reference, result) image pairs using a single ImageCompare batch run.
+        Error heat maps are written next to the result images.
+        Returns a list of tuples containing a boolean to indicate success and the measured error,
+        or None and a list of error messages if ImageCompare failed.
         '''
-        args = [str(image_compare_exe), '-m', 'mse', '-t', str(tolerance), str(ref_file), str(result_file)]
-        if error_file:
-            args += ['-e', str(error_file)]
-        process = subprocess.Popen(args, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
-        output = process.communicate()[0]
-        error = float(output.strip())
-        return process.returncode == 0, error
+        with tempfile.TemporaryDirectory() as temp_dir:
+            manifest_file = Path(temp_dir) / 'manifest.txt'
+            with open(manifest_file, 'w') as f:
+                for ref_file, result_file in pairs:
+                    f.write(f'{ref_file.resolve()}\t{result_file.resolve()}\n')
+            args = [str(image_compare_exe), '-m', 'mse', '-t', str(tolerance), '-e', config.ERROR_IMAGE_SUFFIX, '--manifest', str(manifest_file), '--json']
+            process = subprocess.Popen(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+            output, errs = process.communicate()
+
+        # ImageCompare returns 1 if any image exceeds the tolerance, and still writes the report in that case.
+        errors = list(map(lambda l: l.rstrip(), errs.decode('utf-8').splitlines()))
+        if process.returncode not in [0, 1]:
+            return None, errors + [f'{image_compare_exe} exited with return code {process.returncode}']
+        try:
+            report = json.loads(output)
+            results = [(image['passed'], image['error']) for image in report['images']]
+        except (ValueError, KeyError, TypeError):
+            return None, errors + [f'{image_compare_exe} did not write a valid report (return code {process.returncode})']
+        if len(results) != len(pairs):
+            return None, errors + [f'{image_compare_exe} reported {len(results)} results for {len(pairs)} images']
+        return results, []
 
     def compare_images(self, ref_dir, result_dir, image_compare_exe):
         '''
@@ -208,27 +225,29 @@ class Test:
         messages = []
         image_reports = []
 
-        # Compare every result image with the corresponding reference image and report missing references.
+        # Report result images with no corresponding reference image.
         for image in result_images:
             if not image in ref_images:
                 result = Test.Result.FAILED
                 messages.append(f'Test has generated image "{image}" with no corresponding reference image.')
-                continue
 
-            ref_file = ref_dir / image
-            result_file = result_dir / image
-            error_file = result_dir / (str(image) + config.ERROR_IMAGE_SUFFIX)
-            compare_success, compare_error = self.compare_image(ref_file, result_file, error_file, self.tolerance, image_compare_exe)
-            if not compare_success:
-                result = Test.Result.FAILED
-                messages.append(f'Test image "{image}" failed with error {compare_error}.')
-
-            image_reports.append({
-                'name': str(image),
-                'success': compare_success,
-                'error': compare_error,
-                'tolerance': self.tolerance
-            })
+        # Compare every result image with the corresponding reference image.
+        images = [image for image in result_images if image in ref_images]
+        if len(images) > 0:
+            compare_results, compare_errors = self.compare_image_pairs([(ref_dir / image, result_dir / image) for image in images], self.tolerance, image_compare_exe)
+            if compare_results is None:
+                return Test.Result.FAILED, messages + compare_errors, image_reports
+            for image, (compare_success, compare_error) in zip(images, compare_results):
+                if not compare_success:
+                    result = Test.Result.FAILED
+                    messages.append(f'Test image "{image}" failed with error {compare_error}.')
+
+                image_reports.append({
+                    'name': str(image),
+                    'success': compare_success,
+                    'error': compare_error,
+                    'tolerance': self.tolerance
+                })
 
         # Report missing result images for existing reference images.
         for image in ref_images: